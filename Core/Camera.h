@@ -30,6 +30,8 @@ public:
 	float aspectRatio = 1.333f;
 
 	void setFOVh(const float& deg) { vFOV = (float)Transform::degToRad((float)deg); }
+	// converts radius / distance into the projected size as a fraction of the screen height
+	float getProjectedSizeScale() const { return 1.f / tan(vFOV / 2.f); }
 
 	glm::mat4 getProjectionMatrix_legacy() 
 	{
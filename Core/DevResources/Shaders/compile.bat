@@ -0,0 +1,10 @@
+@echo off
+rem compiles the shaders the engine loads to SPIR-V next to their sources, glslc comes with the Vulkan SDK
+cd /d "%~dp0"
+
+glslc shader.vert -o shader.vert.spv || exit /b 1
+rem VertexFormat::Packed and PackedColor, used when renderSettings.meshVertexFormat is not Float
+glslc -DPACKED_VERTEX shader.vert -o shader_packed.vert.spv || exit /b 1
+glslc shader.frag -o shader.frag.spv || exit /b 1
+glslc sky.vert -o sky.vert.spv || exit /b 1
+glslc sky.frag -o sky.frag.spv || exit /b 1
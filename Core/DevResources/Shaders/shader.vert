@@ -1,10 +1,20 @@
 #version 450
 #extension GL_EXT_scalar_block_layout: require
 // vertex inputs
+#ifdef PACKED_VERTEX
+// compile with -DPACKED_VERTEX (shader_packed.vert.spv, see compile.bat) for VertexFormat::Packed and PackedColor
+// position is quantized to the mesh bounds, push.transform decodes it
+layout(location = 0) in vec4 position;
+layout(location = 2) in vec2 normalOct;
+layout(location = 3) in vec2 uv;
+#else
 layout(location = 0) in vec4 position;
 layout(location = 1) in vec3 color;
 layout(location = 2) in vec3 normal;
 layout(location = 3) in vec2 uv;
+#endif
+// per-instance inputs (binding 1)
+layout(location = 4) in mat4 instanceModel;
 // outputs to fragment shader
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec3 fragPositionWS;
@@ -32,11 +42,27 @@ layout(push_constant) uniform Push
 	mat4 normalMatrix;
 } push;
 
+#ifdef PACKED_VERTEX
+vec3 octDecode(vec2 e)
+{
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  float t = max(-n.z, 0.0);
+  n.x += n.x >= 0.0 ? -t : t;
+  n.y += n.y >= 0.0 ? -t : t;
+  return normalize(n);
+}
+#endif
+
 void main()
 {
-  gl_Position = ubo1.projectionViewMatrix * push.transform * position;
-  fragNormalWS = normalize(mat3(push.normalMatrix) * normal);
-  fragPositionWS = vec4(push.transform * position).xyz;
+#ifdef PACKED_VERTEX
+  vec3 normal = octDecode(normalOct);
+#endif
+  // push.transform is mesh-local, the world transform comes from the instance
+  vec4 positionWS = instanceModel * push.transform * position;
+  gl_Position = ubo1.projectionViewMatrix * positionWS;
+  fragNormalWS = normalize(mat3(instanceModel) * mat3(push.normalMatrix) * normal);
+  fragPositionWS = positionWS.xyz;
   fragColor = vec3(0.8, 0.6, 0.6); // use fixed value instead of vertex color
   fragUV = uv;
 }
\ No newline at end of file
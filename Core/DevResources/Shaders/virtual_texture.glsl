@@ -0,0 +1,76 @@
+// virtual texture sampling and feedback, see VirtualTexture, include with GL_GOOGLE_include_directive
+// the including shader may define VT_SET before the include, the set layout is VirtualTexture::getDescriptorSetLayout
+#ifndef VT_SET
+#define VT_SET 1
+#endif
+
+// one entry per tile of every level: slot x (bits 0-7), slot y (8-15), level of the mapped tile (16-23)
+layout(std430, set = VT_SET, binding = 0) readonly buffer VTPageTable { uint entries[]; } vtPageTable;
+layout(set = VT_SET, binding = 1) uniform sampler2D vtAtlas;
+// one entry per 8x8 block of pixels, tile id + 1, read back by the host
+layout(std430, set = VT_SET, binding = 2) buffer VTFeedback
+{
+	uvec2 blocks;
+	uvec2 jitter; // pixel of each block that writes this frame
+	uint entries[];
+} vtFeedback;
+layout(std140, set = VT_SET, binding = 3) uniform VTParameters
+{
+	uvec4 size; // width, height, tile size, border
+	uvec4 atlas; // level count, slots x, slots y, slot side
+	uvec4 levels[16]; // tiles x, tiles y, first tile
+} vtParams;
+
+// texel position within a level, levels are half the size of the one before, the last texel of odd sizes is dropped
+vec2 vtLevelTexel(vec2 uv, uint level)
+{
+	uvec2 levelSize = max(vtParams.size.xy >> level, uvec2(1));
+	return min(uv * vec2(vtParams.size.xy) / float(1u << level), vec2(levelSize));
+}
+
+uvec2 vtTileOf(vec2 texel, uint level)
+{
+	return min(uvec2(texel / float(vtParams.size.z)), vtParams.levels[level].xy - 1u);
+}
+
+// level the hardware would pick for the full resolution texture
+uint vtDesiredLevel(vec2 uv)
+{
+	vec2 texel = uv * vec2(vtParams.size.xy);
+	vec2 dx = dFdx(texel);
+	vec2 dy = dFdy(texel);
+	float lod = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1.0));
+	return min(uint(lod), vtParams.atlas.x - 1u);
+}
+
+// records the tile at the desired level for the host, only one pixel of each block writes per frame
+void vtRecordFeedback(vec2 uv, uint level)
+{
+	uvec2 pixel = uvec2(gl_FragCoord.xy);
+	if (any(notEqual(pixel & 7u, vtFeedback.jitter))) { return; }
+	uvec2 block = pixel >> 3;
+	if (any(greaterThanEqual(block, vtFeedback.blocks))) { return; }
+	uvec2 tile = vtTileOf(vtLevelTexel(uv, level), level);
+	vtFeedback.entries[block.y * vtFeedback.blocks.x + block.x] = ((level << 28) | (tile.y << 14) | tile.x) + 1u;
+}
+
+/*	samples the finest resident tile covering uv at or above the desired level (bilinear within that level),
+	uv is clamped to the texture, the feedback write lets the host stream in the tile that was actually wanted */
+vec4 vtSample(vec2 uv)
+{
+	uv = clamp(uv, vec2(0.0), vec2(1.0));
+	uint level = vtDesiredLevel(uv);
+	vtRecordFeedback(uv, level);
+
+	uvec2 tile = vtTileOf(vtLevelTexel(uv, level), level);
+	uint entry = vtPageTable.entries[vtParams.levels[level].z + tile.y * vtParams.levels[level].x + tile.x];
+	uvec2 slot = uvec2(entry & 0xFFu, (entry >> 8) & 0xFFu);
+	uint mapped = (entry >> 16) & 0xFFu;
+
+	// position within the mapped tile, the border keeps the bilinear footprint inside the slot
+	vec2 texel = vtLevelTexel(uv, mapped);
+	vec2 local = texel - vec2(vtTileOf(texel, mapped) * vtParams.size.z);
+	vec2 atlasTexel = vec2(slot * vtParams.atlas.w) + float(vtParams.size.w) + local;
+	vec2 atlasSize = vec2(vtParams.atlas.yz * vtParams.atlas.w);
+	return textureLod(vtAtlas, atlasTexel / atlasSize, 0.0);
+}
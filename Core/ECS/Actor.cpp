@@ -8,6 +8,12 @@ namespace ECS
 	Actor::~Actor()
 	{}
 
+	BoundingBox Actor::getBounds() const
+	{
+		const Vec& p = transform.get().translation;
+		return BoundingBox(p, p);
+	}
+
 	void Actor::registerComponent(ActorComponent* component)
 	{
 		if (component->getParentActor() == this) { return; }
@@ -28,8 +34,9 @@ namespace ECS
 	{
 		// internal version of unregisterComponent, this one assumes index is valid
 		if (setNullParent) { components[i]->parentActor = nullptr; }
-		components.erase(std::next(components.begin(), i));
-		components.shrink_to_fit();
+		// swap with the last entry, component order is not preserved (see declaration)
+		components[i] = components.back();
+		components.pop_back();
 	}
 
 	void Actor::destroyComponent(ActorComponent* component)
@@ -50,10 +57,9 @@ namespace ECS
 		if (i >= 0) { unregisterComponent_internal(i, true); }
 	}
 
-	uint32_t Actor::findComponent(ActorComponent* childComponent)
+	int32_t Actor::findComponent(ActorComponent* childComponent) const
 	{
-		if (components.empty()) { return -1; }
-		for (uint32_t i = 0; i < components.size(); i++)
+		for (int32_t i = 0; i < (int32_t)components.size(); i++)
 		{ if (components[i] == childComponent) { return i; } }
 		return -1;
 	}
@@ -20,6 +20,9 @@ namespace ECS
 
 		ActorTransform transform;
 
+		// actors without a spatial shape are treated as a point at their location
+		BoundingBox getBounds() const override;
+
 		/* keeps track of all the components registered to this actor, may not preserve indices */
 		std::vector<ActorComponent*> components;
 
@@ -40,7 +43,7 @@ namespace ECS
 		bool hasTickEnabled = false;
 
 		// returns index (temporary) if found, -1 otherwise
-		uint32_t findComponent(ActorComponent* childComponent);
+		int32_t findComponent(ActorComponent* childComponent) const;
 		
 
 	};
@@ -1,30 +1,33 @@
 #include "Core/ECS/Primitive.h"
+#include "Core/Types/Math.h"
+#include "Core/Mesh/ObjParser.h"
 // std
 #include <cassert>
 #include <cstring>
-
-#define TINYOBJLOADER_IMPLEMENTATION // mesh file loader
-#include "ThirdParty/tiny_obj_loader.h"
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
 
 namespace ECS 
 {
-	Primitive::Primitive(EngineCore::EngineDevice& device, const MeshBuilder& builder) : engineDevice{ device }
-	{
-		createVertexBuffers(builder.vertices);
-		createIndexBuffers(builder.indices);
-	}
+	Primitive::Primitive(EngineCore::EngineDevice& device, const MeshBuilder& builder)
+		: geometry{ createGeometry(device, builder.vertices, builder.indices, EngineCore::VertexFormat::Float, builder.lods) }
+	{}
 
-	Primitive::Primitive(EngineCore::EngineDevice& device, const std::vector<Vertex>& vertices) : engineDevice{ device }
-	{
-		createVertexBuffers(vertices);
-	}
+	Primitive::Primitive(EngineCore::EngineDevice& device, const std::vector<Vertex>& vertices)
+		: geometry{ createGeometry(device, vertices, {}) }
+	{}
 
-	Primitive::Primitive(EngineCore::EngineDevice& device) : engineDevice{ device }
+	Primitive::Primitive(EngineCore::EngineDevice& device)
 	{
 		Primitive::MeshBuilder builder{};
 		builder.makeCubeMesh();
-		createVertexBuffers(builder.vertices);
-		createIndexBuffers(builder.indices);
+		geometry = createGeometry(device, builder.vertices, builder.indices);
+	}
+
+	Primitive::Primitive(std::shared_ptr<const EngineCore::MeshGeometry> sharedGeometry) : geometry{ std::move(sharedGeometry) }
+	{
+		assert(geometry && "cannot create primitive from null geometry");
 	}
 
 	Primitive::~Primitive()
@@ -41,110 +44,211 @@ namespace ECS
 		newMaterial.matUserAdd(); // report use of new material
 	}
 
-	void Primitive::createVertexBuffers(const std::vector<Vertex>& vertices)
+	BoundingBox Primitive::getBounds() const
 	{
-		using namespace EngineCore;
+		// radius of a sphere around the local origin which encloses the mesh at any rotation
+		const BoundingBox& localBounds = getLocalBounds();
+		const Vec c = localBounds.getCenter();
+		const Vec h = localBounds.getHalfExtent();
+		const float radius = std::sqrt(Vec::dot(c, c)) + std::sqrt(Vec::dot(h, h));
+		const Transform& t = transform.get();
+		const float scale = std::max(std::max(std::abs(t.scale.x), std::abs(t.scale.y)), std::abs(t.scale.z));
+		return BoundingBox::fromCenterExtent(t.translation, Vec(radius * scale));
+	}
 
-		vertexCount = static_cast<uint32_t>(vertices.size());
-		assert(vertexCount >= 3 && "vertexCount cannot be below 3");
-		VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
-		uint32_t vertexSize = sizeof(vertices[0]);
-		// temporary buffer to transfer from CPU (host) to GPU (device)
-		GBuffer stagingBuffer
-		{
-			engineDevice, vertexSize, vertexCount,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-		};
-		stagingBuffer.map();
-		stagingBuffer.writeToBuffer((void*)vertices.data()); // write vertices
+	std::shared_ptr<EngineCore::MeshGeometry> Primitive::createGeometry(EngineCore::EngineDevice& device,
+								const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+								const EngineCore::VertexFormat& format, const std::vector<EngineCore::MeshGeometry::Lod>& lods)
+	{
+		const EncodedVertices encoded = encodeVertices(vertices, format);
+		return std::make_shared<EngineCore::MeshGeometry>(device, encoded.data.data(), encoded.stride,
+									static_cast<uint32_t>(vertices.size()), indices, encoded.bounds, format, encoded.decodeTransform, lods);
+	}
 
-		// destination buffer, GPU only for speed (not host accessible)
-		vertexBuffer = std::make_unique<GBuffer>(engineDevice, vertexSize, vertexCount,
-			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	Primitive::EncodedVertices Primitive::encodeVertices(const std::vector<Vertex>& vertices, const EngineCore::VertexFormat& format)
+	{
+		EncodedVertices encoded{};
+		BoundingBox& bounds = encoded.bounds;
+		bounds = BoundingBox(Vec(std::numeric_limits<float>::max()), Vec(std::numeric_limits<float>::lowest()));
+		for (const auto& v : vertices)
+		{
+			bounds.min = { std::min(bounds.min.x, v.position.x), std::min(bounds.min.y, v.position.y),
+							std::min(bounds.min.z, v.position.z) };
+			bounds.max = { std::max(bounds.max.x, v.position.x), std::max(bounds.max.y, v.position.y),
+							std::max(bounds.max.z, v.position.z) };
+		}
+		encoded.stride = getVertexStride(format);
+		encoded.data.resize(static_cast<size_t>(encoded.stride) * vertices.size());
+		if (format == EngineCore::VertexFormat::Float)
+		{
+			if (!vertices.empty()) { std::memcpy(encoded.data.data(), vertices.data(), encoded.data.size()); }
+			return encoded;
+		}
 
-		engineDevice.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(), bufferSize);
+		// packed formats share a layout, the colorless one just drops the trailing color bytes
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			const PackedVertex p = PackedVertex::pack(vertices[i], bounds);
+			std::memcpy(&encoded.data[i * encoded.stride], &p, encoded.stride);
+		}
+		// maps quantized positions in [-1, 1] back to mesh space
+		const Vec c = bounds.getCenter();
+		const Vec h = bounds.getHalfExtent();
+		glm::mat4& decode = encoded.decodeTransform;
+		decode[0][0] = h.x; decode[1][1] = h.y; decode[2][2] = h.z;
+		decode[3] = glm::vec4{ c.x, c.y, c.z, 1.f };
+		return encoded;
 	}
 
-	void Primitive::createIndexBuffers(const std::vector<uint32_t>& indices)
+	Primitive::PackedVertex Primitive::PackedVertex::pack(const Vertex& v, const BoundingBox& bounds)
 	{
-		using namespace EngineCore;
+		const Vec c = bounds.getCenter();
+		const Vec h = bounds.getHalfExtent();
+		// flat axes quantize to 0
+		auto quantize = [](const float& p, const float& center, const float& half)
+		{ return Math::floatToSnorm16(half > 0.f ? (p - center) / half : 0.f); };
 
-		indexCount = static_cast<uint32_t>(indices.size());
-		hasIndexBuffer = indexCount > 0;
-		if (!hasIndexBuffer) { return; }
-		VkDeviceSize bufferSize = sizeof(indices[0]) * indexCount;
-		uint32_t indexSize = sizeof(indices[0]);
-		// same as for vertex buffer
-		GBuffer stagingBuffer
+		PackedVertex p{};
+		p.position[0] = quantize(v.position.x, c.x, h.x);
+		p.position[1] = quantize(v.position.y, c.y, h.y);
+		p.position[2] = quantize(v.position.z, c.z, h.z);
+		p.position[3] = INT16_MAX;
+		float ox, oy;
+		Math::octEncode(v.normal.x, v.normal.y, v.normal.z, ox, oy);
+		p.normal[0] = Math::floatToSnorm16(ox);
+		p.normal[1] = Math::floatToSnorm16(oy);
+		p.uv[0] = Math::floatToHalf(v.uv.x);
+		p.uv[1] = Math::floatToHalf(v.uv.y);
+		for (uint32_t i = 0; i < 3; i++)
 		{
-			engineDevice, indexSize, indexCount,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-		};
-		stagingBuffer.map();
-		stagingBuffer.writeToBuffer((void*)indices.data());
+			const float channel = std::max(0.f, std::min(1.f, v.color[i]));
+			p.color[i] = static_cast<uint8_t>(std::lround(channel * 255.f));
+		}
+		p.color[3] = UINT8_MAX;
+		return p;
+	}
 
-		indexBuffer = std::make_unique<GBuffer>(engineDevice, indexSize, indexCount,
-			VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT); // note INDEX_BUFFER_BIT
+	uint32_t Primitive::getVertexStride(const EngineCore::VertexFormat& format)
+	{
+		static_assert(sizeof(PackedVertex) == 20, "packed vertex must not contain padding");
+		switch (format)
+		{
+		case EngineCore::VertexFormat::Packed: return static_cast<uint32_t>(offsetof(PackedVertex, color));
+		case EngineCore::VertexFormat::PackedColor: return static_cast<uint32_t>(sizeof(PackedVertex));
+		default: return static_cast<uint32_t>(sizeof(Vertex));
+		}
+	}
 
-		engineDevice.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), bufferSize);
+	void Primitive::MeshBuilder::loadFromFile(const std::string& path)
+	{
+		vertices.clear();
+		indices.clear();
+		lods.clear();
+		EngineCore::ObjParser::parseFile(path, vertices);
+		deduplicateVertices(); // OBJ corners are emitted individually, merge them into an indexed mesh
 	}
 
-	void Primitive::bind(VkCommandBuffer commandBuffer)
+	void Primitive::MeshBuilder::loadFromMemory(const char* data, const size_t& size, EngineCore::JobSystem* jobs)
 	{
-		VkBuffer buffers[] = { vertexBuffer->getBuffer() };
-		VkDeviceSize offsets[] = { 0 };
-		vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
-		if (hasIndexBuffer) { vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32); }
+		vertices.clear();
+		indices.clear();
+		lods.clear();
+		const bool parallel = jobs && size >= EngineCore::ObjParser::PARALLEL_MIN_BYTES;
+		if (!parallel || !EngineCore::ObjParser::parseParallel(data, size, *jobs, vertices))
+		{ EngineCore::ObjParser::parse(data, size, vertices); }
+		deduplicateVertices();
 	}
 
-	void Primitive::draw(VkCommandBuffer commandBuffer)
+	void Primitive::MeshBuilder::deduplicateVertices()
 	{
-		if (hasIndexBuffer) { vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0); }
-		else { vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0); }
+		static_assert(sizeof(Vertex) == sizeof(float) * 11, "vertex must not contain padding, it is hashed bytewise");
+		struct VertexHash
+		{ size_t operator()(const Vertex& v) const { return static_cast<size_t>(Math::fnv1a64(&v, sizeof(Vertex))); } };
+		struct VertexEqual
+		{ bool operator()(const Vertex& a, const Vertex& b) const { return std::memcmp(&a, &b, sizeof(Vertex)) == 0; } };
+
+		sourceVertexCount = static_cast<uint32_t>(vertices.size());
+		if (indices.empty())
+		{
+			indices.resize(vertices.size());
+			for (uint32_t i = 0; i < indices.size(); i++) { indices[i] = i; }
+		}
+
+		std::unordered_map<Vertex, uint32_t, VertexHash, VertexEqual> unique;
+		unique.reserve(vertices.size());
+		std::vector<Vertex> uniqueVertices;
+		uniqueVertices.reserve(vertices.size());
+		// old vertex index -> new vertex index
+		std::vector<uint32_t> remap(vertices.size());
+		for (uint32_t i = 0; i < vertices.size(); i++)
+		{
+			auto result = unique.emplace(vertices[i], static_cast<uint32_t>(uniqueVertices.size()));
+			if (result.second) { uniqueVertices.push_back(vertices[i]); }
+			remap[i] = result.first->second;
+		}
+		for (auto& index : indices) { index = remap[index]; }
+		vertices.swap(uniqueVertices);
 	}
 
-	void Primitive::MeshBuilder::loadFromFile(const std::string& path)
+	Primitive::MeshBuilder::OptimizationReport Primitive::MeshBuilder::optimize()
 	{
-		// TODO: support different mesh formats
-		// OBJ format mesh loader, using TinyObjLoader (for now)
-		tinyobj::attrib_t attrib;
-		std::vector<tinyobj::shape_t> shapes;
-		std::vector<tinyobj::material_t> materials;
-		std::string warn, err;
-		if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str()))
+		using namespace EngineCore;
+		if (indices.empty()) { deduplicateVertices(); }
+		// nothing to reorder, the report stays zeroed
+		if (indices.empty()) { return OptimizationReport{}; }
+		const std::vector<MeshGeometry::Lod> levels = lods.empty()
+			? std::vector<MeshGeometry::Lod>{ { 0, static_cast<uint32_t>(indices.size()), 0.f } } : lods;
+		auto levelIndices = [this](const MeshGeometry::Lod& lod)
+		{ return std::vector<uint32_t>(indices.begin() + lod.firstIndex, indices.begin() + lod.firstIndex + lod.indexCount); };
+
+		OptimizationReport report{};
+		report.before = MeshOptimizer::analyzeVertexCache(levelIndices(levels[0]), static_cast<uint32_t>(vertices.size()));
+
+		// levels are drawn separately, so each one is ordered for the cache on its own
+		for (const auto& lod : levels)
 		{
-			throw std::runtime_error("error loading mesh from file: " + warn + err);
+			std::vector<uint32_t> level = levelIndices(lod);
+			MeshOptimizer::optimizeVertexCache(level, static_cast<uint32_t>(vertices.size()));
+			MeshOptimizer::optimizeOverdraw(level, &vertices.data()->position.x, sizeof(Vertex), static_cast<uint32_t>(vertices.size()));
+			std::copy(level.begin(), level.end(), indices.begin() + lod.firstIndex);
 		}
-		vertices.clear();
-		indices.clear(); // indices = 0 for OBJ format to indicate non-indexed primitive
-		for (const auto& shape : shapes)
+		// level 0 references every vertex first, so its fetch order wins
+		vertices.resize(MeshOptimizer::optimizeVertexFetch(vertices.data(), sizeof(Vertex),
+															static_cast<uint32_t>(vertices.size()), indices));
+
+		report.after = MeshOptimizer::analyzeVertexCache(levelIndices(levels[0]), static_cast<uint32_t>(vertices.size()));
+		return report;
+	}
+
+	void Primitive::MeshBuilder::generateLods(const uint32_t& maxLevels)
+	{
+		using namespace EngineCore;
+		assert(maxLevels <= MeshGeometry::MAX_LODS && "too many levels of detail");
+		if (indices.empty()) { deduplicateVertices(); }
+		lods.clear();
+		if (indices.empty()) { return; }
+		const uint32_t baseCount = static_cast<uint32_t>(indices.size());
+		lods.assign(1, MeshGeometry::Lod{ 0, baseCount, 0.f });
+
+		float previousError = 0.f;
+		for (uint32_t level = 1; level < maxLevels; level++)
 		{
-			for (const auto& index : shape.mesh.indices)
-			{
-				Vertex vert{};
-				if (index.vertex_index >= 0)
-				{
-					vert.position = { attrib.vertices[3 * index.vertex_index],
-									attrib.vertices[3 * index.vertex_index + 1],
-									attrib.vertices[3 * index.vertex_index + 2] };
-				}
-				if (index.normal_index >= 0)
-				{
-					vert.normal = { attrib.normals[3 * index.normal_index],
-									attrib.normals[3 * index.normal_index + 1],
-									attrib.normals[3 * index.normal_index + 2] };
-				}
-				if (index.texcoord_index >= 0)
-				{
-					vert.uv = { attrib.texcoords[2 * index.texcoord_index],
-								1 - attrib.texcoords[2 * index.texcoord_index + 1] };
-				}
-				vertices.push_back(vert); // add vertex
-			}
+			const uint32_t previousCount = lods.back().indexCount;
+			const uint32_t targetCount = previousCount / 6 * 3; // half the triangles
+			if (targetCount < 3) { break; }
+			// simplified from the full mesh every time, so errors do not accumulate over levels
+			std::vector<uint32_t> simplified(indices.begin(), indices.begin() + baseCount);
+			const float error = std::max(previousError, MeshOptimizer::simplify(simplified, &vertices.data()->position.x, sizeof(Vertex),
+															static_cast<uint32_t>(vertices.size()), targetCount, MAX_LOD_ERROR));
+			// not worth a level if the simplifier got stuck on seams or borders
+			if (simplified.empty() || simplified.size() > previousCount * 3 / 4) { break; }
+
+			/*	the projected error is about error * screenSize / 2 of the screen height,
+				so the previous level is kept down to the size where this level's error becomes visible */
+			lods.back().screenSize = error > 0.f ? 2.f * LOD_SCREEN_ERROR / error : std::numeric_limits<float>::max();
+			lods.push_back(MeshGeometry::Lod{ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(simplified.size()), 0.f });
+			indices.insert(indices.end(), simplified.begin(), simplified.end());
+			previousError = error;
 		}
 	}
 
@@ -189,20 +293,24 @@ namespace ECS
 		};
 		indices = { 0,  1,  2,  0,  3,  1,  4,  5,  6,  4,  7,  5,  8,  9,  10, 8,  11, 9,
 								12, 13, 14, 12, 15, 13, 16, 17, 18, 16, 19, 17, 20, 21, 22, 20, 23, 21 };
+		lods.clear();
 	}
 
 	std::vector<VkVertexInputBindingDescription> Primitive::Vertex::getBindingDescriptions()
 	{
-		std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+		std::vector<VkVertexInputBindingDescription> bindingDescriptions(2);
 		bindingDescriptions[0].binding = 0;
 		bindingDescriptions[0].stride = sizeof(Vertex);
 		bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		bindingDescriptions[1].binding = INSTANCE_BINDING;
+		bindingDescriptions[1].stride = sizeof(InstanceData);
+		bindingDescriptions[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
 		return bindingDescriptions;
 	}
 
 	std::vector<VkVertexInputAttributeDescription> Primitive::Vertex::getAttributeDescriptions()
 	{
-		return
+		std::vector<VkVertexInputAttributeDescription> attributes
 		{
 			// location, binding, format, offset
 			{ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, position) },
@@ -210,6 +318,42 @@ namespace ECS
 			{ 2, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, normal) },
 			{ 3, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, uv) }
 		};
+		appendInstanceAttributes(attributes);
+		return attributes;
+	}
+
+	std::vector<VkVertexInputBindingDescription> Primitive::PackedVertex::getBindingDescriptions(const EngineCore::VertexFormat& format)
+	{
+		assert(format != EngineCore::VertexFormat::Float && "not a packed vertex format");
+		std::vector<VkVertexInputBindingDescription> bindingDescriptions = Vertex::getBindingDescriptions();
+		bindingDescriptions[0].stride = getVertexStride(format);
+		return bindingDescriptions;
+	}
+
+	std::vector<VkVertexInputAttributeDescription> Primitive::PackedVertex::getAttributeDescriptions(const EngineCore::VertexFormat& format)
+	{
+		assert(format != EngineCore::VertexFormat::Float && "not a packed vertex format");
+		std::vector<VkVertexInputAttributeDescription> attributes
+		{
+			// location, binding, format, offset
+			{ 0, 0, VK_FORMAT_R16G16B16A16_SNORM, offsetof(PackedVertex, position) },
+			{ 2, 0, VK_FORMAT_R16G16_SNORM, offsetof(PackedVertex, normal) },
+			{ 3, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(PackedVertex, uv) }
+		};
+		if (format == EngineCore::VertexFormat::PackedColor)
+		{ attributes.push_back({ 1, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(PackedVertex, color) }); }
+		appendInstanceAttributes(attributes);
+		return attributes;
+	}
+
+	void Primitive::appendInstanceAttributes(std::vector<VkVertexInputAttributeDescription>& attributes)
+	{
+		// instance model matrix, one location per column
+		for (uint32_t column = 0; column < 4; column++)
+		{
+			attributes.push_back({ 4 + column, INSTANCE_BINDING, VK_FORMAT_R32G32B32A32_SFLOAT,
+									static_cast<uint32_t>(offsetof(InstanceData, model) + sizeof(glm::vec4) * column) });
+		}
 	}
 
 } // namespace
\ No newline at end of file
@@ -2,8 +2,12 @@
 
 #include "Core/GPU/engine_device.h"
 #include "Core/GPU/Memory/Buffer.h"
+#include "Core/GPU/MeshGeometry.h"
+#include "Core/GPU/VertexFormat.h"
+#include "Core/Mesh/MeshOptimizer.h"
 #include "Core/ECS/ActorComponent.h"
 #include "Core/GPU/Material.h"
+#include "Core/WorldSector.h"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -14,12 +18,16 @@
 #include <stdexcept>
 #include <memory>
 
+namespace EngineCore { class JobSystem; }
+
 namespace ECS 
 {
-	class Primitive
+	class Primitive : public World::PhysicalElementInterface
 	{
-		Transform transform{}; // TODO: primitive should not have its own transform, 
+		ActorTransform transform{}; // TODO: primitive should not have its own transform, 
 		// instead, getTransform() should be overloaded on components that inherit from Primitive - also remove setTransform()!
+		// cached result of transform.get().mat4(), rebuilt in batches when the transform was updated
+		glm::mat4 worldMatrix{ 1.f };
 	public:
 		struct Vertex
 		{
@@ -27,31 +35,93 @@ namespace ECS
 			glm::vec3 color{};
 			glm::vec3 normal{};
 			glm::vec2 uv{};
-			// binding/attribute descriptions are read by the pipeline
+			/*	binding/attribute descriptions are read by the pipeline,
+				binding 0 is per-vertex, binding 1 is per-instance and holds an InstanceData */
 			static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
 			static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
 		};
 
+		/*	compact vertex for the packed vertex formats (see EngineCore::VertexFormat),
+			positions are quantized to the mesh bounds and decoded by MeshGeometry::getVertexDecodeTransform,
+			VertexFormat::Packed stores the first 16 bytes only (no color) */
+		struct PackedVertex
+		{
+			int16_t position[4]{}; // snorm, w is always 1
+			int16_t normal[2]{}; // snorm, octahedral encoding
+			uint16_t uv[2]{}; // half precision
+			uint8_t color[4]{}; // unorm
+			static PackedVertex pack(const Vertex& v, const BoundingBox& bounds);
+			// binding/attribute descriptions of a packed format, same locations and bindings as Vertex
+			static std::vector<VkVertexInputBindingDescription> getBindingDescriptions(const EngineCore::VertexFormat& format);
+			static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions(const EngineCore::VertexFormat& format);
+		};
+		static uint32_t getVertexStride(const EngineCore::VertexFormat& format);
+
+		// per-instance vertex input (binding 1), occupies 4 attribute locations
+		struct InstanceData
+		{
+			glm::mat4 model{ 1.f };
+		};
+		static constexpr uint32_t INSTANCE_BINDING = 1;
+
 		struct MeshBuilder
 		{
 			std::vector<Vertex> vertices{};
 			std::vector<uint32_t> indices{};
 			void makeCubeMesh();
 			void loadFromFile(const std::string& path);
+			/*	parses OBJ file contents which have already been read into memory,
+				large inputs are parsed on all job threads if a job system is given */
+			void loadFromMemory(const char* data, const size_t& size, EngineCore::JobSystem* jobs = nullptr);
+			/*	merges bitwise identical vertices and rewrites the index buffer accordingly,
+				non-indexed input is treated as indexed (0, 1, 2...), so the result is always indexed */
+			void deduplicateVertices();
+			// vertex count before the last deduplication (one vertex per face corner for OBJ files)
+			uint32_t sourceVertexCount = 0;
+
+			struct OptimizationReport
+			{
+				EngineCore::MeshOptimizer::VertexCacheStats before;
+				EngineCore::MeshOptimizer::VertexCacheStats after;
+			};
+			/*	optional, reorders triangles for vertex cache locality and overdraw, then vertices for fetch locality,
+				non-indexed input is indexed first (see deduplicateVertices), deterministic,
+				every level of detail is reordered on its own, the report covers level 0, empty meshes are left as they are */
+			OptimizationReport optimize();
+
+			/*	index ranges of the levels of detail, empty means the whole index buffer is a single level,
+				see MeshGeometry::Lod */
+			std::vector<EngineCore::MeshGeometry::Lod> lods{};
+			/*	simplifies the mesh (see MeshOptimizer::simplify) into up to maxLevels levels of detail in total,
+				each with about half the triangles of the previous one, the simplified index ranges are appended to indices,
+				stops early once a level cannot be reduced any further within MAX_LOD_ERROR,
+				screen size thresholds are chosen so the simplification error stays below LOD_SCREEN_ERROR */
+			void generateLods(const uint32_t& maxLevels);
+			// largest simplification error of a level, relative to the mesh bounding sphere radius
+			static constexpr float MAX_LOD_ERROR = 0.25f;
+			// tolerated simplification error on screen, as a fraction of the screen height (about a pixel at 1080p)
+			static constexpr float LOD_SCREEN_ERROR = 1.f / 1000.f;
 		};
 
 		Primitive(EngineCore::EngineDevice& engineDevice, const MeshBuilder& builder);
 		Primitive(EngineCore::EngineDevice& engineDevice, const std::vector<Vertex>& vertices);
 		Primitive(EngineCore::EngineDevice& engineDevice);
+		// shares existing geometry, nothing is uploaded
+		Primitive(std::shared_ptr<const EngineCore::MeshGeometry> sharedGeometry);
 		~Primitive();
 
 		Primitive(const Primitive&) = delete;
 		Primitive& operator=(const Primitive&) = delete;
 
 		// binds the primitive's vertices to a command buffer (preparation to render)
-		void bind(VkCommandBuffer commandBuffer);
+		void bind(VkCommandBuffer commandBuffer) { geometry->bind(commandBuffer); }
 		// records a draw call to the command buffer (final step to render mesh)
-		void draw(VkCommandBuffer commandBuffer);
+		void draw(VkCommandBuffer commandBuffer, const uint32_t& instanceCount = 1, const uint32_t& firstInstance = 0,
+				const uint32_t& lod = 0)
+		{ geometry->draw(commandBuffer, instanceCount, firstInstance, lod); }
+		// identifies the bound geometry, used to skip redundant binds and to group instances
+		VkBuffer getVertexBufferHandle() const { return geometry->getVertexBufferHandle(); }
+		const std::shared_ptr<const EngineCore::MeshGeometry>& getGeometry() const { return geometry; }
 
 		// apply a new material (reports one user removed from previous material)
 		void setMaterial(const EngineCore::MaterialHandle& newMaterial);
@@ -59,22 +129,42 @@ namespace ECS
 
 		bool useFakeScale = false; //TODO: TMP - FakeScaleTest082
 
-		Transform& getTransform() { return transform; } // this should be changed to virtual, returning const
-		void setTransform(const Transform& t) { transform = t; }
-
-	private:
-		void createVertexBuffers(const std::vector<Vertex>& vertices);
-		void createIndexBuffers(const std::vector<uint32_t>& indices);
-
-		EngineCore::EngineDevice& engineDevice;
-
-		std::unique_ptr<EngineCore::GBuffer> vertexBuffer;
-		uint32_t vertexCount;
+		const Transform& getTransform() const { return transform.get(); }
+		// marks the world matrix as outdated and reports the new location to the octree (if any)
+		void setTransform(const Transform& t) { transform.set(t); reportPositionUpdated(); }
+		// marks the world matrix as outdated, the bounds do not depend on rotation so the octree is not involved
+		void setRotation(const Vec& rotation) { Transform t = transform.get(); t.rotation = rotation; transform.set(t); }
+		bool isWorldMatrixOutdated() const { return transform.wasUpdated(); }
+		const glm::mat4& getWorldMatrix() const { return worldMatrix; }
+		// stores a matrix built from getTransform() (see Math::buildMatrices)
+		void setWorldMatrix(const glm::mat4& m) { worldMatrix = m; transform.resetUpdatedFlag(); }
+
+		// rotation-independent world bounds (a cube enclosing the bounding sphere of the mesh)
+		BoundingBox getBounds() const override;
+		const BoundingBox& getLocalBounds() const { return geometry->getLocalBounds(); }
+
+		// vertices converted to a vertex format, ready for upload
+		struct EncodedVertices
+		{
+			std::vector<uint8_t> data;
+			uint32_t stride = 0;
+			BoundingBox bounds{};
+			// see MeshGeometry::getVertexDecodeTransform
+			glm::mat4 decodeTransform{ 1.f };
+		};
+		static EncodedVertices encodeVertices(const std::vector<Vertex>& vertices, const EngineCore::VertexFormat& format);
 
-		bool hasIndexBuffer = false;
-		std::unique_ptr<EngineCore::GBuffer> indexBuffer;
-		uint32_t indexCount;
+		// uploads the vertices and indices to new device-local geometry, converted to the given vertex format
+		static std::shared_ptr<EngineCore::MeshGeometry> createGeometry(EngineCore::EngineDevice& device,
+										const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+										const EngineCore::VertexFormat& format = EngineCore::VertexFormat::Float,
+										const std::vector<EngineCore::MeshGeometry::Lod>& lods = {});
 
+	private:
+		std::shared_ptr<const EngineCore::MeshGeometry> geometry;
 		EngineCore::MaterialHandle materialHandle{};
+
+		// instance model matrix attributes (locations 4-7), shared by all vertex formats
+		static void appendInstanceAttributes(std::vector<VkVertexInputAttributeDescription>& attributes);
 	};
 } // namespace
\ No newline at end of file
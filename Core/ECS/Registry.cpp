@@ -0,0 +1,40 @@
+#include "Core/ECS/Registry.h"
+
+namespace ECS
+{
+	Entity Registry::create()
+	{
+		uint32_t index;
+		if (!freeIndices.empty())
+		{
+			index = freeIndices.back();
+			freeIndices.pop_back();
+		}
+		else
+		{
+			index = static_cast<uint32_t>(generations.size());
+			generations.push_back(0);
+			alive.push_back(false);
+		}
+		alive[index] = true;
+		numAlive++;
+		return Entity{ index, generations[index] };
+	}
+
+	void Registry::destroy(const Entity& e)
+	{
+		if (!isValid(e)) { return; }
+		for (auto& pool : pools) { if (pool) { pool->remove(e.index); } }
+		alive[e.index] = false;
+		generations[e.index]++; // invalidates all existing handles to this index
+		freeIndices.push_back(e.index);
+		numAlive--;
+	}
+
+	uint32_t Registry::nextTypeId()
+	{
+		static std::atomic<uint32_t> counter{ 0 };
+		return counter++;
+	}
+
+} // namespace
@@ -0,0 +1,195 @@
+#pragma once
+
+// std
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace ECS
+{
+	/*	handle to an entity in a Registry, the generation is bumped every time an index is recycled,
+		so handles to destroyed entities can be detected instead of silently aliasing a new entity */
+	struct Entity
+	{
+		static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+		uint32_t index = INVALID_INDEX;
+		uint32_t generation = 0;
+
+		bool isNull() const { return index == INVALID_INDEX; }
+		friend bool operator==(const Entity& a, const Entity& b) { return a.index == b.index && a.generation == b.generation; }
+		friend bool operator!=(const Entity& a, const Entity& b) { return !(a == b); }
+	};
+
+	// type-erased pool interface, lets the registry strip all components from a destroyed entity
+	class ComponentPoolBase
+	{
+	public:
+		virtual ~ComponentPoolBase() = default;
+		virtual void remove(const uint32_t& entityIndex) = 0;
+		virtual bool has(const uint32_t& entityIndex) const = 0;
+		virtual size_t size() const = 0;
+	};
+
+	/*	sparse set storage for a single component type, components are packed contiguously (dense)
+		and the sparse array maps entity indices to positions in the dense array,
+		removal swaps the last component into the hole, so component order is not preserved */
+	template<typename T>
+	class ComponentPool : public ComponentPoolBase
+	{
+	public:
+		template<typename... Args>
+		T& emplace(const uint32_t& entityIndex, Args&&... args)
+		{
+			assert(!has(entityIndex) && "entity already has a component of this type");
+			if (entityIndex >= sparse.size()) { sparse.resize(entityIndex + 1, Entity::INVALID_INDEX); }
+			sparse[entityIndex] = static_cast<uint32_t>(dense.size());
+			denseEntities.push_back(entityIndex);
+			dense.emplace_back(std::forward<Args>(args)...);
+			return dense.back();
+		}
+
+		void remove(const uint32_t& entityIndex) override
+		{
+			if (!has(entityIndex)) { return; }
+			const uint32_t i = sparse[entityIndex];
+			const uint32_t last = static_cast<uint32_t>(dense.size() - 1);
+			if (i != last)
+			{
+				dense[i] = std::move(dense[last]);
+				denseEntities[i] = denseEntities[last];
+				sparse[denseEntities[i]] = i;
+			}
+			dense.pop_back();
+			denseEntities.pop_back();
+			sparse[entityIndex] = Entity::INVALID_INDEX;
+		}
+
+		bool has(const uint32_t& entityIndex) const override
+		{ return entityIndex < sparse.size() && sparse[entityIndex] != Entity::INVALID_INDEX; }
+		size_t size() const override { return dense.size(); }
+
+		T& get(const uint32_t& entityIndex) { assert(has(entityIndex)); return dense[sparse[entityIndex]]; }
+		T* tryGet(const uint32_t& entityIndex) { return has(entityIndex) ? &dense[sparse[entityIndex]] : nullptr; }
+
+		// packed component data, iterate this directly for linear per-type passes
+		std::vector<T>& data() { return dense; }
+		// entity index owning each element of data()
+		const std::vector<uint32_t>& entities() const { return denseEntities; }
+
+	private:
+		std::vector<uint32_t> sparse;
+		std::vector<uint32_t> denseEntities;
+		std::vector<T> dense;
+	};
+
+	class Registry;
+
+	// iterates all entities that own every component type in Ts, driven by the smallest pool
+	template<typename... Ts>
+	class View
+	{
+	public:
+		View(Registry& r, ComponentPool<Ts>*... p) : registry{ r }, pools{ p... } {};
+
+		// fn(Entity, Ts&...)
+		template<typename F>
+		void each(F&& fn);
+
+	private:
+		Registry& registry;
+		std::tuple<ComponentPool<Ts>*...> pools;
+
+		const ComponentPoolBase* smallestPool() const
+		{
+			const ComponentPoolBase* smallest = nullptr;
+			std::apply([&smallest](auto*... p)
+				{ ((smallest = (!smallest || p->size() < smallest->size()) ? p : smallest), ...); }, pools);
+			return smallest;
+		}
+	};
+
+	/*	data-oriented entity/component registry, each component type is stored contiguously in its own pool,
+		this exists next to the Actor API and is meant for large numbers of simple (non-virtual) components */
+	class Registry
+	{
+	public:
+		Registry() = default;
+		Registry(const Registry&) = delete;
+		Registry& operator=(const Registry&) = delete;
+
+		Entity create();
+		// destroys the entity and all of its components, the handle (and copies of it) become invalid
+		void destroy(const Entity& e);
+		bool isValid(const Entity& e) const
+		{ return e.index < generations.size() && generations[e.index] == e.generation && alive[e.index]; }
+		uint32_t getEntityCount() const { return numAlive; }
+
+		template<typename T, typename... Args>
+		T& add(const Entity& e, Args&&... args)
+		{
+			assert(isValid(e) && "cannot add component to invalid entity");
+			return getPool<T>().emplace(e.index, std::forward<Args>(args)...);
+		}
+		template<typename T>
+		void remove(const Entity& e) { if (isValid(e)) { getPool<T>().remove(e.index); } }
+		template<typename T>
+		bool has(const Entity& e) { return isValid(e) && getPool<T>().has(e.index); }
+		template<typename T>
+		T& get(const Entity& e) { assert(isValid(e)); return getPool<T>().get(e.index); }
+		template<typename T>
+		T* tryGet(const Entity& e) { return isValid(e) ? getPool<T>().tryGet(e.index) : nullptr; }
+
+		template<typename... Ts>
+		View<Ts...> view() { return View<Ts...>(*this, &getPool<Ts>()...); }
+
+		// calls tick(deltaTime) on every component of type T, a linear pass over packed memory
+		template<typename T>
+		void tick(const float& deltaTime) { for (T& c : getPool<T>().data()) { c.tick(deltaTime); } }
+
+		template<typename T>
+		ComponentPool<T>& getPool()
+		{
+			const uint32_t id = typeId<T>();
+			if (id >= pools.size()) { pools.resize(id + 1); }
+			if (!pools[id]) { pools[id] = std::make_unique<ComponentPool<T>>(); }
+			return *static_cast<ComponentPool<T>*>(pools[id].get());
+		}
+
+		Entity makeHandle(const uint32_t& index) const { return Entity{ index, generations[index] }; }
+
+	private:
+		std::vector<uint32_t> generations;
+		std::vector<bool> alive;
+		std::vector<uint32_t> freeIndices;
+		uint32_t numAlive = 0;
+		// indexed by component type id
+		std::vector<std::unique_ptr<ComponentPoolBase>> pools;
+
+		static uint32_t nextTypeId();
+		template<typename T>
+		static uint32_t typeId() { static const uint32_t id = nextTypeId(); return id; }
+	};
+
+	template<typename... Ts>
+	template<typename F>
+	void View<Ts...>::each(F&& fn)
+	{
+		const ComponentPoolBase* driver = smallestPool();
+		// the driving pool's entity list is copied by index, so fn may not add or remove these component types
+		std::apply([&](auto*... p)
+		{
+			const std::vector<uint32_t>* ents = nullptr;
+			((ents = (static_cast<const ComponentPoolBase*>(p) == driver) ? &p->entities() : ents), ...);
+			for (size_t i = 0; i < ents->size(); i++)
+			{
+				const uint32_t e = (*ents)[i];
+				if ((p->has(e) && ...)) { fn(registry.makeHandle(e), p->get(e)...); }
+			}
+		}, pools);
+	}
+
+} // namespace
@@ -1,6 +1,7 @@
 #pragma once
 #include <vulkan/vulkan.h>
 #include "Core/GPU/engine_device.h"
+#include "Core/GPU/VertexFormat.h"
 
 #include <stdexcept>
 
@@ -43,6 +44,18 @@ namespace EngineCore
 	struct EngineRenderSettings
 	{
 		SampleCountSetting sampleCountMSAA;
+		// prints the mesh render pass draw and bind counts to the console once per second
+		bool printRenderStats = false;
+		// vertex layout of loaded meshes, packed formats use the PACKED_VERTEX shader variants
+		VertexFormat meshVertexFormat = VertexFormat::Float;
+		// levels of detail generated for loaded meshes (1 disables simplification)
+		uint32_t meshLodLevels = 4;
+		// scales the projected size used to pick a mesh level of detail, above 1 keeps detailed levels longer
+		float meshLodBias = 1.f;
+		// added to the mip level picked when sampling textures, negative values sharpen minified textures
+		float textureLodBias = 0.f;
+		// bytes of per-frame upload data (instances, uniforms, staging) per frame in flight, the arena grows if exceeded
+		VkDeviceSize uploadArenaFrameSize = 4 * 1024 * 1024;
 	};
 
 } // namespace
@@ -216,8 +216,11 @@ namespace EngineCore
 		shaderStages[1].pNext = nullptr;
 		shaderStages[1].pSpecializationInfo = nullptr;
 
-		auto bindingDescriptions = ECS::Primitive::Vertex::getBindingDescriptions();
-		auto attributeDescriptions = ECS::Primitive::Vertex::getAttributeDescriptions();
+		const bool packedVertices = matInfo.vertexFormat != VertexFormat::Float;
+		auto bindingDescriptions = packedVertices ? ECS::Primitive::PackedVertex::getBindingDescriptions(matInfo.vertexFormat)
+													: ECS::Primitive::Vertex::getBindingDescriptions();
+		auto attributeDescriptions = packedVertices ? ECS::Primitive::PackedVertex::getAttributeDescriptions(matInfo.vertexFormat)
+													: ECS::Primitive::Vertex::getAttributeDescriptions();
 		VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
 		vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
@@ -245,8 +248,8 @@ namespace EngineCore
 		pipelineInfo.basePipelineIndex = -1;
 		pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-		// create vulkan pipeline object
-		if (vkCreateGraphicsPipelines(device.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+		// create vulkan pipeline object, the shared cache skips compilation of pipelines seen in earlier runs
+		if (vkCreateGraphicsPipelines(device.device(), device.getPipelineCache(), 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
 		{ throw std::runtime_error("failed to create pipeline"); }
 	}
 
@@ -2,6 +2,7 @@
 
 #include "Core/GPU/engine_device.h"
 #include "Core/GPU/Memory/Descriptors.h"
+#include "Core/GPU/VertexFormat.h"
 #include "Core/EngineSettings.h"
 
 #include <glm/glm.hpp>
@@ -59,6 +60,8 @@ namespace EngineCore
 		MaterialShadingProperties shadingProperties{};
 		ShaderFilePaths shaderPaths; // SPIR-V shaders
 		std::vector<VkDescriptorSetLayout> descriptorSetLayouts;
+		// layout of the vertex buffers drawn with this material, the vertex shader must match it
+		VertexFormat vertexFormat = VertexFormat::Float;
 	};
 
 	// a material object is mainly an abstraction around a VkPipeline
@@ -73,6 +76,7 @@ namespace EngineCore
 		Material& operator=(const Material&) = delete;
 
 		VkPipelineLayout getPipelineLayout() { return pipelineLayout; }
+		VertexFormat getVertexFormat() const { return materialCreateInfo.vertexFormat; }
 
 		// binds this material's pipeline to the specified command buffer
 		void bindToCommandBuffer(VkCommandBuffer commandBuffer);
@@ -22,30 +22,29 @@ namespace EngineCore
 	{
 		alignmentSize = getAlignment(instanceSize, minOffsetAlignment);
 		bufferSize = alignmentSize * instanceCount;
-		device.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer, memory);
+		device.createBuffer(bufferSize, usageFlags, memoryPropertyFlags, buffer, allocation);
 	}
 
 	GBuffer::~GBuffer() 
 	{
 		unmap();
 		vkDestroyBuffer(device.device(), buffer, nullptr);
-		vkFreeMemory(device.device(), memory, nullptr);
+		device.getMemoryAllocator().free(allocation);
 	}
 
 	VkResult GBuffer::map(VkDeviceSize size, VkDeviceSize offset) 
 	{
-		// this maps the memory range to the host, making it CPU-accessible
-		assert(buffer && memory && "cannot map uninitialized buffer");
-		return vkMapMemory(device.device(), memory, offset, size, 0, &mapped);
+		// the block is mapped once by the allocator, vkMapMemory must not be called again for a shared block
+		assert(buffer && allocation.memoryBlockHandle && "cannot map uninitialized buffer");
+		if (!allocation.mapped) { return VK_ERROR_MEMORY_MAP_FAILED; }
+		mapped = static_cast<char*>(allocation.mapped) + offset;
+		return VK_SUCCESS;
 	}
 
-	// vkUnmapMemory can't fail
+	// the block stays mapped until it is freed
 	void GBuffer::unmap() 
 	{
-		if (mapped) {
-			vkUnmapMemory(device.device(), memory);
-			mapped = nullptr;
-		}
+		mapped = nullptr;
 	}
 
 	void GBuffer::writeToBuffer(void* data, VkDeviceSize size, VkDeviceSize offset) 
@@ -64,21 +63,14 @@ namespace EngineCore
 
 	VkResult GBuffer::flush(VkDeviceSize size, VkDeviceSize offset) 
 	{
-		VkMappedMemoryRange mappedRange = {};
-		mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-		mappedRange.memory = memory;
-		mappedRange.offset = offset;
-		mappedRange.size = size; // bytes to flush, starting at offset
+		// bytes to flush, starting at offset, translated to the block and rounded to nonCoherentAtomSize
+		VkMappedMemoryRange mappedRange = device.getMemoryAllocator().getMappedRange(allocation, size, offset);
 		return vkFlushMappedMemoryRanges(device.device(), 1, &mappedRange);
 	}
 
 	VkResult GBuffer::invalidate(VkDeviceSize size, VkDeviceSize offset) 
 	{
-		VkMappedMemoryRange mappedRange = {};
-		mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-		mappedRange.memory = memory;
-		mappedRange.offset = offset;
-		mappedRange.size = size;
+		VkMappedMemoryRange mappedRange = device.getMemoryAllocator().getMappedRange(allocation, size, offset);
 		return vkInvalidateMappedMemoryRanges(device.device(), 1, &mappedRange);
 	}
 
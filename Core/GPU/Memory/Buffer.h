@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Core/GPU/engine_device.h"
+#include "Core/GPU/Memory/VMemAllocator.h"
 
 namespace EngineCore 
 {
@@ -14,7 +15,8 @@ namespace EngineCore
 		GBuffer(const GBuffer&) = delete;
 		GBuffer& operator=(const GBuffer&) = delete;
 
-		// calls vkMapMemory for this buffer, whole range by default, starting at 0 (bytes)
+		/*	host-visible memory stays mapped by the allocator, this only exposes the range starting at offset (bytes),
+			fails for device-local buffers */
 		VkResult map(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
 		void unmap();
 
@@ -49,7 +51,7 @@ namespace EngineCore
 		EngineDevice& device;
 		void* mapped = nullptr;
 		VkBuffer buffer = VK_NULL_HANDLE;
-		VkDeviceMemory memory = VK_NULL_HANDLE;
+		Allocation allocation{};
 
 		VkDeviceSize bufferSize;
 		uint32_t instanceCount;
@@ -469,6 +469,31 @@ namespace EngineCore
 		}
 	}
 
+	void DescriptorSet::setImageArrayElement(const uint32_t& arrayIndex, const uint32_t& element, const VkImageView& view)
+	{
+		assert(arrayIndex < imageArraysInfos.size() && element < imageArraysSizes[arrayIndex] && "image array element out of range");
+		imageArraysInfos[arrayIndex][element].imageView = view;
+		imageArraysDirty.assign(framesInFlight, true);
+	}
+
+	void DescriptorSet::updateFrame(const uint32_t& frameIndex)
+	{
+		if (imageArraysDirty.empty() || !imageArraysDirty[frameIndex]) { return; }
+		const uint32_t firstBinding = static_cast<uint32_t>(ubos.size() + samplerImageInfos.size());
+		std::vector<VkWriteDescriptorSet> writes(imageArraysInfos.size());
+		for (uint32_t a = 0; a < imageArraysInfos.size(); a++)
+		{
+			writes[a].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[a].dstSet = sets[frameIndex];
+			writes[a].dstBinding = firstBinding + a;
+			writes[a].descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+			writes[a].descriptorCount = imageArraysSizes[a];
+			writes[a].pImageInfo = imageArraysInfos[a].data();
+		}
+		vkUpdateDescriptorSets(device.device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+		imageArraysDirty[frameIndex] = false;
+	}
+
 	VkDescriptorSetLayout DescriptorSet::getLayout()
 	{
 		assert(layout.get() && "tried to get layout from uninitialized descriptor set");
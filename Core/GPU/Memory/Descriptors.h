@@ -209,6 +209,12 @@ namespace EngineCore
 
 		void finalize(); // allocates descriptors, builds the set layout and VkDescriptorSets  
 
+		/*	replaces one image of an image array (e.g. a streamed texture that became resident),
+			the sets of frames in flight may still be in use, so each one is rewritten by updateFrame */
+		void setImageArrayElement(const uint32_t& arrayIndex, const uint32_t& element, const VkImageView& view);
+		// applies pending image changes to the set of the frame, call after its fence was waited on (beginFrame)
+		void updateFrame(const uint32_t& frameIndex);
+
 		template<typename T> // user-friendly uniform buffer data push function
 		void writeUBOMember(uint32_t uboIndex, T& data, const UBO_Layout::ElementAccessor& position,
 							uint32_t frameIndex, bool flush = true)
@@ -228,6 +234,7 @@ namespace EngineCore
 		std::vector<std::unique_ptr<VkDescriptorImageInfo>> samplerImageInfos;
 		std::vector<std::vector<VkDescriptorImageInfo>> imageArraysInfos; // must be contiguous
 		std::vector<uint32_t> imageArraysSizes;
+		std::vector<bool> imageArraysDirty; // per frame, see setImageArrayElement
 		std::vector<std::unique_ptr<VkDescriptorImageInfo>> samplerInfos;
 		
 		EngineDevice& device;
@@ -1,4 +1,8 @@
 #include "Core/GPU/Memory/Image.h"
+#include "Core/GPU/Memory/UploadManager.h"
+#include "Core/Texture/CookedTexture.h"
+#include "Core/Texture/MipChain.h"
+#include <algorithm>
 #include <cassert>
 #include <stdexcept>
 
@@ -9,12 +13,27 @@
 namespace EngineCore 
 {
 
-	Image::Image(EngineDevice& device, const std::string& path) 
+	Image::Image(EngineDevice& device, const std::string& path, const bool& ownSampler, const float& lodBias) 
 		: device{ device }
 	{
-		loadFromDisk(path);
-		imageView = createImageView(device, image, VK_FORMAT_R8G8B8A8_SRGB);
-		createSampler(sampler, device, 1.f); // TODO: need to check if device supports the anisotropy level!
+		if (!loadCooked(path)) { loadFromDisk(path); }
+		createViewAndSampler(ownSampler, lodBias);
+	}
+
+	Image::Image(EngineDevice& device, const uint8_t* rgba, const uint32_t& width, const uint32_t& height,
+				const bool& ownSampler, const float& lodBias)
+		: device{ device }
+	{
+		loadFromPixels(rgba, width, height);
+		createViewAndSampler(ownSampler, lodBias);
+	}
+
+	void Image::createViewAndSampler(const bool& ownSampler, const float& lodBias)
+	{
+		imageView = createImageView(device, image, format, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_VIEW_TYPE_2D, mipLevels);
+		if (!ownSampler) { return; }
+		// TODO: need to check if device supports the anisotropy level!
+		createSampler(sampler, device, 1.f, lodBias, static_cast<float>(mipLevels));
 	}
 
 	Image::Image(EngineDevice& device, VkImageCreateInfo info, 
@@ -26,9 +45,71 @@ namespace EngineCore
 
 	Image::~Image() 
 	{
-		vkDestroyImageView(device.device(), imageView, nullptr);
-		vkDestroyImage(device.device(), image, nullptr);
-		vkFreeMemory(device.device(), imageMemory, nullptr);
+		VkDevice handle = device.device();
+		DeviceMemoryAllocator& allocator = device.getMemoryAllocator();
+		auto destroy = [handle, &allocator, smp = sampler, view = imageView, img = image, alloc = allocation]() mutable
+		{
+			vkDestroySampler(handle, smp, nullptr);
+			vkDestroyImageView(handle, view, nullptr);
+			vkDestroyImage(handle, img, nullptr);
+			allocator.free(alloc);
+		};
+		// the image must not be destroyed while it is written, the upload manager does it once the copy has completed
+		if (uploaded.completed.valid()) { device.getUploads().releaseAfter(uploaded.value, destroy); }
+		else { destroy(); }
+	}
+
+	static VkFormat getCookedFormat(const BlockFormat& format, const bool& srgb)
+	{
+		switch (format)
+		{
+		case BlockFormat::BC1: return srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+		case BlockFormat::BC3: return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+		case BlockFormat::BC5: return VK_FORMAT_BC5_UNORM_BLOCK;
+		case BlockFormat::BC7: return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+		default: return srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+		}
+	}
+
+	bool Image::loadCooked(const std::string& path)
+	{
+		MappedFile cooked{};
+		CookedTexture::View view{};
+		if (!cooked.open(CookedTexture::getCookedPath(path)) || !CookedTexture::parse(cooked, view)
+			|| !CookedTexture::isUpToDate(*view.header, path)) { return false; }
+
+		const BlockFormat blockFormat = static_cast<BlockFormat>(view.header->format);
+		const VkFormat cookedFormat = getCookedFormat(blockFormat, view.header->srgb != 0);
+		if (BlockCompression::isCompressed(blockFormat) && !device.supportsBlockCompression()) { return false; }
+		VkFormatProperties props;
+		vkGetPhysicalDeviceFormatProperties(device.getPhysicalDevice(), cookedFormat, &props);
+		if (!(props.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) { return false; }
+
+		format = cookedFormat;
+		mipLevels = view.header->levelCount;
+		VkImageCreateInfo info = makeImageCreateInfo(view.header->width, view.header->height, mipLevels);
+		info.format = format;
+		info.usage &= ~VK_IMAGE_USAGE_TRANSFER_SRC_BIT; // every level is in the file, nothing is blitted
+		initImage(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, info);
+
+		// parse guarantees ascending, non-overlapping levels, so the mapped range goes straight into one staging buffer
+		const uint64_t first = view.levels[0].offset;
+		const uint64_t last = view.levels[mipLevels - 1].offset + view.levels[mipLevels - 1].size;
+		UploadManager::ImageUpload upload{};
+		upload.image = image;
+		upload.width = info.extent.width;
+		upload.height = info.extent.height;
+		upload.levelCount = mipLevels;
+		for (uint32_t i = 0; i < mipLevels; i++)
+		{
+			VkBufferImageCopy region{};
+			region.bufferOffset = view.levels[i].offset - first;
+			region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, i, 0, 1 };
+			region.imageExtent = { view.levels[i].width, view.levels[i].height, 1 };
+			upload.regions.push_back(region);
+		}
+		uploaded = device.getUploads().uploadImage(upload, view.data + first, last - first);
+		return true;
 	}
 
 	// loads the image from a file
@@ -37,33 +118,62 @@ namespace EngineCore
 		// import (see Vulkan Tutorial - Texture mapping)
 		int width, height, channels;
 		stbi_uc* pixels = stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
-		VkDeviceSize imageSize = width * height * (uint32_t)4;
-		if (!pixels) { throw std::runtime_error("failed to load image"); }
-
-		// temporary buffer to transfer from CPU (host) to GPU (device)
-		GBuffer stagingBuffer
-		{
-			device, imageSize, 1, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-		};
-
-		// map buffer to host so we can write to it from the host
-		stagingBuffer.map(imageSize);
-		memcpy(stagingBuffer.getMappedMemory(), pixels, static_cast<size_t>(imageSize)); 
-		stagingBuffer.unmap();
-
+		if (!pixels) { throw std::runtime_error("failed to load image: " + path); }
+		loadFromPixels(pixels, static_cast<uint32_t>(width), static_cast<uint32_t>(height));
 		stbi_image_free(pixels); // free importer memory
+	}
+
+	void Image::loadFromPixels(const uint8_t* pixels, const uint32_t& width, const uint32_t& height)
+	{
+		const VkDeviceSize imageSize = static_cast<VkDeviceSize>(width) * height * 4;
 
 		/*	allocate and prep the image for write - device local memory is the fastest
 			but does not allow direct modification from the host */
-		VkImageCreateInfo info = makeImageCreateInfo(width, height); // using defaults set in this function
+		mipLevels = MipChain::getLevelCount(width, height);
+		VkImageCreateInfo info = makeImageCreateInfo(width, height, mipLevels); // using defaults set in this function
 		initImage(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, info);
 
-		// transfer data from buffer to image
-		copyBufferToImage(stagingBuffer, static_cast<uint32_t>(width), static_cast<uint32_t>(height), 1);
+		// the pixels are staged right away, the copy and layout transitions run on the upload queue
+		UploadManager::ImageUpload upload{};
+		upload.image = image;
+		upload.width = info.extent.width;
+		upload.height = info.extent.height;
+		upload.levelCount = mipLevels;
+		auto addRegion = [&](const uint32_t& level, const VkDeviceSize& offset)
+		{
+			VkBufferImageCopy region{};
+			region.bufferOffset = offset;
+			region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+			region.imageExtent = { std::max(1u, upload.width >> level), std::max(1u, upload.height >> level), 1 };
+			upload.regions.push_back(region);
+		};
+
+		if (device.getUploads().canGenerateMips() && canBlitMips(info.format))
+		{
+			addRegion(0, 0);
+			upload.generateMips = true;
+			uploaded = device.getUploads().uploadImage(upload, pixels, imageSize);
+		}
+		else
+		{
+			// a dedicated transfer queue cannot blit, the chain is filtered here and uploaded with level 0
+			std::vector<MipChain::Level> levels;
+			const auto chain = MipChain::build(pixels, upload.width, upload.height, true, levels);
+			for (uint32_t i = 0; i < mipLevels; i++) { addRegion(i, levels[i].offset); }
+			uploaded = device.getUploads().uploadImage(upload, chain.data(), chain.size());
+		}
+	}
+
+	bool Image::canBlitMips(VkFormat format) const
+	{
+		VkFormatProperties props;
+		vkGetPhysicalDeviceFormatProperties(device.getPhysicalDevice(), format, &props);
+		const VkFormatFeatureFlags needed = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT
+											| VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+		return (props.optimalTilingFeatures & needed) == needed;
 	}
 
-	VkImageCreateInfo Image::makeImageCreateInfo(uint32_t width, uint32_t height)
+	VkImageCreateInfo Image::makeImageCreateInfo(uint32_t width, uint32_t height, uint32_t mipLevels)
 	{
 		VkImageCreateInfo ci{};
 		ci.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -71,112 +181,26 @@ namespace EngineCore
 		ci.extent.width = width;
 		ci.extent.height = height;
 		ci.extent.depth = 1;
-		ci.mipLevels = 1;
+		ci.mipLevels = mipLevels;
 		ci.arrayLayers = 1;
 		ci.format = VK_FORMAT_R8G8B8A8_SRGB; // format must be supported by GPU
 		ci.tiling = VK_IMAGE_TILING_OPTIMAL;
 		ci.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 		ci.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT; // shader sample-able
+		if (mipLevels > 1) { ci.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT; }
 		ci.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 		ci.samples = VK_SAMPLE_COUNT_1_BIT;
 		return ci;
 	}
 
-	// performs the memory allocation for the underlying VkImage
+	// creates the underlying VkImage, its memory is suballocated from the device memory allocator
 	void Image::initImage(VkMemoryPropertyFlags memProps, VkImageCreateInfo info)
 	{
-		if (vkCreateImage(device.device(), &info, nullptr, &image) != VK_SUCCESS)
-		{ throw std::runtime_error("failed to create image"); }
-
-		VkMemoryRequirements memRequirements;
-		vkGetImageMemoryRequirements(device.device(), image, &memRequirements);
-
-		VkMemoryAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = memRequirements.size;
-		allocInfo.memoryTypeIndex = device.findMemoryType(memRequirements.memoryTypeBits, memProps);
-
-		if (vkAllocateMemory(device.device(), &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
-		{ throw std::runtime_error("failed to allocate memory for image"); }
-
-		if (vkBindImageMemory(device.device(), image, imageMemory, 0) != VK_SUCCESS)
-		{ throw std::runtime_error("failed to bind memory for image"); }
-	}
-
-	void Image::transitionImageLayout(VkFormat format, 
-								VkImageLayout oldLayout, VkImageLayout newLayout)
-	{
-		VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
-
-		VkImageMemoryBarrier barrier{};
-		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-		barrier.oldLayout = oldLayout;
-		barrier.newLayout = newLayout;
-		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-		barrier.image = image;
-		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		barrier.subresourceRange.baseMipLevel = 0;
-		barrier.subresourceRange.levelCount = 1;
-		barrier.subresourceRange.baseArrayLayer = 0;
-		barrier.subresourceRange.layerCount = 1;
-
-		VkPipelineStageFlags sourceStage;
-		VkPipelineStageFlags destinationStage;
-
-		if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) 
-		{
-			barrier.srcAccessMask = 0;
-			barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-			sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-			destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-		}
-		else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) 
-		{
-			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-			sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-			destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-		}
-		else { throw std::invalid_argument("unsupported image layout transition"); }
-		
-		vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0,
-							nullptr, 0, nullptr, 1, &barrier);
-
-		device.endSingleTimeCommands(commandBuffer);
-	}
-
-	void Image::copyBufferToImage(const GBuffer& buffer, uint32_t width, uint32_t height,
-									uint32_t layerCount)
-								
-	{
-		// vkCmdCopyBufferToImage requires the right image layout, that is handled here
-		transitionImageLayout(VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-
-		VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
-
-		VkBufferImageCopy region{};
-		region.bufferOffset = 0;
-		region.bufferRowLength = 0;
-		region.bufferImageHeight = 0;
-
-		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		region.imageSubresource.mipLevel = 0;
-		region.imageSubresource.baseArrayLayer = 0;
-		region.imageSubresource.layerCount = layerCount; // default = 1
-		region.imageOffset = { 0, 0, 0 };
-		region.imageExtent = { width, height, 1 };
-
-		vkCmdCopyBufferToImage(commandBuffer, buffer.getBuffer(), image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-		device.endSingleTimeCommands(commandBuffer);
-		// transition (again) to a more useful format
-		transitionImageLayout(VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+		device.createImageWithInfo(info, memProps, image, allocation);
 	}
 
 	VkImageView Image::createImageView(EngineDevice& device, VkImage image, VkFormat format, 
-										VkImageAspectFlags aspect, VkImageViewType viewType)
+										VkImageAspectFlags aspect, VkImageViewType viewType, uint32_t mipLevels)
 	{
 		VkImageViewCreateInfo info{};
 		info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -185,7 +209,7 @@ namespace EngineCore
 		info.viewType = viewType;
 		info.subresourceRange.aspectMask = aspect;
 		info.subresourceRange.baseMipLevel = 0;
-		info.subresourceRange.levelCount = 1;
+		info.subresourceRange.levelCount = mipLevels;
 		info.subresourceRange.baseArrayLayer = 0;
 		info.subresourceRange.layerCount = 1;
 
@@ -196,7 +220,8 @@ namespace EngineCore
 		return view;
 	}
 
-	void Image::createSampler(VkSampler& samplerHandleOut, EngineDevice& device, const float& anisotropy)
+	void Image::createSampler(VkSampler& samplerHandleOut, EngineDevice& device, const float& anisotropy,
+							const float& lodBias, const float& maxLod)
 	{
 		VkSamplerCreateInfo info{};
 		info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -216,9 +241,11 @@ namespace EngineCore
 		info.compareOp = VK_COMPARE_OP_ALWAYS;
 
 		info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-		info.mipLodBias = 0.0f;
+		// the bias is clamped to what the device supports
+		const float maxBias = device.properties.limits.maxSamplerLodBias;
+		info.mipLodBias = std::max(-maxBias, std::min(lodBias, maxBias));
 		info.minLod = 0.0f;
-		info.maxLod = 0.0f;
+		info.maxLod = maxLod;
 
 		if (vkCreateSampler(device.device(), &info, nullptr, &samplerHandleOut) != VK_SUCCESS)
 		{ throw std::runtime_error("failed to create texture sampler"); }
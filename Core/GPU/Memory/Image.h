@@ -1,6 +1,11 @@
 #pragma once
 #include "Core/GPU/engine_device.h"
 #include "Core/GPU/Memory/Buffer.h"
+#include "Core/GPU/Memory/UploadManager.h"
+#include "Core/GPU/Memory/VMemAllocator.h"
+
+// std
+#include <future>
 
 namespace EngineCore
 {
@@ -8,7 +13,14 @@ namespace EngineCore
 	class Image
 	{
 	public:
-		Image(EngineDevice& device, const std::string& path);
+		/*	loads the image with a full mip chain, an up to date cooked file (see CookedTexture) is uploaded as is,
+			otherwise the source is decoded and its chain generated (on the upload queue if it can blit, else on the CPU),
+			ownSampler creates a sampler for this image (destroyed with it), images sampled with a shared one pass false,
+			lodBias is added to the level the own sampler picks, negative values sharpen minified views */
+		Image(EngineDevice& device, const std::string& path, const bool& ownSampler = true, const float& lodBias = 0.f);
+		// uploads tightly packed sRGB RGBA8 texels with a generated mip chain, the texels are copied before returning
+		Image(EngineDevice& device, const uint8_t* rgba, const uint32_t& width, const uint32_t& height,
+			const bool& ownSampler = true, const float& lodBias = 0.f);
 		Image(EngineDevice& device, VkImageCreateInfo info, VkMemoryPropertyFlags memProps);
 		~Image();
 
@@ -16,26 +28,46 @@ namespace EngineCore
 		Image& operator=(const Image&) = delete;
 
 		VkImage getImage() { return image; }
-		VkDeviceMemory getMemory() { return imageMemory; }
+		// the memory block the image is placed in, see getAllocation for its range
+		VkDeviceMemory getMemory() { return allocation.memoryBlockHandle; }
+		const Allocation& getAllocation() const { return allocation; }
+		// ready once the image loaded from disk has been copied, it can be sampled before that (see UploadManager)
+		const std::shared_future<void>& getUploadFuture() const { return uploaded.completed; }
+		// frames that sample the image before its future is ready must know about it, see UploadManager::useInFrames
+		uint64_t getUploadValue() const { return uploaded.value; }
+		uint32_t getMipLevels() const { return mipLevels; }
+		VkFormat getFormat() const { return format; }
 
-		static VkImageCreateInfo makeImageCreateInfo(uint32_t width, uint32_t height);
+		// images with more than one level can also be a transfer source, which mip generation by blits needs
+		static VkImageCreateInfo makeImageCreateInfo(uint32_t width, uint32_t height, uint32_t mipLevels = 1);
 		static VkImageView createImageView(EngineDevice& device, VkImage image, VkFormat format,
-						VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT, VkImageViewType viewType = VK_IMAGE_VIEW_TYPE_2D);
-		static void createSampler(VkSampler& samplerHandleOut, EngineDevice& device, const float& anisotropy = 0.f);
+						VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT, VkImageViewType viewType = VK_IMAGE_VIEW_TYPE_2D,
+						uint32_t mipLevels = 1);
+		// maxLod limits sampling to the levels below it, the default allows every level of the bound image
+		static void createSampler(VkSampler& samplerHandleOut, EngineDevice& device, const float& anisotropy = 0.f,
+						const float& lodBias = 0.f, const float& maxLod = VK_LOD_CLAMP_NONE);
 
 		VkImageView imageView = VK_NULL_HANDLE; // the image view handle could be stored here, or anywhere outside the object
-		VkSampler sampler = VK_NULL_HANDLE; // note: samplers are not connected to specific images
+		VkSampler sampler = VK_NULL_HANDLE; // only set with ownSampler, note: samplers are not connected to specific images
 
 	private:
 		VkImage image = VK_NULL_HANDLE;
-		VkDeviceMemory imageMemory = VK_NULL_HANDLE;
+		Allocation allocation{};
+		uint32_t mipLevels = 1;
+		VkFormat format = VK_FORMAT_R8G8B8A8_SRGB;
 		EngineDevice& device;
 
+		// returns false if there is no usable cooked file, or the device cannot sample its format
+		bool loadCooked(const std::string& path);
 		void loadFromDisk(const std::string& path);
+		void loadFromPixels(const uint8_t* pixels, const uint32_t& width, const uint32_t& height);
+		void createViewAndSampler(const bool& ownSampler, const float& lodBias);
 		void initImage(VkMemoryPropertyFlags memProps, VkImageCreateInfo info);
+		// linear blits of the format are needed to generate the chain on the GPU
+		bool canBlitMips(VkFormat format) const;
 
-		void transitionImageLayout(VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
-		void copyBufferToImage(const GBuffer& buffer, uint32_t width, uint32_t height, uint32_t layerCount);
+		// pending upload of the image loaded from disk, see UploadManager
+		UploadManager::Ticket uploaded;
 	};
 }
 
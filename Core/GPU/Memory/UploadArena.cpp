@@ -0,0 +1,111 @@
+#include "Core/GPU/Memory/UploadArena.h"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace EngineCore
+{
+	FrameUploadArena::FrameUploadArena(EngineDevice& device, const VkDeviceSize& capacity, const uint32_t& framesInFlight)
+		: device{ device }, framesInFlight{ framesInFlight }, frameEnds(framesInFlight, 0)
+	{
+		assert(framesInFlight > 0 && capacity > 0 && "upload arena needs a capacity and at least one frame");
+		createBuffer(capacity);
+	}
+
+	void FrameUploadArena::createBuffer(const VkDeviceSize& size)
+	{
+		if (buffer) { retiredBuffers.push_back(RetiredBuffer{ std::move(buffer), framesInFlight }); }
+		buffer = std::make_unique<GBuffer>(device, size, 1, USAGE,
+										VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		if (buffer->map() != VK_SUCCESS) { throw std::runtime_error("failed to map upload arena buffer"); }
+		capacity = size;
+		// nothing of the frames in flight lives in the new buffer
+		head = tail = 0;
+		std::fill(frameEnds.begin(), frameEnds.end(), 0);
+	}
+
+	void FrameUploadArena::beginFrame(const uint32_t& frameIndex)
+	{
+		assert(!frameStarted && "upload arena frame already started");
+		assert(frameIndex < framesInFlight && "upload arena frame index out of range");
+		// frames complete in submission order, so this frame's previous ranges are the oldest ones in use
+		tail = frameEnds[frameIndex];
+		currentFrame = frameIndex;
+		frameStarted = true;
+		frameUsage = 0;
+
+		for (auto& retired : retiredBuffers) { retired.framesLeft--; }
+		retiredBuffers.erase(std::remove_if(retiredBuffers.begin(), retiredBuffers.end(),
+			[](const RetiredBuffer& r) { return r.framesLeft == 0; }), retiredBuffers.end());
+	}
+
+	void FrameUploadArena::endFrame()
+	{
+		assert(frameStarted && "upload arena frame not started");
+		frameEnds[currentFrame] = head;
+		frameStarted = false;
+	}
+
+	bool FrameUploadArena::tryAllocate(const VkDeviceSize& size, const VkDeviceSize& alignment, VkDeviceSize& offsetOut) const
+	{
+		// head == tail means empty, so a range never ends exactly at tail
+		const VkDeviceSize aligned = (head + alignment - 1) & ~(alignment - 1);
+		if (head >= tail)
+		{
+			if (aligned + size <= capacity)
+			{
+				offsetOut = aligned;
+				return true;
+			}
+			// wrap around, the end of the buffer is left unused this time
+			if (size < tail)
+			{
+				offsetOut = 0;
+				return true;
+			}
+			return false;
+		}
+		if (aligned + size < tail)
+		{
+			offsetOut = aligned;
+			return true;
+		}
+		return false;
+	}
+
+	UploadRange FrameUploadArena::allocate(const VkDeviceSize& size, const VkDeviceSize& alignment)
+	{
+		assert(frameStarted && "upload arena allocations must be made between beginFrame and endFrame");
+		assert(alignment > 0 && (alignment & (alignment - 1)) == 0 && "upload arena alignment must be a power of two");
+
+		VkDeviceSize offset = 0;
+		if (!tryAllocate(size, alignment, offset))
+		{
+			// the ranges of the other frames are still read by the GPU, a new buffer takes over from here
+			createBuffer(std::max(capacity * 2, (size + alignment) * framesInFlight));
+			offset = 0;
+		}
+		head = offset + size;
+		frameUsage += size;
+
+		UploadRange range{};
+		range.buffer = buffer->getBuffer();
+		range.offset = offset;
+		range.size = size;
+		range.mapped = static_cast<char*>(buffer->getMappedMemory()) + offset;
+		return range;
+	}
+
+	UploadRange FrameUploadArena::allocateUniform(const VkDeviceSize& size)
+	{
+		return allocate(size, std::max<VkDeviceSize>(16, device.properties.limits.minUniformBufferOffsetAlignment));
+	}
+
+	UploadRange FrameUploadArena::allocateStorage(const VkDeviceSize& size)
+	{
+		return allocate(size, std::max<VkDeviceSize>(16, device.properties.limits.minStorageBufferOffsetAlignment));
+	}
+
+} // namespace
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Core/GPU/engine_device.h"
+#include "Core/GPU/Memory/Buffer.h"
+
+// std
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace EngineCore
+{
+	// a sub-range of the upload arena, valid until the frame it was allocated in has completed on the GPU
+	struct UploadRange
+	{
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0;
+		VkDeviceSize size = 0;
+		void* mapped = nullptr; // host address of offset, written directly, the memory is host coherent
+
+		VkDescriptorBufferInfo descriptorInfo() const { return VkDescriptorBufferInfo{ buffer, offset, size }; }
+	};
+
+	/*	linear allocator for data written by the CPU every frame (uniform, instance and staging data),
+		one persistently mapped host-visible buffer is used as a ring shared by all frames in flight,
+		a frame's ranges are reclaimed at the next beginFrame with the same frame index (its fence has signaled by then),
+		so per-frame uploads need no buffer creation or map calls, not thread safe (allocate on the recording thread) */
+	class FrameUploadArena
+	{
+	public:
+		FrameUploadArena(EngineDevice& device, const VkDeviceSize& capacity, const uint32_t& framesInFlight);
+
+		FrameUploadArena(const FrameUploadArena&) = delete;
+		FrameUploadArena& operator=(const FrameUploadArena&) = delete;
+
+		// reclaims the ranges of the frame's previous use, the frame's fence must have been waited on
+		void beginFrame(const uint32_t& frameIndex);
+		// marks the end of the frame's ranges, call before its command buffer is submitted
+		void endFrame();
+
+		/*	returns a range of at least size bytes, offset aligned to alignment (power of two),
+			if the ring is full a larger buffer replaces it, the old one is kept until its frames have completed */
+		UploadRange allocate(const VkDeviceSize& size, const VkDeviceSize& alignment = 16);
+		// aligned to minUniformBufferOffsetAlignment
+		UploadRange allocateUniform(const VkDeviceSize& size);
+		// aligned to minStorageBufferOffsetAlignment
+		UploadRange allocateStorage(const VkDeviceSize& size);
+
+		VkDeviceSize getCapacity() const { return capacity; }
+		// bytes allocated by the current frame so far
+		VkDeviceSize getFrameUsage() const { return frameUsage; }
+
+		// the arena buffer can be bound as any of these
+		static constexpr VkBufferUsageFlags USAGE = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT
+			| VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+
+	private:
+		EngineDevice& device;
+		const uint32_t framesInFlight;
+
+		std::unique_ptr<GBuffer> buffer;
+		VkDeviceSize capacity = 0;
+		// allocations are made at head, everything from tail up to head (wrapping around) is still in use
+		VkDeviceSize head = 0;
+		VkDeviceSize tail = 0;
+		// head at the end of each frame, the frame's ranges end there
+		std::vector<VkDeviceSize> frameEnds;
+		uint32_t currentFrame = 0;
+		bool frameStarted = false;
+		VkDeviceSize frameUsage = 0;
+
+		// replaced buffers, destroyed once every frame in flight has completed since they were replaced
+		struct RetiredBuffer { std::unique_ptr<GBuffer> buffer; uint32_t framesLeft; };
+		std::vector<RetiredBuffer> retiredBuffers;
+
+		void createBuffer(const VkDeviceSize& size);
+		// true if size bytes fit at the aligned head (or at 0 after wrapping), sets offsetOut
+		bool tryAllocate(const VkDeviceSize& size, const VkDeviceSize& alignment, VkDeviceSize& offsetOut) const;
+	};
+
+} // namespace
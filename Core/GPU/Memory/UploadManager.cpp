@@ -0,0 +1,358 @@
+#include "Core/GPU/Memory/UploadManager.h"
+#include "Core/Types/Math.h"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+namespace EngineCore
+{
+	UploadManager::UploadManager(EngineDevice& device) : device{ device }, queue{ device.uploadQueue() }
+	{
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = device.getUploadQueueFamily();
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+		if (vkCreateCommandPool(device.device(), &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+		{ throw std::runtime_error("failed to create upload command pool"); }
+
+		VkSemaphoreTypeCreateInfo typeInfo{};
+		typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+		typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		typeInfo.initialValue = 0;
+		VkSemaphoreCreateInfo semaphoreInfo{};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphoreInfo.pNext = &typeInfo;
+		if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &timeline) != VK_SUCCESS)
+		{ throw std::runtime_error("failed to create upload timeline semaphore"); }
+
+		stagingRing = std::make_unique<GBuffer>(device, STAGING_RING_SIZE, 1, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+												VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		if (stagingRing->map() != VK_SUCCESS) { throw std::runtime_error("failed to map upload staging ring"); }
+
+		// the batch being recorded is always the next one submitted
+		recording.value = 1;
+		completionThread = std::thread(&UploadManager::completionLoop, this);
+	}
+
+	UploadManager::~UploadManager()
+	{
+		waitIdle();
+		{
+			std::lock_guard<std::mutex> g(lock);
+			stopping = true;
+		}
+		completionSignal.notify_all();
+		completionThread.join();
+		vkDestroySemaphore(device.device(), timeline, nullptr);
+		vkDestroyCommandPool(device.device(), commandPool, nullptr); // also frees the command buffers
+	}
+
+	bool UploadManager::allocateRing(const VkDeviceSize& size, VkDeviceSize& offsetOut)
+	{
+		// the used range always ends at ringHead, so the free space starts there and may wrap around
+		if (ringUsed == 0) { ringHead = 0; }
+		VkDeviceSize offset = Math::roundUpToClosestMultiple<VkDeviceSize>(ringHead, STAGING_ALIGNMENT);
+		VkDeviceSize padding = offset - ringHead;
+		if (offset + size > STAGING_RING_SIZE)
+		{
+			padding = STAGING_RING_SIZE - ringHead;
+			offset = 0;
+		}
+		if (ringUsed + padding + size > STAGING_RING_SIZE) { return false; }
+
+		ringHead = offset + size;
+		ringUsed += padding + size;
+		recording.ringBytes += padding + size;
+		offsetOut = offset;
+		return true;
+	}
+
+	VkCommandBuffer UploadManager::stage(const void* data, const VkDeviceSize& size, VkBuffer& stagingOut,
+										VkDeviceSize& stagingOffsetOut)
+	{
+		if (allocateRing(size, stagingOffsetOut))
+		{
+			std::memcpy(static_cast<char*>(stagingRing->getMappedMemory()) + stagingOffsetOut, data, static_cast<size_t>(size));
+			stagingOut = stagingRing->getBuffer();
+		}
+		else
+		{
+			auto staging = std::make_unique<GBuffer>(device, size, 1, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+													VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			if (staging->map() != VK_SUCCESS) { throw std::runtime_error("failed to map upload staging buffer"); }
+			std::memcpy(staging->getMappedMemory(), data, static_cast<size_t>(size));
+			stagingOut = staging->getBuffer();
+			stagingOffsetOut = 0;
+			recording.staging.push_back(std::move(staging));
+		}
+
+		if (recording.commandBuffer == VK_NULL_HANDLE)
+		{
+			if (!freeCommandBuffers.empty())
+			{
+				recording.commandBuffer = freeCommandBuffers.back();
+				freeCommandBuffers.pop_back();
+				vkResetCommandBuffer(recording.commandBuffer, 0);
+			}
+			else
+			{
+				VkCommandBufferAllocateInfo allocInfo{};
+				allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+				allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+				allocInfo.commandPool = commandPool;
+				allocInfo.commandBufferCount = 1;
+				if (vkAllocateCommandBuffers(device.device(), &allocInfo, &recording.commandBuffer) != VK_SUCCESS)
+				{ throw std::runtime_error("failed to allocate upload command buffer"); }
+			}
+			VkCommandBufferBeginInfo beginInfo{};
+			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+			vkBeginCommandBuffer(recording.commandBuffer, &beginInfo);
+		}
+		recording.bytes += size;
+		return recording.commandBuffer;
+	}
+
+	UploadManager::Ticket UploadManager::addPromise()
+	{
+		recording.promises.emplace_back();
+		Ticket ticket{ recording.promises.back().get_future().share(), recording.value };
+		// large batches are not held back until the next frame, a shared queue may only be used by the render thread
+		if (recording.bytes >= MAX_BATCH_BYTES && !device.isUploadQueueShared()) { submit(); }
+		return ticket;
+	}
+
+	UploadManager::Ticket UploadManager::uploadBuffer(VkBuffer dstBuffer, const VkDeviceSize& dstOffset,
+														const void* data, const VkDeviceSize& size)
+	{
+		assert(size > 0 && "upload size cannot be zero");
+		std::lock_guard<std::mutex> g(lock);
+		VkBuffer staging;
+		VkDeviceSize stagingOffset;
+		VkCommandBuffer cmd = stage(data, size, staging, stagingOffset);
+
+		VkBufferCopy region{};
+		region.srcOffset = stagingOffset;
+		region.dstOffset = dstOffset;
+		region.size = size;
+		vkCmdCopyBuffer(cmd, staging, dstBuffer, 1, &region);
+		return addPromise();
+	}
+
+	UploadManager::Ticket UploadManager::uploadImage(const ImageUpload& upload, const void* data, const VkDeviceSize& size)
+	{
+		assert(size > 0 && "upload size cannot be zero");
+		assert(!upload.regions.empty() && upload.levelCount > 0 && "image upload needs at least one region");
+		assert((!upload.generateMips || canGenerateMips()) && "mip generation needs a graphics capable upload queue");
+		std::lock_guard<std::mutex> g(lock);
+		VkBuffer staging;
+		VkDeviceSize stagingOffset;
+		VkCommandBuffer cmd = stage(data, size, staging, stagingOffset);
+
+		auto barrier = [&](const uint32_t& baseLevel, const uint32_t& levelCount, VkImageLayout oldLayout, VkImageLayout newLayout,
+							VkAccessFlags srcAccess, VkAccessFlags dstAccess)
+		{
+			VkImageMemoryBarrier b{};
+			b.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			b.oldLayout = oldLayout;
+			b.newLayout = newLayout;
+			b.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			b.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			b.image = upload.image;
+			b.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, baseLevel, levelCount, 0, upload.layerCount };
+			b.srcAccessMask = srcAccess;
+			b.dstAccessMask = dstAccess;
+			return b;
+		};
+
+		VkImageMemoryBarrier toTransfer = barrier(0, upload.levelCount, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+												0, VK_ACCESS_TRANSFER_WRITE_BIT);
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+							0, nullptr, 0, nullptr, 1, &toTransfer);
+
+		uint32_t uploadedLevels = 0;
+		for (const auto& region : upload.regions) { uploadedLevels = std::max(uploadedLevels, region.imageSubresource.mipLevel + 1); }
+		std::vector<VkBufferImageCopy> regions = upload.regions;
+		for (auto& region : regions) { region.bufferOffset += stagingOffset; }
+		vkCmdCopyBufferToImage(cmd, staging, upload.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+							static_cast<uint32_t>(regions.size()), regions.data());
+
+		/*	every generated level reads the one before it, which is done being written once it becomes a blit source,
+			sources go straight to SHADER_READ_ONLY_OPTIMAL afterwards */
+		const bool blits = upload.generateMips && uploadedLevels < upload.levelCount;
+		for (uint32_t level = uploadedLevels; blits && level < upload.levelCount; level++)
+		{
+			VkImageMemoryBarrier toSource = barrier(level - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+													VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+			vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+								0, nullptr, 0, nullptr, 1, &toSource);
+
+			VkImageBlit blit{};
+			blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, upload.layerCount };
+			blit.srcOffsets[1] = { static_cast<int32_t>(std::max(1u, upload.width >> (level - 1))),
+									static_cast<int32_t>(std::max(1u, upload.height >> (level - 1))), 1 };
+			blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, upload.layerCount };
+			blit.dstOffsets[1] = { static_cast<int32_t>(std::max(1u, upload.width >> level)),
+									static_cast<int32_t>(std::max(1u, upload.height >> level)), 1 };
+			vkCmdBlitImage(cmd, upload.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, upload.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+							1, &blit, VK_FILTER_LINEAR);
+
+			VkImageMemoryBarrier sourceDone = barrier(level - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+													VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT, 0);
+			vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+								0, nullptr, 0, nullptr, 1, &sourceDone);
+		}
+
+		/*	the shader stages do not exist on a transfer queue, the timeline semaphore wait of the frame submission
+			makes the copy visible to them */
+		std::vector<VkImageMemoryBarrier> toShader;
+		if (!blits)
+		{
+			toShader.push_back(barrier(0, upload.levelCount, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+										VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, 0));
+		}
+		else
+		{
+			// uploaded levels below the last one were never a blit source, the smallest level was only written
+			if (uploadedLevels > 1)
+			{
+				toShader.push_back(barrier(0, uploadedLevels - 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+											VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, 0));
+			}
+			toShader.push_back(barrier(upload.levelCount - 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+										VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, 0));
+		}
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+							0, nullptr, 0, nullptr, static_cast<uint32_t>(toShader.size()), toShader.data());
+		return addPromise();
+	}
+
+	UploadManager::Ticket UploadManager::uploadImage(VkImage dstImage, const void* data, const VkDeviceSize& size,
+														const uint32_t& width, const uint32_t& height, const uint32_t& layerCount)
+	{
+		ImageUpload upload{};
+		upload.image = dstImage;
+		upload.width = width;
+		upload.height = height;
+		upload.layerCount = layerCount;
+		VkBufferImageCopy region{};
+		region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, layerCount };
+		region.imageExtent = { width, height, 1 };
+		upload.regions.push_back(region);
+		return uploadImage(upload, data, size);
+	}
+
+	void UploadManager::submit()
+	{
+		if (recording.commandBuffer == VK_NULL_HANDLE) { return; }
+		if (vkEndCommandBuffer(recording.commandBuffer) != VK_SUCCESS)
+		{ throw std::runtime_error("failed to record upload command buffer"); }
+
+		VkTimelineSemaphoreSubmitInfo timelineInfo{};
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timelineInfo.signalSemaphoreValueCount = 1;
+		timelineInfo.pSignalSemaphoreValues = &recording.value;
+
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.pNext = &timelineInfo;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &recording.commandBuffer;
+		submitInfo.signalSemaphoreCount = 1;
+		submitInfo.pSignalSemaphores = &timeline;
+		if (vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+		{ throw std::runtime_error("failed to submit uploads"); }
+
+		submittedValue = recording.value;
+		submitted.push_back(std::move(recording));
+		recording = Batch{};
+		recording.value = submittedValue + 1;
+		completionSignal.notify_one();
+	}
+
+	void UploadManager::flush()
+	{
+		std::lock_guard<std::mutex> g(lock);
+		submit();
+	}
+
+	void UploadManager::waitIdle()
+	{
+		std::unique_lock<std::mutex> g(lock);
+		submit();
+		idleSignal.wait(g, [this]() { return submitted.empty(); });
+	}
+
+	void UploadManager::releaseAfter(const uint64_t& value, std::function<void()> release)
+	{
+		{
+			std::lock_guard<std::mutex> g(lock);
+			// the completion thread takes the releases of a batch together with raising completedValue
+			if (value > completedValue.load(std::memory_order_relaxed))
+			{
+				if (value == recording.value) { recording.releases.push_back(std::move(release)); return; }
+				for (auto& batch : submitted)
+				{
+					if (batch.value == value) { batch.releases.push_back(std::move(release)); return; }
+				}
+				assert(false && "release refers to an upload that was never recorded");
+			}
+		}
+		release();
+	}
+
+	void UploadManager::useInFrames(const uint64_t& value)
+	{
+		if (value <= getCompletedValue()) { return; }
+		uint64_t current = frameValue.load(std::memory_order_relaxed);
+		while (value > current && !frameValue.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+	}
+
+	uint64_t UploadManager::getFrameWaitValue() const
+	{
+		// every frame keeps waiting until the newest upload a frame used has completed, earlier ones complete before it
+		const uint64_t value = frameValue.load(std::memory_order_relaxed);
+		return value > getCompletedValue() ? value : 0;
+	}
+
+	void UploadManager::completionLoop()
+	{
+		std::unique_lock<std::mutex> g(lock);
+		while (true)
+		{
+			completionSignal.wait(g, [this]() { return stopping || !submitted.empty(); });
+			if (submitted.empty()) { return; } // stopping
+
+			// batches complete in submission order, the semaphore is waited on without holding the lock
+			const uint64_t value = submitted.front().value;
+			g.unlock();
+			VkSemaphoreWaitInfo waitInfo{};
+			waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+			waitInfo.semaphoreCount = 1;
+			waitInfo.pSemaphores = &timeline;
+			waitInfo.pValues = &value;
+			vkWaitSemaphores(device.device(), &waitInfo, UINT64_MAX);
+			g.lock();
+
+			// the batch stays queued until its futures are ready, so waitIdle cannot return early
+			auto staging = std::move(submitted.front().staging);
+			auto promises = std::move(submitted.front().promises);
+			auto releases = std::move(submitted.front().releases);
+			freeCommandBuffers.push_back(submitted.front().commandBuffer);
+			ringUsed -= submitted.front().ringBytes;
+			completedValue.store(value, std::memory_order_release);
+			g.unlock();
+			staging.clear(); // released through the (thread safe) memory allocator
+			for (auto& release : releases) { release(); }
+			releases.clear();
+			for (auto& promise : promises) { promise.set_value(); }
+			g.lock();
+			submitted.pop_front();
+			if (submitted.empty()) { idleSignal.notify_all(); }
+		}
+	}
+
+} // namespace
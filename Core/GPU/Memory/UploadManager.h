@@ -0,0 +1,141 @@
+#pragma once
+
+#include "Core/GPU/engine_device.h"
+#include "Core/GPU/Memory/Buffer.h"
+
+// std
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace EngineCore
+{
+	/*	copies data from the host into device-local buffers and images without stalling the graphics queue,
+		uploads are recorded into one command buffer per batch and submitted together on the upload queue
+		(a dedicated transfer queue if the device has one), each batch signals the next value of a timeline semaphore,
+		frames only wait for the uploads of resources they use (see useInFrames), so unrelated uploads never stall a frame,
+		data is staged in a persistently mapped ring, uploads that do not fit get a staging buffer of their own,
+		a completion thread releases staging memory and fulfils the returned futures, thread safe */
+	class UploadManager
+	{
+	public:
+		UploadManager(EngineDevice& device);
+		// completes all pending uploads
+		~UploadManager();
+
+		UploadManager(const UploadManager&) = delete;
+		UploadManager& operator=(const UploadManager&) = delete;
+
+		// a pending upload, value is the timeline semaphore value its batch signals once the copy has completed
+		struct Ticket
+		{
+			std::shared_future<void> completed;
+			uint64_t value = 0;
+		};
+
+		/*	the data is copied into staging memory before returning, the destination must have been created with
+			VK_BUFFER_USAGE_TRANSFER_DST_BIT and stay alive until the future is ready */
+		Ticket uploadBuffer(VkBuffer dstBuffer, const VkDeviceSize& dstOffset, const void* data,
+											const VkDeviceSize& size);
+		// the levels of a color image to upload, see uploadImage
+		struct ImageUpload
+		{
+			VkImage image = VK_NULL_HANDLE;
+			// size of level 0
+			uint32_t width = 0;
+			uint32_t height = 0;
+			uint32_t levelCount = 1;
+			uint32_t layerCount = 1;
+			// where the uploaded levels lie in the data, bufferOffset is relative to the start of the data
+			std::vector<VkBufferImageCopy> regions;
+			/*	levels above the highest uploaded one are blitted from the level before them (linear filter),
+				the image needs VK_IMAGE_USAGE_TRANSFER_SRC_BIT and the upload queue has to support graphics */
+			bool generateMips = false;
+		};
+		/*	the data is copied into staging memory before returning,
+			all levels are transitioned from UNDEFINED and left in SHADER_READ_ONLY_OPTIMAL */
+		Ticket uploadImage(const ImageUpload& upload, const void* data, const VkDeviceSize& size);
+		// uploads tightly packed texels of mip level 0 (all array layers) of a single level image
+		Ticket uploadImage(VkImage dstImage, const void* data, const VkDeviceSize& size,
+											const uint32_t& width, const uint32_t& height, const uint32_t& layerCount = 1);
+		// blits need a queue with graphics support, see ImageUpload::generateMips
+		bool canGenerateMips() const { return device.isUploadQueueGraphicsCapable(); }
+
+		/*	submits the recorded uploads as one batch, called by the renderer before every frame submission,
+			must be called from the render thread if the upload queue is shared with graphics */
+		void flush();
+		// flushes and waits until every upload has completed, the same thread rules as for flush apply
+		void waitIdle();
+		/*	runs release once the batch with this value has completed, right away if it already has,
+			destructors on any thread hand over resources an upload may still write, without waiting or submitting */
+		void releaseAfter(const uint64_t& value, std::function<void()> release);
+
+		/*	frames submitted from now on use a resource of the upload with this value, they wait for it until it has completed,
+			call when a resource is bound, thread safe and cheap once the upload has completed */
+		void useInFrames(const uint64_t& value);
+		// the frame submission waits for getFrameWaitValue on this semaphore, 0 if no frame resource is still uploading
+		VkSemaphore getTimelineSemaphore() const { return timeline; }
+		uint64_t getFrameWaitValue() const;
+		// the highest value whose batch has completed on the GPU
+		uint64_t getCompletedValue() const { return completedValue.load(std::memory_order_acquire); }
+
+	private:
+		struct Batch
+		{
+			VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+			uint64_t value = 0;
+			VkDeviceSize bytes = 0;
+			// bytes of the staging ring used by the batch, including padding, released when it completes
+			VkDeviceSize ringBytes = 0;
+			std::vector<std::unique_ptr<GBuffer>> staging;
+			std::vector<std::promise<void>> promises;
+			std::vector<std::function<void()>> releases;
+		};
+
+		// batches above this size are submitted right away (unless the queue is shared with graphics)
+		static constexpr VkDeviceSize MAX_BATCH_BYTES = 64ull * 1024 * 1024;
+		static constexpr VkDeviceSize STAGING_RING_SIZE = 32ull * 1024 * 1024;
+		// copy offsets of compressed images must be a multiple of the block size
+		static constexpr VkDeviceSize STAGING_ALIGNMENT = 16;
+
+		EngineDevice& device;
+		VkQueue queue;
+		VkCommandPool commandPool = VK_NULL_HANDLE;
+		VkSemaphore timeline = VK_NULL_HANDLE;
+
+		std::mutex lock;
+		std::condition_variable completionSignal;
+		std::condition_variable idleSignal;
+		Batch recording{};
+		std::deque<Batch> submitted;
+		// command buffers of completed batches, reset and reused by the next batch
+		std::vector<VkCommandBuffer> freeCommandBuffers;
+		uint64_t submittedValue = 0;
+		std::atomic<uint64_t> completedValue{ 0 };
+		// highest value any frame resource was uploaded with
+		std::atomic<uint64_t> frameValue{ 0 };
+		bool stopping = false;
+		std::unique_ptr<GBuffer> stagingRing;
+		VkDeviceSize ringHead = 0;
+		// bytes between the oldest incomplete batch and ringHead
+		VkDeviceSize ringUsed = 0;
+		std::thread completionThread;
+
+		/*	copies the data into the staging ring (or a new staging buffer of the recording batch),
+			returns the command buffer of the batch, lock must be held */
+		VkCommandBuffer stage(const void* data, const VkDeviceSize& size, VkBuffer& stagingOut, VkDeviceSize& stagingOffsetOut);
+		// false if the ring has no contiguous space left until earlier batches complete
+		bool allocateRing(const VkDeviceSize& size, VkDeviceSize& offsetOut);
+		Ticket addPromise();
+		void submit(); // lock must be held
+		void completionLoop();
+	};
+
+} // namespace
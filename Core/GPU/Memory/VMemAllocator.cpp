@@ -1,124 +1,620 @@
 #include "Core/GPU/Memory/VMemAllocator.h"
+#include "Core/GPU/engine_device.h"
 
 // std
+#include <algorithm>
+#include <cassert>
 #include <stdexcept>
+#include <string>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 namespace EngineCore
 {
-	DeviceMemoryAllocator::DeviceMemoryAllocator(EngineDevice& device) : device{ device }
+	static VkDeviceSize alignUp(const VkDeviceSize& value, const VkDeviceSize& alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	// index of the lowest set bit, value must not be 0
+	static uint32_t findLowestBit(const uint64_t& value)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return static_cast<uint32_t>(index);
+#else
+		return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+	}
+
+	// index of the highest set bit, value must not be 0
+	static uint32_t findHighestBit(const uint64_t& value)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return static_cast<uint32_t>(index);
+#else
+		return static_cast<uint32_t>(63 - __builtin_clzll(value));
+#endif
+	}
+
+	// ---- DeviceMemoryPool (TLSF) ----
+
+	void DeviceMemoryPool::mapping(VkDeviceSize size, uint32_t& fl, uint32_t& sl)
 	{
-		// get properties and memory info about the physical device
-		const VkPhysicalDevice& gpu = device.getPhysicalDevice();
-		if (gpu == VK_NULL_HANDLE)
+		// sizes below SL_COUNT are binned linearly in the first level
+		if (size < SL_COUNT)
 		{
-			throw std::runtime_error("allocator error, invalid VkPhysicalDevice");
+			fl = 0;
+			sl = static_cast<uint32_t>(size);
+			return;
 		}
+		const uint32_t msb = findHighestBit(size);
+		fl = msb - SL_LOG2 + 1;
+		sl = static_cast<uint32_t>(size >> (msb - SL_LOG2)) - SL_COUNT;
+	}
 
-		VkPhysicalDeviceMemoryProperties gpuMemProps;
-		vkGetPhysicalDeviceMemoryProperties(gpu, &gpuMemProps);
-		VkPhysicalDeviceProperties gpuProps;
-		vkGetPhysicalDeviceProperties(gpu, &gpuProps);
-		//memTypeAllocSizes = (size_t*)calloc(1, sizeof(size_t) * gpuMemProps.memoryTypeCount);
-		memTypeAllocSizes.resize(gpuMemProps.memoryTypeCount);
-		pools.resize(gpuMemProps.memoryTypeCount);
-		pageSize = gpuProps.limits.bufferImageGranularity;
-		blockMinSize = pageSize * (uint64_t)10;
+	uint32_t DeviceMemoryPool::createNode()
+	{
+		uint32_t node;
+		if (!unusedNodes.empty())
+		{
+			node = unusedNodes.back();
+			unusedNodes.pop_back();
+		}
+		else
+		{
+			node = static_cast<uint32_t>(nodes.size());
+			nodes.emplace_back();
+		}
+		nodes[node] = MemoryNode{};
+		return node;
 	}
 
-	DeviceMemoryAllocator::~DeviceMemoryAllocator() {}
+	void DeviceMemoryPool::destroyNode(uint32_t node) { unusedNodes.push_back(node); }
 
-	void DeviceMemoryAllocator::alloc(Allocation& allocOut, VkDeviceSize size, uint32_t memType, VkMemoryPropertyFlags usage)
+	void DeviceMemoryPool::insertFreeNode(uint32_t node)
 	{
-		DeviceMemoryPool& pool = pools[memType];
+		MemoryNode& n = nodes[node];
+		n.free = true;
+		n.prevFree = INVALID_MEMORY_NODE;
+		n.nextFree = INVALID_MEMORY_NODE;
+		if (blocks[n.block].excluded) { return; }
 
-		// always alloc a multiple of pageSize
-		VkDeviceSize reqSize = ((size / pageSize) + 1) * pageSize;
-		memTypeAllocSizes[memType] += reqSize;
+		uint32_t fl, sl;
+		mapping(n.size, fl, sl);
+		uint32_t& head = freeHeads[fl * SL_COUNT + sl];
+		n.nextFree = head;
+		if (head != INVALID_MEMORY_NODE) { nodes[head].prevFree = node; }
+		head = node;
+		slBitmaps[fl] |= 1u << sl;
+		flBitmap |= 1ull << fl;
+	}
 
-		BlockSpanIndexPair location;
+	void DeviceMemoryPool::removeFreeNode(uint32_t node)
+	{
+		MemoryNode& n = nodes[node];
+		if (blocks[n.block].excluded) { return; }
 
-		bool wholePage = (usage != VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-		if (findSpaceInPoolForAlloc(location, memType,
-			reqSize, wholePage))
+		uint32_t fl, sl;
+		mapping(n.size, fl, sl);
+		uint32_t& head = freeHeads[fl * SL_COUNT + sl];
+		if (n.prevFree != INVALID_MEMORY_NODE) { nodes[n.prevFree].nextFree = n.nextFree; }
+		if (n.nextFree != INVALID_MEMORY_NODE) { nodes[n.nextFree].prevFree = n.prevFree; }
+		if (head == node)
 		{
-			location = { addBlockToPool(reqSize, memType, wholePage), 0 };
+			head = n.nextFree;
+			if (head == INVALID_MEMORY_NODE)
+			{
+				slBitmaps[fl] &= ~(1u << sl);
+				if (slBitmaps[fl] == 0) { flBitmap &= ~(1ull << fl); }
+			}
+		}
+		n.prevFree = INVALID_MEMORY_NODE;
+		n.nextFree = INVALID_MEMORY_NODE;
+	}
 
-			allocOut.memoryBlockHandle = pool.getBlock(location.blockIndex).mem.memoryBlockHandle;
-			allocOut.size = size;
-			allocOut.offset = pool.getBlock(location.blockIndex).layout[location.spanIndex].offset;
-			allocOut.memoryType = memType;
-			allocOut.id = location.blockIndex;
+	uint32_t DeviceMemoryPool::findFreeNode(VkDeviceSize size)
+	{
+		// round up to the next size class, so every range in the bin that is found is large enough
+		if (size >= SL_COUNT) { size += (1ull << (findHighestBit(size) - SL_LOG2)) - 1; }
+		uint32_t fl, sl;
+		mapping(size, fl, sl);
+		if (fl >= FL_COUNT) { return INVALID_MEMORY_NODE; }
 
-			markMemoryUsedInBlock(memType, location, reqSize);
+		uint32_t slMap = slBitmaps[fl] & (~0u << sl);
+		if (slMap == 0)
+		{
+			// no bin of this power of two is large enough, take the smallest non-empty larger one
+			const uint64_t flMap = fl + 1 < 64 ? flBitmap & (~0ull << (fl + 1)) : 0;
+			if (flMap == 0) { return INVALID_MEMORY_NODE; }
+			fl = findLowestBit(flMap);
+			slMap = slBitmaps[fl];
 		}
+		sl = findLowestBit(slMap);
+		return freeHeads[fl * SL_COUNT + sl];
 	}
 
-	void DeviceMemoryAllocator::free(Allocation& alloc)
+	uint32_t DeviceMemoryPool::allocate(VkDeviceSize size, VkDeviceSize alignment)
+	{
+		/*	free ranges usually start aligned already, so the bin for the plain size is tried first,
+			searching with size + alignment - 1 always fits but skips ranges that would fit exactly */
+		uint32_t node = findFreeNode(size);
+		if (node != INVALID_MEMORY_NODE && alignUp(nodes[node].offset, alignment) + size > nodes[node].offset + nodes[node].size)
+		{
+			node = alignment > 1 ? findFreeNode(size + alignment - 1) : INVALID_MEMORY_NODE;
+		}
+		if (node == INVALID_MEMORY_NODE) { return INVALID_MEMORY_NODE; }
+		removeFreeNode(node);
+
+		const uint32_t block = nodes[node].block;
+		const VkDeviceSize aligned = alignUp(nodes[node].offset, alignment);
+		// the alignment padding in front stays free, its physical neighbour in front is always in use
+		if (aligned > nodes[node].offset)
+		{
+			const uint32_t front = createNode();
+			nodes[front].offset = nodes[node].offset;
+			nodes[front].size = aligned - nodes[node].offset;
+			nodes[front].block = block;
+			nodes[front].prevPhysical = nodes[node].prevPhysical;
+			nodes[front].nextPhysical = node;
+			if (nodes[front].prevPhysical != INVALID_MEMORY_NODE) { nodes[nodes[front].prevPhysical].nextPhysical = front; }
+			else { blocks[block].firstNode = front; }
+			nodes[node].prevPhysical = front;
+			nodes[node].offset = aligned;
+			nodes[node].size -= nodes[front].size;
+			insertFreeNode(front);
+		}
+		// the remainder behind is split off unless it is too small to be useful
+		if (nodes[node].size - size >= MIN_SPLIT_SIZE)
+		{
+			const uint32_t back = createNode();
+			nodes[back].offset = aligned + size;
+			nodes[back].size = nodes[node].size - size;
+			nodes[back].block = block;
+			nodes[back].prevPhysical = node;
+			nodes[back].nextPhysical = nodes[node].nextPhysical;
+			if (nodes[back].nextPhysical != INVALID_MEMORY_NODE) { nodes[nodes[back].nextPhysical].prevPhysical = back; }
+			nodes[node].nextPhysical = back;
+			nodes[node].size = size;
+			insertFreeNode(back);
+		}
+
+		MemoryNode& n = nodes[node];
+		n.free = false;
+		n.allocSize = size;
+		n.alignment = alignment;
+		n.userData = nullptr;
+		blocks[block].allocationCount++;
+		blocks[block].usedSize += n.size;
+		return node;
+	}
+
+	void DeviceMemoryPool::release(uint32_t node)
+	{
+		assert(!nodes[node].free && "memory range is freed twice");
+		DeviceMemoryBlock& block = blocks[nodes[node].block];
+		block.allocationCount--;
+		block.usedSize -= nodes[node].size;
+		nodes[node].userData = nullptr;
+
+		// merge with the free neighbours on both sides, so free ranges never touch
+		const uint32_t prev = nodes[node].prevPhysical;
+		if (prev != INVALID_MEMORY_NODE && nodes[prev].free)
+		{
+			removeFreeNode(prev);
+			nodes[prev].size += nodes[node].size;
+			nodes[prev].nextPhysical = nodes[node].nextPhysical;
+			if (nodes[prev].nextPhysical != INVALID_MEMORY_NODE) { nodes[nodes[prev].nextPhysical].prevPhysical = prev; }
+			destroyNode(node);
+			node = prev;
+		}
+		const uint32_t next = nodes[node].nextPhysical;
+		if (next != INVALID_MEMORY_NODE && nodes[next].free)
+		{
+			removeFreeNode(next);
+			nodes[node].size += nodes[next].size;
+			nodes[node].nextPhysical = nodes[next].nextPhysical;
+			if (nodes[node].nextPhysical != INVALID_MEMORY_NODE) { nodes[nodes[node].nextPhysical].prevPhysical = node; }
+			destroyNode(next);
+		}
+		insertFreeNode(node);
+	}
+
+	uint32_t DeviceMemoryPool::addBlockSlot()
 	{
-		VkDeviceSize reqAllocSize = ((alloc.size / pageSize) + 1) * pageSize;
+		for (uint32_t i = 0; i < blocks.size(); ++i)
+		{
+			if (blocks[i].memory == VK_NULL_HANDLE) { return i; }
+		}
+		blocks.emplace_back();
+		return static_cast<uint32_t>(blocks.size() - 1);
+	}
 
-		OffsetSizePair span = { alloc.offset, reqAllocSize };
+	void DeviceMemoryPool::addBlockRange(uint32_t block)
+	{
+		const uint32_t node = createNode();
+		nodes[node].size = blocks[block].size;
+		nodes[node].block = block;
+		blocks[block].firstNode = node;
+		insertFreeNode(node);
+	}
 
-		DeviceMemoryPool& pool = pools[alloc.memoryType];
-		pool.getBlock(alloc.id).pageReserved = false;
+	void DeviceMemoryPool::removeBlockRange(uint32_t block)
+	{
+		const uint32_t node = blocks[block].firstNode;
+		assert(node != INVALID_MEMORY_NODE && nodes[node].free && nodes[node].size == blocks[block].size
+				&& "only empty blocks can be removed");
+		removeFreeNode(node);
+		destroyNode(node);
+		blocks[block].firstNode = INVALID_MEMORY_NODE;
+	}
 
-		bool found = false;
+	void DeviceMemoryPool::setBlockExcluded(uint32_t block, bool excluded)
+	{
+		if (blocks[block].excluded == excluded) { return; }
+		if (excluded)
+		{
+			for (uint32_t n = blocks[block].firstNode; n != INVALID_MEMORY_NODE; n = nodes[n].nextPhysical)
+			{ if (nodes[n].free) { removeFreeNode(n); } }
+			blocks[block].excluded = true;
+		}
+		else
+		{
+			blocks[block].excluded = false;
+			for (uint32_t n = blocks[block].firstNode; n != INVALID_MEMORY_NODE; n = nodes[n].nextPhysical)
+			{ if (nodes[n].free) { insertFreeNode(n); } }
+		}
+	}
 
-		uint32_t numLayoutMems = pool.getBlock(alloc.id).layout.size();
-		for (uint32_t j = 0; j < numLayoutMems; ++j)
+	void DeviceMemoryPool::validate() const
+	{
+		auto fail = [](const std::string& what) { throw std::runtime_error("memory pool invalid: " + what); };
+		uint32_t listedFreeNodes = 0;
+		for (uint32_t b = 0; b < blocks.size(); ++b)
 		{
-			if (pool.getBlock(alloc.id).layout[j].offset == reqAllocSize + alloc.offset)
+			const DeviceMemoryBlock& block = blocks[b];
+			const std::string name = "block " + std::to_string(b);
+			if (block.memory == VK_NULL_HANDLE || block.dedicated)
+			{
+				if (block.firstNode != INVALID_MEMORY_NODE) { fail(name + " has nodes but no shared memory"); }
+				continue;
+			}
+			// the nodes must tile the block without gaps or overlaps, in address order
+			VkDeviceSize end = 0;
+			VkDeviceSize used = 0;
+			uint32_t allocations = 0;
+			uint32_t prev = INVALID_MEMORY_NODE;
+			for (uint32_t n = block.firstNode; n != INVALID_MEMORY_NODE; n = nodes[n].nextPhysical)
 			{
-				pool.getBlock(alloc.id).layout[j].offset = alloc.offset;
-				pool.getBlock(alloc.id).layout[j].size += reqAllocSize;
-				found = true;
-				break;
+				const MemoryNode& node = nodes[n];
+				if (node.block != b) { fail(name + " links a node of another block"); }
+				if (node.prevPhysical != prev) { fail(name + " has a broken physical back link"); }
+				if (node.offset != end || node.size == 0) { fail(name + " has a gap, an overlap or an empty node"); }
+				if (node.free)
+				{
+					if (prev != INVALID_MEMORY_NODE && nodes[prev].free) { fail(name + " has two free neighbours"); }
+					if (!block.excluded) { listedFreeNodes++; }
+				}
+				else
+				{
+					if (node.offset % node.alignment != 0) { fail(name + " has a misaligned allocation"); }
+					if (node.size < node.allocSize) { fail(name + " has an allocation smaller than requested"); }
+					used += node.size;
+					allocations++;
+				}
+				end = node.offset + node.size;
+				prev = n;
 			}
+			if (end != block.size) { fail(name + " nodes do not cover the block"); }
+			if (used != block.usedSize || allocations != block.allocationCount) { fail(name + " usage counters are off"); }
 		}
 
-		if (!found)
+		// every free node of an included block is in the bin of its size, bins and bitmaps agree
+		uint32_t binnedFreeNodes = 0;
+		for (uint32_t fl = 0; fl < FL_COUNT; fl++)
 		{
-			pools[alloc.memoryType].getBlock(alloc.id).layout.push_back(span);
-			memTypeAllocSizes[alloc.memoryType] -= reqAllocSize;
+			if (((flBitmap >> fl) & 1) != (slBitmaps[fl] != 0 ? 1u : 0u)) { fail("first level bitmap out of date"); }
+			for (uint32_t sl = 0; sl < SL_COUNT; sl++)
+			{
+				const uint32_t head = freeHeads[fl * SL_COUNT + sl];
+				if (((slBitmaps[fl] >> sl) & 1) != (head != INVALID_MEMORY_NODE ? 1u : 0u)) { fail("second level bitmap out of date"); }
+				uint32_t prev = INVALID_MEMORY_NODE;
+				for (uint32_t n = head; n != INVALID_MEMORY_NODE; n = nodes[n].nextFree)
+				{
+					const MemoryNode& node = nodes[n];
+					uint32_t nodeFl, nodeSl;
+					mapping(node.size, nodeFl, nodeSl);
+					if (!node.free || blocks[node.block].excluded) { fail("free list holds a used or excluded node"); }
+					if (nodeFl != fl || nodeSl != sl) { fail("free node is in the wrong bin"); }
+					if (node.prevFree != prev) { fail("free list has a broken back link"); }
+					if (++binnedFreeNodes > nodes.size()) { fail("free list has a cycle"); }
+					prev = n;
+				}
+			}
 		}
+		if (binnedFreeNodes != listedFreeNodes) { fail("free lists and blocks disagree on the free node count"); }
 	}
 
-	bool DeviceMemoryAllocator::findSpaceInPoolForAlloc(BlockSpanIndexPair& locationOut,
-		uint32_t memType, VkDeviceSize size, bool needsWholePage)
+	// ---- DeviceMemoryAllocator ----
+
+	// forwards to vulkan, memory is allocated from the device's logical device
+	class VulkanDeviceMemory : public DeviceMemoryInterface
 	{
-		DeviceMemoryPool& pool = pools[memType];
+	public:
+		VulkanDeviceMemory(EngineDevice& device) : device{ device }
+		{
+			if (device.getPhysicalDevice() == VK_NULL_HANDLE) { throw std::runtime_error("allocator error, invalid VkPhysicalDevice"); }
+		}
+		VkPhysicalDeviceMemoryProperties getMemoryProperties() override
+		{
+			VkPhysicalDeviceMemoryProperties properties{};
+			vkGetPhysicalDeviceMemoryProperties(device.getPhysicalDevice(), &properties);
+			return properties;
+		}
+		VkDeviceSize getNonCoherentAtomSize() override
+		{
+			VkPhysicalDeviceProperties properties;
+			vkGetPhysicalDeviceProperties(device.getPhysicalDevice(), &properties);
+			return properties.limits.nonCoherentAtomSize;
+		}
+		VkResult allocateMemory(const VkMemoryAllocateInfo& info, VkDeviceMemory& memory) override
+		{ return vkAllocateMemory(device.device(), &info, nullptr, &memory); }
+		void freeMemory(VkDeviceMemory memory) override { vkFreeMemory(device.device(), memory, nullptr); }
+		VkResult mapMemory(VkDeviceMemory memory, void*& data) override
+		{ return vkMapMemory(device.device(), memory, 0, VK_WHOLE_SIZE, 0, &data); }
+		void unmapMemory(VkDeviceMemory memory) override { vkUnmapMemory(device.device(), memory); }
+
+	private:
+		EngineDevice& device;
+	};
 
-		for (uint32_t i = 0; i < pool.blocks.size(); ++i)
+	DeviceMemoryAllocator::DeviceMemoryAllocator(EngineDevice& device)
+		: ownedDriver{ std::make_unique<VulkanDeviceMemory>(device) }, driver{ *ownedDriver }
+	{
+		memoryProperties = driver.getMemoryProperties();
+		memTypeAllocSizes.resize(memoryProperties.memoryTypeCount);
+		pools.resize(memoryProperties.memoryTypeCount * 2);
+		nonCoherentAtomSize = std::max<VkDeviceSize>(1, driver.getNonCoherentAtomSize());
+	}
+
+	DeviceMemoryAllocator::DeviceMemoryAllocator(DeviceMemoryInterface& driverIn) : driver{ driverIn }
+	{
+		memoryProperties = driver.getMemoryProperties();
+		memTypeAllocSizes.resize(memoryProperties.memoryTypeCount);
+		pools.resize(memoryProperties.memoryTypeCount * 2);
+		nonCoherentAtomSize = std::max<VkDeviceSize>(1, driver.getNonCoherentAtomSize());
+	}
+
+	DeviceMemoryAllocator::~DeviceMemoryAllocator()
+	{
+		// resources which are still alive lose their memory here, they must not be used anymore
+		for (auto& pool : pools)
 		{
-			for (uint32_t j = 0; j < pool.getBlock(i).layout.size(); ++j)
+			for (uint32_t i = 0; i < pool.blocks.size(); ++i)
 			{
-				bool validOffset = needsWholePage ? pool.getBlock(i).layout[j].offset == 0 : true;
-				if (pool.getBlock(i).layout[j].size >= size && validOffset)
+				if (pool.blocks[i].memory != VK_NULL_HANDLE) { freeBlock(pool, i); }
+			}
+		}
+	}
+
+	VkDeviceSize DeviceMemoryAllocator::getBlockSize(uint32_t memType) const
+	{
+		// small heaps (e.g. the 256 MB host-visible device-local heap) get smaller blocks
+		const VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[memType].heapIndex].size;
+		return std::min(PREFERRED_BLOCK_SIZE, std::max<VkDeviceSize>(heapSize / 8, 1024 * 1024));
+	}
+
+	uint32_t DeviceMemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+	{
+		for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+		{
+			if ((typeFilter & (1u << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) { return i; }
+		}
+		throw std::runtime_error("failed to find suitable memory type!");
+	}
+
+	void DeviceMemoryAllocator::validate()
+	{
+		std::lock_guard<std::mutex> g(lock);
+		for (const auto& pool : pools) { pool.validate(); }
+	}
+
+	void DeviceMemoryAllocator::alloc(Allocation& allocOut, const VkMemoryRequirements& requirements,
+									VkMemoryPropertyFlags properties, bool linear, bool dedicated)
+	{
+		const uint32_t memType = findMemoryType(requirements.memoryTypeBits, properties);
+		const VkMemoryPropertyFlags typeFlags = memoryProperties.memoryTypes[memType].propertyFlags;
+		// mapped ranges of non-coherent memory are flushed in whole atoms, so neighbours must not share one
+		VkDeviceSize alignment = std::max<VkDeviceSize>(1, requirements.alignment);
+		VkDeviceSize size = requirements.size;
+		if ((typeFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && !(typeFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+		{
+			alignment = std::max(alignment, nonCoherentAtomSize);
+			size = alignUp(size, nonCoherentAtomSize);
+		}
+
+		std::lock_guard<std::mutex> g(lock);
+		DeviceMemoryPool& pool = getPool(memType, linear);
+		allocOut = Allocation{};
+		allocOut.memoryType = memType;
+		allocOut.linear = linear;
+
+		// large resources get a block of their own, so they do not leave most of a shared block unused
+		const VkDeviceSize blockSize = getBlockSize(memType);
+		if (dedicated || size > blockSize / 2)
+		{
+			const uint32_t block = addBlockToPool(pool, size, memType, true);
+			DeviceMemoryBlock& b = pool.getBlock(block);
+			b.allocationCount = 1;
+			b.usedSize = size;
+			allocOut.memoryBlockHandle = b.memory;
+			allocOut.size = size;
+			allocOut.id = block;
+			allocOut.mapped = b.mapped;
+		}
+		else
+		{
+			uint32_t node = pool.allocate(size, alignment);
+			if (node == INVALID_MEMORY_NODE)
+			{
+				addBlockToPool(pool, blockSize, memType, false);
+				node = pool.allocate(size, alignment);
+				if (node == INVALID_MEMORY_NODE) { throw std::runtime_error("allocation failed, resource does not fit a new block"); }
+			}
+			setAllocation(allocOut, pool, node);
+		}
+		memTypeAllocSizes[memType] += allocOut.size;
+		numAllocsTotal++;
+	}
+
+	void DeviceMemoryAllocator::free(Allocation& alloc)
+	{
+		if (alloc.memoryBlockHandle == VK_NULL_HANDLE) { return; }
+		std::lock_guard<std::mutex> g(lock);
+		DeviceMemoryPool& pool = getPool(alloc.memoryType, alloc.linear);
+		DeviceMemoryBlock& block = pool.getBlock(alloc.id);
+		assert(block.memory == alloc.memoryBlockHandle && "allocation does not belong to this allocator");
+
+		memTypeAllocSizes[alloc.memoryType] -= alloc.size;
+		numAllocsTotal--;
+
+		if (block.dedicated) { freeBlock(pool, alloc.id); }
+		else
+		{
+			pool.release(alloc.node);
+			// one empty block per pool is kept, so short-lived resources (staging buffers) do not reallocate it every time
+			if (block.allocationCount == 0)
+			{
+				for (uint32_t i = 0; i < pool.blocks.size(); ++i)
+				{
+					const DeviceMemoryBlock& other = pool.blocks[i];
+					if (i != alloc.id && other.memory != VK_NULL_HANDLE && !other.dedicated && other.allocationCount == 0)
+					{
+						pool.removeBlockRange(alloc.id);
+						freeBlock(pool, alloc.id);
+						break;
+					}
+				}
+			}
+		}
+		alloc = Allocation{};
+	}
+
+	VkMappedMemoryRange DeviceMemoryAllocator::getMappedRange(const Allocation& allocation, VkDeviceSize size,
+															VkDeviceSize offset) const
+	{
+		assert(offset <= allocation.size && "mapped range outside of the allocation");
+		if (size == VK_WHOLE_SIZE) { size = allocation.size - offset; }
+		const VkDeviceSize begin = (allocation.offset + offset) / nonCoherentAtomSize * nonCoherentAtomSize;
+		const VkDeviceSize end = std::min(alignUp(allocation.offset + offset + size, nonCoherentAtomSize),
+										allocation.offset + allocation.size);
+		VkMappedMemoryRange range{};
+		range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+		range.memory = allocation.memoryBlockHandle;
+		range.offset = begin;
+		range.size = end - begin;
+		return range;
+	}
+
+	void DeviceMemoryAllocator::setUserData(const Allocation& allocation, void* userData)
+	{
+		// dedicated allocations are never moved
+		if (allocation.node == INVALID_MEMORY_NODE) { return; }
+		std::lock_guard<std::mutex> g(lock);
+		getPool(allocation.memoryType, allocation.linear).nodes[allocation.node].userData = userData;
+	}
+
+	uint32_t DeviceMemoryAllocator::defragment(const MoveCallback& move, VkDeviceSize maxBytes)
+	{
+		std::lock_guard<std::mutex> g(lock);
+		uint32_t releasedBlocks = 0;
+		VkDeviceSize movedBytes = 0;
+		for (uint32_t memType = 0; memType < memoryProperties.memoryTypeCount; memType++)
+		{
+			for (const bool linear : { true, false })
+			{
+				DeviceMemoryPool& pool = getPool(memType, linear);
+				// the least used shared block is emptied into the free space of the others
+				uint32_t source = INVALID_MEMORY_NODE;
+				uint32_t sharedBlocks = 0;
+				for (uint32_t i = 0; i < pool.blocks.size(); ++i)
 				{
-					locationOut.blockIndex = i;
-					locationOut.spanIndex = j;
-					return true;
+					const DeviceMemoryBlock& block = pool.blocks[i];
+					if (block.memory == VK_NULL_HANDLE || block.dedicated) { continue; }
+					sharedBlocks++;
+					if (source == INVALID_MEMORY_NODE || block.usedSize < pool.blocks[source].usedSize) { source = i; }
+				}
+				if (sharedBlocks < 2) { continue; }
+
+				std::vector<uint32_t> used;
+				for (uint32_t n = pool.blocks[source].firstNode; n != INVALID_MEMORY_NODE; n = pool.nodes[n].nextPhysical)
+				{ if (!pool.nodes[n].free) { used.push_back(n); } }
+
+				// allocations must not land in the block they are moved out of
+				pool.setBlockExcluded(source, true);
+				for (const uint32_t node : used)
+				{
+					if (maxBytes - movedBytes < pool.nodes[node].allocSize) { break; }
+					const uint32_t target = pool.allocate(pool.nodes[node].allocSize, pool.nodes[node].alignment);
+					if (target == INVALID_MEMORY_NODE) { break; }
+
+					Allocation from{}, to{};
+					from.memoryType = to.memoryType = memType;
+					from.linear = to.linear = linear;
+					setAllocation(from, pool, node);
+					setAllocation(to, pool, target);
+					void* userData = pool.nodes[node].userData;
+					if (move(from, to, userData))
+					{
+						pool.nodes[target].userData = userData;
+						pool.release(node);
+						movedBytes += to.size;
+					}
+					else { pool.release(target); }
+				}
+				pool.setBlockExcluded(source, false);
+
+				if (pool.blocks[source].allocationCount == 0)
+				{
+					pool.removeBlockRange(source);
+					freeBlock(pool, source);
+					releasedBlocks++;
 				}
 			}
 		}
-		return false;
+		return releasedBlocks;
 	}
 
-	uint32_t DeviceMemoryAllocator::addBlockToPool(VkDeviceSize size, uint32_t memType, bool fitToAlloc)
+	void DeviceMemoryAllocator::setAllocation(Allocation& allocOut, DeviceMemoryPool& pool, uint32_t node)
 	{
-		VkDeviceSize newSize = size * 2;
-		newSize = (newSize < blockMinSize) ? blockMinSize : newSize;
+		const MemoryNode& n = pool.nodes[node];
+		const DeviceMemoryBlock& block = pool.getBlock(n.block);
+		allocOut.memoryBlockHandle = block.memory;
+		allocOut.offset = n.offset;
+		allocOut.size = n.allocSize;
+		allocOut.id = n.block;
+		allocOut.node = node;
+		allocOut.mapped = block.mapped ? static_cast<char*>(block.mapped) + n.offset : nullptr;
+	}
 
-		VkMemoryAllocateInfo info = makeMemoryAllocateInfo(newSize, memType);
+	uint32_t DeviceMemoryAllocator::addBlockToPool(DeviceMemoryPool& pool, VkDeviceSize size, uint32_t memType,
+													bool dedicated)
+	{
+		VkMemoryAllocateInfo info = makeMemoryAllocateInfo(size, memType);
 
-		DeviceMemoryBlock newBlock = {};
-		VkResult res = vkAllocateMemory(device.device(), &info, nullptr, &newBlock.mem.memoryBlockHandle);
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkResult res = driver.allocateMemory(info, memory);
 
 		if (res == VK_ERROR_TOO_MANY_OBJECTS)
 		{
 			throw std::runtime_error("allocation failed, limit exceeded");
 		}
-		if (res == VK_ERROR_OUT_OF_DEVICE_MEMORY)
+		if (res == VK_ERROR_OUT_OF_DEVICE_MEMORY || res == VK_ERROR_OUT_OF_HOST_MEMORY)
 		{
 			throw std::runtime_error("allocation failed, out of device memory");
 		}
@@ -127,25 +623,36 @@ namespace EngineCore
 			throw std::runtime_error("allocation failed, unknown error");
 		}
 
+		// persistent mapping, vkMapMemory cannot be called again for a block while it is mapped
+		void* mapped = nullptr;
+		if (memoryProperties.memoryTypes[memType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+		{
+			if (driver.mapMemory(memory, mapped) != VK_SUCCESS)
+			{
+				driver.freeMemory(memory);
+				throw std::runtime_error("failed to map device memory block");
+			}
+		}
 
-		newBlock.mem.memoryType = memType;
-		newBlock.mem.size = newSize;
-
-		DeviceMemoryPool& pool = pools[memType];
-		pool.blocks.push_back(newBlock);
-
-		pool.getBlock(pool.blocks.size() - 1).layout.push_back({ 0, newSize });
-
-		numAllocsTotal++;
-
-		return pool.blocks.size() - 1;
+		const uint32_t index = pool.addBlockSlot();
+		DeviceMemoryBlock& block = pool.getBlock(index);
+		block = DeviceMemoryBlock{};
+		block.memory = memory;
+		block.size = size;
+		block.mapped = mapped;
+		block.dedicated = dedicated;
+		if (!dedicated) { pool.addBlockRange(index); }
+		numBlocksTotal++;
+		return index;
 	}
 
-	void DeviceMemoryAllocator::markMemoryUsedInBlock(uint32_t memType, BlockSpanIndexPair location, VkDeviceSize size)
+	void DeviceMemoryAllocator::freeBlock(DeviceMemoryPool& pool, uint32_t block)
 	{
-		DeviceMemoryPool& pool = pools[memType];
-		pool.getBlock(location.blockIndex).layout[location.spanIndex].offset += size;
-		pool.getBlock(location.blockIndex).layout[location.spanIndex].size -= size;
+		DeviceMemoryBlock& b = pool.getBlock(block);
+		if (b.mapped) { driver.unmapMemory(b.memory); }
+		driver.freeMemory(b.memory);
+		b = DeviceMemoryBlock{};
+		numBlocksTotal--;
 	}
 
-} // namespace
\ No newline at end of file
+} // namespace
@@ -1,76 +1,217 @@
 #pragma once
 
-#include "Core/GPU/engine_device.h"
-#include <stdint.h> // should not be necessary
+#include <vulkan/vulkan.h>
 
+// std
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
 
-namespace EngineCore 
+namespace EngineCore
 {
+	class EngineDevice;
+
+	static constexpr uint32_t INVALID_MEMORY_NODE = UINT32_MAX;
+
 	// info about an individual resource and where it is in device memory
 	struct Allocation
 	{
 		// size of the resource
-		VkDeviceSize size;
+		VkDeviceSize size = 0;
 		// offset within memory block
-		VkDeviceSize offset;
+		VkDeviceSize offset = 0;
 		// type of memory the resource resides in
-		uint32_t memoryType;
+		uint32_t memoryType = 0;
 		// parent block
-		VkDeviceMemory memoryBlockHandle;
-		uint32_t id;
+		VkDeviceMemory memoryBlockHandle = VK_NULL_HANDLE;
+		// index of the parent block within its pool
+		uint32_t id = 0;
+		// range of the block owned by this allocation, INVALID_MEMORY_NODE for dedicated allocations
+		uint32_t node = INVALID_MEMORY_NODE;
+		// linear resources (buffers) and optimal-tiling images live in separate pools
+		bool linear = true;
+		// host address of the allocation, the whole block stays mapped while it exists, null if not host visible
+		void* mapped = nullptr;
 	};
 
-	struct OffsetSizePair { uint64_t offset; uint64_t size; };
-	struct BlockSpanIndexPair { uint32_t blockIndex; uint32_t spanIndex; };
+	// a range of a memory block, either owned by an allocation or free
+	struct MemoryNode
+	{
+		VkDeviceSize offset = 0;
+		VkDeviceSize size = 0;
+		uint32_t block = 0;
+		// neighbours in address order within the same block
+		uint32_t prevPhysical = INVALID_MEMORY_NODE;
+		uint32_t nextPhysical = INVALID_MEMORY_NODE;
+		// neighbours in the free list of the same size class, only used while free
+		uint32_t prevFree = INVALID_MEMORY_NODE;
+		uint32_t nextFree = INVALID_MEMORY_NODE;
+		bool free = true;
+		// requested size, alignment and owner of the allocation, used when it is moved by defragment
+		VkDeviceSize allocSize = 0;
+		VkDeviceSize alignment = 1;
+		void* userData = nullptr;
+	};
 
-	// an allocation block which may contain multiple individual allocations
+	// one vkAllocateMemory, shared by many allocations unless it is dedicated
 	struct DeviceMemoryBlock
 	{
-		Allocation mem; // alloc for the block itself
-		std::vector<OffsetSizePair> layout;
-		bool pageReserved;
+		VkDeviceMemory memory = VK_NULL_HANDLE; // null if the slot is unused
+		VkDeviceSize size = 0;
+		void* mapped = nullptr;
+		uint32_t allocationCount = 0;
+		VkDeviceSize usedSize = 0;
+		// node at offset 0, the start of the physical node list
+		uint32_t firstNode = INVALID_MEMORY_NODE;
+		// holds a single large resource and is not managed by the free lists
+		bool dedicated = false;
+		// free ranges of this block are kept out of the free lists while its allocations are moved away
+		bool excluded = false;
 	};
 
-	// a collection of memory blocks
+	/*	the blocks of one memory type and their free ranges, managed as a two-level segregated fit (TLSF) allocator:
+		free ranges are binned by size class (power of two, split into SL_COUNT linear steps),
+		two levels of bitmaps find a non-empty bin that is large enough in constant time,
+		freed ranges merge with free neighbours of the same block immediately, independent of the vulkan side */
 	struct DeviceMemoryPool
 	{
+		static constexpr uint32_t SL_LOG2 = 5;
+		static constexpr uint32_t SL_COUNT = 1u << SL_LOG2;
+		static constexpr uint32_t FL_COUNT = 64 - SL_LOG2 + 1;
+		// the remainder of a free range is left with the allocation if it is smaller than this
+		static constexpr VkDeviceSize MIN_SPLIT_SIZE = 256;
+
 		std::vector<DeviceMemoryBlock> blocks;
+		std::vector<MemoryNode> nodes;
+		std::vector<uint32_t> unusedNodes;
+
+		uint64_t flBitmap = 0;
+		std::array<uint32_t, FL_COUNT> slBitmaps{};
+		std::array<uint32_t, FL_COUNT * SL_COUNT> freeHeads;
+
+		DeviceMemoryPool() { freeHeads.fill(INVALID_MEMORY_NODE); }
 
 		DeviceMemoryBlock& getBlock(uint32_t i) { return blocks[i]; }
+
+		// returns a free slot for a block, slots of freed blocks are reused so indices of live allocations stay valid
+		uint32_t addBlockSlot();
+		// makes the whole block one free range
+		void addBlockRange(uint32_t block);
+		// removes the single free range of an empty block, before its slot is released
+		void removeBlockRange(uint32_t block);
+
+		// finds, aligns and splits a free range, returns INVALID_MEMORY_NODE if no block has enough space
+		uint32_t allocate(VkDeviceSize size, VkDeviceSize alignment);
+		// returns the range to the free lists, merged with its free neighbours
+		void release(uint32_t node);
+
+		// keeps the free ranges of a block out of (or puts them back into) the free lists, see defragment
+		void setBlockExcluded(uint32_t block, bool excluded);
+
+		/*	checks the node lists of every block and the free lists against each other,
+			throws std::runtime_error naming the first broken invariant, for tests */
+		void validate() const;
+
+	private:
+		static void mapping(VkDeviceSize size, uint32_t& fl, uint32_t& sl);
+		uint32_t findFreeNode(VkDeviceSize size);
+		void insertFreeNode(uint32_t node);
+		void removeFreeNode(uint32_t node);
+		uint32_t createNode();
+		void destroyNode(uint32_t node);
 	};
 
-	/* this allocator manages resources (e.g. textures) in device memory (vram) */
+	/*	the driver side of the allocator, memory properties and the vkAllocateMemory/vkMapMemory family of calls,
+		the device implements it with vulkan, tests (see Tools/AllocatorFuzz) with host memory */
+	class DeviceMemoryInterface
+	{
+	public:
+		virtual ~DeviceMemoryInterface() = default;
+		virtual VkPhysicalDeviceMemoryProperties getMemoryProperties() = 0;
+		virtual VkDeviceSize getNonCoherentAtomSize() = 0;
+		virtual VkResult allocateMemory(const VkMemoryAllocateInfo& info, VkDeviceMemory& memory) = 0;
+		virtual void freeMemory(VkDeviceMemory memory) = 0;
+		// maps the whole block
+		virtual VkResult mapMemory(VkDeviceMemory memory, void*& data) = 0;
+		virtual void unmapMemory(VkDeviceMemory memory) = 0;
+	};
+
+	/*	this allocator manages resources (e.g. textures) in device memory (vram),
+		resources are placed in large blocks so the number of driver allocations stays far below maxMemoryAllocationCount,
+		linear and optimal-tiling resources never share a block, which keeps bufferImageGranularity from applying,
+		host-visible blocks are mapped once when they are created, thread safe */
 	class DeviceMemoryAllocator
 	{
 	public:
 		DeviceMemoryAllocator(EngineDevice& device);
+		// the driver must outlive the allocator
+		DeviceMemoryAllocator(DeviceMemoryInterface& driver);
 		~DeviceMemoryAllocator();
 
-		// find space for a resource and assign it to a location in device memory
-		void alloc(Allocation& allocOut, VkDeviceSize size, uint32_t memType, VkMemoryPropertyFlags usage);
+		DeviceMemoryAllocator(const DeviceMemoryAllocator&) = delete;
+		DeviceMemoryAllocator& operator=(const DeviceMemoryAllocator&) = delete;
+
+		/*	find space for a resource and assign it to a location in device memory,
+			linear is false for images with optimal tiling, dedicated forces a block of its own (e.g. for render targets),
+			resources above half of the block size always get one, throws if no memory is left */
+		void alloc(Allocation& allocOut, const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties,
+					bool linear, bool dedicated = false);
 		// clears the memory of a resource, remember to stop using the associated resource
 		void free(Allocation& allocation);
 
+		/*	range for vkFlushMappedMemoryRanges/vkInvalidateMappedMemoryRanges, relative to the allocation,
+			rounded out to nonCoherentAtomSize, VK_WHOLE_SIZE covers the rest of the allocation */
+		VkMappedMemoryRange getMappedRange(const Allocation& allocation, VkDeviceSize size, VkDeviceSize offset) const;
+
+		// the owner of an allocation, passed to the defragment callback so it can find the resource to move
+		void setUserData(const Allocation& allocation, void* userData);
+
+		/*	copies the contents of the resource to the new allocation and rebinds it, the copy must be complete on return,
+			returns false to keep the resource where it is, must not call back into the allocator */
+		using MoveCallback = std::function<bool(const Allocation& from, const Allocation& to, void* userData)>;
+		/*	moves allocations out of the least used block of every pool into free space of the other blocks,
+			up to maxBytes in total, blocks which end up empty are released, returns the number of released blocks,
+			call it when the device is idle (e.g. after a level is unloaded) */
+		uint32_t defragment(const MoveCallback& move, VkDeviceSize maxBytes = VK_WHOLE_SIZE);
+
 		// returns the currently allocated size of the specified memory type
 		size_t getAllocMemTypeSize(uint32_t memoryType) { return memTypeAllocSizes[memoryType]; }
 		// returns the total number of resources allocated across all memory types
 		const uint32_t& getNumAllocs() { return numAllocsTotal; }
+		// number of vkAllocateMemory calls currently alive
+		uint32_t getNumBlocks() const { return numBlocksTotal; }
+
+		// runs DeviceMemoryPool::validate on every pool
+		void validate();
 
 	private:
-		EngineDevice& device;
+		// set if the allocator created the driver itself (from an EngineDevice)
+		std::unique_ptr<DeviceMemoryInterface> ownedDriver;
+		DeviceMemoryInterface& driver;
+		VkPhysicalDeviceMemoryProperties memoryProperties{};
+		std::mutex lock;
 
-		// each pool corresponds to a memory type
+		// two pools per memory type, see getPool
 		std::vector<DeviceMemoryPool> pools;
+		DeviceMemoryPool& getPool(uint32_t memType, bool linear) { return pools[memType * 2 + (linear ? 0 : 1)]; }
 
-		// total number of allocated blocks
+		// total number of allocated resources
 		uint32_t numAllocsTotal = 0;
+		uint32_t numBlocksTotal = 0;
 		// allocation sizes for each memory type
 		std::vector<size_t> memTypeAllocSizes;
 
-		// pagesize is set based on gpu bufferImageGranularity
-		uint32_t pageSize;
-		VkDeviceSize blockMinSize;
-		
+		// mapped ranges of non-coherent memory must be aligned to this
+		VkDeviceSize nonCoherentAtomSize;
+		// preferred block size, resources above half of it get a block of their own
+		static constexpr VkDeviceSize PREFERRED_BLOCK_SIZE = 64ull * 1024 * 1024;
+		VkDeviceSize getBlockSize(uint32_t memType) const;
+		// first memory type allowed by typeFilter that has all the properties, throws if there is none
+		uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+
 		inline VkMemoryAllocateInfo makeMemoryAllocateInfo(VkDeviceSize size, uint32_t memType)
 		{
 			VkMemoryAllocateInfo allocInfo = {};
@@ -80,18 +221,12 @@ namespace EngineCore
 			return allocInfo;
 		}
 
-		// checks all blocks in pool and returns a chunk of free memory that can fit the allocation
-		bool findSpaceInPoolForAlloc(BlockSpanIndexPair& locationOut,
-					uint32_t memType, VkDeviceSize size, bool needsWholePage);
-
-		// adds a new block to the specified pool
-		uint32_t addBlockToPool(VkDeviceSize size,
-					uint32_t memType, bool fitToAlloc);
-
-		void markMemoryUsedInBlock(uint32_t memType, BlockSpanIndexPair location,
-					VkDeviceSize size);
-
+		// fills the allocation from a node of the pool
+		void setAllocation(Allocation& allocOut, DeviceMemoryPool& pool, uint32_t node);
 
+		// adds a new block to the specified pool, returns its index
+		uint32_t addBlockToPool(DeviceMemoryPool& pool, VkDeviceSize size, uint32_t memType, bool dedicated);
+		void freeBlock(DeviceMemoryPool& pool, uint32_t block);
 	};
 
 } // namespace
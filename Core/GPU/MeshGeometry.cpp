@@ -0,0 +1,109 @@
+#include "Core/GPU/MeshGeometry.h"
+#include "Core/GPU/Memory/UploadManager.h"
+
+#include <cassert>
+#include <stdexcept>
+
+namespace EngineCore
+{
+	MeshGeometry::MeshGeometry(EngineDevice& deviceIn, const void* vertexData, const uint32_t& vertexStride,
+							const uint32_t& numVertices, const std::vector<uint32_t>& indices, const BoundingBox& bounds,
+							const VertexFormat& format, const glm::mat4& decodeTransform, const std::vector<Lod>& levels)
+		: device{ deviceIn }, vertexCount{ numVertices }, indexCount{ static_cast<uint32_t>(indices.size()) }, localBounds{ bounds },
+		vertexFormat{ format }, vertexDecodeTransform{ decodeTransform }
+	{
+		setLods(levels);
+		if (vertexCount <= UINT16_MAX && indexCount > 0)
+		{
+			// halves index memory and bandwidth
+			const std::vector<uint16_t> indices16(indices.begin(), indices.end());
+			indexType = VK_INDEX_TYPE_UINT16;
+			upload(vertexData, vertexStride, indices16.data());
+			return;
+		}
+		upload(vertexData, vertexStride, indices.data());
+	}
+
+	MeshGeometry::MeshGeometry(EngineDevice& deviceIn, const void* vertexData, const uint32_t& vertexStride,
+							const uint32_t& numVertices, const void* indexData, const VkIndexType& type, const uint32_t& numIndices,
+							const BoundingBox& bounds, const VertexFormat& format, const glm::mat4& decodeTransform,
+							const std::vector<Lod>& levels)
+		: device{ deviceIn }, vertexCount{ numVertices }, indexCount{ numIndices }, indexType{ type }, localBounds{ bounds },
+		vertexFormat{ format }, vertexDecodeTransform{ decodeTransform }
+	{
+		assert((type == VK_INDEX_TYPE_UINT16 || type == VK_INDEX_TYPE_UINT32) && "unsupported index type");
+		setLods(levels);
+		upload(vertexData, vertexStride, indexData);
+	}
+
+	MeshGeometry::~MeshGeometry()
+	{
+		// the upload may not even be submitted yet, the buffers are released once it has completed
+		if (!uploaded.completed.valid()) { return; }
+		std::shared_ptr<GBuffer> vertices = std::move(vertexBuffer);
+		std::shared_ptr<GBuffer> indices = std::move(indexBuffer);
+		device.getUploads().releaseAfter(uploaded.value, [vertices, indices]() mutable { vertices.reset(); indices.reset(); });
+	}
+
+	void MeshGeometry::setLods(const std::vector<Lod>& levels)
+	{
+		if (levels.empty() || indexCount == 0)
+		{
+			lods.assign(1, Lod{ 0, indexCount, 0.f });
+			return;
+		}
+		if (levels.size() > MAX_LODS) { throw std::runtime_error("mesh has too many levels of detail"); }
+		for (const auto& lod : levels)
+		{
+			if (static_cast<uint64_t>(lod.firstIndex) + lod.indexCount > indexCount || lod.indexCount % 3 != 0)
+			{ throw std::runtime_error("mesh level of detail exceeds the index buffer"); }
+		}
+		lods = levels;
+		lods.back().screenSize = 0.f; // the last level is used for anything smaller
+	}
+
+	uint32_t MeshGeometry::selectLod(const float& screenSize) const
+	{
+		uint32_t lod = 0;
+		while (lod + 1 < lods.size() && screenSize < lods[lod].screenSize) { lod++; }
+		return lod;
+	}
+
+	void MeshGeometry::upload(const void* vertexData, const uint32_t& vertexStride, const void* indexData)
+	{
+		assert(vertexCount >= 3 && "vertexCount cannot be below 3");
+		vertexBuffer = createDeviceLocalBuffer(vertexData, vertexStride, vertexCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+		if (indexCount == 0) { return; }
+		const uint32_t indexSize = indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+		indexBuffer = createDeviceLocalBuffer(indexData, indexSize, indexCount, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+	}
+
+	std::unique_ptr<GBuffer> MeshGeometry::createDeviceLocalBuffer(const void* data, const uint32_t& elementSize,
+																const uint32_t& count, const VkBufferUsageFlags& usage)
+	{
+		// destination buffer, GPU only for speed (not host accessible)
+		auto buffer = std::make_unique<GBuffer>(device, elementSize, count, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+												VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		// the data is staged before this returns, frames submitted after the next flush wait for the copy on the GPU
+		uploaded = device.getUploads().uploadBuffer(buffer->getBuffer(), 0, data, (VkDeviceSize)elementSize * count);
+		return buffer;
+	}
+
+	void MeshGeometry::bind(VkCommandBuffer commandBuffer) const
+	{
+		device.getUploads().useInFrames(uploaded.value);
+		VkBuffer buffers[] = { vertexBuffer->getBuffer() };
+		VkDeviceSize offsets[] = { 0 };
+		vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+		if (indexBuffer) { vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, indexType); }
+	}
+
+	void MeshGeometry::draw(VkCommandBuffer commandBuffer, const uint32_t& instanceCount, const uint32_t& firstInstance,
+							const uint32_t& lod) const
+	{
+		assert(lod < lods.size() && "level of detail out of range");
+		if (indexBuffer) { vkCmdDrawIndexed(commandBuffer, lods[lod].indexCount, instanceCount, lods[lod].firstIndex, 0, firstInstance); }
+		else { vkCmdDraw(commandBuffer, vertexCount, instanceCount, 0, firstInstance); }
+	}
+
+} // namespace
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "Core/GPU/engine_device.h"
+#include "Core/GPU/Memory/Buffer.h"
+#include "Core/GPU/Memory/UploadManager.h"
+#include "Core/GPU/VertexFormat.h"
+#include "Core/Types/Bounds.h"
+
+#include <glm/glm.hpp>
+
+// std
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <vector>
+
+namespace EngineCore
+{
+	/*	device-local vertex and index buffers of a mesh, immutable after creation,
+		geometry is shared between primitives (std::shared_ptr) so identical meshes are uploaded once
+		and can be drawn instanced */
+	class MeshGeometry
+	{
+	public:
+		/*	index range of one level of detail, all levels share the vertex buffer,
+			level 0 is the full mesh, each further level has fewer triangles */
+		struct Lod
+		{
+			uint32_t firstIndex = 0;
+			uint32_t indexCount = 0;
+			// projected size (fraction of the screen height) below which the next level is used
+			float screenSize = 0.f;
+		};
+		static constexpr uint32_t MAX_LODS = 8;
+
+		/*	vertexData holds vertexCount vertices of vertexStride bytes each, an empty index array means non-indexed,
+			decodeTransform maps the stored positions to mesh space (identity unless positions are quantized),
+			without lods the whole index buffer is a single level */
+		MeshGeometry(EngineDevice& device, const void* vertexData, const uint32_t& vertexStride, const uint32_t& vertexCount,
+					const std::vector<uint32_t>& indices, const BoundingBox& localBounds,
+					const VertexFormat& format = VertexFormat::Float, const glm::mat4& decodeTransform = glm::mat4{ 1.f },
+					const std::vector<Lod>& lods = {});
+		// indexData is uploaded as is, it holds indexCount indices of the given type
+		MeshGeometry(EngineDevice& device, const void* vertexData, const uint32_t& vertexStride, const uint32_t& vertexCount,
+					const void* indexData, const VkIndexType& indexType, const uint32_t& indexCount, const BoundingBox& localBounds,
+					const VertexFormat& format, const glm::mat4& decodeTransform, const std::vector<Lod>& lods = {});
+
+		// buffers still written by a pending upload are released once it has completed, see UploadManager::releaseAfter
+		~MeshGeometry();
+
+		MeshGeometry(const MeshGeometry&) = delete;
+		MeshGeometry& operator=(const MeshGeometry&) = delete;
+
+		// binds the vertex buffer (binding 0) and index buffer, the frame waits for their upload if it is still pending
+		void bind(VkCommandBuffer commandBuffer) const;
+		void draw(VkCommandBuffer commandBuffer, const uint32_t& instanceCount = 1, const uint32_t& firstInstance = 0,
+				const uint32_t& lod = 0) const;
+
+		// the first level whose screen size threshold the given projected size reaches
+		uint32_t selectLod(const float& screenSize) const;
+		uint32_t getLodCount() const { return static_cast<uint32_t>(lods.size()); }
+		const Lod& getLod(const uint32_t& lod) const { return lods[lod]; }
+		uint32_t getTriangleCount(const uint32_t& lod = 0) const { return (indexBuffer ? lods[lod].indexCount : vertexCount) / 3; }
+
+		VkBuffer getVertexBufferHandle() const { return vertexBuffer->getBuffer(); }
+		uint32_t getVertexCount() const { return vertexCount; }
+		uint32_t getIndexCount() const { return indexCount; }
+		VkIndexType getIndexType() const { return indexType; }
+		const BoundingBox& getLocalBounds() const { return localBounds; }
+		VertexFormat getVertexFormat() const { return vertexFormat; }
+		// mesh-local transform to apply before the world transform (push constant transform)
+		const glm::mat4& getVertexDecodeTransform() const { return vertexDecodeTransform; }
+		// ready once the vertex and index data have been copied, the geometry can be drawn before that (see UploadManager)
+		const std::shared_future<void>& getUploadFuture() const { return uploaded.completed; }
+
+	private:
+		void upload(const void* vertexData, const uint32_t& vertexStride, const void* indexData);
+		// validates the given levels, or creates a single level covering all indices
+		void setLods(const std::vector<Lod>& levels);
+		// creates a device-local buffer, its data is copied asynchronously by the upload manager
+		std::unique_ptr<GBuffer> createDeviceLocalBuffer(const void* data, const uint32_t& elementSize,
+														const uint32_t& count, const VkBufferUsageFlags& usage);
+
+		EngineDevice& device;
+		std::unique_ptr<GBuffer> vertexBuffer;
+		uint32_t vertexCount = 0;
+		std::unique_ptr<GBuffer> indexBuffer;
+		uint32_t indexCount = 0;
+		// 16-bit indices are used whenever every vertex can be addressed with them
+		VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+		BoundingBox localBounds{};
+		VertexFormat vertexFormat = VertexFormat::Float;
+		glm::mat4 vertexDecodeTransform{ 1.f };
+		std::vector<Lod> lods;
+		// batches complete in order, so the future of the last upload covers both buffers
+		UploadManager::Ticket uploaded;
+	};
+
+} // namespace
@@ -0,0 +1,92 @@
+#include "Core/GPU/RenderQueue.h"
+#include "Core/ECS/Primitive.h"
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+namespace EngineCore
+{
+	static_assert((1u << RenderQueue::LOD_BITS) >= MeshGeometry::MAX_LODS, "sort key cannot hold every level of detail");
+
+	void RenderQueue::clear()
+	{
+		items.clear();
+		keys.clear();
+		sortedIndices.clear();
+		// ids are only meaningful within one frame
+		pipelineIds.clear();
+		descriptorSetIds.clear();
+		vertexBufferIds.clear();
+	}
+
+	void RenderQueue::add(ECS::Primitive* mesh, VkDescriptorSet descriptorSet, const Vec& viewPosition, const float& lodScale)
+	{
+		if (!mesh || !mesh->getMaterial()) { return; }
+		Material* material = mesh->getMaterial();
+		const float distanceSquared = Vec::distanceSquared(viewPosition, mesh->getTransform().translation);
+
+		// bounds radius over distance, the full level is used from inside the bounds
+		const float radius = mesh->getBounds().getHalfExtent().x;
+		const float screenSize = distanceSquared > radius * radius
+			? radius * lodScale / std::sqrt(distanceSquared) : std::numeric_limits<float>::max();
+		const uint32_t lod = mesh->getGeometry()->selectLod(screenSize);
+
+		const uint64_t pipeline = pipelineIds.get(material, PIPELINE_BITS);
+		const uint64_t set = descriptorSetIds.get(descriptorSet, DESCRIPTOR_SET_BITS);
+		const uint64_t vb = vertexBufferIds.get(mesh->getVertexBufferHandle(), VERTEX_BUFFER_BITS);
+		const uint64_t depth = quantizeDepth(distanceSquared);
+
+		keys.push_back((pipeline << (DESCRIPTOR_SET_BITS + VERTEX_BUFFER_BITS + LOD_BITS + DEPTH_BITS))
+					| (set << (VERTEX_BUFFER_BITS + LOD_BITS + DEPTH_BITS)) | (vb << (LOD_BITS + DEPTH_BITS))
+					| (static_cast<uint64_t>(lod) << DEPTH_BITS) | depth);
+		items.push_back(DrawItem{ mesh, material, descriptorSet, lod });
+	}
+
+	uint32_t RenderQueue::quantizeDepth(const float& distanceSquared)
+	{
+		// the bit pattern of a positive float increases monotonically with its value
+		uint32_t bits;
+		std::memcpy(&bits, &distanceSquared, sizeof(bits));
+		return bits >> (32 - DEPTH_BITS);
+	}
+
+	void RenderQueue::sort()
+	{
+		const uint32_t n = size();
+		sortedIndices.resize(n);
+		for (uint32_t i = 0; i < n; i++) { sortedIndices[i] = i; }
+		if (n < 2) { return; }
+		keysTemp.resize(n);
+		indicesTemp.resize(n);
+
+		// LSD radix sort, 8 passes of 8 bits, stable
+		uint64_t* srcKeys = keys.data(); uint64_t* dstKeys = keysTemp.data();
+		uint32_t* srcIdx = sortedIndices.data(); uint32_t* dstIdx = indicesTemp.data();
+		for (uint32_t shift = 0; shift < 64; shift += 8)
+		{
+			uint32_t offsets[256] = {};
+			for (uint32_t i = 0; i < n; i++) { offsets[(srcKeys[i] >> shift) & 0xFF]++; }
+			// every key has the same digit, the pass would not change the order
+			if (offsets[(srcKeys[0] >> shift) & 0xFF] == n) { continue; }
+			uint32_t sum = 0;
+			for (uint32_t& o : offsets) { const uint32_t c = o; o = sum; sum += c; }
+			for (uint32_t i = 0; i < n; i++)
+			{
+				const uint32_t d = offsets[(srcKeys[i] >> shift) & 0xFF]++;
+				dstKeys[d] = srcKeys[i];
+				dstIdx[d] = srcIdx[i];
+			}
+			std::swap(srcKeys, dstKeys);
+			std::swap(srcIdx, dstIdx);
+		}
+		// results may have ended up in the scratch arrays
+		if (srcKeys != keys.data())
+		{
+			keys.swap(keysTemp);
+			sortedIndices.swap(indicesTemp);
+		}
+	}
+
+} // namespace
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "Core/Types/CommonTypes.h"
+
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace ECS { class Primitive; }
+
+namespace EngineCore
+{
+	class Material;
+
+	/*	collects the draws of a frame and orders them to minimize state changes,
+		each draw gets a 64-bit key, high to low: pipeline | descriptor set | vertex buffer | level of detail | depth,
+		so draws sharing a pipeline end up adjacent, then draws sharing a set, and so on */
+	class RenderQueue
+	{
+	public:
+		struct DrawItem
+		{
+			ECS::Primitive* mesh;
+			Material* material;
+			VkDescriptorSet descriptorSet;
+			// level of detail of the mesh geometry, see MeshGeometry::selectLod
+			uint32_t lod;
+		};
+
+		// per-frame command counts, binds that were skipped as redundant are not counted
+		struct Stats
+		{
+			uint32_t draws = 0;
+			uint32_t instances = 0;
+			uint32_t pipelineBinds = 0;
+			uint32_t descriptorSetBinds = 0;
+			uint32_t vertexBufferBinds = 0;
+			// summed over all instances
+			uint64_t triangles = 0;
+			Stats& operator+=(const Stats& o)
+			{
+				draws += o.draws; instances += o.instances; pipelineBinds += o.pipelineBinds;
+				descriptorSetBinds += o.descriptorSetBinds; vertexBufferBinds += o.vertexBufferBinds; triangles += o.triangles;
+				return *this;
+			}
+		};
+
+		RenderQueue() = default;
+		RenderQueue(const RenderQueue&) = delete;
+		RenderQueue& operator=(const RenderQueue&) = delete;
+
+		void clear();
+		/*	meshes without a material are ignored, depth sorts front to back from the view position,
+			the level of detail is picked from the projected size of the mesh bounds,
+			lodScale converts bounds radius / distance into a fraction of the screen height (1 / tan(vertical fov / 2)) */
+		void add(ECS::Primitive* mesh, VkDescriptorSet descriptorSet, const Vec& viewPosition, const float& lodScale);
+		// radix sorts the draws by key, equal keys keep their insertion order
+		void sort();
+
+		uint32_t size() const { return static_cast<uint32_t>(items.size()); }
+		// valid after sort()
+		const DrawItem& getSorted(const uint32_t& i) const { return items[sortedIndices[i]]; }
+
+		// bit layout of the sort key
+		static constexpr uint32_t PIPELINE_BITS = 12;
+		static constexpr uint32_t DESCRIPTOR_SET_BITS = 12;
+		static constexpr uint32_t VERTEX_BUFFER_BITS = 16;
+		static constexpr uint32_t LOD_BITS = 3;
+		static constexpr uint32_t DEPTH_BITS = 21;
+		static_assert(PIPELINE_BITS + DESCRIPTOR_SET_BITS + VERTEX_BUFFER_BITS + LOD_BITS + DEPTH_BITS == 64,
+					"sort key must be 64 bits");
+
+	private:
+		std::vector<DrawItem> items;
+		std::vector<uint64_t> keys;
+		std::vector<uint32_t> sortedIndices;
+		// radix sort scratch
+		std::vector<uint64_t> keysTemp;
+		std::vector<uint32_t> indicesTemp;
+
+		/*	handles are mapped to small ids in order of first appearance within a frame, the ids only serve to group draws,
+			the tables are reset by clear(), so handles of destroyed objects are not kept around,
+			once a frame has used up all ids the remaining handles share the last one (less grouping, still correct) */
+		template<typename Handle>
+		struct IdTable
+		{
+			std::unordered_map<Handle, uint32_t> ids;
+			uint32_t get(const Handle& h, const uint32_t& bits)
+			{
+				auto it = ids.find(h);
+				if (it != ids.end()) { return it->second; }
+				const uint32_t maxId = static_cast<uint32_t>((1ull << bits) - 1);
+				if (ids.size() > maxId) { return maxId; }
+				const uint32_t id = static_cast<uint32_t>(ids.size());
+				ids.emplace(h, id);
+				return id;
+			}
+			void clear() { ids.clear(); }
+		};
+		IdTable<const Material*> pipelineIds;
+		IdTable<VkDescriptorSet> descriptorSetIds;
+		IdTable<VkBuffer> vertexBufferIds;
+
+		static uint32_t quantizeDepth(const float& distanceSquared);
+	};
+
+} // namespace
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+
+namespace EngineCore
+{
+	/*	vertex buffer layouts, a mesh material must be created with the format of the meshes it draws,
+		packed formats need shaders compiled with PACKED_VERTEX defined */
+	enum class VertexFormat : uint8_t
+	{
+		// ECS::Primitive::Vertex, 44 bytes, 32-bit floats
+		Float,
+		/*	ECS::Primitive::PackedVertex without color, 16 bytes,
+			16-bit position relative to the mesh bounds, octahedral normal and half precision uv */
+		Packed,
+		// ECS::Primitive::PackedVertex, 20 bytes, Packed followed by an 8-bit RGBA color
+		PackedColor
+	};
+
+} // namespace
@@ -1,6 +1,13 @@
 #include "Core/GPU/engine_device.h"
 #include "Core/application.h"
+#include "Core/GPU/Memory/UploadManager.h"
+#include "Core/GPU/Memory/VMemAllocator.h"
+#include "Core/Types/MappedFile.h"
+#include "Core/Types/Math.h"
+#include <algorithm>
 #include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <set>
 #include <unordered_set>
@@ -51,10 +58,18 @@ namespace EngineCore
 		pickPhysicalDevice();
 		createLogicalDevice();
 		createCommandPool();
+		createPipelineCache();
+		memoryAllocator = std::make_unique<DeviceMemoryAllocator>(*this);
+		uploads = std::make_unique<UploadManager>(*this);
 	}
 
 	EngineDevice::~EngineDevice() 
 	{
+		// pending uploads are completed first, their staging buffers belong to the allocator
+		uploads.reset();
+		memoryAllocator.reset();
+		savePipelineCache();
+		vkDestroyPipelineCache(device_, pipelineCache, nullptr);
 		vkDestroyCommandPool(device_, commandPool, nullptr);
 		vkDestroyDevice(device_, nullptr);
 
@@ -149,14 +164,27 @@ namespace EngineCore
 		std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 		std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily, indices.presentFamily };
 
-		float queuePriority = 1.0f;
+		/*	uploads go to a separate transfer family if there is one, else to a second queue of the graphics family,
+			with a single graphics queue they share it */
+		uint32_t graphicsFamilyQueueCount = 1;
+		if (indices.transferFamilyHasValue) { uniqueQueueFamilies.insert(indices.transferFamily); }
+		else
+		{
+			uint32_t familyCount = 0;
+			vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+			std::vector<VkQueueFamilyProperties> families(familyCount);
+			vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+			graphicsFamilyQueueCount = std::min(2u, families[indices.graphicsFamily].queueCount);
+		}
+
+		const float queuePriorities[] = { 1.0f, 1.0f };
 		for (uint32_t queueFamily : uniqueQueueFamilies) 
 		{
 			VkDeviceQueueCreateInfo queueCreateInfo = {};
 			queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
 			queueCreateInfo.queueFamilyIndex = queueFamily;
-			queueCreateInfo.queueCount = 1;
-			queueCreateInfo.pQueuePriorities = &queuePriority;
+			queueCreateInfo.queueCount = queueFamily == indices.graphicsFamily ? graphicsFamilyQueueCount : 1;
+			queueCreateInfo.pQueuePriorities = queuePriorities;
 			queueCreateInfos.push_back(queueCreateInfo);
 		}
 
@@ -166,6 +194,11 @@ namespace EngineCore
 		deviceFeatures1.fillModeNonSolid = VK_TRUE;
 		deviceFeatures1.wideLines = VK_TRUE;
 		deviceFeatures1.largePoints = VK_TRUE;
+		// optional, cooked textures fall back to uncompressed sources without it
+		VkPhysicalDeviceFeatures supportedFeatures;
+		vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+		deviceFeatures1.textureCompressionBC = supportedFeatures.textureCompressionBC;
+		blockCompressionSupported = supportedFeatures.textureCompressionBC == VK_TRUE;
 
 		VkPhysicalDeviceFeatures2 deviceFeatures2 = {};
 		deviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
@@ -175,6 +208,7 @@ namespace EngineCore
 		VkPhysicalDeviceVulkan12Features deviceFeatures12 = {};
 		deviceFeatures12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
 		deviceFeatures12.uniformBufferStandardLayout = VK_TRUE;
+		deviceFeatures12.timelineSemaphore = VK_TRUE; // upload completion, see UploadManager
 
 		deviceFeatures2.pNext = &deviceFeatures12;
 
@@ -196,6 +230,19 @@ namespace EngineCore
 
 		vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
 		vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+		uploadFamily_ = indices.transferFamilyHasValue ? indices.transferFamily : indices.graphicsFamily;
+		vkGetDeviceQueue(device_, uploadFamily_, indices.transferFamilyHasValue ? 0 : graphicsFamilyQueueCount - 1, &uploadQueue_);
+		uploadSharingFamilies[0] = indices.graphicsFamily;
+		uploadSharingFamilies[1] = uploadFamily_;
+	}
+
+	void EngineDevice::setUploadSharing(bool transferDst, VkSharingMode& mode, uint32_t& familyCount,
+										const uint32_t*& families) const
+	{
+		if (!transferDst || uploadSharingFamilies[0] == uploadSharingFamilies[1]) { return; }
+		mode = VK_SHARING_MODE_CONCURRENT;
+		familyCount = 2;
+		families = uploadSharingFamilies;
 	}
 
 	void EngineDevice::createCommandPool() 
@@ -213,6 +260,102 @@ namespace EngineCore
 		}
 	}
 
+	/*	the driver's own header (VkPipelineCacheHeaderVersionOne) identifies the device but not the driver version,
+		so the cache data is wrapped in a header of our own, a hash also catches truncated or corrupted files */
+	struct PipelineCacheFileHeader
+	{
+		static constexpr uint32_t MAGIC = 0x43504B56; // "VKPC"
+		static constexpr uint32_t VERSION = 1;
+
+		uint32_t magic = MAGIC;
+		uint32_t version = VERSION;
+		uint32_t vendorID = 0;
+		uint32_t deviceID = 0;
+		uint32_t driverVersion = 0;
+		uint32_t reserved = 0;
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE]{};
+		uint64_t dataSize = 0;
+		uint64_t dataHash = 0; // FNV-1a of the cache data
+	};
+	static_assert(sizeof(PipelineCacheFileHeader) == 56, "pipeline cache header layout changed, increment VERSION");
+
+	// next to the other engine resources, not in whatever directory the engine was started from
+	static std::string getPipelineCachePath() { return makePath("pipeline_cache.bin"); }
+
+	void EngineDevice::createPipelineCache()
+	{
+		// a cache from another device or driver would be rejected by the driver at best, it is not passed on
+		MappedFile file{};
+		const void* initialData = nullptr;
+		size_t initialSize = 0;
+		const std::string path = getPipelineCachePath();
+		if (file.open(path) && file.size() >= sizeof(PipelineCacheFileHeader))
+		{
+			const PipelineCacheFileHeader* header = reinterpret_cast<const PipelineCacheFileHeader*>(file.data());
+			const uint8_t* data = file.data() + sizeof(PipelineCacheFileHeader);
+			const VkPipelineCacheHeaderVersionOne* driverHeader = reinterpret_cast<const VkPipelineCacheHeaderVersionOne*>(data);
+			const bool valid = header->magic == PipelineCacheFileHeader::MAGIC && header->version == PipelineCacheFileHeader::VERSION
+				&& header->vendorID == properties.vendorID && header->deviceID == properties.deviceID
+				&& header->driverVersion == properties.driverVersion
+				&& std::memcmp(header->pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0
+				&& header->dataSize >= sizeof(VkPipelineCacheHeaderVersionOne)
+				&& header->dataSize == file.size() - sizeof(PipelineCacheFileHeader)
+				&& Math::fnv1a64(data, static_cast<size_t>(header->dataSize)) == header->dataHash
+				&& driverHeader->headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+				&& driverHeader->vendorID == properties.vendorID && driverHeader->deviceID == properties.deviceID
+				&& std::memcmp(driverHeader->pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+			if (valid)
+			{
+				initialData = data;
+				initialSize = static_cast<size_t>(header->dataSize);
+			}
+			else { std::cout << "pipeline cache " << path << " is outdated or invalid, pipelines are compiled again\n"; }
+		}
+
+		VkPipelineCacheCreateInfo info{};
+		info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		info.initialDataSize = initialSize;
+		info.pInitialData = initialData;
+		if (vkCreatePipelineCache(device_, &info, nullptr, &pipelineCache) != VK_SUCCESS)
+		{
+			// drivers may still refuse data that passed the checks, start empty then
+			info.initialDataSize = 0;
+			info.pInitialData = nullptr;
+			if (vkCreatePipelineCache(device_, &info, nullptr, &pipelineCache) != VK_SUCCESS)
+			{ throw std::runtime_error("failed to create pipeline cache"); }
+		}
+	}
+
+	void EngineDevice::savePipelineCache()
+	{
+		size_t size = 0;
+		if (vkGetPipelineCacheData(device_, pipelineCache, &size, nullptr) != VK_SUCCESS || size == 0) { return; }
+		std::vector<uint8_t> data(size);
+		if (vkGetPipelineCacheData(device_, pipelineCache, &size, data.data()) != VK_SUCCESS) { return; }
+		data.resize(size);
+
+		PipelineCacheFileHeader header{};
+		header.vendorID = properties.vendorID;
+		header.deviceID = properties.deviceID;
+		header.driverVersion = properties.driverVersion;
+		std::memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+		header.dataSize = data.size();
+		header.dataHash = Math::fnv1a64(data.data(), data.size());
+
+		// written under a temporary name first, so a crash never leaves a truncated file behind
+		const std::string path = getPipelineCachePath();
+		const std::string tempPath = path + ".tmp";
+		{
+			std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+			if (!out) { return; }
+			out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+			if (!out) { return; }
+		}
+		std::error_code error;
+		std::filesystem::rename(tempPath, path, error);
+	}
+
 	void EngineDevice::createSurface() { window.createWindowSurface(instance, &surface_); }
 
 	bool EngineDevice::isDeviceSuitable(VkPhysicalDevice device) 
@@ -376,6 +519,19 @@ namespace EngineCore
 			i++;
 		}
 
+		// prefer a family without graphics and compute, those are usually backed by the copy engine
+		for (uint32_t f = 0; f < queueFamilyCount; f++)
+		{
+			const VkQueueFlags flags = queueFamilies[f].queueFlags;
+			if (queueFamilies[f].queueCount == 0 || !(flags & VK_QUEUE_TRANSFER_BIT) || (flags & VK_QUEUE_GRAPHICS_BIT)) { continue; }
+			if (!indices.transferFamilyHasValue || !(flags & VK_QUEUE_COMPUTE_BIT))
+			{
+				indices.transferFamily = f;
+				indices.transferFamilyHasValue = true;
+			}
+			if (!(flags & VK_QUEUE_COMPUTE_BIT)) { break; }
+		}
+
 		return indices;
 	}
 
@@ -447,13 +603,15 @@ namespace EngineCore
 	}
 
 	void EngineDevice::createBuffer(VkDeviceSize size,VkBufferUsageFlags usage,
-						VkMemoryPropertyFlags properties,VkBuffer& buffer,VkDeviceMemory& bufferMemory) 
+						VkMemoryPropertyFlags properties,VkBuffer& buffer,Allocation& bufferAllocation) 
 	{
 		VkBufferCreateInfo bufferInfo{};
 		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 		bufferInfo.size = size;
 		bufferInfo.usage = usage;
 		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		setUploadSharing(usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT, bufferInfo.sharingMode,
+						bufferInfo.queueFamilyIndexCount, bufferInfo.pQueueFamilyIndices);
 
 		if (vkCreateBuffer(device_, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) 
 		{
@@ -463,15 +621,16 @@ namespace EngineCore
 		VkMemoryRequirements memRequirements;
 		vkGetBufferMemoryRequirements(device_, buffer, &memRequirements);
 
-		VkMemoryAllocateInfo allocInfo{};
-		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-		allocInfo.allocationSize = memRequirements.size;
-		allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+		try { memoryAllocator->alloc(bufferAllocation, memRequirements, properties, true); }
+		catch (...) { vkDestroyBuffer(device_, buffer, nullptr); buffer = VK_NULL_HANDLE; throw; }
 
-		if (vkAllocateMemory(device_, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) 
-		{ throw std::runtime_error("failed to allocate VkBuffer memory"); }
-
-		vkBindBufferMemory(device_, buffer, bufferMemory, 0);
+		if (vkBindBufferMemory(device_, buffer, bufferAllocation.memoryBlockHandle, bufferAllocation.offset) != VK_SUCCESS)
+		{
+			vkDestroyBuffer(device_, buffer, nullptr);
+			buffer = VK_NULL_HANDLE;
+			memoryAllocator->free(bufferAllocation);
+			throw std::runtime_error("failed to bind VkBuffer memory");
+		}
 	}
 
 	VkCommandBuffer EngineDevice::beginSingleTimeCommands() 
@@ -558,10 +717,46 @@ namespace EngineCore
 		allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
 
 		if (vkAllocateMemory(device_, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) 
-		{ throw std::runtime_error("failed to allocate image memory!"); }
+		{
+			vkDestroyImage(device_, image, nullptr);
+			image = VK_NULL_HANDLE;
+			throw std::runtime_error("failed to allocate image memory!");
+		}
 
 		if (vkBindImageMemory(device_, image, imageMemory, 0) != VK_SUCCESS) 
-		{ throw std::runtime_error("failed to bind image memory!"); }
+		{
+			vkDestroyImage(device_, image, nullptr);
+			image = VK_NULL_HANDLE;
+			vkFreeMemory(device_, imageMemory, nullptr);
+			imageMemory = VK_NULL_HANDLE;
+			throw std::runtime_error("failed to bind image memory!");
+		}
+	}
+
+	void EngineDevice::createImageWithInfo(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties,
+											VkImage& image, Allocation& imageAllocation)
+	{
+		VkImageCreateInfo info = imageInfo;
+		setUploadSharing(info.usage & VK_IMAGE_USAGE_TRANSFER_DST_BIT, info.sharingMode,
+						info.queueFamilyIndexCount, info.pQueueFamilyIndices);
+		if (vkCreateImage(device_, &info, nullptr, &image) != VK_SUCCESS) 
+		{ throw std::runtime_error("failed to create image!"); }
+
+		VkMemoryRequirements memRequirements;
+		vkGetImageMemoryRequirements(device_, image, &memRequirements);
+
+		// optimal tiling images must not share a bufferImageGranularity page with linear resources
+		const bool linear = imageInfo.tiling == VK_IMAGE_TILING_LINEAR;
+		try { memoryAllocator->alloc(imageAllocation, memRequirements, properties, linear); }
+		catch (...) { vkDestroyImage(device_, image, nullptr); image = VK_NULL_HANDLE; throw; }
+
+		if (vkBindImageMemory(device_, image, imageAllocation.memoryBlockHandle, imageAllocation.offset) != VK_SUCCESS) 
+		{
+			vkDestroyImage(device_, image, nullptr);
+			image = VK_NULL_HANDLE;
+			memoryAllocator->free(imageAllocation);
+			throw std::runtime_error("failed to bind image memory!");
+		}
 	}
 
 	/*void EngineDevice::importImageFromFile(const char* path)
@@ -3,6 +3,7 @@
 #include "Core/engine_window.h"
 
 // std lib headers
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -10,6 +11,9 @@ class EngineApplication; // forward-declaration
 
 namespace EngineCore 
 {
+	class DeviceMemoryAllocator;
+	struct Allocation;
+	class UploadManager;
 
 	struct SwapChainSupportDetails 
 	{
@@ -22,8 +26,11 @@ namespace EngineCore
 	{
 		uint32_t graphicsFamily;
 		uint32_t presentFamily;
+		// transfer-only family (DMA engine) if the device has one, otherwise a transfer capable non-graphics family
+		uint32_t transferFamily;
 		bool graphicsFamilyHasValue = false;
 		bool presentFamilyHasValue = false;
+		bool transferFamilyHasValue = false;
 		bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
 	};
 
@@ -49,6 +56,18 @@ namespace EngineCore
 		VkSurfaceKHR surface() { return surface_; }
 		VkQueue graphicsQueue() { return graphicsQueue_; }
 		VkQueue presentQueue() { return presentQueue_; }
+		/*	queue used by the upload manager, a dedicated transfer queue if available,
+			if isUploadQueueShared it is the graphics queue and must only be used from the render thread */
+		VkQueue uploadQueue() { return uploadQueue_; }
+		uint32_t getUploadQueueFamily() const { return uploadFamily_; }
+		bool isUploadQueueShared() const { return uploadQueue_ == graphicsQueue_; }
+		// true if the upload queue belongs to the graphics family and can record blits
+		bool isUploadQueueGraphicsCapable() const { return uploadFamily_ == uploadSharingFamilies[0]; }
+		// BC1-BC7 textures can be sampled, see CookedTexture
+		bool supportsBlockCompression() const { return blockCompressionSupported; }
+		/*	shared by all pipeline creation, loaded from the previous run if it was written by the same device and driver,
+			saved when the device is destroyed, so warm runs skip most shader compilation */
+		VkPipelineCache getPipelineCache() const { return pipelineCache; }
 		VkInstance getVulkanInstance() { return instance; } // for imgui
 
 		SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
@@ -61,24 +80,36 @@ namespace EngineCore
 		// checks device properties to get the max samples supported for both color and depth
 		VkSampleCountFlagBits getMaxSampleCount();
 
+		// suballocates device memory for buffers and images, see DeviceMemoryAllocator
+		DeviceMemoryAllocator& getMemoryAllocator() { return *memoryAllocator; }
+		// batches buffer and image uploads on the upload queue, see UploadManager
+		UploadManager& getUploads() { return *uploads; }
+
 		// Buffer Helper Functions
+		// creates a buffer placed in a block of the memory allocator, free the allocation after destroying the buffer
 		void createBuffer(
 			VkDeviceSize size,
 			VkBufferUsageFlags usage,
 			VkMemoryPropertyFlags properties,
 			VkBuffer& buffer,
-			VkDeviceMemory& bufferMemory);
+			Allocation& bufferAllocation);
 		VkCommandBuffer beginSingleTimeCommands();
 		void endSingleTimeCommands(VkCommandBuffer commandBuffer);
 		void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
 		void copyBufferToImage(
 			VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
-		// creates a vulkan image object
+		// creates a vulkan image object with dedicated memory
 		void createImageWithInfo(
 			const VkImageCreateInfo& imageInfo,
 			VkMemoryPropertyFlags properties,
 			VkImage& image,
 			VkDeviceMemory& imageMemory);
+		// creates a vulkan image object placed in a block of the memory allocator
+		void createImageWithInfo(
+			const VkImageCreateInfo& imageInfo,
+			VkMemoryPropertyFlags properties,
+			VkImage& image,
+			Allocation& imageAllocation);
 		// imports and initializes an image texture from disk
 		//void importImageFromFile(const char* path);
 		// takes a VkImage and transitions its layout
@@ -94,6 +125,9 @@ namespace EngineCore
 		void pickPhysicalDevice();
 		void createLogicalDevice();
 		void createCommandPool();
+		void createPipelineCache();
+		// writes the cache contents for the next run, failures only cost compile time then
+		void savePipelineCache();
 
 		// helper functions
 		bool isDeviceSuitable(VkPhysicalDevice device);
@@ -116,6 +150,17 @@ namespace EngineCore
 		VkSurfaceKHR surface_;
 		VkQueue graphicsQueue_;
 		VkQueue presentQueue_;
+		VkQueue uploadQueue_;
+		uint32_t uploadFamily_;
+		std::unique_ptr<DeviceMemoryAllocator> memoryAllocator;
+		std::unique_ptr<UploadManager> uploads;
+
+		/*	resources written by the upload queue are shared concurrently with the graphics family if the families differ,
+			which avoids queue family ownership transfers */
+		void setUploadSharing(bool transferDst, VkSharingMode& mode, uint32_t& familyCount, const uint32_t*& families) const;
+		uint32_t uploadSharingFamilies[2]{};
+		bool blockCompressionSupported = false;
+		VkPipelineCache pipelineCache = VK_NULL_HANDLE;
 
 		const std::vector<const char*> validationLayers = { "VK_LAYER_KHRONOS_validation" };
 		const std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
@@ -59,6 +59,7 @@ namespace EngineCore
 		init_info.PhysicalDevice = device.getPhysicalDevice();
 		init_info.Device = device.device();
 		init_info.Queue = device.graphicsQueue();
+		init_info.PipelineCache = device.getPipelineCache();
 		init_info.DescriptorPool = descriptorPool;
 		init_info.MinImageCount = 2;
 		init_info.ImageCount = imageCount;
@@ -0,0 +1,167 @@
+#include "Core/Jobs/JobSystem.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace EngineCore
+{
+	// identifies the queue owned by the current thread, non-worker threads share the last queue
+	static thread_local const JobSystem* tlsSystem = nullptr;
+	static thread_local uint32_t tlsQueueIndex = 0;
+
+	JobSystem::JobSystem(uint32_t workerCount)
+	{
+		if (workerCount == 0)
+		{
+			const uint32_t hw = std::thread::hardware_concurrency();
+			workerCount = hw > 1 ? hw - 1 : 1;
+		}
+		for (uint32_t i = 0; i < workerCount + 1; i++) { queues.push_back(std::make_unique<WorkQueue>()); }
+		workers.reserve(workerCount);
+		for (uint32_t i = 0; i < workerCount; i++) { workers.emplace_back(&JobSystem::workerLoop, this, i); }
+	}
+
+	JobSystem::~JobSystem()
+	{
+		{
+			std::lock_guard<std::mutex> g(sleepLock);
+			stopping = true;
+		}
+		wakeCondition.notify_all();
+		for (auto& t : workers) { t.join(); }
+	}
+
+	void JobSystem::addDependency(const JobHandle& job, const JobHandle& dependency)
+	{
+		assert(job && dependency && "cannot add null job dependency");
+		std::lock_guard<std::mutex> g(dependency->lock);
+		if (dependency->isFinished()) { return; }
+		job->pendingDependencies++;
+		dependency->dependents.push_back(job);
+	}
+
+	void JobSystem::submit(const JobHandle& job)
+	{
+		assert(job && "cannot submit null job");
+		// releases the reference held since creation
+		if (--job->pendingDependencies == 0) { enqueue(job); }
+	}
+
+	JobHandle JobSystem::run(std::function<void()> fn)
+	{
+		JobHandle job = createJob(std::move(fn));
+		submit(job);
+		return job;
+	}
+
+	void JobSystem::wait(const JobHandle& job)
+	{
+		const uint32_t q = getCallerQueueIndex();
+		while (!job->isFinished())
+		{
+			if (JobHandle j = findJob(q)) { execute(j); }
+			else { std::this_thread::yield(); }
+		}
+	}
+
+	void JobSystem::parallelFor(const uint32_t& count, const uint32_t& minBatchSize,
+								const std::function<void(uint32_t, uint32_t)>& fn)
+	{
+		if (count == 0) { return; }
+		// a few batches per thread gives stealing something to balance with
+		const uint32_t targetBatches = getThreadCount() * 4;
+		const uint32_t batchSize = std::max(std::max(minBatchSize, 1u), (count + targetBatches - 1) / targetBatches);
+		if (batchSize >= count) { fn(0, count); return; }
+
+		// a single parent job depends on all batches, so only one wait is needed
+		JobHandle done = createJob([]() {});
+		for (uint32_t begin = 0; begin < count; begin += batchSize)
+		{
+			const uint32_t end = std::min(count, begin + batchSize);
+			JobHandle batch = createJob([&fn, begin, end]() { fn(begin, end); });
+			addDependency(done, batch);
+			submit(batch);
+		}
+		submit(done);
+		wait(done);
+	}
+
+	void JobSystem::workerLoop(const uint32_t& index)
+	{
+		tlsSystem = this;
+		tlsQueueIndex = index;
+		while (true)
+		{
+			if (JobHandle j = findJob(index)) { execute(j); continue; }
+			std::unique_lock<std::mutex> g(sleepLock);
+			wakeCondition.wait(g, [this]() { return stopping || queuedJobs.load() > 0; });
+			if (stopping && queuedJobs.load() == 0) { return; }
+		}
+	}
+
+	void JobSystem::enqueue(const JobHandle& job)
+	{
+		uint32_t q = getCallerQueueIndex();
+		// non-worker threads spread their jobs over the workers, which then start on them without stealing
+		if (q == workers.size()) { q = externalPushIndex++ % static_cast<uint32_t>(queues.size()); }
+		{
+			// counted before the push, so the counter can never drop below the number of queued jobs
+			std::lock_guard<std::mutex> g(sleepLock);
+			queuedJobs++;
+		}
+		{
+			std::lock_guard<std::mutex> g(queues[q]->lock);
+			queues[q]->jobs.push_back(job);
+		}
+		wakeCondition.notify_one();
+	}
+
+	JobHandle JobSystem::findJob(const uint32_t& queueIndex)
+	{
+		if (queuedJobs.load() == 0) { return nullptr; }
+		// own queue first, newest job is most likely to be hot in cache
+		{
+			WorkQueue& own = *queues[queueIndex];
+			std::lock_guard<std::mutex> g(own.lock);
+			if (!own.jobs.empty())
+			{
+				JobHandle j = std::move(own.jobs.back());
+				own.jobs.pop_back();
+				queuedJobs--;
+				return j;
+			}
+		}
+		// steal the oldest job from another queue
+		const uint32_t n = static_cast<uint32_t>(queues.size());
+		for (uint32_t i = 1; i < n; i++)
+		{
+			WorkQueue& victim = *queues[(queueIndex + i) % n];
+			std::unique_lock<std::mutex> g(victim.lock, std::try_to_lock);
+			if (!g.owns_lock() || victim.jobs.empty()) { continue; }
+			JobHandle j = std::move(victim.jobs.front());
+			victim.jobs.pop_front();
+			queuedJobs--;
+			return j;
+		}
+		return nullptr;
+	}
+
+	void JobSystem::execute(const JobHandle& job)
+	{
+		job->fn();
+		job->fn = nullptr; // release captures early
+		std::vector<JobHandle> ready;
+		{
+			std::lock_guard<std::mutex> g(job->lock);
+			job->finished.store(true, std::memory_order_release);
+			ready.swap(job->dependents);
+		}
+		for (auto& d : ready) { if (--d->pendingDependencies == 0) { enqueue(d); } }
+	}
+
+	uint32_t JobSystem::getCallerQueueIndex() const
+	{
+		return (tlsSystem == this) ? tlsQueueIndex : static_cast<uint32_t>(workers.size());
+	}
+
+} // namespace
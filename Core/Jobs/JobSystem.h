@@ -0,0 +1,99 @@
+#pragma once
+
+// std
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace EngineCore
+{
+	/*	a unit of work, jobs form a graph through dependencies,
+		a job becomes runnable once it has been submitted and all of its dependencies have finished */
+	class Job
+	{
+	public:
+		Job(std::function<void()>&& f) : fn{ std::move(f) } {};
+		Job(const Job&) = delete;
+		Job& operator=(const Job&) = delete;
+
+		bool isFinished() const { return finished.load(std::memory_order_acquire); }
+
+	private:
+		friend class JobSystem;
+		std::function<void()> fn;
+		// unfinished dependencies, plus one that is released by submit()
+		std::atomic<uint32_t> pendingDependencies{ 1 };
+		std::atomic<bool> finished{ false };
+		// jobs waiting on this one, guarded by lock
+		std::mutex lock;
+		std::vector<std::shared_ptr<Job>> dependents;
+	};
+	using JobHandle = std::shared_ptr<Job>;
+
+	/*	work-stealing job scheduler, each worker owns a deque which it pops from the back (LIFO),
+		idle workers steal from the front of other deques, threads that wait on a job
+		help out by executing queued jobs instead of blocking */
+	class JobSystem
+	{
+	public:
+		// workerCount 0 uses one worker per hardware thread, minus the calling (main) thread
+		JobSystem(uint32_t workerCount = 0);
+		~JobSystem();
+
+		JobSystem(const JobSystem&) = delete;
+		JobSystem& operator=(const JobSystem&) = delete;
+
+		// creates a job without scheduling it, dependencies may be added until it is submitted
+		JobHandle createJob(std::function<void()> fn) { return std::make_shared<Job>(std::move(fn)); }
+		// job will not run before dependency has finished, must be called before job is submitted
+		void addDependency(const JobHandle& job, const JobHandle& dependency);
+		// schedules the job, it runs as soon as its dependencies have finished
+		void submit(const JobHandle& job);
+		// creates and submits a job in one step
+		JobHandle run(std::function<void()> fn);
+		// blocks until the job has finished, the calling thread executes other jobs meanwhile
+		void wait(const JobHandle& job);
+
+		/*	splits [0, count) into batches of at least minBatchSize and calls fn(begin, end) for each,
+			returns once all batches have finished */
+		void parallelFor(const uint32_t& count, const uint32_t& minBatchSize,
+						const std::function<void(uint32_t, uint32_t)>& fn);
+
+		// number of threads executing jobs, including the thread that waits
+		uint32_t getThreadCount() const { return static_cast<uint32_t>(workers.size()) + 1; }
+		/*	index of the calling thread in [0, getThreadCount()), usable for per-thread resources,
+			all non-worker threads share the last index */
+		uint32_t getCurrentThreadIndex() const { return getCallerQueueIndex(); }
+
+	private:
+		struct WorkQueue
+		{
+			std::mutex lock;
+			std::deque<JobHandle> jobs;
+		};
+
+		// one queue per worker, the last one is shared by all non-worker threads
+		std::vector<std::unique_ptr<WorkQueue>> queues;
+		std::vector<std::thread> workers;
+		std::atomic<uint32_t> queuedJobs{ 0 };
+		std::atomic<uint32_t> externalPushIndex{ 0 };
+		std::atomic<bool> stopping{ false };
+		// used only to put idle workers to sleep
+		std::mutex sleepLock;
+		std::condition_variable wakeCondition;
+
+		void workerLoop(const uint32_t& index);
+		void enqueue(const JobHandle& job);
+		// pops from the own queue, or steals from another, returns nullptr if no work was found
+		JobHandle findJob(const uint32_t& queueIndex);
+		void execute(const JobHandle& job);
+		uint32_t getCallerQueueIndex() const;
+	};
+
+} // namespace
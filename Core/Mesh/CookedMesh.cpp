@@ -0,0 +1,191 @@
+#include "Core/Mesh/CookedMesh.h"
+#include "Core/Types/Math.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <thread>
+
+namespace EngineCore
+{
+	namespace CookedMesh
+	{
+		static constexpr uint64_t BLOB_ALIGNMENT = 16;
+
+		std::string getCookedPath(const std::string& sourcePath) { return sourcePath + ".vmesh"; }
+
+		bool parse(const MappedFile& file, View& view)
+		{
+			if (!file.isOpen() || file.size() < sizeof(Header)) { return false; }
+			const Header* header = reinterpret_cast<const Header*>(file.data());
+			if (header->magic != MAGIC || header->version != VERSION) { return false; }
+			if (header->indexSize != 0 && header->indexSize != sizeof(uint16_t) && header->indexSize != sizeof(uint32_t))
+			{ return false; }
+			// an index size of 0 marks a mesh drawn without indices, anything else would be read as 32-bit indices
+			if ((header->indexSize == 0) != (header->indexCount == 0) || header->indexCount % 3 != 0) { return false; }
+			if (header->vertexCount < 3 || header->lodCount == 0 || header->lodCount > MeshGeometry::MAX_LODS) { return false; }
+			if (header->vertexFormat > static_cast<uint8_t>(VertexFormat::PackedColor)
+				|| header->vertexStride != ECS::Primitive::getVertexStride(static_cast<VertexFormat>(header->vertexFormat)))
+			{ return false; }
+
+			// every blob must lie inside the file
+			const uint64_t fileSize = file.size();
+			auto inside = [&](const uint64_t& offset, const uint64_t& bytes)
+			{ return offset % BLOB_ALIGNMENT == 0 && offset <= fileSize && bytes <= fileSize - offset; };
+			if (!inside(header->vertexOffset, static_cast<uint64_t>(header->vertexStride) * header->vertexCount)
+				|| !inside(header->indexOffset, static_cast<uint64_t>(header->indexSize) * header->indexCount)
+				|| !inside(header->lodOffset, sizeof(Lod) * header->lodCount)) { return false; }
+
+			view.header = header;
+			view.vertices = file.data() + header->vertexOffset;
+			view.indices = file.data() + header->indexOffset;
+			view.lods = reinterpret_cast<const Lod*>(file.data() + header->lodOffset);
+
+			// meshes without indices have a single level covering all vertices, see MeshGeometry::setLods
+			if (header->indexCount == 0) { return header->lodCount == 1 && view.lods[0].firstIndex == 0 && view.lods[0].indexCount == 0; }
+			// the full mesh starts the index buffer, every level draws whole triangles from inside it
+			if (view.lods[0].firstIndex != 0) { return false; }
+			for (uint32_t i = 0; i < header->lodCount; i++)
+			{
+				if (view.lods[i].indexCount == 0 || view.lods[i].indexCount % 3 != 0
+					|| static_cast<uint64_t>(view.lods[i].firstIndex) + view.lods[i].indexCount > header->indexCount) { return false; }
+			}
+			// indices past the vertex blob would make the GPU read outside the vertex buffer
+			uint32_t maxIndex = 0;
+			if (header->indexSize == sizeof(uint16_t))
+			{
+				const uint16_t* indices = static_cast<const uint16_t*>(view.indices);
+				for (uint32_t i = 0; i < header->indexCount; i++) { maxIndex = std::max<uint32_t>(maxIndex, indices[i]); }
+			}
+			else
+			{
+				const uint32_t* indices = static_cast<const uint32_t*>(view.indices);
+				for (uint32_t i = 0; i < header->indexCount; i++) { maxIndex = std::max(maxIndex, indices[i]); }
+			}
+			return maxIndex < header->vertexCount;
+		}
+
+		static uint8_t getCookFlags(const bool& optimize) { return optimize ? COOK_OPTIMIZED : 0; }
+
+		bool isUpToDate(const Header& header, const std::string& sourcePath, const VertexFormat& format,
+						const bool& optimize, const uint32_t& lodLevels)
+		{
+			if (header.vertexFormat != static_cast<uint8_t>(format) || header.lodLevels != lodLevels
+				|| header.cookFlags != getCookFlags(optimize)) { return false; }
+			uint64_t size = 0;
+			int64_t writeTime = 0;
+			// cooked files may be shipped without their sources
+			if (!MappedFile::getFileStamp(sourcePath, size, writeTime)) { return true; }
+			return header.sourceSize == size && header.sourceWriteTime == writeTime;
+		}
+
+		void cook(const std::string& sourcePath, const std::vector<char>& sourceContents, const VertexFormat& format,
+					const bool& optimize, const uint32_t& lodLevels, ECS::Primitive::MeshBuilder& builder, JobSystem* jobs)
+		{
+			builder.loadFromMemory(sourceContents.data(), sourceContents.size(), jobs);
+			std::cout << "loaded mesh " << sourcePath << ", vertices: " << builder.sourceVertexCount
+				<< " -> " << builder.vertices.size() << " (deduplicated), indices: " << builder.indices.size() << "\n";
+			if (lodLevels > 1)
+			{
+				builder.generateLods(lodLevels);
+				std::cout << "simplified mesh " << sourcePath << ", triangles per level:";
+				for (const auto& lod : builder.lods) { std::cout << " " << lod.indexCount / 3; }
+				std::cout << "\n";
+			}
+			if (optimize)
+			{
+				const auto report = builder.optimize();
+				std::cout << "optimized mesh " << sourcePath << ", ACMR: " << report.before.acmr << " -> " << report.after.acmr
+					<< ", ATVR: " << report.before.atvr << " -> " << report.after.atvr << "\n";
+			}
+			const uint64_t sourceHash = Math::fnv1a64(sourceContents.data(), sourceContents.size());
+			if (!write(getCookedPath(sourcePath), builder, format, optimize, lodLevels, sourcePath, sourceHash))
+			{ std::cout << "could not write cooked mesh " << getCookedPath(sourcePath) << "\n"; }
+		}
+
+		bool write(const std::string& cookedPath, const ECS::Primitive::MeshBuilder& builder, const VertexFormat& format,
+					const bool& optimize, const uint32_t& lodLevels, const std::string& sourcePath, const uint64_t& sourceHash)
+		{
+			const auto encoded = ECS::Primitive::encodeVertices(builder.vertices, format);
+			const bool shortIndices = builder.vertices.size() <= UINT16_MAX;
+
+			Header header{};
+			header.vertexFormat = static_cast<uint8_t>(format);
+			header.cookFlags = getCookFlags(optimize);
+			header.indexSize = static_cast<uint8_t>(builder.indices.empty() ? 0 : (shortIndices ? sizeof(uint16_t) : sizeof(uint32_t)));
+			header.vertexStride = encoded.stride;
+			header.vertexCount = static_cast<uint32_t>(builder.vertices.size());
+			header.indexCount = static_cast<uint32_t>(builder.indices.size());
+			header.lodCount = static_cast<uint32_t>(std::max<size_t>(1, builder.lods.size()));
+			header.lodLevels = lodLevels;
+			header.boundsMin[0] = encoded.bounds.min.x; header.boundsMin[1] = encoded.bounds.min.y; header.boundsMin[2] = encoded.bounds.min.z;
+			header.boundsMax[0] = encoded.bounds.max.x; header.boundsMax[1] = encoded.bounds.max.y; header.boundsMax[2] = encoded.bounds.max.z;
+			std::memcpy(header.decodeTransform, &encoded.decodeTransform[0][0], sizeof(header.decodeTransform));
+			header.sourceHash = sourceHash;
+			MappedFile::getFileStamp(sourcePath, header.sourceSize, header.sourceWriteTime);
+
+			auto align = [](const uint64_t& v) { return Math::roundUpToClosestMultiple<uint64_t>(v, BLOB_ALIGNMENT); };
+			header.vertexOffset = align(sizeof(Header));
+			header.indexOffset = align(header.vertexOffset + encoded.data.size());
+			header.lodOffset = align(header.indexOffset + static_cast<uint64_t>(header.indexSize) * header.indexCount);
+
+			std::vector<Lod> lods(header.lodCount);
+			lods[0].indexCount = header.indexCount;
+			for (size_t i = 0; i < builder.lods.size(); i++)
+			{
+				lods[i].firstIndex = builder.lods[i].firstIndex;
+				lods[i].indexCount = builder.lods[i].indexCount;
+				lods[i].screenSize = builder.lods[i].screenSize;
+			}
+
+			std::vector<char> file(header.lodOffset + sizeof(Lod) * lods.size(), 0);
+			std::memcpy(file.data(), &header, sizeof(Header));
+			if (!encoded.data.empty()) { std::memcpy(&file[header.vertexOffset], encoded.data.data(), encoded.data.size()); }
+			if (header.indexSize == sizeof(uint16_t))
+			{
+				for (uint32_t i = 0; i < header.indexCount; i++)
+				{
+					const uint16_t index = static_cast<uint16_t>(builder.indices[i]);
+					std::memcpy(&file[header.indexOffset + i * sizeof(uint16_t)], &index, sizeof(uint16_t));
+				}
+			}
+			else if (header.indexSize == sizeof(uint32_t))
+			{ std::memcpy(&file[header.indexOffset], builder.indices.data(), builder.indices.size() * sizeof(uint32_t)); }
+			std::memcpy(&file[header.lodOffset], lods.data(), sizeof(Lod) * lods.size());
+
+			/*	written under a temporary name first, so a crash never leaves a truncated file behind,
+				the name is unique per thread since the same mesh may be cooked by concurrent loads */
+			const std::string tempPath = cookedPath + "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + ".tmp";
+			{
+				std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+				if (!out) { return false; }
+				out.write(file.data(), static_cast<std::streamsize>(file.size()));
+				if (!out) { return false; }
+			}
+			std::error_code error;
+			std::filesystem::rename(tempPath, cookedPath, error);
+			return !error;
+		}
+
+		std::shared_ptr<MeshGeometry> createGeometry(EngineDevice& device, const View& view)
+		{
+			const Header& header = *view.header;
+			const BoundingBox bounds(Vec{ header.boundsMin[0], header.boundsMin[1], header.boundsMin[2] },
+									Vec{ header.boundsMax[0], header.boundsMax[1], header.boundsMax[2] });
+			glm::mat4 decodeTransform;
+			std::memcpy(&decodeTransform[0][0], header.decodeTransform, sizeof(header.decodeTransform));
+			const VkIndexType indexType = header.indexSize == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+			std::vector<MeshGeometry::Lod> lods(header.lodCount);
+			for (uint32_t i = 0; i < header.lodCount; i++)
+			{ lods[i] = MeshGeometry::Lod{ view.lods[i].firstIndex, view.lods[i].indexCount, view.lods[i].screenSize }; }
+			return std::make_shared<MeshGeometry>(device, view.vertices, header.vertexStride, header.vertexCount,
+												view.indices, indexType, header.indexCount, bounds,
+												static_cast<VertexFormat>(header.vertexFormat), decodeTransform, lods);
+		}
+
+	} // namespace CookedMesh
+
+} // namespace
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "Core/ECS/Primitive.h"
+#include "Core/GPU/MeshGeometry.h"
+#include "Core/GPU/VertexFormat.h"
+#include "Core/Types/MappedFile.h"
+
+// std
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace EngineCore
+{
+	/*	versioned binary mesh container, holds vertex and index data exactly as uploaded to the GPU,
+		so a mapped file can be copied straight into a staging buffer without any parsing,
+		layout: Header | vertex blob | index blob | lod table, every blob 16-byte aligned, little-endian */
+	namespace CookedMesh
+	{
+		static constexpr uint32_t MAGIC = 0x48534D56; // "VMSH"
+		// increment whenever the layout or the cooking pipeline changes, older files are cooked again
+		static constexpr uint32_t VERSION = 3;
+		// cook options stored in Header::cookFlags, a file cooked with other options is cooked again
+		static constexpr uint8_t COOK_OPTIMIZED = 1 << 0; // vertex cache and fetch optimized, see MeshBuilder::optimize
+
+		struct Header
+		{
+			uint32_t magic = MAGIC;
+			uint32_t version = VERSION;
+			uint8_t vertexFormat = 0; // VertexFormat
+			uint8_t indexSize = 0; // 2 or 4 bytes
+			uint8_t cookFlags = 0; // COOK_ flags
+			uint8_t reserved0 = 0;
+			uint32_t vertexStride = 0;
+			uint32_t vertexCount = 0;
+			uint32_t indexCount = 0;
+			uint32_t lodCount = 0;
+			// levels requested when cooking, lodCount may be lower if the mesh could not be simplified further
+			uint32_t lodLevels = 1;
+			float boundsMin[3]{};
+			float boundsMax[3]{};
+			float decodeTransform[16]{}; // column-major, see MeshGeometry::getVertexDecodeTransform
+			// identifies the source file, a cooked file is stale once the source size or write time changes
+			uint64_t sourceHash = 0; // FNV-1a of the source contents
+			uint64_t sourceSize = 0;
+			int64_t sourceWriteTime = 0;
+			// byte offsets from the start of the file
+			uint64_t vertexOffset = 0;
+			uint64_t indexOffset = 0;
+			uint64_t lodOffset = 0;
+		};
+		static_assert(sizeof(Header) == 168, "cooked mesh header layout changed, increment VERSION");
+
+		// index range of one level of detail, level 0 is the full mesh
+		struct Lod
+		{
+			uint32_t firstIndex = 0;
+			uint32_t indexCount = 0;
+			// projected size (fraction of the screen height) below which the next level is used, see MeshGeometry::Lod
+			float screenSize = 0.f;
+			uint32_t reserved = 0;
+		};
+
+		// pointers into a mapped cooked file, valid while the file stays mapped
+		struct View
+		{
+			const Header* header = nullptr;
+			const void* vertices = nullptr;
+			const void* indices = nullptr;
+			const Lod* lods = nullptr;
+		};
+
+		std::string getCookedPath(const std::string& sourcePath);
+
+		/*	validates the header, blob ranges, level of detail table and index values,
+			returns false for foreign, truncated, outdated or inconsistent files */
+		bool parse(const MappedFile& file, View& view);
+		/*	true if the file matches the vertex format, level of detail count and optimize option,
+			and the source file (if present) has not changed since cooking */
+		bool isUpToDate(const Header& header, const std::string& sourcePath, const VertexFormat& format,
+						const bool& optimize, const uint32_t& lodLevels);
+
+		/*	parses OBJ contents into the builder (deduplicated, with up to lodLevels levels of detail, optionally optimized)
+			and writes the cooked file next to the source, a failed write is reported but not fatal,
+			see MeshBuilder::loadFromMemory for jobs */
+		void cook(const std::string& sourcePath, const std::vector<char>& sourceContents, const VertexFormat& format,
+					const bool& optimize, const uint32_t& lodLevels, ECS::Primitive::MeshBuilder& builder, JobSystem* jobs = nullptr);
+		// returns false if the file could not be written
+		bool write(const std::string& cookedPath, const ECS::Primitive::MeshBuilder& builder, const VertexFormat& format,
+					const bool& optimize, const uint32_t& lodLevels, const std::string& sourcePath, const uint64_t& sourceHash);
+
+		// uploads the mapped data, the only copy is the one into the staging buffer
+		std::shared_ptr<MeshGeometry> createGeometry(EngineDevice& device, const View& view);
+
+	} // namespace CookedMesh
+
+} // namespace
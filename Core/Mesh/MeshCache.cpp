@@ -0,0 +1,84 @@
+#include "Core/Mesh/MeshCache.h"
+#include "Core/ECS/Primitive.h"
+#include "Core/Mesh/CookedMesh.h"
+#include "Core/Types/Math.h"
+
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+namespace EngineCore
+{
+	std::shared_ptr<const MeshGeometry> MeshCache::load(const std::string& path)
+	{
+		// same path, no file access at all
+		{
+			std::lock_guard<std::mutex> g(lock);
+			auto pathIt = byPath.find(path);
+			if (pathIt != byPath.end())
+			{
+				if (auto geometry = pathIt->second.lock()) { numHits++; return geometry; }
+			}
+		}
+
+		// a cooked file is mapped and uploaded directly, no parsing at all
+		{
+			MappedFile cooked{};
+			CookedMesh::View view{};
+			if (cooked.open(CookedMesh::getCookedPath(path)) && CookedMesh::parse(cooked, view)
+				&& CookedMesh::isUpToDate(*view.header, path, vertexFormat, optimizeMeshes, maxLodLevels))
+			{
+				const uint64_t hash = view.header->sourceHash;
+				{
+					std::lock_guard<std::mutex> g(lock);
+					if (auto geometry = findByContentHash(hash)) { byPath[path] = geometry; numHits++; return geometry; }
+				}
+				return insert(path, hash, CookedMesh::createGeometry(device, view));
+			}
+		}
+
+		// otherwise the source file is parsed and cooked for the next time
+		std::ifstream file(path, std::ios::binary);
+		if (!file) { throw std::runtime_error("failed to open mesh file: " + path); }
+		const std::vector<char> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		const uint64_t hash = Math::fnv1a64(contents.data(), contents.size());
+
+		// same contents under another path (copied assets)
+		{
+			std::lock_guard<std::mutex> g(lock);
+			if (auto geometry = findByContentHash(hash)) { byPath[path] = geometry; numHits++; return geometry; }
+		}
+
+		ECS::Primitive::MeshBuilder builder{};
+		CookedMesh::cook(path, contents, vertexFormat, optimizeMeshes, maxLodLevels, builder, jobs);
+		return insert(path, hash, ECS::Primitive::createGeometry(device, builder.vertices, builder.indices, vertexFormat, builder.lods));
+	}
+
+	std::shared_ptr<const MeshGeometry> MeshCache::insert(const std::string& path, const uint64_t& hash,
+														std::shared_ptr<const MeshGeometry> geometry)
+	{
+		std::lock_guard<std::mutex> g(lock);
+		// a concurrent load of the same contents got here first
+		if (auto existing = findByContentHash(hash)) { byPath[path] = existing; numHits++; return existing; }
+		byPath[path] = geometry;
+		byContentHash[hash] = geometry;
+		numLoads++;
+		return geometry;
+	}
+
+	std::shared_ptr<const MeshGeometry> MeshCache::findByContentHash(const uint64_t& hash) const
+	{
+		auto it = byContentHash.find(hash);
+		return it != byContentHash.end() ? it->second.lock() : nullptr;
+	}
+
+	void MeshCache::purgeExpired()
+	{
+		std::lock_guard<std::mutex> g(lock);
+		for (auto it = byPath.begin(); it != byPath.end();) { it = it->second.expired() ? byPath.erase(it) : std::next(it); }
+		for (auto it = byContentHash.begin(); it != byContentHash.end();)
+		{ it = it->second.expired() ? byContentHash.erase(it) : std::next(it); }
+	}
+
+} // namespace
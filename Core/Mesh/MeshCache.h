@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Core/GPU/MeshGeometry.h"
+
+// std
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace EngineCore
+{
+	class JobSystem;
+
+	/*	registry of loaded mesh geometry, keyed by file path and by a hash of the file contents,
+		geometry is reference counted by the primitives using it (std::shared_ptr),
+		the cache only holds weak references, so unused geometry is freed as soon as the last user is gone */
+	class MeshCache
+	{
+	public:
+		/*	geometry is created in the given vertex format,
+			optimizeOnLoad runs MeshBuilder::optimize on every newly loaded mesh,
+			large source files are parsed on the job threads if a job system is given,
+			meshes get up to lodLevels levels of detail (see MeshBuilder::generateLods) */
+		MeshCache(EngineDevice& deviceIn, const VertexFormat& format = VertexFormat::Float, const bool& optimizeOnLoad = true,
+				JobSystem* jobsIn = nullptr, const uint32_t& lodLevels = 1)
+			: device{ deviceIn }, vertexFormat{ format }, optimizeMeshes{ optimizeOnLoad }, jobs{ jobsIn }, maxLodLevels{ lodLevels } {};
+
+		MeshCache(const MeshCache&) = delete;
+		MeshCache& operator=(const MeshCache&) = delete;
+
+		/*	returns the geometry of a mesh file, the file is only loaded and uploaded
+			if neither the path nor identical file contents are in use already, thread safe,
+			loads of different files run in parallel, concurrent loads of the same file all return the first one to finish,
+			an up to date cooked file (see CookedMesh) is used instead of the source file when available */
+		std::shared_ptr<const MeshGeometry> load(const std::string& path);
+
+		// forgets entries whose geometry has been freed
+		void purgeExpired();
+
+		uint32_t getLoadCount() const { return numLoads; }
+		uint32_t getHitCount() const { return numHits; }
+
+	private:
+		// null if the hash is unknown or its geometry has been freed, lock must be held
+		std::shared_ptr<const MeshGeometry> findByContentHash(const uint64_t& hash) const;
+		/*	registers geometry that was loaded without holding the lock, if another thread finished a load of the same contents
+			in the meantime its geometry is returned instead and the new one is dropped, so every user shares one copy */
+		std::shared_ptr<const MeshGeometry> insert(const std::string& path, const uint64_t& hash,
+												std::shared_ptr<const MeshGeometry> geometry);
+
+		EngineDevice& device;
+		const VertexFormat vertexFormat;
+		const bool optimizeMeshes;
+		JobSystem* jobs;
+		const uint32_t maxLodLevels;
+		// guards the maps and counters only, files are read, parsed and uploaded without it
+		std::mutex lock;
+		std::unordered_map<std::string, std::weak_ptr<const MeshGeometry>> byPath;
+		std::unordered_map<uint64_t, std::weak_ptr<const MeshGeometry>> byContentHash;
+		std::atomic<uint32_t> numLoads{ 0 };
+		std::atomic<uint32_t> numHits{ 0 };
+	};
+
+} // namespace
@@ -0,0 +1,634 @@
+#include "Core/Mesh/MeshOptimizer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace EngineCore
+{
+	namespace MeshOptimizer
+	{
+		// FIFO cache simulation, a vertex is a hit while fewer than cacheSize misses happened since it was loaded
+		struct FifoCache
+		{
+			std::vector<uint32_t> timestamps;
+			uint32_t time;
+			uint32_t cacheSize;
+			FifoCache(const uint32_t& vertexCount, const uint32_t& size)
+				: timestamps(vertexCount, 0), time{ size + 1 }, cacheSize{ size } {}
+			// returns 1 on a miss
+			uint32_t access(const uint32_t& v)
+			{
+				if (time - timestamps[v] > cacheSize) { timestamps[v] = time++; return 1; }
+				return 0;
+			}
+			void reset() { time += cacheSize + 1; }
+		};
+
+		VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, const uint32_t& vertexCount,
+											const uint32_t& cacheSize)
+		{
+			assert(indices.size() % 3 == 0 && "index count must be a multiple of 3");
+			VertexCacheStats stats{};
+			if (indices.empty() || vertexCount == 0) { return stats; }
+			FifoCache cache{ vertexCount, cacheSize };
+			uint32_t misses = 0;
+			for (const auto& index : indices) { misses += cache.access(index); }
+			stats.acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+			stats.atvr = static_cast<float>(misses) / static_cast<float>(vertexCount);
+			return stats;
+		}
+
+		// Forsyth scoring constants, see "Linear-Speed Vertex Cache Optimisation" (T. Forsyth, 2006)
+		static constexpr uint32_t FORSYTH_CACHE_SIZE = 32;
+		static constexpr uint32_t FORSYTH_MAX_VALENCE = 32;
+		static constexpr float CACHE_DECAY_POWER = 1.5f;
+		static constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+		static constexpr float VALENCE_BOOST_SCALE = 2.f;
+		static constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+		struct ForsythTables
+		{
+			// index FORSYTH_CACHE_SIZE means not cached
+			float cache[FORSYTH_CACHE_SIZE + 1];
+			float valence[FORSYTH_MAX_VALENCE + 1];
+			ForsythTables()
+			{
+				for (uint32_t i = 0; i < FORSYTH_CACHE_SIZE; i++)
+				{
+					// the vertices of the last triangle get a fixed score, so it is not simply continued in a strip
+					if (i < 3) { cache[i] = LAST_TRIANGLE_SCORE; continue; }
+					const float scaler = 1.f / static_cast<float>(FORSYTH_CACHE_SIZE - 3);
+					cache[i] = std::pow(1.f - static_cast<float>(i - 3) * scaler, CACHE_DECAY_POWER);
+				}
+				cache[FORSYTH_CACHE_SIZE] = 0.f;
+				valence[0] = 0.f;
+				for (uint32_t i = 1; i <= FORSYTH_MAX_VALENCE; i++)
+				{
+					// vertices with few remaining triangles are preferred, so they are finished and leave the cache
+					valence[i] = VALENCE_BOOST_SCALE * std::pow(static_cast<float>(i), -VALENCE_BOOST_POWER);
+				}
+			}
+			float score(const uint32_t& cachePosition, const uint32_t& remainingValence) const
+			{
+				if (remainingValence == 0) { return -1.f; }
+				return cache[cachePosition] + valence[std::min(remainingValence, FORSYTH_MAX_VALENCE)];
+			}
+		};
+
+		void optimizeVertexCache(std::vector<uint32_t>& indices, const uint32_t& vertexCount)
+		{
+			assert(indices.size() % 3 == 0 && "index count must be a multiple of 3");
+			const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+			if (triangleCount == 0) { return; }
+			static const ForsythTables tables{};
+
+			// triangle adjacency per vertex, [adjacencyOffsets[v], adjacencyOffsets[v] + liveValence[v]) are not emitted yet
+			std::vector<uint32_t> liveValence(vertexCount, 0);
+			for (const auto& index : indices)
+			{
+				assert(index < vertexCount && "index out of range");
+				liveValence[index]++;
+			}
+			std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+			for (uint32_t v = 0; v < vertexCount; v++) { adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveValence[v]; }
+			std::vector<uint32_t> adjacency(indices.size());
+			{
+				std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+				for (uint32_t t = 0; t < triangleCount; t++)
+				{
+					for (uint32_t k = 0; k < 3; k++) { adjacency[fill[indices[t * 3 + k]]++] = t; }
+				}
+			}
+
+			std::vector<uint32_t> cachePositions(vertexCount, FORSYTH_CACHE_SIZE);
+			std::vector<float> vertexScores(vertexCount);
+			for (uint32_t v = 0; v < vertexCount; v++) { vertexScores[v] = tables.score(FORSYTH_CACHE_SIZE, liveValence[v]); }
+			std::vector<uint8_t> emitted(triangleCount, 0);
+
+			std::vector<uint32_t> cache, nextCache;
+			cache.reserve(FORSYTH_CACHE_SIZE + 3);
+			nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+			std::vector<uint32_t> output;
+			output.reserve(indices.size());
+
+			// fallback when no cached vertex has triangles left, the first remaining triangle in input order
+			uint32_t inputCursor = 0;
+			uint32_t best = 0;
+
+			for (uint32_t n = 0; n < triangleCount; n++)
+			{
+				if (best == UINT32_MAX)
+				{
+					while (emitted[inputCursor]) { inputCursor++; }
+					best = inputCursor;
+				}
+				const uint32_t* tri = &indices[best * 3];
+				output.insert(output.end(), tri, tri + 3);
+				emitted[best] = 1;
+
+				// remove the triangle from the live adjacency of its vertices
+				for (uint32_t k = 0; k < 3; k++)
+				{
+					const uint32_t v = tri[k];
+					uint32_t* adj = &adjacency[adjacencyOffsets[v]];
+					for (uint32_t i = 0; i < liveValence[v]; i++)
+					{
+						if (adj[i] == best) { std::swap(adj[i], adj[liveValence[v] - 1]); liveValence[v]--; break; }
+					}
+				}
+
+				// emitted vertices move to the front of the LRU cache
+				nextCache.clear();
+				nextCache.insert(nextCache.end(), tri, tri + 3);
+				for (const auto& v : cache)
+				{
+					if (v != tri[0] && v != tri[1] && v != tri[2]) { nextCache.push_back(v); }
+				}
+				for (uint32_t i = 0; i < nextCache.size(); i++)
+				{
+					const uint32_t v = nextCache[i];
+					cachePositions[v] = i < FORSYTH_CACHE_SIZE ? i : FORSYTH_CACHE_SIZE;
+					vertexScores[v] = tables.score(cachePositions[v], liveValence[v]);
+				}
+				if (nextCache.size() > FORSYTH_CACHE_SIZE) { nextCache.resize(FORSYTH_CACHE_SIZE); }
+				cache.swap(nextCache);
+
+				// the next triangle is the best scoring one touching the cache, ties go to the lowest index
+				best = UINT32_MAX;
+				float bestScore = -1.f;
+				for (const auto& v : cache)
+				{
+					const uint32_t* adj = &adjacency[adjacencyOffsets[v]];
+					for (uint32_t i = 0; i < liveValence[v]; i++)
+					{
+						const uint32_t t = adj[i];
+						const float score = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]]
+											+ vertexScores[indices[t * 3 + 2]];
+						if (score > bestScore || (score == bestScore && t < best)) { bestScore = score; best = t; }
+					}
+				}
+			}
+			indices.swap(output);
+		}
+
+		void optimizeOverdraw(std::vector<uint32_t>& indices, const float* positions, const size_t& vertexStride,
+								const uint32_t& vertexCount, const float& threshold)
+		{
+			assert(indices.size() % 3 == 0 && "index count must be a multiple of 3");
+			assert(vertexStride >= sizeof(float) * 3 && "vertex stride too small to hold a position");
+			const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+			if (triangleCount < 2) { return; }
+			constexpr uint32_t cacheSize = 16;
+
+			// hard boundaries, where the cache optimizer had to start over (every vertex of the triangle missed)
+			std::vector<uint32_t> hardBoundaries;
+			{
+				FifoCache cache{ vertexCount, cacheSize };
+				for (uint32_t t = 0; t < triangleCount; t++)
+				{
+					const uint32_t misses = cache.access(indices[t * 3]) + cache.access(indices[t * 3 + 1])
+											+ cache.access(indices[t * 3 + 2]);
+					if (t == 0 || misses == 3) { hardBoundaries.push_back(t); }
+				}
+				hardBoundaries.push_back(triangleCount);
+			}
+
+			/*	soft boundaries split hard clusters further wherever the piece so far is within threshold of the
+				cluster's own ACMR, so reordering pieces costs little cache efficiency */
+			std::vector<uint32_t> clusters;
+			{
+				FifoCache cache{ vertexCount, cacheSize };
+				for (size_t c = 0; c + 1 < hardBoundaries.size(); c++)
+				{
+					const uint32_t begin = hardBoundaries[c];
+					const uint32_t end = hardBoundaries[c + 1];
+					cache.reset();
+					uint32_t clusterMisses = 0;
+					for (uint32_t i = begin * 3; i < end * 3; i++) { clusterMisses += cache.access(indices[i]); }
+					const float limit = threshold * static_cast<float>(clusterMisses) / static_cast<float>(end - begin);
+
+					cache.reset();
+					uint32_t start = begin;
+					uint32_t misses = 0;
+					clusters.push_back(begin);
+					for (uint32_t t = begin; t < end; t++)
+					{
+						misses += cache.access(indices[t * 3]) + cache.access(indices[t * 3 + 1]) + cache.access(indices[t * 3 + 2]);
+						if (t + 1 < end && static_cast<float>(misses) / static_cast<float>(t + 1 - start) <= limit)
+						{
+							start = t + 1;
+							misses = 0;
+							cache.reset();
+							clusters.push_back(start);
+						}
+					}
+				}
+				clusters.push_back(triangleCount);
+			}
+			const uint32_t clusterCount = static_cast<uint32_t>(clusters.size() - 1);
+			if (clusterCount < 2) { return; }
+
+			auto position = [&](const uint32_t& v) -> const float*
+			{ return reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + v * vertexStride); };
+
+			// area weighted centroid and normal per cluster
+			std::vector<float> clusterData(clusterCount * 6, 0.f);
+			float meshCentroid[3]{ 0.f, 0.f, 0.f };
+			float meshArea = 0.f;
+			for (uint32_t c = 0; c < clusterCount; c++)
+			{
+				float* centroid = &clusterData[c * 6];
+				float* normal = &clusterData[c * 6 + 3];
+				float area = 0.f;
+				for (uint32_t t = clusters[c]; t < clusters[c + 1]; t++)
+				{
+					const float* a = position(indices[t * 3]);
+					const float* b = position(indices[t * 3 + 1]);
+					const float* d = position(indices[t * 3 + 2]);
+					const float e1[3]{ b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+					const float e2[3]{ d[0] - a[0], d[1] - a[1], d[2] - a[2] };
+					const float n[3]{ e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+					const float triArea = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+					for (uint32_t k = 0; k < 3; k++)
+					{
+						centroid[k] += (a[k] + b[k] + d[k]) / 3.f * triArea;
+						normal[k] += n[k];
+					}
+					area += triArea;
+				}
+				for (uint32_t k = 0; k < 3; k++) { meshCentroid[k] += centroid[k]; }
+				meshArea += area;
+				const float invArea = area > 0.f ? 1.f / area : 0.f;
+				for (uint32_t k = 0; k < 3; k++) { centroid[k] *= invArea; }
+				const float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+				const float invLength = length > 0.f ? 1.f / length : 0.f;
+				for (uint32_t k = 0; k < 3; k++) { normal[k] *= invLength; }
+			}
+			if (meshArea > 0.f) { for (uint32_t k = 0; k < 3; k++) { meshCentroid[k] /= meshArea; } }
+
+			// clusters facing away from the mesh center are drawn first, they are the most likely occluders
+			std::vector<float> sortKeys(clusterCount);
+			std::vector<uint32_t> order(clusterCount);
+			for (uint32_t c = 0; c < clusterCount; c++)
+			{
+				const float* centroid = &clusterData[c * 6];
+				const float* normal = &clusterData[c * 6 + 3];
+				sortKeys[c] = (centroid[0] - meshCentroid[0]) * normal[0] + (centroid[1] - meshCentroid[1]) * normal[1]
+							+ (centroid[2] - meshCentroid[2]) * normal[2];
+				order[c] = c;
+			}
+			std::stable_sort(order.begin(), order.end(),
+								[&](const uint32_t& a, const uint32_t& b) { return sortKeys[a] > sortKeys[b]; });
+
+			std::vector<uint32_t> output;
+			output.reserve(indices.size());
+			for (const auto& c : order)
+			{
+				output.insert(output.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+			}
+
+			const float acmrBefore = analyzeVertexCache(indices, vertexCount, cacheSize).acmr;
+			const float acmrAfter = analyzeVertexCache(output, vertexCount, cacheSize).acmr;
+			if (acmrAfter <= acmrBefore * threshold) { indices.swap(output); }
+		}
+
+		uint32_t optimizeVertexFetch(void* vertices, const size_t& vertexSize, const uint32_t& vertexCount,
+										std::vector<uint32_t>& indices)
+		{
+			// old vertex index -> new vertex index
+			std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+			uint32_t newCount = 0;
+			for (auto& index : indices)
+			{
+				assert(index < vertexCount && "index out of range");
+				if (remap[index] == UINT32_MAX) { remap[index] = newCount++; }
+				index = remap[index];
+			}
+
+			char* data = static_cast<char*>(vertices);
+			std::vector<char> reordered(newCount * vertexSize);
+			for (uint32_t v = 0; v < vertexCount; v++)
+			{
+				if (remap[v] != UINT32_MAX) { std::memcpy(&reordered[remap[v] * vertexSize], data + v * vertexSize, vertexSize); }
+			}
+			if (!reordered.empty()) { std::memcpy(data, reordered.data(), reordered.size()); }
+			return newCount;
+		}
+
+
+		// symmetric 4x4 error quadric of a set of weighted planes, only the upper triangle is stored
+		struct Quadric
+		{
+			double a2 = 0.0, ab = 0.0, ac = 0.0, ad = 0.0, b2 = 0.0, bc = 0.0, bd = 0.0, c2 = 0.0, cd = 0.0, d2 = 0.0;
+			double weight = 0.0;
+			// plane ax + by + cz + d = 0, (a, b, c) must be unit length
+			void addPlane(const double& a, const double& b, const double& c, const double& d, const double& w)
+			{
+				a2 += w * a * a; ab += w * a * b; ac += w * a * c; ad += w * a * d;
+				b2 += w * b * b; bc += w * b * c; bd += w * b * d;
+				c2 += w * c * c; cd += w * c * d; d2 += w * d * d;
+				weight += w;
+			}
+			void add(const Quadric& q)
+			{
+				a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad; b2 += q.b2; bc += q.bc; bd += q.bd;
+				c2 += q.c2; cd += q.cd; d2 += q.d2; weight += q.weight;
+			}
+			// weighted mean of the squared distances of a point to the planes
+			double error(const float* p) const
+			{
+				if (weight <= 0.0) { return 0.0; }
+				const double x = p[0], y = p[1], z = p[2];
+				const double e = a2 * x * x + b2 * y * y + c2 * z * z + d2
+								+ 2.0 * (ab * x * y + ac * x * z + bc * y * z + ad * x + bd * y + cd * z);
+				return std::max(0.0, e) / weight;
+			}
+		};
+
+		// how a vertex may be moved by an edge collapse
+		enum class SimplifyVertexKind : uint8_t
+		{
+			Manifold, // onto any neighbor
+			Border, // onto a neighbor along a border edge
+			Locked // never (seams, non-manifold vertices, border corners)
+		};
+
+		// border edges keep their shape much better when their planes outweigh the surface planes
+		static constexpr double BORDER_PLANE_WEIGHT = 10.0;
+
+		float simplify(std::vector<uint32_t>& indices, const float* positions, const size_t& vertexStride,
+						const uint32_t& vertexCount, const uint32_t& targetIndexCount, const float& targetError)
+		{
+			assert(indices.size() % 3 == 0 && "index count must be a multiple of 3");
+			assert(vertexStride >= sizeof(float) * 3 && "vertex stride too small to hold a position");
+			if (indices.size() <= targetIndexCount || vertexCount == 0) { return 0.f; }
+			auto positionOf = [&](const uint32_t& v)
+			{ return reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + v * vertexStride); };
+
+			// positions are normalized to the bounding sphere, so errors are relative to the mesh size
+			std::vector<uint8_t> referenced(vertexCount, 0);
+			for (const auto& index : indices)
+			{
+				assert(index < vertexCount && "index out of range");
+				referenced[index] = 1;
+			}
+			float boundsMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+			float boundsMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+			for (uint32_t v = 0; v < vertexCount; v++)
+			{
+				if (!referenced[v]) { continue; }
+				for (uint32_t k = 0; k < 3; k++)
+				{
+					boundsMin[k] = std::min(boundsMin[k], positionOf(v)[k]);
+					boundsMax[k] = std::max(boundsMax[k], positionOf(v)[k]);
+				}
+			}
+			float center[3], radiusSquared = 0.f;
+			for (uint32_t k = 0; k < 3; k++)
+			{
+				center[k] = (boundsMin[k] + boundsMax[k]) * .5f;
+				radiusSquared += (boundsMax[k] - center[k]) * (boundsMax[k] - center[k]);
+			}
+			if (radiusSquared <= 0.f) { return 0.f; }
+			const float invRadius = 1.f / std::sqrt(radiusSquared);
+			std::vector<float> normalized(static_cast<size_t>(vertexCount) * 3);
+			for (uint32_t v = 0; v < vertexCount; v++)
+			{
+				for (uint32_t k = 0; k < 3; k++) { normalized[v * 3 + k] = (positionOf(v)[k] - center[k]) * invRadius; }
+			}
+			auto p = [&](const uint32_t& v) { return &normalized[v * 3]; };
+
+			// vertices sharing a position (attribute seams) are welded for topology, weld[v] is the lowest such vertex
+			std::vector<uint32_t> weld(vertexCount);
+			std::vector<uint32_t> wedgeCount(vertexCount, 0);
+			{
+				std::vector<uint32_t> order(vertexCount);
+				for (uint32_t v = 0; v < vertexCount; v++) { order[v] = v; }
+				auto less = [&](const uint32_t& a, const uint32_t& b)
+				{
+					const float* pa = positionOf(a);
+					const float* pb = positionOf(b);
+					if (pa[0] != pb[0]) { return pa[0] < pb[0]; }
+					if (pa[1] != pb[1]) { return pa[1] < pb[1]; }
+					if (pa[2] != pb[2]) { return pa[2] < pb[2]; }
+					return a < b;
+				};
+				std::sort(order.begin(), order.end(), less);
+				for (uint32_t i = 0; i < vertexCount; i++)
+				{
+					const uint32_t v = order[i];
+					const bool samePosition = i > 0 && std::memcmp(positionOf(v), positionOf(order[i - 1]), sizeof(float) * 3) == 0;
+					weld[v] = samePosition ? weld[order[i - 1]] : v;
+					if (referenced[v]) { wedgeCount[weld[v]]++; }
+				}
+			}
+
+			// triangles per welded edge, 1 is a border, above 2 is non-manifold
+			auto edgeKey = [&](const uint32_t& a, const uint32_t& b)
+			{
+				const uint64_t wa = weld[a], wb = weld[b];
+				return wa < wb ? (wa << 32) | wb : (wb << 32) | wa;
+			};
+			std::unordered_map<uint64_t, uint32_t> edgeTriangles;
+			auto countEdges = [&]()
+			{
+				edgeTriangles.clear();
+				edgeTriangles.reserve(indices.size());
+				for (size_t i = 0; i < indices.size(); i += 3)
+				{
+					for (uint32_t k = 0; k < 3; k++) { edgeTriangles[edgeKey(indices[i + k], indices[i + (k + 1) % 3])]++; }
+				}
+			};
+			countEdges();
+			auto isBorderEdge = [&](const uint32_t& a, const uint32_t& b)
+			{
+				auto it = edgeTriangles.find(edgeKey(a, b));
+				return it != edgeTriangles.end() && it->second == 1;
+			};
+
+			// classification and error quadrics, both per welded vertex
+			std::vector<uint32_t> borderEdges(vertexCount, 0);
+			std::vector<uint8_t> nonManifold(vertexCount, 0);
+			std::vector<Quadric> quadrics(vertexCount);
+			for (size_t i = 0; i < indices.size(); i += 3)
+			{
+				const uint32_t* tri = &indices[i];
+				const float* p0 = p(tri[0]);
+				const float* p1 = p(tri[1]);
+				const float* p2 = p(tri[2]);
+				const double e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+				const double e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+				double n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+				const double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+				if (length > 0.0) { n[0] /= length; n[1] /= length; n[2] /= length; }
+				// the face plane, weighted by area
+				if (length > 0.0)
+				{
+					const double d = -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]);
+					for (uint32_t k = 0; k < 3; k++) { quadrics[weld[tri[k]]].addPlane(n[0], n[1], n[2], d, length * .5); }
+				}
+				for (uint32_t k = 0; k < 3; k++)
+				{
+					const uint32_t a = tri[k], b = tri[(k + 1) % 3];
+					const uint32_t count = edgeTriangles[edgeKey(a, b)];
+					if (count > 2) { nonManifold[weld[a]] = 1; nonManifold[weld[b]] = 1; }
+					if (count != 1) { continue; }
+					borderEdges[weld[a]]++;
+					borderEdges[weld[b]]++;
+					if (length <= 0.0) { continue; }
+					// a plane through the border edge, perpendicular to the face, keeps the border from shrinking
+					const float* pa = p(a);
+					const float* pb = p(b);
+					const double e[3] = { pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2] };
+					double m[3] = { e[1] * n[2] - e[2] * n[1], e[2] * n[0] - e[0] * n[2], e[0] * n[1] - e[1] * n[0] };
+					const double mLength = std::sqrt(m[0] * m[0] + m[1] * m[1] + m[2] * m[2]);
+					if (mLength <= 0.0) { continue; }
+					m[0] /= mLength; m[1] /= mLength; m[2] /= mLength;
+					const double d = -(m[0] * pa[0] + m[1] * pa[1] + m[2] * pa[2]);
+					const double w = (e[0] * e[0] + e[1] * e[1] + e[2] * e[2]) * BORDER_PLANE_WEIGHT;
+					quadrics[weld[a]].addPlane(m[0], m[1], m[2], d, w);
+					quadrics[weld[b]].addPlane(m[0], m[1], m[2], d, w);
+				}
+			}
+			std::vector<SimplifyVertexKind> kinds(vertexCount, SimplifyVertexKind::Locked);
+			for (uint32_t v = 0; v < vertexCount; v++)
+			{
+				const uint32_t w = weld[v];
+				if (wedgeCount[w] != 1 || nonManifold[w]) { continue; }
+				// a border vertex has exactly two border edges, anything else is a corner
+				if (borderEdges[w] == 0) { kinds[v] = SimplifyVertexKind::Manifold; }
+				else if (borderEdges[w] == 2) { kinds[v] = SimplifyVertexKind::Border; }
+			}
+
+			struct Collapse
+			{
+				uint32_t from;
+				uint32_t to;
+				double error;
+			};
+			std::vector<Collapse> candidates;
+			std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+			std::vector<uint32_t> adjacency;
+			std::vector<uint8_t> collapseLocked(vertexCount);
+			const double errorLimit = static_cast<double>(targetError) * targetError;
+			double resultError = 0.0;
+
+			// true if moving from onto to turns a remaining triangle around from by more than ~75 degrees (or degenerates it)
+			auto hasFlips = [&](const uint32_t& from, const uint32_t& to)
+			{
+				for (uint32_t a = adjacencyOffsets[from]; a < adjacencyOffsets[from + 1]; a++)
+				{
+					const uint32_t* tri = &indices[adjacency[a] * 3];
+					if (tri[0] == to || tri[1] == to || tri[2] == to) { continue; } // collapses into a line, removed
+					const float* before[3] = { p(tri[0]), p(tri[1]), p(tri[2]) };
+					const float* after[3] = { before[0], before[1], before[2] };
+					for (uint32_t k = 0; k < 3; k++) { if (tri[k] == from) { after[k] = p(to); } }
+					double n[2][3];
+					for (uint32_t s = 0; s < 2; s++)
+					{
+						const float* const* q = s == 0 ? before : after;
+						const double e1[3] = { q[1][0] - q[0][0], q[1][1] - q[0][1], q[1][2] - q[0][2] };
+						const double e2[3] = { q[2][0] - q[0][0], q[2][1] - q[0][1], q[2][2] - q[0][2] };
+						n[s][0] = e1[1] * e2[2] - e1[2] * e2[1];
+						n[s][1] = e1[2] * e2[0] - e1[0] * e2[2];
+						n[s][2] = e1[0] * e2[1] - e1[1] * e2[0];
+					}
+					const double dot = n[0][0] * n[1][0] + n[0][1] * n[1][1] + n[0][2] * n[1][2];
+					const double lengths = std::sqrt((n[0][0] * n[0][0] + n[0][1] * n[0][1] + n[0][2] * n[0][2])
+													* (n[1][0] * n[1][0] + n[1][1] * n[1][1] + n[1][2] * n[1][2]));
+					if (dot <= .25 * lengths) { return true; }
+				}
+				return false;
+			};
+
+			// each pass collapses a set of independent edges, cheapest first, then rewrites the index buffer
+			while (indices.size() > targetIndexCount)
+			{
+				const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+				std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+				for (const auto& index : indices) { adjacencyOffsets[index + 1]++; }
+				for (uint32_t v = 0; v < vertexCount; v++) { adjacencyOffsets[v + 1] += adjacencyOffsets[v]; }
+				adjacency.resize(indices.size());
+				{
+					std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+					for (uint32_t t = 0; t < triangleCount; t++)
+					{
+						for (uint32_t k = 0; k < 3; k++) { adjacency[fill[indices[t * 3 + k]]++] = t; }
+					}
+				}
+
+				candidates.clear();
+				for (uint32_t t = 0; t < triangleCount; t++)
+				{
+					for (uint32_t k = 0; k < 3; k++)
+					{
+						const uint32_t a = indices[t * 3 + k], b = indices[t * 3 + (k + 1) % 3];
+						for (uint32_t direction = 0; direction < 2; direction++)
+						{
+							const uint32_t from = direction == 0 ? a : b;
+							const uint32_t to = direction == 0 ? b : a;
+							if (kinds[from] == SimplifyVertexKind::Locked || weld[from] == weld[to]) { continue; }
+							if (kinds[from] == SimplifyVertexKind::Border
+								&& (kinds[to] == SimplifyVertexKind::Manifold || !isBorderEdge(from, to))) { continue; }
+							Quadric q = quadrics[weld[from]];
+							q.add(quadrics[weld[to]]);
+							candidates.push_back(Collapse{ from, to, q.error(p(to)) });
+						}
+					}
+				}
+				// ties are broken by vertex index, so the result does not depend on the sort implementation
+				std::sort(candidates.begin(), candidates.end(), [](const Collapse& a, const Collapse& b)
+					{
+						if (a.error != b.error) { return a.error < b.error; }
+						if (a.from != b.from) { return a.from < b.from; }
+						return a.to < b.to;
+					});
+
+				const uint32_t trianglesToRemove = static_cast<uint32_t>((indices.size() - targetIndexCount + 2) / 3);
+				uint32_t removed = 0;
+				uint32_t collapses = 0;
+				std::fill(collapseLocked.begin(), collapseLocked.end(), 0);
+				for (const auto& c : candidates)
+				{
+					if (c.error > errorLimit || removed >= trianglesToRemove) { break; }
+					if (collapseLocked[c.from] || collapseLocked[c.to] || hasFlips(c.from, c.to)) { continue; }
+					// every vertex sharing a triangle with from keeps its triangles unchanged for the rest of the pass
+					for (uint32_t a = adjacencyOffsets[c.from]; a < adjacencyOffsets[c.from + 1]; a++)
+					{
+						const uint32_t* tri = &indices[adjacency[a] * 3];
+						collapseLocked[tri[0]] = 1; collapseLocked[tri[1]] = 1; collapseLocked[tri[2]] = 1;
+					}
+					collapseLocked[c.to] = 1;
+					for (uint32_t a = adjacencyOffsets[c.from]; a < adjacencyOffsets[c.from + 1]; a++)
+					{
+						uint32_t* tri = &indices[adjacency[a] * 3];
+						if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to) { removed++; }
+						for (uint32_t k = 0; k < 3; k++) { if (tri[k] == c.from) { tri[k] = c.to; } }
+					}
+					quadrics[weld[c.to]].add(quadrics[weld[c.from]]);
+					resultError = std::max(resultError, c.error);
+					collapses++;
+				}
+				if (collapses == 0) { break; }
+
+				// drop the triangles which collapsed into lines
+				size_t write = 0;
+				for (size_t i = 0; i < indices.size(); i += 3)
+				{
+					const uint32_t i0 = indices[i], i1 = indices[i + 1], i2 = indices[i + 2];
+					if (i0 == i1 || i1 == i2 || i0 == i2) { continue; }
+					indices[write++] = i0; indices[write++] = i1; indices[write++] = i2;
+				}
+				indices.resize(write);
+				// collapses along a border create new border edges
+				countEdges();
+			}
+			return static_cast<float>(std::sqrt(resultError));
+		}
+	} // namespace MeshOptimizer
+
+} // namespace
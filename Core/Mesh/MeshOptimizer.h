@@ -0,0 +1,53 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace EngineCore
+{
+	/*	CPU-only, deterministic index/vertex reordering for indexed triangle lists,
+		the output depends only on the input, so results can be compared against reference meshes */
+	namespace MeshOptimizer
+	{
+		// post-transform vertex cache efficiency of an index buffer, simulated with a FIFO cache
+		struct VertexCacheStats
+		{
+			// average cache miss ratio, transformed vertices per triangle (0.5 is ideal for large grids, 3 is worst)
+			float acmr = 0.f;
+			// average transform to vertex ratio, transformed vertices per vertex (1 is ideal)
+			float atvr = 0.f;
+		};
+		VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, const uint32_t& vertexCount,
+											const uint32_t& cacheSize = 16);
+
+		/*	reorders triangles for post-transform cache locality (Forsyth's linear-speed algorithm),
+			vertices are left untouched */
+		void optimizeVertexCache(std::vector<uint32_t>& indices, const uint32_t& vertexCount);
+
+		/*	reorders clusters of a cache-optimized index buffer so that outward facing clusters come first,
+			which lets early depth testing reject more of the hidden ones (Tipsify-style overdraw ordering),
+			the new order is rejected if its ACMR exceeds the input ACMR by more than the threshold factor,
+			positions are read as 3 floats at the start of every vertexStride bytes */
+		void optimizeOverdraw(std::vector<uint32_t>& indices, const float* positions, const size_t& vertexStride,
+								const uint32_t& vertexCount, const float& threshold = 1.05f);
+
+		/*	reorders vertices in the order the index buffer first references them and rewrites the indices,
+			unreferenced vertices are dropped, returns the new vertex count */
+		uint32_t optimizeVertexFetch(void* vertices, const size_t& vertexSize, const uint32_t& vertexCount,
+										std::vector<uint32_t>& indices);
+
+		/*	reduces the triangle count towards targetIndexCount by edge collapses in order of their quadric error
+			(Garland and Heckbert, 1997), vertices are only moved onto other existing vertices,
+			so the result indexes the same vertex buffer and can be stored as a level of detail next to the input,
+			attribute seams, non-manifold edges and border corners are kept in place, borders only collapse along themselves,
+			collapses that would flip a triangle are skipped, no collapse exceeds targetError,
+			errors are distances relative to the radius of the bounding sphere of the vertices,
+			returns the largest error of the applied collapses, positions are read like in optimizeOverdraw */
+		float simplify(std::vector<uint32_t>& indices, const float* positions, const size_t& vertexStride,
+						const uint32_t& vertexCount, const uint32_t& targetIndexCount, const float& targetError);
+
+	} // namespace MeshOptimizer
+
+} // namespace
@@ -0,0 +1,365 @@
+#include "Core/Mesh/ObjParser.h"
+#include "Core/Jobs/JobSystem.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#define TINYOBJLOADER_IMPLEMENTATION // mesh file loader
+#include "ThirdParty/tiny_obj_loader.h"
+
+namespace EngineCore
+{
+	namespace ObjParser
+	{
+		using Vertex = ECS::Primitive::Vertex;
+
+		// converts parsed OBJ data into a non-indexed vertex list
+		static void objToVertices(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes,
+								std::vector<Vertex>& vertices)
+		{
+			for (const auto& shape : shapes)
+			{
+				for (const auto& index : shape.mesh.indices)
+				{
+					Vertex vert{};
+					if (index.vertex_index >= 0)
+					{
+						vert.position = { attrib.vertices[3 * index.vertex_index],
+										attrib.vertices[3 * index.vertex_index + 1],
+										attrib.vertices[3 * index.vertex_index + 2] };
+					}
+					if (index.normal_index >= 0)
+					{
+						vert.normal = { attrib.normals[3 * index.normal_index],
+										attrib.normals[3 * index.normal_index + 1],
+										attrib.normals[3 * index.normal_index + 2] };
+					}
+					if (index.texcoord_index >= 0)
+					{
+						vert.uv = { attrib.texcoords[2 * index.texcoord_index],
+									1 - attrib.texcoords[2 * index.texcoord_index + 1] };
+					}
+					vertices.push_back(vert); // add vertex
+				}
+			}
+		}
+
+		void parseFile(const std::string& path, std::vector<Vertex>& vertices)
+		{
+			// TODO: support different mesh formats
+			tinyobj::attrib_t attrib;
+			std::vector<tinyobj::shape_t> shapes;
+			std::vector<tinyobj::material_t> materials;
+			std::string warn, err;
+			if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str()))
+			{
+				throw std::runtime_error("error loading mesh from file: " + warn + err);
+			}
+			objToVertices(attrib, shapes, vertices);
+		}
+
+		void parse(const char* data, const size_t& size, std::vector<Vertex>& vertices)
+		{
+			tinyobj::attrib_t attrib;
+			std::vector<tinyobj::shape_t> shapes;
+			std::vector<tinyobj::material_t> materials;
+			std::string warn, err;
+			std::istringstream stream(std::string(data, size));
+			tinyobj::MaterialFileReader matReader(""); // same lookup as parseFile
+			if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, &stream, &matReader))
+			{
+				throw std::runtime_error("error loading mesh from memory: " + warn + err);
+			}
+			objToVertices(attrib, shapes, vertices);
+		}
+
+		// one face corner, indices are zero-based, -1 if absent
+		struct Corner
+		{
+			// position, texcoord, normal
+			int32_t index[3];
+			// bit k set: index[k] came from a negative (relative) index and is relative to the chunk's first element
+			uint8_t relative;
+		};
+
+		// a range of whole lines, parsed independently of the other chunks
+		struct Chunk
+		{
+			const char* begin = nullptr;
+			const char* end = nullptr;
+			std::vector<float> positions, normals, texcoords;
+			std::vector<Corner> corners;
+			std::vector<uint8_t> faceSizes; // 3 or 4
+			// largest (position index - positions defined before the face in this chunk), detects forward references
+			int64_t maxForwardReference = std::numeric_limits<int64_t>::min();
+			// global index of the chunk's first position, normal, texcoord
+			int64_t firstElement[3]{};
+			std::vector<Vertex> vertices;
+		};
+
+		static inline bool isSpace(const char& c) { return c == ' ' || c == '\t'; }
+
+		// same as tinyobj::parseReal, bounded by the line end instead of a terminating zero
+		static float parseReal(const char*& p, const char* lineEnd)
+		{
+			while (p < lineEnd && isSpace(*p)) { p++; }
+			const char* end = p;
+			while (end < lineEnd && !isSpace(*end) && *end != '\r') { end++; }
+			double value = 0.0;
+			tinyobj::tryParseDouble(p, end, &value);
+			p = end;
+			return static_cast<float>(value);
+		}
+
+		// atoi-like, but fails if there are no digits, in which case tinyobj would fail as well
+		static bool parseIndex(const char*& p, const char* lineEnd, int32_t& out)
+		{
+			bool negative = false;
+			if (p < lineEnd && (*p == '-' || *p == '+')) { negative = *p == '-'; p++; }
+			if (p >= lineEnd || *p < '0' || *p > '9') { return false; }
+			int64_t value = 0;
+			while (p < lineEnd && *p >= '0' && *p <= '9')
+			{
+				value = value * 10 + (*p - '0');
+				if (value > std::numeric_limits<int32_t>::max()) { return false; }
+				p++;
+			}
+			out = static_cast<int32_t>(negative ? -value : value);
+			// skip whatever follows up to the next separator, like tinyobj
+			while (p < lineEnd && *p != '/' && !isSpace(*p) && *p != '\r') { p++; }
+			return out != 0;
+		}
+
+		// parses "v", "v/t", "v//n" or "v/t/n" (tinyobj::parseTriple), localCounts are the elements defined so far in the chunk
+		static bool parseCorner(const char*& p, const char* lineEnd, const int64_t localCounts[3], Chunk& chunk)
+		{
+			Corner corner{ { -1, -1, -1 }, 0 };
+			auto resolve = [&](const uint32_t& k, const int32_t& raw)
+			{
+				if (raw > 0) { corner.index[k] = raw - 1; }
+				else
+				{
+					corner.index[k] = static_cast<int32_t>(localCounts[k] + raw);
+					corner.relative |= static_cast<uint8_t>(1u << k);
+				}
+			};
+
+			int32_t raw = 0;
+			if (!parseIndex(p, lineEnd, raw)) { return false; }
+			resolve(0, raw);
+			if (raw > 0) { chunk.maxForwardReference = std::max<int64_t>(chunk.maxForwardReference, raw - 1 - localCounts[0]); }
+			if (p < lineEnd && *p == '/')
+			{
+				p++;
+				if (p < lineEnd && *p == '/')
+				{
+					p++;
+					if (!parseIndex(p, lineEnd, raw)) { return false; }
+					resolve(2, raw);
+				}
+				else
+				{
+					if (!parseIndex(p, lineEnd, raw)) { return false; }
+					resolve(1, raw);
+					if (p < lineEnd && *p == '/')
+					{
+						p++;
+						if (!parseIndex(p, lineEnd, raw)) { return false; }
+						resolve(2, raw);
+					}
+				}
+			}
+			chunk.corners.push_back(corner);
+			return true;
+		}
+
+		// first pass, returns false if the chunk contains something only tinyobj handles
+		static bool parseChunk(Chunk& chunk)
+		{
+			const char* p = chunk.begin;
+			while (p < chunk.end)
+			{
+				// lines end at \n, \r or \r\n (tinyobj safeGetline)
+				const char* lineEnd = p;
+				while (lineEnd < chunk.end && *lineEnd != '\n' && *lineEnd != '\r') { lineEnd++; }
+				const char* token = p;
+				p = lineEnd + 1;
+
+				while (token < lineEnd && isSpace(*token)) { token++; }
+				if (token >= lineEnd || *token == '#') { continue; }
+				const size_t length = static_cast<size_t>(lineEnd - token);
+				auto at = [&](const size_t& i) { return i < length ? token[i] : '\0'; };
+
+				if (at(0) == 'v' && isSpace(at(1)))
+				{
+					token += 2;
+					for (uint32_t k = 0; k < 3; k++) { chunk.positions.push_back(parseReal(token, lineEnd)); }
+					continue;
+				}
+				if (at(0) == 'v' && at(1) == 'n' && isSpace(at(2)))
+				{
+					token += 3;
+					for (uint32_t k = 0; k < 3; k++) { chunk.normals.push_back(parseReal(token, lineEnd)); }
+					continue;
+				}
+				if (at(0) == 'v' && at(1) == 't' && isSpace(at(2)))
+				{
+					token += 3;
+					for (uint32_t k = 0; k < 2; k++) { chunk.texcoords.push_back(parseReal(token, lineEnd)); }
+					continue;
+				}
+				// skin weights, lines and points may fail the whole file in tinyobj
+				if ((at(0) == 'v' && at(1) == 'w' && isSpace(at(2))) || ((at(0) == 'l' || at(0) == 'p') && isSpace(at(1))))
+				{ return false; }
+
+				if (at(0) == 'f' && isSpace(at(1)))
+				{
+					token += 2;
+					while (token < lineEnd && isSpace(*token)) { token++; }
+					const int64_t localCounts[3] = { static_cast<int64_t>(chunk.positions.size() / 3),
+													static_cast<int64_t>(chunk.texcoords.size() / 2),
+													static_cast<int64_t>(chunk.normals.size() / 3) };
+					uint32_t faceSize = 0;
+					while (token < lineEnd && *token != '\r')
+					{
+						if (!parseCorner(token, lineEnd, localCounts, chunk)) { return false; }
+						faceSize++;
+						while (token < lineEnd && (isSpace(*token) || *token == '\r')) { token++; }
+					}
+					if (faceSize > 4) { return false; }
+					// tinyobj skips degenerate faces
+					if (faceSize < 3) { chunk.corners.resize(chunk.corners.size() - faceSize); continue; }
+					chunk.faceSizes.push_back(static_cast<uint8_t>(faceSize));
+				}
+				// groups, objects, materials and smoothing groups do not affect the vertices
+			}
+			return true;
+		}
+
+		// second pass, turns faces into triangle corner vertices, returns false on invalid indices
+		static bool assembleChunk(Chunk& chunk, const std::vector<float>& positions, const std::vector<float>& normals,
+								const std::vector<float>& texcoords)
+		{
+			const int64_t counts[3] = { static_cast<int64_t>(positions.size() / 3), static_cast<int64_t>(texcoords.size() / 2),
+										static_cast<int64_t>(normals.size() / 3) };
+			chunk.vertices.reserve(chunk.faceSizes.size() * 6);
+
+			auto makeVertex = [&](const Corner& c, int64_t (&resolved)[3]) -> bool
+			{
+				for (uint32_t k = 0; k < 3; k++)
+				{
+					resolved[k] = c.index[k];
+					if (c.relative & (1u << k)) { resolved[k] += chunk.firstElement[k]; }
+					else if (c.index[k] < 0) { continue; } // absent
+					if (resolved[k] < 0 || resolved[k] >= counts[k]) { return false; }
+				}
+				return true;
+			};
+			auto emit = [&](const Corner& c)
+			{
+				int64_t r[3];
+				makeVertex(c, r);
+				Vertex vert{};
+				vert.position = { positions[3 * r[0]], positions[3 * r[0] + 1], positions[3 * r[0] + 2] };
+				if (c.index[2] >= 0 || (c.relative & 4u)) { vert.normal = { normals[3 * r[2]], normals[3 * r[2] + 1], normals[3 * r[2] + 2] }; }
+				if (c.index[1] >= 0 || (c.relative & 2u)) { vert.uv = { texcoords[2 * r[1]], 1 - texcoords[2 * r[1] + 1] }; }
+				chunk.vertices.push_back(vert);
+			};
+
+			const Corner* corners = chunk.corners.data();
+			for (const auto& faceSize : chunk.faceSizes)
+			{
+				int64_t r[4][3];
+				for (uint32_t i = 0; i < faceSize; i++) { if (!makeVertex(corners[i], r[i])) { return false; } }
+				if (faceSize == 3)
+				{
+					emit(corners[0]); emit(corners[1]); emit(corners[2]);
+				}
+				else
+				{
+					// split along the shorter diagonal, computed exactly like tinyobj
+					const float* v0 = &positions[3 * r[0][0]];
+					const float* v1 = &positions[3 * r[1][0]];
+					const float* v2 = &positions[3 * r[2][0]];
+					const float* v3 = &positions[3 * r[3][0]];
+					const float e02x = v2[0] - v0[0], e02y = v2[1] - v0[1], e02z = v2[2] - v0[2];
+					const float e13x = v3[0] - v1[0], e13y = v3[1] - v1[1], e13z = v3[2] - v1[2];
+					const float sqr02 = e02x * e02x + e02y * e02y + e02z * e02z;
+					const float sqr13 = e13x * e13x + e13y * e13y + e13z * e13z;
+					if (sqr02 < sqr13)
+					{
+						emit(corners[0]); emit(corners[1]); emit(corners[2]);
+						emit(corners[0]); emit(corners[2]); emit(corners[3]);
+					}
+					else
+					{
+						emit(corners[0]); emit(corners[1]); emit(corners[3]);
+						emit(corners[1]); emit(corners[2]); emit(corners[3]);
+					}
+				}
+				corners += faceSize;
+			}
+			return true;
+		}
+
+		bool parseParallel(const char* data, const size_t& size, JobSystem& jobs, std::vector<Vertex>& vertices)
+		{
+			// chunks end after a line break, several chunks per thread to balance uneven lines
+			constexpr size_t minChunkBytes = 256 * 1024;
+			const size_t chunkCount = std::max<size_t>(1, std::min<size_t>(jobs.getThreadCount() * 4, size / minChunkBytes));
+			std::vector<Chunk> chunks(chunkCount);
+			const char* dataEnd = data + size;
+			const char* begin = data;
+			for (size_t c = 0; c < chunkCount; c++)
+			{
+				const char* end = c + 1 == chunkCount ? dataEnd : std::max(begin, data + size * (c + 1) / chunkCount);
+				while (end < dataEnd && *end != '\n' && *end != '\r') { end++; }
+				if (end < dataEnd) { end++; }
+				chunks[c].begin = begin;
+				chunks[c].end = end;
+				begin = end;
+			}
+
+			std::atomic<bool> supported{ true };
+			jobs.parallelFor(static_cast<uint32_t>(chunkCount), 1, [&](uint32_t first, uint32_t last)
+				{
+					for (uint32_t c = first; c < last; c++) { if (!parseChunk(chunks[c])) { supported = false; } }
+				});
+			if (!supported) { return false; }
+
+			// merge the attribute arrays, the chunks' relative indices become global through the prefix counts
+			std::vector<float> positions, normals, texcoords;
+			int64_t prefix[3]{};
+			for (auto& chunk : chunks)
+			{
+				std::copy(prefix, prefix + 3, chunk.firstElement);
+				// tinyobj would reject quads referencing positions defined later, such files take the reference path
+				if (chunk.maxForwardReference >= prefix[0]) { return false; }
+				positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+				texcoords.insert(texcoords.end(), chunk.texcoords.begin(), chunk.texcoords.end());
+				normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+				prefix[0] += static_cast<int64_t>(chunk.positions.size() / 3);
+				prefix[1] += static_cast<int64_t>(chunk.texcoords.size() / 2);
+				prefix[2] += static_cast<int64_t>(chunk.normals.size() / 3);
+			}
+
+			jobs.parallelFor(static_cast<uint32_t>(chunkCount), 1, [&](uint32_t first, uint32_t last)
+				{
+					for (uint32_t c = first; c < last; c++)
+					{ if (!assembleChunk(chunks[c], positions, normals, texcoords)) { supported = false; } }
+				});
+			if (!supported) { return false; }
+
+			size_t total = vertices.size();
+			for (const auto& chunk : chunks) { total += chunk.vertices.size(); }
+			vertices.reserve(total);
+			for (const auto& chunk : chunks) { vertices.insert(vertices.end(), chunk.vertices.begin(), chunk.vertices.end()); }
+			return true;
+		}
+
+	} // namespace ObjParser
+
+} // namespace
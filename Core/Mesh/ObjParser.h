@@ -0,0 +1,33 @@
+#pragma once
+
+#include "Core/ECS/Primitive.h"
+
+// std
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace EngineCore
+{
+	class JobSystem;
+
+	/*	OBJ parsing into one vertex per triangle corner (non-indexed), faces are triangulated like tinyobj does,
+		only positions, normals and texture coordinates are read */
+	namespace ObjParser
+	{
+		// reference parser (tinyobj), throws on malformed input
+		void parseFile(const std::string& path, std::vector<ECS::Primitive::Vertex>& vertices);
+		void parse(const char* data, const size_t& size, std::vector<ECS::Primitive::Vertex>& vertices);
+
+		/*	multi-threaded parser producing the same vertices as parse, the input is split into chunks of whole lines
+			which are parsed and assembled into vertices in parallel, then concatenated in file order,
+			returns false without touching vertices if the input uses anything it does not handle identically
+			(polygons above 4 corners, line/point elements, forward or invalid indices), parse should be used then */
+		bool parseParallel(const char* data, const size_t& size, JobSystem& jobs, std::vector<ECS::Primitive::Vertex>& vertices);
+
+		// inputs below this size are not worth splitting
+		static constexpr size_t PARALLEL_MIN_BYTES = 1 << 20;
+
+	} // namespace ObjParser
+
+} // namespace
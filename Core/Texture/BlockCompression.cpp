@@ -0,0 +1,344 @@
+#include "Core/Texture/BlockCompression.h"
+#include "Core/Jobs/JobSystem.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace EngineCore
+{
+	namespace BlockCompression
+	{
+		static constexpr uint32_t BLOCK_TEXELS = 16;
+
+		uint32_t getBlockSize(const BlockFormat& format)
+		{
+			switch (format)
+			{
+			case BlockFormat::BC1: return 8;
+			case BlockFormat::BC3:
+			case BlockFormat::BC5:
+			case BlockFormat::BC7: return 16;
+			default: return 4;
+			}
+		}
+
+		bool isCompressed(const BlockFormat& format) { return format != BlockFormat::RGBA8; }
+
+		size_t getEncodedSize(const BlockFormat& format, const uint32_t& width, const uint32_t& height)
+		{
+			if (!isCompressed(format)) { return static_cast<size_t>(width) * height * 4; }
+			return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * getBlockSize(format);
+		}
+
+		/*	mean and dominant direction of the first channels of the block texels (power iteration on the covariance),
+			the axis is zero if all texels are equal */
+		template<uint32_t C>
+		static void principalAxis(const uint8_t* rgba, float (&mean)[C], float (&axis)[C])
+		{
+			for (uint32_t c = 0; c < C; c++) { mean[c] = 0.f; }
+			for (uint32_t i = 0; i < BLOCK_TEXELS; i++) { for (uint32_t c = 0; c < C; c++) { mean[c] += rgba[i * 4 + c]; } }
+			for (uint32_t c = 0; c < C; c++) { mean[c] /= BLOCK_TEXELS; }
+
+			float cov[C][C]{};
+			float minV[C], maxV[C];
+			for (uint32_t c = 0; c < C; c++) { minV[c] = 255.f; maxV[c] = 0.f; }
+			for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+			{
+				float d[C];
+				for (uint32_t c = 0; c < C; c++)
+				{
+					d[c] = rgba[i * 4 + c] - mean[c];
+					minV[c] = std::min(minV[c], static_cast<float>(rgba[i * 4 + c]));
+					maxV[c] = std::max(maxV[c], static_cast<float>(rgba[i * 4 + c]));
+				}
+				for (uint32_t a = 0; a < C; a++) { for (uint32_t b = 0; b < C; b++) { cov[a][b] += d[a] * d[b]; } }
+			}
+
+			// the bounding box diagonal is a good start, a few iterations are enough for 16 texels
+			for (uint32_t c = 0; c < C; c++) { axis[c] = maxV[c] - minV[c]; }
+			for (uint32_t iteration = 0; iteration < 8; iteration++)
+			{
+				float next[C]{};
+				for (uint32_t a = 0; a < C; a++) { for (uint32_t b = 0; b < C; b++) { next[a] += cov[a][b] * axis[b]; } }
+				float length = 0.f;
+				for (uint32_t c = 0; c < C; c++) { length += next[c] * next[c]; }
+				if (length < 1e-12f) { break; } // the start axis is already orthogonal to all variance, or there is none
+				length = std::sqrt(length);
+				for (uint32_t c = 0; c < C; c++) { axis[c] = next[c] / length; }
+			}
+			float length = 0.f;
+			for (uint32_t c = 0; c < C; c++) { length += axis[c] * axis[c]; }
+			length = std::sqrt(length);
+			for (uint32_t c = 0; c < C; c++) { axis[c] = length > 0.f ? axis[c] / length : 0.f; }
+		}
+
+		// endpoints where the texels projected onto the axis start and end
+		template<uint32_t C>
+		static void fitEndpoints(const uint8_t* rgba, float (&low)[C], float (&high)[C], const float& inset)
+		{
+			float mean[C], axis[C];
+			principalAxis<C>(rgba, mean, axis);
+			float tMin = 0.f, tMax = 0.f;
+			for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+			{
+				float t = 0.f;
+				for (uint32_t c = 0; c < C; c++) { t += (rgba[i * 4 + c] - mean[c]) * axis[c]; }
+				tMin = std::min(tMin, t);
+				tMax = std::max(tMax, t);
+			}
+			// pulling the endpoints in lowers the average error, the extremes are rarely hit exactly
+			const float pull = (tMax - tMin) * inset;
+			for (uint32_t c = 0; c < C; c++)
+			{
+				low[c] = std::max(0.f, std::min(255.f, mean[c] + axis[c] * (tMin + pull)));
+				high[c] = std::max(0.f, std::min(255.f, mean[c] + axis[c] * (tMax - pull)));
+			}
+		}
+
+		static uint16_t packRgb565(const float (&c)[3])
+		{
+			const uint32_t r = static_cast<uint32_t>(std::lround(c[0] * 31.f / 255.f));
+			const uint32_t g = static_cast<uint32_t>(std::lround(c[1] * 63.f / 255.f));
+			const uint32_t b = static_cast<uint32_t>(std::lround(c[2] * 31.f / 255.f));
+			return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+		}
+
+		static void unpackRgb565(const uint16_t& v, int32_t (&c)[3])
+		{
+			const int32_t r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+			c[0] = (r << 3) | (r >> 2);
+			c[1] = (g << 2) | (g >> 4);
+			c[2] = (b << 3) | (b >> 2);
+		}
+
+		void encodeBC1(const uint8_t* rgba, uint8_t* out)
+		{
+			float low[3], high[3];
+			fitEndpoints<3>(rgba, low, high, 1.f / 16.f);
+			uint16_t c0 = packRgb565(high);
+			uint16_t c1 = packRgb565(low);
+			// c0 > c1 selects the four color mode, equal endpoints need no indices at all
+			if (c0 < c1) { std::swap(c0, c1); }
+
+			uint32_t indices = 0;
+			if (c0 != c1)
+			{
+				int32_t palette[4][3];
+				unpackRgb565(c0, palette[0]);
+				unpackRgb565(c1, palette[1]);
+				for (uint32_t c = 0; c < 3; c++)
+				{
+					palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+					palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+				}
+				for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+				{
+					uint32_t best = 0;
+					int32_t bestError = INT32_MAX;
+					for (uint32_t p = 0; p < 4; p++)
+					{
+						int32_t error = 0;
+						for (uint32_t c = 0; c < 3; c++)
+						{
+							const int32_t d = rgba[i * 4 + c] - palette[p][c];
+							error += d * d;
+						}
+						if (error < bestError) { bestError = error; best = p; }
+					}
+					indices |= best << (i * 2);
+				}
+			}
+			std::memcpy(out, &c0, 2);
+			std::memcpy(out + 2, &c1, 2);
+			std::memcpy(out + 4, &indices, 4);
+		}
+
+		// one channel of the block in the BC4 layout (two 8-bit endpoints and 3-bit indices), as used by BC3 alpha and BC5
+		static void encodeChannel(const uint8_t* rgba, const uint32_t& channel, uint8_t* out)
+		{
+			uint8_t minV = 255, maxV = 0;
+			for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+			{
+				minV = std::min(minV, rgba[i * 4 + channel]);
+				maxV = std::max(maxV, rgba[i * 4 + channel]);
+			}
+			uint64_t bits = static_cast<uint64_t>(maxV) | (static_cast<uint64_t>(minV) << 8);
+			if (maxV != minV)
+			{
+				// a0 > a1 selects the eight value mode: a0, a1 and six steps between them
+				int32_t palette[8];
+				palette[0] = maxV;
+				palette[1] = minV;
+				for (int32_t k = 1; k <= 6; k++) { palette[k + 1] = ((7 - k) * maxV + k * minV) / 7; }
+				for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+				{
+					uint64_t best = 0;
+					int32_t bestError = INT32_MAX;
+					for (uint32_t p = 0; p < 8; p++)
+					{
+						const int32_t error = std::abs(rgba[i * 4 + channel] - palette[p]);
+						if (error < bestError) { bestError = error; best = p; }
+					}
+					bits |= best << (16 + i * 3);
+				}
+			}
+			std::memcpy(out, &bits, 8);
+		}
+
+		void encodeBC3(const uint8_t* rgba, uint8_t* out)
+		{
+			encodeChannel(rgba, 3, out);
+			encodeBC1(rgba, out + 8);
+		}
+
+		void encodeBC5(const uint8_t* rgba, uint8_t* out)
+		{
+			encodeChannel(rgba, 0, out);
+			encodeChannel(rgba, 1, out + 8);
+		}
+
+		// appends bits to a 128-bit block, least significant first
+		struct BitWriter
+		{
+			uint8_t* out;
+			uint32_t position = 0;
+			void write(uint32_t value, const uint32_t& count)
+			{
+				for (uint32_t i = 0; i < count; i++, position++)
+				{
+					if ((value >> i) & 1) { out[position / 8] |= static_cast<uint8_t>(1u << (position % 8)); }
+				}
+			}
+		};
+
+		void encodeBC7(const uint8_t* rgba, uint8_t* out)
+		{
+			static constexpr int32_t WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+			float endpoints[2][4];
+			fitEndpoints<4>(rgba, endpoints[0], endpoints[1], 1.f / 32.f);
+			bool opaque = true;
+			for (uint32_t i = 0; i < BLOCK_TEXELS; i++) { opaque = opaque && rgba[i * 4 + 3] == 255; }
+
+			// mode 6: 7-bit endpoints with one shared low bit (p-bit) each, 4-bit indices
+			uint32_t quantized[2][4];
+			uint32_t pbits[2];
+			int32_t palette[16][4];
+			for (uint32_t e = 0; e < 2; e++)
+			{
+				float bestError = 1e30f;
+				for (uint32_t p = opaque ? 1 : 0; p < 2; p++) // opaque blocks keep alpha at exactly 255
+				{
+					uint32_t q[4];
+					float error = 0.f;
+					for (uint32_t c = 0; c < 4; c++)
+					{
+						q[c] = static_cast<uint32_t>(std::max(0l, std::min(127l, std::lround((endpoints[e][c] - p) * 0.5f))));
+						const float d = static_cast<float>(q[c] * 2 + p) - endpoints[e][c];
+						error += d * d;
+					}
+					if (error < bestError)
+					{
+						bestError = error;
+						pbits[e] = p;
+						for (uint32_t c = 0; c < 4; c++) { quantized[e][c] = q[c]; }
+					}
+				}
+			}
+			for (uint32_t w = 0; w < 16; w++)
+			{
+				for (uint32_t c = 0; c < 4; c++)
+				{
+					const int32_t v0 = static_cast<int32_t>(quantized[0][c] * 2 + pbits[0]);
+					const int32_t v1 = static_cast<int32_t>(quantized[1][c] * 2 + pbits[1]);
+					palette[w][c] = ((64 - WEIGHTS[w]) * v0 + WEIGHTS[w] * v1 + 32) >> 6;
+				}
+			}
+
+			uint32_t indices[BLOCK_TEXELS];
+			for (uint32_t i = 0; i < BLOCK_TEXELS; i++)
+			{
+				int32_t bestError = INT32_MAX;
+				for (uint32_t w = 0; w < 16; w++)
+				{
+					int32_t error = 0;
+					for (uint32_t c = 0; c < 4; c++)
+					{
+						const int32_t d = rgba[i * 4 + c] - palette[w][c];
+						error += d * d;
+					}
+					if (error < bestError) { bestError = error; indices[i] = w; }
+				}
+			}
+			// the first index is stored without its top bit, so it must be below 8, swapping the endpoints flips all indices
+			if (indices[0] >= 8)
+			{
+				for (uint32_t c = 0; c < 4; c++) { std::swap(quantized[0][c], quantized[1][c]); }
+				std::swap(pbits[0], pbits[1]);
+				for (uint32_t i = 0; i < BLOCK_TEXELS; i++) { indices[i] = 15 - indices[i]; }
+			}
+
+			std::memset(out, 0, 16);
+			BitWriter writer{ out };
+			writer.write(1u << 6, 7); // mode 6
+			for (uint32_t c = 0; c < 4; c++)
+			{
+				writer.write(quantized[0][c], 7);
+				writer.write(quantized[1][c], 7);
+			}
+			writer.write(pbits[0], 1);
+			writer.write(pbits[1], 1);
+			writer.write(indices[0], 3);
+			for (uint32_t i = 1; i < BLOCK_TEXELS; i++) { writer.write(indices[i], 4); }
+			assert(writer.position == 128 && "BC7 mode 6 block must be 128 bits");
+		}
+
+		std::vector<uint8_t> encode(const BlockFormat& format, const uint8_t* rgba, const uint32_t& width, const uint32_t& height,
+									JobSystem* jobs)
+		{
+			assert(rgba && width > 0 && height > 0 && "cannot encode an empty image");
+			std::vector<uint8_t> out(getEncodedSize(format, width, height));
+			if (!isCompressed(format))
+			{
+				std::memcpy(out.data(), rgba, out.size());
+				return out;
+			}
+
+			void (*encodeBlock)(const uint8_t*, uint8_t*) = encodeBC1;
+			if (format == BlockFormat::BC3) { encodeBlock = encodeBC3; }
+			else if (format == BlockFormat::BC5) { encodeBlock = encodeBC5; }
+			else if (format == BlockFormat::BC7) { encodeBlock = encodeBC7; }
+			const uint32_t blockSize = getBlockSize(format);
+			const uint32_t blocksX = (width + 3) / 4;
+			const uint32_t blocksY = (height + 3) / 4;
+
+			auto encodeRows = [&](uint32_t begin, uint32_t end)
+			{
+				uint8_t block[BLOCK_TEXELS * 4];
+				for (uint32_t by = begin; by < end; by++)
+				{
+					for (uint32_t bx = 0; bx < blocksX; bx++)
+					{
+						for (uint32_t y = 0; y < 4; y++)
+						{
+							const size_t row = std::min(by * 4 + y, height - 1);
+							for (uint32_t x = 0; x < 4; x++)
+							{
+								const size_t column = std::min(bx * 4 + x, width - 1);
+								std::memcpy(&block[(y * 4 + x) * 4], &rgba[(row * width + column) * 4], 4);
+							}
+						}
+						encodeBlock(block, &out[(static_cast<size_t>(by) * blocksX + bx) * blockSize]);
+					}
+				}
+			};
+			if (jobs) { jobs->parallelFor(blocksY, 4, encodeRows); }
+			else { encodeRows(0, blocksY); }
+			return out;
+		}
+
+	} // namespace BlockCompression
+
+} // namespace
@@ -0,0 +1,47 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace EngineCore
+{
+	class JobSystem;
+
+	// block-compressed texture formats, stored in cooked textures, see CookedTexture
+	enum class BlockFormat : uint8_t
+	{
+		RGBA8 = 0,	// uncompressed, 4 bytes per texel
+		BC1 = 1,	// opaque color, 8 bytes per 4x4 block (8:1 against RGBA8)
+		BC3 = 2,	// color and smooth alpha, 16 bytes per block
+		BC5 = 3,	// two independent channels (normal map XY), 16 bytes per block
+		BC7 = 4,	// color and alpha at higher quality than BC3, 16 bytes per block, only mode 6 is encoded
+	};
+
+	/*	CPU encoders for the BC formats, fast single-pass fits intended for offline cooking:
+		endpoints are picked along the principal axis of each block and indices by the nearest palette entry,
+		texels are encoded in the space they are stored in (sRGB images stay in sRGB) */
+	namespace BlockCompression
+	{
+		// bytes per 4x4 block, 4 bytes per texel for RGBA8
+		uint32_t getBlockSize(const BlockFormat& format);
+		bool isCompressed(const BlockFormat& format);
+		// size of an encoded width x height image, partial blocks at the edges count as whole blocks
+		size_t getEncodedSize(const BlockFormat& format, const uint32_t& width, const uint32_t& height);
+
+		// encodes one 4x4 block of RGBA8 texels (row-major, 64 bytes) into out (getBlockSize bytes)
+		void encodeBC1(const uint8_t* rgba, uint8_t* out);
+		void encodeBC3(const uint8_t* rgba, uint8_t* out);
+		// red and green channels
+		void encodeBC5(const uint8_t* rgba, uint8_t* out);
+		void encodeBC7(const uint8_t* rgba, uint8_t* out);
+
+		/*	encodes a whole RGBA8 image, edge blocks repeat the last row and column,
+			block rows are spread over the job threads if a job system is given */
+		std::vector<uint8_t> encode(const BlockFormat& format, const uint8_t* rgba, const uint32_t& width, const uint32_t& height,
+									JobSystem* jobs = nullptr);
+
+	} // namespace BlockCompression
+
+} // namespace
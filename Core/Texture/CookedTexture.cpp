@@ -0,0 +1,116 @@
+#include "Core/Texture/CookedTexture.h"
+#include "Core/Texture/MipChain.h"
+#include "Core/Types/Math.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace EngineCore
+{
+	namespace CookedTexture
+	{
+		static constexpr uint64_t LEVEL_ALIGNMENT = 16;
+		// a 64k texture has 17 levels
+		static constexpr uint32_t MAX_LEVELS = 17;
+
+		std::string getCookedPath(const std::string& sourcePath) { return sourcePath + ".vtex"; }
+
+		bool parse(const MappedFile& file, View& view)
+		{
+			if (!file.isOpen() || file.size() < sizeof(Header)) { return false; }
+			const Header* header = reinterpret_cast<const Header*>(file.data());
+			if (header->magic != MAGIC || header->version != VERSION) { return false; }
+			if (header->format > static_cast<uint8_t>(BlockFormat::BC7) || header->width == 0 || header->height == 0
+				|| header->levelCount == 0 || header->levelCount > MipChain::getLevelCount(header->width, header->height)
+				|| header->levelCount > MAX_LEVELS) { return false; }
+
+			/*	every level must lie inside the file and match the size of its mip, levels follow each other in order
+				without overlapping, so the range from the first to the end of the last one holds all of them */
+			const uint64_t fileSize = file.size();
+			auto inside = [&](const uint64_t& offset, const uint64_t& bytes)
+			{ return offset % LEVEL_ALIGNMENT == 0 && offset <= fileSize && bytes <= fileSize - offset; };
+			if (!inside(header->levelOffset, sizeof(Level) * header->levelCount)) { return false; }
+
+			const BlockFormat format = static_cast<BlockFormat>(header->format);
+			const Level* levels = reinterpret_cast<const Level*>(file.data() + header->levelOffset);
+			for (uint32_t i = 0; i < header->levelCount; i++)
+			{
+				const uint32_t width = std::max(1u, header->width >> i);
+				const uint32_t height = std::max(1u, header->height >> i);
+				if (levels[i].width != width || levels[i].height != height
+					|| levels[i].size != BlockCompression::getEncodedSize(format, width, height)
+					|| !inside(levels[i].offset, levels[i].size)) { return false; }
+				if (i > 0 && levels[i].offset < levels[i - 1].offset + levels[i - 1].size) { return false; }
+			}
+
+			view.header = header;
+			view.levels = levels;
+			view.data = file.data();
+			return true;
+		}
+
+		bool isUpToDate(const Header& header, const std::string& sourcePath)
+		{
+			uint64_t size = 0;
+			int64_t writeTime = 0;
+			// cooked files may be shipped without their sources
+			if (!MappedFile::getFileStamp(sourcePath, size, writeTime)) { return true; }
+			return header.sourceSize == size && header.sourceWriteTime == writeTime;
+		}
+
+		bool cook(const std::string& sourcePath, const uint8_t* rgba, const uint32_t& width, const uint32_t& height,
+				const BlockFormat& format, const bool& srgb, const uint64_t& sourceHash, JobSystem* jobs)
+		{
+			Header header{};
+			header.format = static_cast<uint8_t>(format);
+			header.srgb = format != BlockFormat::BC5 && srgb ? 1 : 0;
+			header.width = width;
+			header.height = height;
+			header.sourceHash = sourceHash;
+			MappedFile::getFileStamp(sourcePath, header.sourceSize, header.sourceWriteTime);
+
+			std::vector<MipChain::Level> mips;
+			const auto chain = MipChain::build(rgba, width, height, header.srgb != 0, mips, MAX_LEVELS);
+			header.levelCount = static_cast<uint32_t>(mips.size());
+
+			auto align = [](const uint64_t& v) { return Math::roundUpToClosestMultiple<uint64_t>(v, LEVEL_ALIGNMENT); };
+			header.levelOffset = align(sizeof(Header));
+			std::vector<Level> levels(header.levelCount);
+			std::vector<std::vector<uint8_t>> encoded(header.levelCount);
+			uint64_t end = align(header.levelOffset + sizeof(Level) * levels.size());
+			for (uint32_t i = 0; i < header.levelCount; i++)
+			{
+				encoded[i] = BlockCompression::encode(format, chain.data() + mips[i].offset, mips[i].width, mips[i].height, jobs);
+				levels[i].offset = end;
+				levels[i].size = encoded[i].size();
+				levels[i].width = mips[i].width;
+				levels[i].height = mips[i].height;
+				end = align(end + levels[i].size);
+			}
+
+			std::vector<char> file(end, 0);
+			std::memcpy(file.data(), &header, sizeof(Header));
+			std::memcpy(&file[header.levelOffset], levels.data(), sizeof(Level) * levels.size());
+			for (uint32_t i = 0; i < header.levelCount; i++)
+			{ std::memcpy(&file[levels[i].offset], encoded[i].data(), encoded[i].size()); }
+
+			// written under a temporary name first, so a crash never leaves a truncated file behind
+			const std::string cookedPath = getCookedPath(sourcePath);
+			const std::string tempPath = cookedPath + ".tmp";
+			{
+				std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+				if (!out) { return false; }
+				out.write(file.data(), static_cast<std::streamsize>(file.size()));
+				if (!out) { return false; }
+			}
+			std::error_code error;
+			std::filesystem::rename(tempPath, cookedPath, error);
+			return !error;
+		}
+
+	} // namespace CookedTexture
+
+} // namespace
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "Core/Texture/BlockCompression.h"
+#include "Core/Types/MappedFile.h"
+
+// std
+#include <cstdint>
+#include <string>
+
+namespace EngineCore
+{
+	class JobSystem;
+
+	/*	versioned binary texture container, holds every mip level exactly as uploaded to the GPU
+		(block-compressed or RGBA8), so a mapped file is copied straight into a staging buffer without decoding,
+		layout: Header | level table | level 0 | level 1 | ..., every level 16-byte aligned, little-endian */
+	namespace CookedTexture
+	{
+		static constexpr uint32_t MAGIC = 0x58455456; // "VTEX"
+		// increment whenever the layout or the encoders change, older files are ignored until cooked again
+		static constexpr uint32_t VERSION = 1;
+
+		struct Header
+		{
+			uint32_t magic = MAGIC;
+			uint32_t version = VERSION;
+			uint8_t format = 0; // BlockFormat
+			uint8_t srgb = 1; // color data, sampled through an sRGB view
+			uint16_t reserved0 = 0;
+			uint32_t width = 0;
+			uint32_t height = 0;
+			uint32_t levelCount = 0;
+			uint32_t reserved1 = 0;
+			// identifies the source file, a cooked file is stale once the source size or write time changes
+			uint64_t sourceHash = 0; // FNV-1a of the source contents
+			uint64_t sourceSize = 0;
+			int64_t sourceWriteTime = 0;
+			// byte offset of the level table from the start of the file
+			uint64_t levelOffset = 0;
+		};
+		static_assert(sizeof(Header) == 64, "cooked texture header layout changed, increment VERSION");
+
+		struct Level
+		{
+			uint64_t offset = 0;
+			uint64_t size = 0;
+			uint32_t width = 0;
+			uint32_t height = 0;
+		};
+
+		// pointers into a mapped cooked file, valid while the file stays mapped
+		struct View
+		{
+			const Header* header = nullptr;
+			const Level* levels = nullptr;
+			const uint8_t* data = nullptr; // start of the file, level offsets are relative to it
+		};
+
+		std::string getCookedPath(const std::string& sourcePath);
+
+		/*	validates the header and level ranges, returns false for foreign, truncated or outdated files
+			and for levels that are out of order or overlap */
+		bool parse(const MappedFile& file, View& view);
+		// true if the source file (if present) has not changed since cooking
+		bool isUpToDate(const Header& header, const std::string& sourcePath);
+
+		/*	builds the mip chain of decoded RGBA8 texels, encodes every level and writes the cooked file next to the source,
+			srgb is ignored for BC5 (two linear channels), returns false if the file could not be written,
+			blocks are encoded on the job threads if a job system is given */
+		bool cook(const std::string& sourcePath, const uint8_t* rgba, const uint32_t& width, const uint32_t& height,
+				const BlockFormat& format, const bool& srgb, const uint64_t& sourceHash, JobSystem* jobs = nullptr);
+
+	} // namespace CookedTexture
+
+} // namespace
@@ -0,0 +1,110 @@
+#include "Core/Texture/MipChain.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace EngineCore
+{
+	namespace MipChain
+	{
+		// resolution of the linear to sRGB table, fine enough that the dark end rounds to the same byte as pow
+		static constexpr uint32_t ENCODE_STEPS = 16384;
+
+		static float srgbToLinear(const float& c)
+		{ return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f); }
+		static float linearToSrgb(const float& c)
+		{ return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.f / 2.4f) - 0.055f; }
+
+		struct SrgbTables
+		{
+			std::array<float, 256> decode{};
+			std::array<uint8_t, ENCODE_STEPS + 1> encode{};
+			SrgbTables()
+			{
+				for (uint32_t i = 0; i < 256; i++) { decode[i] = srgbToLinear(i / 255.f); }
+				for (uint32_t i = 0; i <= ENCODE_STEPS; i++)
+				{ encode[i] = static_cast<uint8_t>(std::lround(linearToSrgb(static_cast<float>(i) / ENCODE_STEPS) * 255.f)); }
+			}
+		};
+		static const SrgbTables& getSrgbTables()
+		{
+			static const SrgbTables tables{};
+			return tables;
+		}
+
+		uint32_t getLevelCount(const uint32_t& width, const uint32_t& height)
+		{
+			uint32_t levels = 1;
+			for (uint32_t size = std::max(width, height); size > 1; size >>= 1) { levels++; }
+			return levels;
+		}
+
+		// halves src into dst, both 4 bytes per texel
+		static void downsample(const uint8_t* src, const Level& srcLevel, uint8_t* dst, const Level& dstLevel, const bool& srgb)
+		{
+			const SrgbTables& tables = getSrgbTables();
+			for (uint32_t y = 0; y < dstLevel.height; y++)
+			{
+				const uint32_t y0 = std::min(y * 2, srcLevel.height - 1);
+				const uint32_t y1 = std::min(y * 2 + 1, srcLevel.height - 1);
+				const uint8_t* row0 = src + static_cast<size_t>(y0) * srcLevel.width * 4;
+				const uint8_t* row1 = src + static_cast<size_t>(y1) * srcLevel.width * 4;
+				uint8_t* out = dst + static_cast<size_t>(y) * dstLevel.width * 4;
+				for (uint32_t x = 0; x < dstLevel.width; x++)
+				{
+					const size_t x0 = static_cast<size_t>(std::min(x * 2, srcLevel.width - 1)) * 4;
+					const size_t x1 = static_cast<size_t>(std::min(x * 2 + 1, srcLevel.width - 1)) * 4;
+					for (uint32_t c = 0; c < 4; c++)
+					{
+						if (srgb && c < 3)
+						{
+							const float sum = tables.decode[row0[x0 + c]] + tables.decode[row0[x1 + c]]
+											+ tables.decode[row1[x0 + c]] + tables.decode[row1[x1 + c]];
+							const float linear = std::min(sum * 0.25f, 1.f);
+							out[x * 4 + c] = tables.encode[static_cast<uint32_t>(linear * ENCODE_STEPS + 0.5f)];
+						}
+						else
+						{
+							const uint32_t sum = row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c];
+							out[x * 4 + c] = static_cast<uint8_t>((sum + 2) / 4);
+						}
+					}
+				}
+			}
+		}
+
+		std::vector<uint8_t> build(const uint8_t* rgba, const uint32_t& width, const uint32_t& height, const bool& srgb,
+									std::vector<Level>& levelsOut, uint32_t maxLevels)
+		{
+			assert(rgba && width > 0 && height > 0 && "mip chain needs a non-empty image");
+			const uint32_t fullCount = getLevelCount(width, height);
+			const uint32_t levelCount = maxLevels == 0 ? fullCount : std::min(maxLevels, fullCount);
+
+			levelsOut.resize(levelCount);
+			size_t total = 0;
+			for (uint32_t i = 0; i < levelCount; i++)
+			{
+				Level& level = levelsOut[i];
+				level.width = std::max(1u, width >> i);
+				level.height = std::max(1u, height >> i);
+				level.offset = total;
+				level.size = static_cast<size_t>(level.width) * level.height * 4;
+				total += level.size;
+			}
+
+			std::vector<uint8_t> data(total);
+			std::memcpy(data.data(), rgba, levelsOut[0].size);
+			for (uint32_t i = 1; i < levelCount; i++)
+			{
+				downsample(data.data() + levelsOut[i - 1].offset, levelsOut[i - 1],
+							data.data() + levelsOut[i].offset, levelsOut[i], srgb);
+			}
+			return data;
+		}
+
+	} // namespace MipChain
+
+} // namespace
@@ -0,0 +1,34 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace EngineCore
+{
+	/*	CPU generation of mip chains for 8-bit RGBA images, used when the upload queue cannot blit
+		or the format has no linear filtering support, see Image::loadFromDisk */
+	namespace MipChain
+	{
+		// one level within the buffer returned by build
+		struct Level
+		{
+			uint32_t width = 0;
+			uint32_t height = 0;
+			size_t offset = 0;
+			size_t size = 0;
+		};
+
+		// number of levels down to 1x1
+		uint32_t getLevelCount(const uint32_t& width, const uint32_t& height);
+
+		/*	copies level 0 and appends the smaller levels, tightly packed one after another,
+			every level is a 2x2 box filter of the previous one (odd edges repeat the last texel),
+			srgb texels are averaged in linear space, alpha is always linear, maxLevels of 0 builds the whole chain */
+		std::vector<uint8_t> build(const uint8_t* rgba, const uint32_t& width, const uint32_t& height, const bool& srgb,
+									std::vector<Level>& levelsOut, uint32_t maxLevels = 0);
+
+	} // namespace MipChain
+
+} // namespace
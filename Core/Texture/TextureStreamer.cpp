@@ -0,0 +1,110 @@
+#include "Core/Texture/TextureStreamer.h"
+#include "Core/GPU/Memory/UploadManager.h"
+
+#include <cassert>
+#include <chrono>
+#include <iostream>
+
+namespace EngineCore
+{
+	TextureStreamer::TextureStreamer(EngineDevice& device, const uint32_t& workerCount, const float& lodBias)
+		: device{ device }, jobs{ workerCount }
+	{
+		// neutral grey, so unloaded surfaces do not stand out
+		const uint8_t grey[4] = { 128, 128, 128, 255 };
+		placeholder = std::make_unique<Image>(device, grey, 1, 1, false);
+		Image::createSampler(sampler, device, 1.f, lodBias);
+	}
+
+	TextureStreamer::~TextureStreamer()
+	{
+		waitIdle();
+		vkDestroySampler(device.device(), sampler, nullptr);
+	}
+
+	TextureStreamer::Handle TextureStreamer::request(const std::string& path)
+	{
+		std::lock_guard<std::mutex> g(lock);
+		const Handle handle = static_cast<Handle>(entries.size());
+		entries.push_back(std::make_unique<Entry>());
+		Entry& entry = *entries.back();
+		entry.path = path;
+		// entries are never removed and their addresses are stable, the worker may keep the reference
+		entry.job = jobs.run([this, &entry]() { load(entry); });
+		loading.push_back(handle);
+		return handle;
+	}
+
+	void TextureStreamer::load(Entry& entry)
+	{
+		try
+		{
+			// decoding, mip generation and staging all happen here, the upload itself completes later
+			auto image = std::make_unique<Image>(device, entry.path, false);
+			std::lock_guard<std::mutex> g(lock);
+			entry.image = std::move(image);
+		}
+		catch (const std::exception& e)
+		{
+			std::cout << "could not stream texture " << entry.path << ": " << e.what() << "\n";
+			std::lock_guard<std::mutex> g(lock);
+			entry.failed = true;
+		}
+	}
+
+	const std::vector<TextureStreamer::Handle>& TextureStreamer::update()
+	{
+		std::lock_guard<std::mutex> g(lock);
+		becameResident.clear();
+		for (size_t i = 0; i < loading.size();)
+		{
+			Entry& entry = *entries[loading[i]];
+			const bool uploaded = entry.image && entry.image->getUploadFuture().wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+			if (uploaded) { entry.resident = true; becameResident.push_back(loading[i]); }
+			if (uploaded || entry.failed)
+			{
+				loading[i] = loading.back();
+				loading.pop_back();
+			}
+			else { i++; }
+		}
+		return becameResident;
+	}
+
+	void TextureStreamer::waitIdle()
+	{
+		std::vector<JobHandle> pending;
+		{
+			std::lock_guard<std::mutex> g(lock);
+			for (const Handle& handle : loading) { pending.push_back(entries[handle]->job); }
+		}
+		for (const auto& job : pending) { jobs.wait(job); }
+		device.getUploads().waitIdle();
+	}
+
+	VkImageView TextureStreamer::getImageView(const Handle& handle)
+	{
+		std::lock_guard<std::mutex> g(lock);
+		assert(handle < entries.size() && "texture handle out of range");
+		const Entry& entry = *entries[handle];
+		if (entry.resident) { return entry.image->imageView; }
+		// resident images have completed their upload, the placeholder may still be uploading in the first frames
+		device.getUploads().useInFrames(placeholder->getUploadValue());
+		return placeholder->imageView;
+	}
+
+	bool TextureStreamer::isResident(const Handle& handle)
+	{
+		std::lock_guard<std::mutex> g(lock);
+		assert(handle < entries.size() && "texture handle out of range");
+		return entries[handle]->resident;
+	}
+
+	bool TextureStreamer::hasFailed(const Handle& handle)
+	{
+		std::lock_guard<std::mutex> g(lock);
+		assert(handle < entries.size() && "texture handle out of range");
+		return entries[handle]->failed;
+	}
+
+} // namespace
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Core/GPU/engine_device.h"
+#include "Core/GPU/Memory/Image.h"
+#include "Core/Jobs/JobSystem.h"
+
+// std
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace EngineCore
+{
+	/*	loads textures in the background: files are decoded (or mapped, see CookedTexture) and uploaded on worker threads
+		of its own job system, so long decodes never hold up the per-frame jobs,
+		until a texture is resident its handle resolves to a small placeholder, which the renderer swaps out
+		once update reports the texture, see DescriptorSet::setImageArrayElement */
+	class TextureStreamer
+	{
+	public:
+		using Handle = uint32_t;
+		/*	loads are mostly decoding and disk reads, a few workers keep up with streaming,
+			one per hardware thread would compete with the per-frame job system for every core */
+		static constexpr uint32_t DEFAULT_WORKER_COUNT = 2;
+
+		// lodBias applies to the shared sampler, the streamed textures and the placeholder have no sampler of their own
+		TextureStreamer(EngineDevice& device, const uint32_t& workerCount = DEFAULT_WORKER_COUNT, const float& lodBias = 0.f);
+		// waits for loads in progress
+		~TextureStreamer();
+
+		TextureStreamer(const TextureStreamer&) = delete;
+		TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+		// queues a texture file, returns right away, thread safe
+		Handle request(const std::string& path);
+
+		/*	marks textures whose upload has completed as resident and returns their handles,
+			call once per frame from the render thread, the returned list is valid until the next call */
+		const std::vector<Handle>& update();
+		// blocks until every requested texture is resident (or failed to load), from the render thread since it flushes uploads
+		void waitIdle();
+
+		// view of the texture once it is resident, the placeholder's until then
+		VkImageView getImageView(const Handle& handle);
+		bool isResident(const Handle& handle);
+		// failed textures keep the placeholder
+		bool hasFailed(const Handle& handle);
+		// a sampler for all streamed textures, it allows every mip level
+		VkSampler getSampler() const { return sampler; }
+
+	private:
+		struct Entry
+		{
+			std::string path;
+			// set by the worker once the upload has been queued
+			std::unique_ptr<Image> image;
+			bool resident = false;
+			bool failed = false;
+			JobHandle job;
+		};
+
+		EngineDevice& device;
+		std::unique_ptr<Image> placeholder;
+		VkSampler sampler = VK_NULL_HANDLE;
+
+		std::mutex lock;
+		std::vector<std::unique_ptr<Entry>> entries; // indexed by handle
+		std::vector<Handle> loading;
+		std::vector<Handle> becameResident;
+
+		// destroyed first, so no worker touches the entries after that
+		JobSystem jobs;
+
+		void load(Entry& entry);
+	};
+
+} // namespace
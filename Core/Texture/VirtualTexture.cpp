@@ -0,0 +1,273 @@
+#include "Core/Texture/VirtualTexture.h"
+#include "Core/GPU/Memory/UploadManager.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace EngineCore
+{
+	VirtualTexture::VirtualTexture(EngineDevice& device, const std::string& sourcePath, const uint32_t& framesInFlight,
+								const uint32_t& maxWidth, const uint32_t& maxHeight, const uint32_t& atlasSlots, const uint32_t& workerCount)
+		: device{ device }, framesInFlight{ framesInFlight }, jobs{ workerCount }
+	{
+		assert(framesInFlight > 0 && "virtual texture needs at least one frame in flight");
+		const std::string path = VirtualTextureFile::getCookedPath(sourcePath);
+		if (!file.open(path) || !VirtualTextureFile::parse(file, view))
+		{ throw std::runtime_error("failed to open virtual texture tile file: " + path); }
+		if (!VirtualTextureFile::isUpToDate(*view.header, sourcePath))
+		{ std::cout << "virtual texture tile file " << path << " is older than its source, cook it again\n"; }
+
+		const VirtualTextureFile::Header& header = *view.header;
+		cache = std::make_unique<VirtualTextureCache>(view.layout, atlasSlots, atlasSlots, PROTECTED_FRAMES);
+		slotSide = header.tileSize + 2 * header.border;
+		const uint32_t atlasSide = slotSide * atlasSlots;
+		if (atlasSide > device.properties.limits.maxImageDimension2D)
+		{ throw std::runtime_error("virtual texture atlas exceeds the maximum image size: " + path); }
+
+		// the atlas has a single level, tiles of every level are stored side by side
+		VkImageCreateInfo info = Image::makeImageCreateInfo(atlasSide, atlasSide, 1);
+		info.format = header.srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+		atlas = std::make_unique<Image>(device, info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		atlas->imageView = Image::createImageView(device, atlas->getImage(), info.format);
+		Image::createSampler(sampler, device, 0.f, 0.f, 0.f);
+
+		// the root tile is always resident, it is uploaded with the initial page table before the first frame
+		UploadManager& uploads = device.getUploads();
+		const VkDeviceSize tileBytes = VirtualTextureFile::getTileBytes(header);
+		UploadManager::ImageUpload upload{};
+		upload.image = atlas->getImage();
+		upload.width = atlasSide;
+		upload.height = atlasSide;
+		VkBufferImageCopy region{};
+		region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+		region.imageExtent = { slotSide, slotSide, 1 };
+		upload.regions.push_back(region);
+		uploads.uploadImage(upload, VirtualTextureFile::getTile(view, view.layout.getRoot()), tileBytes);
+
+		const auto& table = cache->getPageTable();
+		const VkDeviceSize tableBytes = sizeof(VirtualTextureCache::PageEntry) * table.size();
+		pageTable = std::make_unique<GBuffer>(device, tableBytes, 1, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+											VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		// batches complete in order, every frame that samples the texture waits for the later of the two uploads
+		initialUploadValue = uploads.uploadBuffer(pageTable->getBuffer(), 0, table.data(), tableBytes).value;
+		uploads.useInFrames(initialUploadValue);
+		cache->takeDirtyRanges(dirtyRanges);
+
+		Parameters params{};
+		params.width = header.width;
+		params.height = header.height;
+		params.tileSize = header.tileSize;
+		params.border = header.border;
+		params.levelCount = header.levelCount;
+		params.slotsX = atlasSlots;
+		params.slotsY = atlasSlots;
+		params.slotSide = slotSide;
+		for (uint32_t i = 0; i < header.levelCount; i++)
+		{
+			params.levels[i][0] = view.layout.getTilesX(i);
+			params.levels[i][1] = view.layout.getTilesY(i);
+			params.levels[i][2] = view.layout.getFirstTile(i);
+		}
+		parameters = std::make_unique<GBuffer>(device, sizeof(Parameters), 1, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+											VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		if (parameters->map() != VK_SUCCESS) { throw std::runtime_error("failed to map virtual texture parameters"); }
+		parameters->writeToBuffer(&params);
+
+		// read back by the host once the frame's fence has signaled
+		const uint32_t blocksX = (maxWidth + FEEDBACK_SCALE - 1) / FEEDBACK_SCALE;
+		const uint32_t blocksY = (maxHeight + FEEDBACK_SCALE - 1) / FEEDBACK_SCALE;
+		feedbackEntries = blocksX * blocksY;
+		const VkDeviceSize feedbackBytes = sizeof(FeedbackHeader) + sizeof(uint32_t) * feedbackEntries;
+		for (uint32_t i = 0; i < framesInFlight; i++)
+		{
+			feedback.push_back(std::make_unique<GBuffer>(device, feedbackBytes, 1, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+														VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+			if (feedback.back()->map() != VK_SUCCESS) { throw std::runtime_error("failed to map virtual texture feedback buffer"); }
+			auto* data = static_cast<uint8_t*>(feedback.back()->getMappedMemory());
+			std::memset(data, 0, static_cast<size_t>(feedbackBytes));
+			FeedbackHeader* fh = reinterpret_cast<FeedbackHeader*>(data);
+			fh->blocksX = blocksX;
+			fh->blocksY = blocksY;
+		}
+		feedbackFrames.assign(framesInFlight, 0);
+
+		createDescriptors();
+	}
+
+	VirtualTexture::~VirtualTexture()
+	{
+		for (const auto& l : loads) { jobs.wait(l.second); }
+		vkDestroySampler(device.device(), sampler, nullptr);
+		// the root tile and page table may still be uploading, they are released once the copies have completed
+		std::shared_ptr<Image> atlasImage = std::move(atlas);
+		std::shared_ptr<GBuffer> table = std::move(pageTable);
+		device.getUploads().releaseAfter(initialUploadValue, [atlasImage, table]() mutable { atlasImage.reset(); table.reset(); });
+	}
+
+	void VirtualTexture::createDescriptors()
+	{
+		setLayout = DescriptorSetLayout::Builder(device)
+			.addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+			.addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+			.addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+			.addBinding(3, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT)
+			.build();
+		pool = DescriptorPool::Builder(device)
+			.setMaxSets(framesInFlight)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2 * framesInFlight)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, framesInFlight)
+			.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, framesInFlight)
+			.build();
+
+		sets.resize(framesInFlight);
+		VkDescriptorBufferInfo tableInfo = pageTable->descriptorInfo();
+		VkDescriptorImageInfo atlasInfo{ sampler, atlas->imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+		VkDescriptorBufferInfo paramsInfo = parameters->descriptorInfo();
+		for (uint32_t i = 0; i < framesInFlight; i++)
+		{
+			VkDescriptorBufferInfo feedbackInfo = feedback[i]->descriptorInfo();
+			if (!DescriptorWriter(*setLayout, *pool)
+				.writeBuffer(0, &tableInfo)
+				.writeImage(1, &atlasInfo)
+				.writeBuffer(2, &feedbackInfo)
+				.writeBuffer(3, &paramsInfo)
+				.build(sets[i])) { throw std::runtime_error("failed to allocate virtual texture descriptor set"); }
+		}
+	}
+
+	void VirtualTexture::load(const uint32_t& tile)
+	{
+		// touching the mapped pages reads them from disk, on the worker rather than the render thread
+		LoadedTile result{};
+		result.tile = tile;
+		const uint8_t* texels = VirtualTextureFile::getTile(view, tile);
+		result.texels.assign(texels, texels + VirtualTextureFile::getTileBytes(*view.header));
+		std::lock_guard<std::mutex> g(lock);
+		loaded.push_back(std::move(result));
+	}
+
+	void VirtualTexture::update(VkCommandBuffer commandBuffer, const uint32_t& frameIndex, FrameUploadArena& arena)
+	{
+		assert(frameIndex < framesInFlight && "frame index out of range");
+		frame++;
+
+		// the frame's previous feedback is complete, its fence has signaled and endFrame made the writes available
+		auto* feedbackData = static_cast<uint8_t*>(feedback[frameIndex]->getMappedMemory());
+		FeedbackHeader* fh = reinterpret_cast<FeedbackHeader*>(feedbackData);
+		uint32_t* entries = reinterpret_cast<uint32_t*>(feedbackData + sizeof(FeedbackHeader));
+		if (feedbackFrames[frameIndex] != 0)
+		{
+			cache->resolveFeedback(entries, feedbackEntries, feedbackFrames[frameIndex]);
+			std::memset(entries, 0, sizeof(uint32_t) * feedbackEntries);
+		}
+		// every pixel of a block gets its turn within FEEDBACK_SCALE^2 frames
+		fh->jitterX = static_cast<uint32_t>(frame % FEEDBACK_SCALE);
+		fh->jitterY = static_cast<uint32_t>((frame / FEEDBACK_SCALE) % FEEDBACK_SCALE);
+		feedbackFrames[frameIndex] = frame;
+
+		// reads that finished since the last frame, tiles that found no slot are requested again by later feedback
+		std::vector<LoadedTile> ready;
+		{
+			std::lock_guard<std::mutex> g(lock);
+			ready.swap(loaded);
+		}
+		const uint32_t inFlight = static_cast<uint32_t>(loads.size() - ready.size());
+		for (const uint32_t& tile : cache->takeRequests(MAX_LOADS_IN_FLIGHT - inFlight, frame))
+		{
+			loads[tile] = jobs.run([this, tile]() { load(tile); });
+		}
+
+		std::vector<VkBufferImageCopy> tileCopies;
+		std::vector<VkBuffer> tileSources;
+		const VkDeviceSize tileBytes = VirtualTextureFile::getTileBytes(*view.header);
+		for (auto& result : ready)
+		{
+			loads.erase(result.tile);
+			const uint32_t slot = cache->insert(result.tile, frame);
+			if (slot == VirtualTextureCache::INVALID_SLOT) { continue; }
+
+			const UploadRange range = arena.allocate(tileBytes);
+			std::memcpy(range.mapped, result.texels.data(), static_cast<size_t>(tileBytes));
+			uint32_t x, y;
+			cache->getSlotPosition(slot, x, y);
+			VkBufferImageCopy region{};
+			region.bufferOffset = range.offset;
+			region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+			region.imageOffset = { static_cast<int32_t>(x * slotSide), static_cast<int32_t>(y * slotSide), 0 };
+			region.imageExtent = { slotSide, slotSide, 1 };
+			tileCopies.push_back(region);
+			tileSources.push_back(range.buffer);
+		}
+
+		std::vector<VkBufferCopy> tableCopies;
+		std::vector<VkBuffer> tableSources;
+		cache->takeDirtyRanges(dirtyRanges);
+		const auto& table = cache->getPageTable();
+		for (const auto& r : dirtyRanges)
+		{
+			const VkDeviceSize bytes = sizeof(VirtualTextureCache::PageEntry) * r.second;
+			const UploadRange range = arena.allocate(bytes);
+			std::memcpy(range.mapped, table.data() + r.first, static_cast<size_t>(bytes));
+			tableCopies.push_back(VkBufferCopy{ range.offset, sizeof(VirtualTextureCache::PageEntry) * r.first, bytes });
+			tableSources.push_back(range.buffer);
+		}
+		if (tileCopies.empty() && tableCopies.empty()) { return; }
+
+		/*	earlier frames on this queue may still sample the slots and read the page table,
+			the copies wait for their fragment shaders, the atlas keeps its contents through the transitions */
+		VkImageMemoryBarrier toTransfer{};
+		toTransfer.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		toTransfer.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		toTransfer.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		toTransfer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		toTransfer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		toTransfer.image = atlas->getImage();
+		toTransfer.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+		toTransfer.srcAccessMask = 0;
+		toTransfer.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+							0, nullptr, 0, nullptr, tileCopies.empty() ? 0 : 1, &toTransfer);
+
+		for (size_t i = 0; i < tileCopies.size(); i++)
+		{
+			vkCmdCopyBufferToImage(commandBuffer, tileSources[i], atlas->getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &tileCopies[i]);
+		}
+		for (size_t i = 0; i < tableCopies.size(); i++)
+		{
+			vkCmdCopyBuffer(commandBuffer, tableSources[i], pageTable->getBuffer(), 1, &tableCopies[i]);
+		}
+
+		VkImageMemoryBarrier toShader = toTransfer;
+		toShader.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		toShader.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		toShader.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		toShader.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		VkMemoryBarrier tableDone{};
+		tableDone.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		tableDone.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		tableDone.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+							tableCopies.empty() ? 0 : 1, &tableDone, 0, nullptr, tileCopies.empty() ? 0 : 1, &toShader);
+	}
+
+	void VirtualTexture::endFrame(VkCommandBuffer commandBuffer, const uint32_t& frameIndex)
+	{
+		assert(frameIndex < framesInFlight && "frame index out of range");
+		// the fence alone does not make shader writes visible to the host, even in coherent memory
+		VkBufferMemoryBarrier toHost{};
+		toHost.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		toHost.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		toHost.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		toHost.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		toHost.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		toHost.buffer = feedback[frameIndex]->getBuffer();
+		toHost.offset = 0;
+		toHost.size = VK_WHOLE_SIZE;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+							0, nullptr, 1, &toHost, 0, nullptr);
+	}
+
+} // namespace
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "Core/GPU/engine_device.h"
+#include "Core/GPU/Memory/Buffer.h"
+#include "Core/GPU/Memory/Descriptors.h"
+#include "Core/GPU/Memory/Image.h"
+#include "Core/GPU/Memory/UploadArena.h"
+#include "Core/Jobs/JobSystem.h"
+#include "Core/Texture/VirtualTextureCache.h"
+#include "Core/Texture/VirtualTextureFile.h"
+#include "Core/Types/MappedFile.h"
+
+// std
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace EngineCore
+{
+	/*	a texture far larger than video memory, sampled through a page table (see virtual_texture.glsl):
+		only tiles that recent frames asked for are kept in a physical atlas, the rest falls back to coarser resident tiles,
+		shaders write the tiles they need into a per-frame feedback buffer (one pixel of every 8x8 block per frame),
+		update reads it back once the frame has completed, loads missing tiles from the tile file (see VirtualTextureFile)
+		on worker threads and copies them into the atlas on the graphics queue, so frames in flight never see a slot change */
+	class VirtualTexture
+	{
+	public:
+		// feedback is written for one pixel of every FEEDBACK_SCALE x FEEDBACK_SCALE block
+		static constexpr uint32_t FEEDBACK_SCALE = 8;
+
+		/*	sourcePath is the image the tile file was cooked from, the atlas holds atlasSlots x atlasSlots tiles,
+			feedback covers screens up to maxWidth x maxHeight pixels, workerCount 0 uses the JobSystem default */
+		VirtualTexture(EngineDevice& device, const std::string& sourcePath, const uint32_t& framesInFlight,
+					const uint32_t& maxWidth, const uint32_t& maxHeight, const uint32_t& atlasSlots = 16, const uint32_t& workerCount = 1);
+		// waits for tile reads in progress
+		~VirtualTexture();
+
+		VirtualTexture(const VirtualTexture&) = delete;
+		VirtualTexture& operator=(const VirtualTexture&) = delete;
+
+		/*	resolves the feedback of the frame's previous use, starts loading missing tiles and records the copies
+			of loaded tiles and page table changes, call after the frame's fence was waited on (beginFrame)
+			and before its render pass begins, staging memory comes from the frame's upload arena */
+		void update(VkCommandBuffer commandBuffer, const uint32_t& frameIndex, FrameUploadArena& arena);
+		/*	makes the frame's feedback writes visible to the host, call after the last render pass that samples
+			the texture ends and before the command buffer is submitted, update reads them once the fence has signaled */
+		void endFrame(VkCommandBuffer commandBuffer, const uint32_t& frameIndex);
+
+		/*	set layout: 0 page table (storage buffer), 1 atlas (combined image sampler),
+			2 feedback (storage buffer, per frame), 3 parameters (uniform buffer), fragment stage */
+		VkDescriptorSetLayout getDescriptorSetLayout() const { return setLayout->getDescriptorSetLayout(); }
+		VkDescriptorSet getDescriptorSet(const uint32_t& frameIndex) const { return sets[frameIndex]; }
+
+		const VirtualTextureLayout& getLayout() const { return cache->getLayout(); }
+		uint32_t getResidentTileCount() const { return cache->getResidentCount(); }
+
+	private:
+		// read by the shaders, std140
+		struct Parameters
+		{
+			uint32_t width, height, tileSize, border;
+			uint32_t levelCount, slotsX, slotsY, slotSide;
+			uint32_t levels[VirtualTextureLayout::MAX_LEVELS][4]; // tiles x, tiles y, first tile, unused
+		};
+		// at the start of each feedback buffer, followed by one entry per block (tile id + 1, 0 if nothing was sampled)
+		struct FeedbackHeader
+		{
+			uint32_t blocksX, blocksY;
+			// the pixel of each block that writes feedback this frame
+			uint32_t jitterX, jitterY;
+		};
+		struct LoadedTile
+		{
+			uint32_t tile = 0;
+			std::vector<uint8_t> texels;
+		};
+
+		// slots are only reused once they have not been seen in feedback for this many frames
+		static constexpr uint32_t PROTECTED_FRAMES = 16;
+		static constexpr uint32_t MAX_LOADS_IN_FLIGHT = 32;
+
+		EngineDevice& device;
+		const uint32_t framesInFlight;
+		MappedFile file;
+		VirtualTextureFile::View view{};
+		std::unique_ptr<VirtualTextureCache> cache;
+		uint32_t slotSide = 0;
+		uint64_t frame = 0;
+
+		std::unique_ptr<Image> atlas;
+		VkSampler sampler = VK_NULL_HANDLE;
+		std::unique_ptr<GBuffer> pageTable;
+		// the atlas and page table are written by the upload manager until this value has completed
+		uint64_t initialUploadValue = 0;
+		std::unique_ptr<GBuffer> parameters;
+		std::vector<std::unique_ptr<GBuffer>> feedback; // per frame, host visible
+		std::vector<uint64_t> feedbackFrames; // frame each feedback buffer was last written in, 0 if never
+		uint32_t feedbackEntries = 0;
+
+		std::unique_ptr<DescriptorSetLayout> setLayout;
+		std::unique_ptr<DescriptorPool> pool;
+		std::vector<VkDescriptorSet> sets;
+
+		std::mutex lock;
+		std::vector<LoadedTile> loaded; // guarded by lock
+		std::unordered_map<uint32_t, JobHandle> loads; // tile -> read in progress, render thread only
+		std::vector<std::pair<uint32_t, uint32_t>> dirtyRanges;
+
+		// destroyed first, so no worker touches the file after that
+		JobSystem jobs;
+
+		void createDescriptors();
+		void load(const uint32_t& tile);
+	};
+
+} // namespace
@@ -0,0 +1,266 @@
+#include "Core/Texture/VirtualTextureCache.h"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace EngineCore
+{
+	// the root tile never leaves the first slot
+	static constexpr uint32_t ROOT_SLOT = 0;
+
+	VirtualTextureLayout::VirtualTextureLayout(const uint32_t& widthIn, const uint32_t& heightIn, const uint32_t& tileSizeIn)
+		: width{ widthIn }, height{ heightIn }, tileSize{ tileSizeIn }
+	{
+		assert(width > 0 && height > 0 && tileSize > 0 && "virtual texture without texels");
+		levelCount = 1;
+		while (std::max(getLevelWidth(levelCount - 1), getLevelHeight(levelCount - 1)) > tileSize)
+		{
+			if (levelCount == MAX_LEVELS) { throw std::runtime_error("virtual texture has too many levels for its tile size"); }
+			levelCount++;
+		}
+		if (getTilesX(0) > MAX_TILES_PER_AXIS || getTilesY(0) > MAX_TILES_PER_AXIS)
+		{ throw std::runtime_error("virtual texture has too many tiles"); }
+	}
+
+	uint32_t VirtualTextureLayout::getFirstTile(const uint32_t& level) const
+	{
+		uint32_t first = 0;
+		for (uint32_t i = 0; i < level; i++) { first += getTilesX(i) * getTilesY(i); }
+		return first;
+	}
+
+	bool VirtualTextureLayout::isValid(const uint32_t& tile) const
+	{
+		const uint32_t level = VirtualTile::getLevel(tile);
+		return level < levelCount && VirtualTile::getX(tile) < getTilesX(level) && VirtualTile::getY(tile) < getTilesY(level);
+	}
+
+	uint32_t VirtualTextureLayout::getIndex(const uint32_t& tile) const
+	{
+		const uint32_t level = VirtualTile::getLevel(tile);
+		return getFirstTile(level) + VirtualTile::getY(tile) * getTilesX(level) + VirtualTile::getX(tile);
+	}
+
+	uint32_t VirtualTextureLayout::getParent(const uint32_t& tile) const
+	{
+		const uint32_t level = VirtualTile::getLevel(tile) + 1;
+		assert(level < levelCount && "the root tile has no parent");
+		// the clamp keeps a child's parent the tile the shader finds at the coarser level
+		return VirtualTile::pack(level, std::min(VirtualTile::getX(tile) / 2, getTilesX(level) - 1),
+								std::min(VirtualTile::getY(tile) / 2, getTilesY(level) - 1));
+	}
+
+	uint32_t VirtualTextureLayout::getRoot() const { return VirtualTile::pack(levelCount - 1, 0, 0); }
+
+	VirtualTextureCache::VirtualTextureCache(const VirtualTextureLayout& layoutIn, const uint32_t& slotsXIn, const uint32_t& slotsY,
+											const uint32_t& protectedFramesIn)
+		: layout{ layoutIn }, slotsX{ slotsXIn }, protectedFrames{ protectedFramesIn }
+	{
+		assert(layout.levelCount > 0 && "virtual texture layout is empty");
+		assert(slotsX > 0 && slotsY > 0 && slotsX <= 256 && slotsY <= 256 && "page entries store slot positions in 8 bits");
+		assert(slotsX * slotsY > 1 && "the root tile needs a slot of its own");
+
+		slots.resize(slotsX * slotsY);
+		for (uint32_t i = static_cast<uint32_t>(slots.size()) - 1; i > ROOT_SLOT; i--) { freeSlots.push_back(i); }
+		const uint32_t root = layout.getRoot();
+		slots[ROOT_SLOT].tile = root;
+		slots[ROOT_SLOT].used = true;
+		resident[root] = ROOT_SLOT;
+
+		// everything starts out mapped to the root, the whole table has to be written once
+		pageTable.assign(layout.getTileCount(), makeEntry(ROOT_SLOT, layout.levelCount - 1));
+		dirtyLevels.resize(layout.levelCount);
+		for (uint32_t i = 0; i < layout.levelCount; i++) { dirtyLevels[i] = { layout.getFirstTile(i), layout.getFirstTile(i + 1) }; }
+	}
+
+	void VirtualTextureCache::resolveFeedback(const uint32_t* entries, const size_t& count, const uint64_t& frame)
+	{
+		// most of the feedback repeats a few tiles, a visited tile has had its ancestors visited too
+		visited.clear();
+		for (size_t i = 0; i < count; i++)
+		{
+			if (entries[i] == 0) { continue; }
+			uint32_t tile = entries[i] - 1;
+			if (!layout.isValid(tile)) { continue; }
+			while (visited.insert(tile).second)
+			{
+				const auto it = resident.find(tile);
+				if (it != resident.end()) { touch(it->second, frame); }
+				else if (loading.count(tile) == 0) { queued[tile] = frame; }
+				if (VirtualTile::getLevel(tile) + 1 == layout.levelCount) { break; }
+				tile = layout.getParent(tile);
+			}
+		}
+	}
+
+	std::vector<uint32_t> VirtualTextureCache::takeRequests(const uint32_t& maxCount, const uint64_t& frame)
+	{
+		std::vector<std::pair<uint32_t, uint64_t>> candidates;
+		for (auto it = queued.begin(); it != queued.end();)
+		{
+			if (frame > it->second + REQUEST_LIFETIME) { it = queued.erase(it); continue; }
+			candidates.push_back(*it);
+			++it;
+		}
+		const size_t taken = std::min<size_t>(maxCount, candidates.size());
+		// coarser levels first, then the most recently requested
+		std::partial_sort(candidates.begin(), candidates.begin() + taken, candidates.end(), [](const auto& a, const auto& b)
+		{
+			const uint32_t levelA = VirtualTile::getLevel(a.first), levelB = VirtualTile::getLevel(b.first);
+			return levelA != levelB ? levelA > levelB : a.second > b.second;
+		});
+
+		std::vector<uint32_t> requests;
+		requests.reserve(taken);
+		for (size_t i = 0; i < taken; i++)
+		{
+			const uint32_t tile = candidates[i].first;
+			queued.erase(tile);
+			loading.insert(tile);
+			requests.push_back(tile);
+		}
+		return requests;
+	}
+
+	uint32_t VirtualTextureCache::insert(const uint32_t& tile, const uint64_t& frame)
+	{
+		assert(layout.isValid(tile) && "virtual texture tile out of range");
+		loading.erase(tile);
+		queued.erase(tile);
+		const auto found = resident.find(tile);
+		if (found != resident.end()) { touch(found->second, frame); return found->second; }
+
+		uint32_t slot = INVALID_SLOT;
+		if (!freeSlots.empty())
+		{
+			slot = freeSlots.back();
+			freeSlots.pop_back();
+		}
+		else
+		{
+			// the head of the list is the least recently used, if it is protected every other slot is too
+			if (lruHead == INVALID_SLOT || frame < slots[lruHead].lastUsed + protectedFrames) { return INVALID_SLOT; }
+			slot = lruHead;
+			evict(slot);
+		}
+
+		Slot& s = slots[slot];
+		s.tile = tile;
+		s.used = true;
+		s.lastUsed = frame;
+		linkBack(slot);
+		resident[tile] = slot;
+
+		// the tile replaces every coarser fallback in its area, finer resident tiles keep their entries
+		const uint32_t level = VirtualTile::getLevel(tile);
+		mapArea(tile, makeEntry(slot, level), [level](const uint32_t& mapped) { return mapped > level; });
+		return slot;
+	}
+
+	void VirtualTextureCache::cancel(const uint32_t& tile) { loading.erase(tile); }
+
+	void VirtualTextureCache::takeDirtyRanges(std::vector<std::pair<uint32_t, uint32_t>>& rangesOut)
+	{
+		rangesOut.clear();
+		for (auto& range : dirtyLevels)
+		{
+			if (range.first < range.second) { rangesOut.emplace_back(range.first, range.second - range.first); }
+			range = { UINT32_MAX, 0 };
+		}
+	}
+
+	VirtualTextureCache::PageEntry VirtualTextureCache::makeEntry(const uint32_t& slot, const uint32_t& level) const
+	{
+		uint32_t x, y;
+		getSlotPosition(slot, x, y);
+		return x | (y << 8) | (level << 16) | (1u << 24);
+	}
+
+	void VirtualTextureCache::touch(const uint32_t& slot, const uint64_t& frame)
+	{
+		Slot& s = slots[slot];
+		s.lastUsed = std::max(s.lastUsed, frame);
+		if (slot == ROOT_SLOT || lruTail == slot) { return; }
+		unlink(slot);
+		linkBack(slot);
+	}
+
+	void VirtualTextureCache::unlink(const uint32_t& slot)
+	{
+		Slot& s = slots[slot];
+		if (s.prev != INVALID_SLOT) { slots[s.prev].next = s.next; }
+		else { lruHead = s.next; }
+		if (s.next != INVALID_SLOT) { slots[s.next].prev = s.prev; }
+		else { lruTail = s.prev; }
+		s.prev = s.next = INVALID_SLOT;
+	}
+
+	void VirtualTextureCache::linkBack(const uint32_t& slot)
+	{
+		Slot& s = slots[slot];
+		s.prev = lruTail;
+		s.next = INVALID_SLOT;
+		if (lruTail != INVALID_SLOT) { slots[lruTail].next = slot; }
+		else { lruHead = slot; }
+		lruTail = slot;
+	}
+
+	template<typename Predicate>
+	void VirtualTextureCache::mapArea(const uint32_t& tile, const PageEntry& entry, Predicate replace)
+	{
+		const uint32_t level = VirtualTile::getLevel(tile);
+		const uint32_t x = VirtualTile::getX(tile);
+		const uint32_t y = VirtualTile::getY(tile);
+		// the last row and column of a level also cover the finer tiles whose parents were clamped onto them
+		const bool lastX = x + 1 == layout.getTilesX(level);
+		const bool lastY = y + 1 == layout.getTilesY(level);
+
+		for (uint32_t k = 0; k <= level; k++)
+		{
+			const uint32_t shift = level - k;
+			const uint32_t tilesX = layout.getTilesX(k);
+			const uint32_t tilesY = layout.getTilesY(k);
+			const uint32_t endX = lastX ? tilesX : std::min(tilesX, (x + 1) << shift);
+			const uint32_t endY = lastY ? tilesY : std::min(tilesY, (y + 1) << shift);
+			const uint32_t first = layout.getFirstTile(k);
+
+			auto& dirty = dirtyLevels[k];
+			for (uint32_t row = y << shift; row < endY; row++)
+			{
+				for (uint32_t col = x << shift; col < endX; col++)
+				{
+					const uint32_t index = first + row * tilesX + col;
+					PageEntry& current = pageTable[index];
+					if (!replace((current >> 16) & 0xFF)) { continue; }
+					current = entry;
+					dirty.first = std::min(dirty.first, index);
+					dirty.second = std::max(dirty.second, index + 1);
+				}
+			}
+		}
+	}
+
+	void VirtualTextureCache::evict(const uint32_t& slot)
+	{
+		Slot& s = slots[slot];
+		assert(slot != ROOT_SLOT && s.used && "evicting a slot that holds no tile");
+		const uint32_t tile = s.tile;
+
+		// the area falls back to the nearest resident ancestor, the root at worst
+		uint32_t ancestor = layout.getParent(tile);
+		auto it = resident.find(ancestor);
+		while (it == resident.end())
+		{
+			ancestor = layout.getParent(ancestor);
+			it = resident.find(ancestor);
+		}
+		const uint32_t level = VirtualTile::getLevel(tile);
+		mapArea(tile, makeEntry(it->second, VirtualTile::getLevel(ancestor)), [level](const uint32_t& mapped) { return mapped == level; });
+
+		resident.erase(tile);
+		unlink(slot);
+		s.used = false;
+	}
+
+} // namespace
@@ -0,0 +1,133 @@
+#pragma once
+
+// std
+#include <cstdint>
+#include <cstddef>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace EngineCore
+{
+	/*	tile grid of a virtual texture, level 0 is the full resolution, every level is half the size of the one before
+		(like MipChain), the last level fits in a single tile, tiles of all levels are numbered level by level, row-major */
+	struct VirtualTextureLayout
+	{
+		static constexpr uint32_t MAX_LEVELS = 16;
+		static constexpr uint32_t MAX_TILES_PER_AXIS = 1u << 14;
+
+		uint32_t width = 0;
+		uint32_t height = 0;
+		uint32_t tileSize = 0;
+		uint32_t levelCount = 0;
+
+		VirtualTextureLayout() = default;
+		VirtualTextureLayout(const uint32_t& widthIn, const uint32_t& heightIn, const uint32_t& tileSizeIn);
+
+		uint32_t getLevelWidth(const uint32_t& level) const { return width >> level > 0 ? width >> level : 1; }
+		uint32_t getLevelHeight(const uint32_t& level) const { return height >> level > 0 ? height >> level : 1; }
+		uint32_t getTilesX(const uint32_t& level) const { return (getLevelWidth(level) + tileSize - 1) / tileSize; }
+		uint32_t getTilesY(const uint32_t& level) const { return (getLevelHeight(level) + tileSize - 1) / tileSize; }
+		// number of the first tile of the level
+		uint32_t getFirstTile(const uint32_t& level) const;
+		uint32_t getTileCount() const { return getFirstTile(levelCount); }
+
+		bool isValid(const uint32_t& tile) const;
+		// index of the tile among all tiles (page table entry, tile file table)
+		uint32_t getIndex(const uint32_t& tile) const;
+		// tile of the next level covering this one, the last row and column of a level may map past the smaller level
+		uint32_t getParent(const uint32_t& tile) const;
+		// the single tile of the last level, always resident
+		uint32_t getRoot() const;
+	};
+
+	// tile ids, packed the same way as the feedback written by virtual_texture.glsl
+	namespace VirtualTile
+	{
+		inline uint32_t pack(const uint32_t& level, const uint32_t& x, const uint32_t& y) { return (level << 28) | (y << 14) | x; }
+		inline uint32_t getLevel(const uint32_t& tile) { return tile >> 28; }
+		inline uint32_t getX(const uint32_t& tile) { return tile & 0x3FFF; }
+		inline uint32_t getY(const uint32_t& tile) { return (tile >> 14) & 0x3FFF; }
+	}
+
+	/*	CPU side of virtual texturing, independent of vulkan: which tiles live in which slot of the physical atlas,
+		the page table that maps every tile to the finest resident tile covering it, and the resolution of feedback,
+		slots are recycled least recently used first, not thread safe */
+	class VirtualTextureCache
+	{
+	public:
+		static constexpr uint32_t INVALID_SLOT = UINT32_MAX;
+		// requests not confirmed by feedback for this many frames are dropped
+		static constexpr uint64_t REQUEST_LIFETIME = 120;
+
+		/*	one page table entry per tile of every level: slot x (bits 0-7), slot y (8-15), level of the mapped tile (16-23),
+			bit 24 set, the shader follows it to the atlas */
+		using PageEntry = uint32_t;
+
+		/*	the atlas holds slotsXIn * slotsY tiles (at most 256 per axis), the root tile is pinned in slot 0,
+			tiles used within the last protectedFramesIn frames are never evicted, since frames in flight may sample them */
+		VirtualTextureCache(const VirtualTextureLayout& layoutIn, const uint32_t& slotsXIn, const uint32_t& slotsY,
+							const uint32_t& protectedFramesIn);
+
+		/*	entries are tile ids + 1 as written by the feedback pass, zero and invalid entries are skipped,
+			requested tiles and all their ancestors are marked as used in the frame, missing ones are queued */
+		void resolveFeedback(const uint32_t* entries, const size_t& count, const uint64_t& frame);
+		// up to maxCount queued tiles, coarser levels first so fallbacks appear early, they are marked as loading
+		std::vector<uint32_t> takeRequests(const uint32_t& maxCount, const uint64_t& frame);
+		/*	makes a loaded tile resident and updates the page table, returns its slot,
+			INVALID_SLOT if all slots are protected, the tile is then requested again later */
+		uint32_t insert(const uint32_t& tile, const uint64_t& frame);
+		// forgets a tile that could not be loaded, it is requested again if it is still needed
+		void cancel(const uint32_t& tile);
+
+		const std::vector<PageEntry>& getPageTable() const { return pageTable; }
+		// ranges (first entry, count) of the page table changed since the last call, one per level at most
+		void takeDirtyRanges(std::vector<std::pair<uint32_t, uint32_t>>& rangesOut);
+
+		const VirtualTextureLayout& getLayout() const { return layout; }
+		uint32_t getSlotCount() const { return static_cast<uint32_t>(slots.size()); }
+		uint32_t getResidentCount() const { return static_cast<uint32_t>(resident.size()); }
+		bool isResident(const uint32_t& tile) const { return resident.count(tile) != 0; }
+		// atlas position of a slot, in slots
+		void getSlotPosition(const uint32_t& slot, uint32_t& x, uint32_t& y) const { x = slot % slotsX; y = slot / slotsX; }
+
+	private:
+		struct Slot
+		{
+			uint32_t tile = 0;
+			bool used = false;
+			uint64_t lastUsed = 0;
+			// least recently used list, the root slot is never in it
+			uint32_t prev = INVALID_SLOT;
+			uint32_t next = INVALID_SLOT;
+		};
+
+		const VirtualTextureLayout layout;
+		const uint32_t slotsX;
+		const uint32_t protectedFrames;
+
+		std::vector<Slot> slots;
+		std::vector<uint32_t> freeSlots;
+		uint32_t lruHead = INVALID_SLOT; // least recently used
+		uint32_t lruTail = INVALID_SLOT;
+
+		std::unordered_map<uint32_t, uint32_t> resident; // tile -> slot
+		std::unordered_set<uint32_t> loading;
+		std::unordered_map<uint32_t, uint64_t> queued; // tile -> last frame it was requested in
+		std::unordered_set<uint32_t> visited; // scratch for resolveFeedback
+
+		std::vector<PageEntry> pageTable;
+		std::vector<std::pair<uint32_t, uint32_t>> dirtyLevels; // per level [begin, end) of changed entries
+
+		PageEntry makeEntry(const uint32_t& slot, const uint32_t& level) const;
+		void touch(const uint32_t& slot, const uint64_t& frame);
+		void unlink(const uint32_t& slot);
+		void linkBack(const uint32_t& slot);
+		// the entries covered by the tile are set to entry wherever the mapped level passes the predicate
+		template<typename Predicate>
+		void mapArea(const uint32_t& tile, const PageEntry& entry, Predicate replace);
+		void evict(const uint32_t& slot);
+	};
+
+} // namespace
@@ -0,0 +1,148 @@
+#include "Core/Texture/VirtualTextureFile.h"
+#include "Core/Texture/MipChain.h"
+#include "Core/Jobs/JobSystem.h"
+#include "Core/Types/Math.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace EngineCore
+{
+	namespace VirtualTextureFile
+	{
+		static constexpr uint64_t TILE_ALIGNMENT = 16;
+
+		std::string getCookedPath(const std::string& sourcePath) { return sourcePath + ".vtiles"; }
+
+		bool parse(const MappedFile& file, View& view)
+		{
+			if (!file.isOpen() || file.size() < sizeof(Header)) { return false; }
+			const Header* header = reinterpret_cast<const Header*>(file.data());
+			if (header->magic != MAGIC || header->version != VERSION) { return false; }
+			if (header->width == 0 || header->height == 0 || header->tileSize == 0 || header->border > header->tileSize) { return false; }
+
+			VirtualTextureLayout layout;
+			try { layout = VirtualTextureLayout(header->width, header->height, header->tileSize); }
+			catch (const std::exception&) { return false; }
+			if (layout.levelCount != header->levelCount) { return false; }
+
+			// every tile must lie inside the file
+			const uint64_t fileSize = file.size();
+			auto inside = [&](const uint64_t& offset, const uint64_t& bytes)
+			{ return offset % TILE_ALIGNMENT == 0 && offset <= fileSize && bytes <= fileSize - offset; };
+			const uint64_t tileCount = layout.getTileCount();
+			if (!inside(header->tableOffset, sizeof(uint64_t) * tileCount)) { return false; }
+			const uint64_t* offsets = reinterpret_cast<const uint64_t*>(file.data() + header->tableOffset);
+			const uint64_t tileBytes = getTileBytes(*header);
+			for (uint64_t i = 0; i < tileCount; i++)
+			{
+				if (!inside(offsets[i], tileBytes)) { return false; }
+			}
+
+			view.header = header;
+			view.tileOffsets = offsets;
+			view.data = file.data();
+			view.layout = layout;
+			return true;
+		}
+
+		bool isUpToDate(const Header& header, const std::string& sourcePath)
+		{
+			uint64_t size = 0;
+			int64_t writeTime = 0;
+			// tile files may be shipped without their sources
+			if (!MappedFile::getFileStamp(sourcePath, size, writeTime)) { return true; }
+			return header.sourceSize == size && header.sourceWriteTime == writeTime;
+		}
+
+		const uint8_t* getTile(const View& view, const uint32_t& tile)
+		{
+			return view.data + view.tileOffsets[view.layout.getIndex(tile)];
+		}
+
+		bool cook(const std::string& sourcePath, const uint8_t* rgba, const uint32_t& width, const uint32_t& height,
+				const uint32_t& tileSize, const uint32_t& border, const bool& srgb, JobSystem* jobs)
+		{
+			const VirtualTextureLayout layout(width, height, tileSize);
+			Header header{};
+			header.width = width;
+			header.height = height;
+			header.tileSize = tileSize;
+			header.border = border;
+			header.levelCount = layout.levelCount;
+			header.srgb = srgb ? 1 : 0;
+			MappedFile::getFileStamp(sourcePath, header.sourceSize, header.sourceWriteTime);
+
+			std::vector<MipChain::Level> mips;
+			const auto chain = MipChain::build(rgba, width, height, srgb, mips, layout.levelCount);
+
+			// stored tiles are all the same size, so the table is known before any tile is cut
+			auto align = [](const uint64_t& v) { return Math::roundUpToClosestMultiple<uint64_t>(v, TILE_ALIGNMENT); };
+			const uint32_t tileCount = layout.getTileCount();
+			const uint64_t tileBytes = getTileBytes(header);
+			header.tableOffset = align(sizeof(Header));
+			std::vector<uint64_t> offsets(tileCount);
+			uint64_t end = align(header.tableOffset + sizeof(uint64_t) * tileCount);
+			for (auto& offset : offsets) { offset = end; end = align(end + tileBytes); }
+
+			// written under a temporary name first, so a crash never leaves a truncated file behind
+			const std::string cookedPath = getCookedPath(sourcePath);
+			const std::string tempPath = cookedPath + ".tmp";
+			{
+				std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+				if (!out) { return false; }
+				out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+				out.seekp(static_cast<std::streamoff>(header.tableOffset));
+				out.write(reinterpret_cast<const char*>(offsets.data()), static_cast<std::streamsize>(sizeof(uint64_t) * tileCount));
+
+				const uint32_t side = tileSize + 2 * border;
+				for (uint32_t level = 0; level < layout.levelCount; level++)
+				{
+					const MipChain::Level& mip = mips[level];
+					const uint8_t* texels = chain.data() + mip.offset;
+					const uint32_t tilesX = layout.getTilesX(level);
+					const uint32_t levelTiles = tilesX * layout.getTilesY(level);
+					std::vector<uint8_t> tiles(tileBytes * levelTiles);
+
+					auto cut = [&](uint32_t begin, uint32_t last)
+					{
+						for (uint32_t t = begin; t < last; t++)
+						{
+							const int64_t originX = static_cast<int64_t>(t % tilesX) * tileSize - border;
+							const int64_t originY = static_cast<int64_t>(t / tilesX) * tileSize - border;
+							uint8_t* dst = tiles.data() + tileBytes * t;
+							for (uint32_t y = 0; y < side; y++)
+							{
+								const int64_t sy = std::clamp<int64_t>(originY + y, 0, mip.height - 1);
+								for (uint32_t x = 0; x < side; x++)
+								{
+									const int64_t sx = std::clamp<int64_t>(originX + x, 0, mip.width - 1);
+									std::memcpy(dst + (static_cast<size_t>(y) * side + x) * 4, texels + (sy * mip.width + sx) * 4, 4);
+								}
+							}
+						}
+					};
+					if (jobs) { jobs->parallelFor(levelTiles, 4, cut); }
+					else { cut(0, levelTiles); }
+
+					const uint32_t first = layout.getFirstTile(level);
+					for (uint32_t t = 0; t < levelTiles; t++)
+					{
+						out.seekp(static_cast<std::streamoff>(offsets[first + t]));
+						out.write(reinterpret_cast<const char*>(tiles.data() + tileBytes * t), static_cast<std::streamsize>(tileBytes));
+					}
+				}
+				if (!out) { return false; }
+			}
+			std::error_code error;
+			std::filesystem::rename(tempPath, cookedPath, error);
+			return !error;
+		}
+
+	} // namespace VirtualTextureFile
+
+} // namespace
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Core/Texture/VirtualTextureCache.h"
+#include "Core/Types/MappedFile.h"
+
+// std
+#include <cstdint>
+#include <string>
+
+namespace EngineCore
+{
+	class JobSystem;
+
+	/*	tiled texture container for virtual texturing, every tile of every level (see VirtualTextureLayout) is stored
+		as RGBA8 texels with a border of neighbouring texels on each side, so tiles filter correctly once scattered over the atlas,
+		layout: Header | tile offset table (one per tile, in tile index order) | tiles, 16-byte aligned, little-endian */
+	namespace VirtualTextureFile
+	{
+		static constexpr uint32_t MAGIC = 0x4C495456; // "VTIL"
+		// increment whenever the layout changes, older files are ignored until cooked again
+		static constexpr uint32_t VERSION = 1;
+
+		struct Header
+		{
+			uint32_t magic = MAGIC;
+			uint32_t version = VERSION;
+			uint32_t width = 0;
+			uint32_t height = 0;
+			uint32_t tileSize = 0; // texels per side without the border
+			uint32_t border = 0;
+			uint32_t levelCount = 0;
+			uint8_t srgb = 1;
+			uint8_t reserved0 = 0;
+			uint16_t reserved1 = 0;
+			// identifies the source file, a cooked file is stale once the source size or write time changes
+			uint64_t sourceSize = 0;
+			int64_t sourceWriteTime = 0;
+			// byte offset of the tile offset table from the start of the file
+			uint64_t tableOffset = 0;
+			uint64_t reserved2 = 0;
+		};
+		static_assert(sizeof(Header) == 64, "virtual texture header layout changed, increment VERSION");
+
+		// pointers into a mapped tile file, valid while the file stays mapped
+		struct View
+		{
+			const Header* header = nullptr;
+			const uint64_t* tileOffsets = nullptr;
+			const uint8_t* data = nullptr; // start of the file, tile offsets are relative to it
+			VirtualTextureLayout layout;
+		};
+
+		std::string getCookedPath(const std::string& sourcePath);
+		// bytes of one stored tile including its border
+		inline uint64_t getTileBytes(const Header& header)
+		{
+			const uint64_t side = header.tileSize + 2ull * header.border;
+			return side * side * 4;
+		}
+
+		// validates the header and every tile range, returns false for foreign, truncated or outdated files
+		bool parse(const MappedFile& file, View& view);
+		// true if the source file (if present) has not changed since cooking
+		bool isUpToDate(const Header& header, const std::string& sourcePath);
+		// texels of a tile, the tile must be valid for the view's layout
+		const uint8_t* getTile(const View& view, const uint32_t& tile);
+
+		/*	builds the levels of decoded RGBA8 texels (see MipChain), cuts them into tiles and writes the tile file next to the source,
+			border texels past the level's edge repeat the edge, returns false if the file could not be written,
+			tiles are cut on the job threads if a job system is given */
+		bool cook(const std::string& sourcePath, const uint8_t* rgba, const uint32_t& width, const uint32_t& height,
+				const uint32_t& tileSize, const uint32_t& border, const bool& srgb, JobSystem* jobs = nullptr);
+
+	} // namespace VirtualTextureFile
+
+} // namespace
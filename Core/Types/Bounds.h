@@ -0,0 +1,145 @@
+#pragma once
+
+#include "Core/Types/CommonTypes.h"
+
+#include <glm/glm.hpp>
+
+// std
+#include <cmath>
+#include <algorithm>
+
+// axis-aligned bounding box, used for spatial queries and culling
+struct BoundingBox
+{
+	Vec min{};
+	Vec max{};
+
+	BoundingBox() = default;
+	BoundingBox(const Vec& minIn, const Vec& maxIn) : min{ minIn }, max{ maxIn } {};
+
+	static BoundingBox fromCenterExtent(const Vec& center, const Vec& halfExtent)
+	{ return BoundingBox(center - halfExtent, center + halfExtent); }
+
+	Vec getCenter() const { return Vec{ (min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, (min.z + max.z) * 0.5f }; }
+	Vec getHalfExtent() const { return Vec{ (max.x - min.x) * 0.5f, (max.y - min.y) * 0.5f, (max.z - min.z) * 0.5f }; }
+	// largest half extent along any axis
+	float getMaxHalfExtent() const
+	{
+		const Vec h = getHalfExtent();
+		return std::max(std::max(h.x, h.y), h.z);
+	}
+
+	bool intersects(const BoundingBox& b) const
+	{
+		return (min.x <= b.max.x && max.x >= b.min.x) &&
+			   (min.y <= b.max.y && max.y >= b.min.y) &&
+			   (min.z <= b.max.z && max.z >= b.min.z);
+	}
+	// true if b is entirely inside this box
+	bool contains(const BoundingBox& b) const
+	{
+		return (b.min.x >= min.x && b.max.x <= max.x) &&
+			   (b.min.y >= min.y && b.max.y <= max.y) &&
+			   (b.min.z >= min.z && b.max.z <= max.z);
+	}
+	bool contains(const Vec& p) const
+	{
+		return (p.x >= min.x && p.x <= max.x) && (p.y >= min.y && p.y <= max.y) && (p.z >= min.z && p.z <= max.z);
+	}
+};
+
+struct BoundingSphere
+{
+	Vec center{};
+	float radius = 0.f;
+
+	BoundingSphere() = default;
+	BoundingSphere(const Vec& c, const float& r) : center{ c }, radius{ r } {};
+
+	bool intersects(const BoundingBox& b) const
+	{
+		// squared distance from the sphere center to the closest point in the box
+		const float dx = std::max(std::max(b.min.x - center.x, 0.f), center.x - b.max.x);
+		const float dy = std::max(std::max(b.min.y - center.y, 0.f), center.y - b.max.y);
+		const float dz = std::max(std::max(b.min.z - center.z, 0.f), center.z - b.max.z);
+		return (dx * dx + dy * dy + dz * dz) <= radius * radius;
+	}
+	// true if b is entirely inside this sphere (farthest corner test)
+	bool contains(const BoundingBox& b) const
+	{
+		const float dx = std::max(std::abs(b.min.x - center.x), std::abs(b.max.x - center.x));
+		const float dy = std::max(std::abs(b.min.y - center.y), std::abs(b.max.y - center.y));
+		const float dz = std::max(std::abs(b.min.z - center.z), std::abs(b.max.z - center.z));
+		return (dx * dx + dy * dy + dz * dz) <= radius * radius;
+	}
+};
+
+/*	view frustum represented as six inward-facing planes (xyz = normal, w = distance)
+	planes are extracted from a combined projection-view matrix (Gribb/Hartmann method) */
+struct Frustum
+{
+	enum Side { Left = 0, Right, Bottom, Top, Near, Far };
+	glm::vec4 planes[6];
+
+	static Frustum fromMatrix(const glm::mat4& m)
+	{
+		// glm matrices are column-major, m[column][row]
+		const glm::vec4 r0{ m[0][0], m[1][0], m[2][0], m[3][0] };
+		const glm::vec4 r1{ m[0][1], m[1][1], m[2][1], m[3][1] };
+		const glm::vec4 r2{ m[0][2], m[1][2], m[2][2], m[3][2] };
+		const glm::vec4 r3{ m[0][3], m[1][3], m[2][3], m[3][3] };
+		Frustum f{};
+		f.planes[Left] = add(r3, r0);
+		f.planes[Right] = sub(r3, r0);
+		f.planes[Bottom] = add(r3, r1);
+		f.planes[Top] = sub(r3, r1);
+		// -w <= z is a superset of the 0 <= z clip range, so this near plane is conservative
+		f.planes[Near] = add(r3, r2);
+		f.planes[Far] = sub(r3, r2);
+		for (auto& p : f.planes)
+		{
+			const float len = std::sqrt(p.x * p.x + p.y * p.y + p.z * p.z);
+			if (len > EPSILON_F) { p = glm::vec4{ p.x / len, p.y / len, p.z / len, p.w / len }; }
+		}
+		return f;
+	}
+
+	// true if the box is at least partially inside the frustum (may report false positives near corners)
+	bool intersects(const BoundingBox& b) const
+	{
+		for (const auto& p : planes)
+		{
+			// corner furthest along the plane normal
+			const float x = p.x >= 0.f ? b.max.x : b.min.x;
+			const float y = p.y >= 0.f ? b.max.y : b.min.y;
+			const float z = p.z >= 0.f ? b.max.z : b.min.z;
+			if (p.x * x + p.y * y + p.z * z + p.w < 0.f) { return false; }
+		}
+		return true;
+	}
+	// true if the box is entirely inside the frustum
+	bool contains(const BoundingBox& b) const
+	{
+		for (const auto& p : planes)
+		{
+			// corner furthest against the plane normal
+			const float x = p.x >= 0.f ? b.min.x : b.max.x;
+			const float y = p.y >= 0.f ? b.min.y : b.max.y;
+			const float z = p.z >= 0.f ? b.min.z : b.max.z;
+			if (p.x * x + p.y * y + p.z * z + p.w < 0.f) { return false; }
+		}
+		return true;
+	}
+	bool intersects(const BoundingSphere& s) const
+	{
+		for (const auto& p : planes)
+		{
+			if (p.x * s.center.x + p.y * s.center.y + p.z * s.center.z + p.w < -s.radius) { return false; }
+		}
+		return true;
+	}
+
+private:
+	static glm::vec4 add(const glm::vec4& a, const glm::vec4& b) { return { a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w }; }
+	static glm::vec4 sub(const glm::vec4& a, const glm::vec4& b) { return { a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w }; }
+};
@@ -1,37 +1,170 @@
 #pragma once
 #include <array>
 #include <cassert>
+#include <cstdint>
+#include <cstddef>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <utility>
 
+/*	chunked object pool with stable addresses, objects are constructed in place inside fixed-size arrays
+	which are linked together as the container grows, nothing is ever moved or reallocated,
+	so pointers to contained objects remain valid until the object itself is erased */
 template <class T, unsigned int MAX>
-class LinkedArraySeries 
-{	
+class LinkedArraySeries
+{
+	static_assert(MAX > 0, "LinkedArraySeries must be allowed at least one array");
+
+	// storage for a single object, the object is always at offset 0 so a T* can be converted back to its slot
+	struct Slot
+	{
+		alignas(T) unsigned char data[sizeof(T)];
+		Slot* nextFree = nullptr;
+		bool alive = false;
+		T* get() { return reinterpret_cast<T*>(data); }
+	};
+
 	struct LnkArr
 	{
-		LnkArr(const uint32_t& n) : arr[n]
-		{ len = n; };
-		array<T> arr;
+		LnkArr(const uint32_t& n) : arr{ new Slot[n] }, len{ n } {};
+		~LnkArr() { delete[] arr; }
+		LnkArr(const LnkArr&) = delete;
+		LnkArr& operator=(const LnkArr&) = delete;
+		Slot* arr;
 		uint32_t len;
 		LnkArr* next = nullptr;
 		void linkTo(LnkArr& l) { next = &l; }
 	};
 
 public:
-	// <T, AMAX> series holds at most MAX arrays (nodes) which can own objects of type T
-	LinkedArraySeries(const uint32_t& firstArrayLength)
+	/*	<T, MAX> series holds at most MAX arrays (nodes) which can own objects of type T,
+		with geometric growth enabled, each new array is twice as long as the previous one */
+	LinkedArraySeries(const uint32_t& firstArrayLength, const bool& geometricGrowth = false)
+		: initArrayLength{ firstArrayLength }, growGeometric{ geometricGrowth }
 	{
-		assert(initArrayLength > 0);
-		elementSizeBytes = sizeof(T);
-		series.push_back(std::move(new T[n]));
+		assert(initArrayLength > 0 && "LinkedArraySeries array length must be above zero");
 	}
 	// deletes everything in the container
-	LinkedArraySeries(const uint32_t& arrSize)
+	~LinkedArraySeries()
+	{
+		clear();
+		for (uint32_t i = 0; i < numArrays; i++) { delete series[i]; }
+	}
+
+	LinkedArraySeries(const LinkedArraySeries&) = delete;
+	LinkedArraySeries& operator=(const LinkedArraySeries&) = delete;
+
+	// constructs an object in the first free slot, O(1) (amortized if a new array has to be linked)
+	template<typename... Args>
+	T* emplace(Args&&... args)
+	{
+		if (!firstFree) { linkNewArray(); }
+		Slot* s = firstFree;
+		T* obj = new (s->data) T(std::forward<Args>(args)...); // may throw, slot stays free in that case
+		firstFree = s->nextFree;
+		s->nextFree = nullptr;
+		s->alive = true;
+		count++;
+		return obj;
+	}
+	T* insert(const T& obj) { return emplace(obj); }
+	T* insert(T&& obj) { return emplace(std::move(obj)); }
+
+	// destroys an object that was created by this container, O(1)
+	void erase(T* obj)
 	{
+		if (!obj) { return; }
+		Slot* s = reinterpret_cast<Slot*>(reinterpret_cast<unsigned char*>(obj) - offsetof(Slot, data));
+		assert(s->alive && "LinkedArraySeries erase called on a dead slot");
+		obj->~T();
+		s->alive = false;
+		s->nextFree = firstFree;
+		firstFree = s;
+		count--;
+	}
 
+	// destroys all objects but keeps the arrays for reuse
+	void clear()
+	{
+		firstFree = nullptr;
+		for (uint32_t i = numArrays; i-- > 0;)
+		{
+			LnkArr& a = *series[i];
+			for (uint32_t j = a.len; j-- > 0;)
+			{
+				Slot& s = a.arr[j];
+				if (s.alive) { s.get()->~T(); s.alive = false; }
+				s.nextFree = firstFree;
+				firstFree = &s;
+			}
+		}
+		count = 0;
 	}
-	void initSeries(const uint32_t& n) { series[n]; }
 
-	size_t nodeSizeBytes;
-	std::array<LnkArr*, MAX> series;
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	size_t capacity() const { return totalCapacity; }
+	uint32_t getArrayCount() const { return numArrays; }
+
+	// forward iterator over live objects, free slots (holes) are skipped
+	class Iterator
+	{
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using difference_type = std::ptrdiff_t;
+		using value_type = T;
+		using pointer = T*;
+		using reference = T&;
+
+		Iterator(LnkArr* a, uint32_t i) : arr{ a }, index{ i } { skipDead(); }
+		reference operator*() const { return *arr->arr[index].get(); }
+		pointer operator->() const { return arr->arr[index].get(); }
+		Iterator& operator++() { index++; skipDead(); return *this; }
+		Iterator operator++(int) { Iterator tmp = *this; ++(*this); return tmp; }
+		friend bool operator== (const Iterator& a, const Iterator& b) { return a.arr == b.arr && a.index == b.index; }
+		friend bool operator!= (const Iterator& a, const Iterator& b) { return !(a == b); }
+
+	private:
+		void skipDead()
+		{
+			while (arr)
+			{
+				while (index < arr->len && !arr->arr[index].alive) { index++; }
+				if (index < arr->len) { return; }
+				arr = arr->next;
+				index = 0;
+			}
+		}
+		LnkArr* arr;
+		uint32_t index;
+	};
+	Iterator begin() { return Iterator(numArrays > 0 ? series[0] : nullptr, 0); }
+	Iterator end() { return Iterator(nullptr, 0); }
 
+private:
+	void linkNewArray()
+	{
+		if (numArrays >= MAX) { throw std::runtime_error("LinkedArraySeries is full, MAX arrays reached"); }
+		uint32_t n = initArrayLength;
+		if (growGeometric && numArrays > 0) { n = series[numArrays - 1]->len * 2; }
+		LnkArr* a = new LnkArr(n);
+		if (numArrays > 0) { series[numArrays - 1]->linkTo(*a); }
+		series[numArrays++] = a;
+		totalCapacity += n;
+		// push slots in reverse so that objects are handed out in memory order
+		for (uint32_t j = n; j-- > 0;)
+		{
+			a->arr[j].nextFree = firstFree;
+			firstFree = &a->arr[j];
+		}
+	}
 
+	uint32_t initArrayLength;
+	bool growGeometric;
+	std::array<LnkArr*, MAX> series{};
+	uint32_t numArrays = 0;
+	Slot* firstFree = nullptr;
+	size_t count = 0;
+	size_t totalCapacity = 0;
 };
@@ -0,0 +1,73 @@
+#include "Core/Types/MappedFile.h"
+
+#include <filesystem>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool MappedFile::open(const std::string& path)
+{
+	close();
+#ifdef _WIN32
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+							FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) { return false; }
+	LARGE_INTEGER fileSize{};
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) { CloseHandle(file); return false; }
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping) { CloseHandle(file); return false; }
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!view) { CloseHandle(mapping); CloseHandle(file); return false; }
+	fileHandle = file;
+	mappingHandle = mapping;
+	mappedData = static_cast<const uint8_t*>(view);
+	mappedSize = static_cast<size_t>(fileSize.QuadPart);
+#else
+	const int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) { return false; }
+	struct stat st{};
+	if (fstat(fd, &st) != 0 || st.st_size <= 0) { ::close(fd); return false; }
+	void* view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd); // the mapping keeps its own reference to the file
+	if (view == MAP_FAILED) { return false; }
+	mappedData = static_cast<const uint8_t*>(view);
+	mappedSize = static_cast<size_t>(st.st_size);
+#endif
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (!mappedData) { return; }
+#ifdef _WIN32
+	UnmapViewOfFile(mappedData);
+	CloseHandle(static_cast<HANDLE>(mappingHandle));
+	CloseHandle(static_cast<HANDLE>(fileHandle));
+	fileHandle = nullptr;
+	mappingHandle = nullptr;
+#else
+	munmap(const_cast<uint8_t*>(mappedData), mappedSize);
+#endif
+	mappedData = nullptr;
+	mappedSize = 0;
+}
+
+bool MappedFile::getFileStamp(const std::string& path, uint64_t& size, int64_t& writeTime)
+{
+	std::error_code error;
+	const auto fileSize = std::filesystem::file_size(path, error);
+	if (error) { return false; }
+	const auto fileTime = std::filesystem::last_write_time(path, error);
+	if (error) { return false; }
+	size = static_cast<uint64_t>(fileSize);
+	writeTime = static_cast<int64_t>(fileTime.time_since_epoch().count());
+	return true;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/*	read-only memory mapped file, the contents are paged in by the OS on first access,
+	so nothing is copied until the data is actually used */
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile() { close(); }
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// returns false if the file does not exist or cannot be mapped, empty files cannot be mapped
+	bool open(const std::string& path);
+	void close();
+
+	bool isOpen() const { return mappedData != nullptr; }
+	const uint8_t* data() const { return mappedData; }
+	size_t size() const { return mappedSize; }
+
+	// size and last write time of a file, identifies the source of cooked files, false if it does not exist
+	static bool getFileStamp(const std::string& path, uint64_t& size, int64_t& writeTime);
+
+private:
+	const uint8_t* mappedData = nullptr;
+	size_t mappedSize = 0;
+#ifdef _WIN32
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#endif
+};
@@ -1,5 +1,8 @@
 #pragma once
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <numeric>
 
 namespace Math
@@ -29,6 +32,59 @@ namespace Math
 	template<typename T = float>
 	T invSqrt(const T& v) { return 1.0 / sqrt(v); }
 
+	// 64-bit FNV-1a hash, pass a previous result as seed to hash data in several parts
+	inline uint64_t fnv1a64(const void* data, const size_t& size, uint64_t seed = 14695981039346656037ull)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; i++) { seed = (seed ^ bytes[i]) * 1099511628211ull; }
+		return seed;
+	}
+
+	// IEEE 754 half precision bits, rounds to nearest, values beyond the half range become infinity
+	inline uint16_t floatToHalf(const float& f)
+	{
+		uint32_t x;
+		std::memcpy(&x, &f, sizeof(x));
+		const uint32_t sign = (x >> 16) & 0x8000;
+		const int32_t exponent = static_cast<int32_t>((x >> 23) & 0xff) - 127 + 15;
+		uint32_t mantissa = x & 0x7fffff;
+		if (((x >> 23) & 0xff) == 0xff) { return static_cast<uint16_t>(sign | 0x7c00 | (mantissa ? 0x200 : 0)); } // inf, nan
+		if (exponent >= 31) { return static_cast<uint16_t>(sign | 0x7c00); }
+		if (exponent <= 0)
+		{
+			// subnormal half
+			if (exponent < -10) { return static_cast<uint16_t>(sign); }
+			mantissa |= 0x800000;
+			const uint32_t shift = static_cast<uint32_t>(14 - exponent);
+			uint32_t half = mantissa >> shift;
+			if ((mantissa >> (shift - 1)) & 1) { half++; }
+			return static_cast<uint16_t>(sign | half);
+		}
+		uint32_t half = sign | (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+		if (mantissa & 0x1000) { half++; } // a carry into the exponent still rounds correctly
+		return static_cast<uint16_t>(half);
+	}
+
+	// [-1, 1] to a 16-bit signed normalized integer (VK_FORMAT_*_SNORM)
+	inline int16_t floatToSnorm16(const float& v)
+	{
+		const float c = std::fmax(-1.f, std::fmin(1.f, v));
+		return static_cast<int16_t>(std::lround(c * 32767.f));
+	}
+
+	// octahedral encoding of a unit vector into two components in [-1, 1]
+	inline void octEncode(const float& x, const float& y, const float& z, float& outX, float& outY)
+	{
+		const float l1 = std::fabs(x) + std::fabs(y) + std::fabs(z);
+		const float inv = l1 > 0.f ? 1.f / l1 : 0.f;
+		const float px = x * inv;
+		const float py = y * inv;
+		if (z >= 0.f) { outX = px; outY = py; return; }
+		// the lower hemisphere is folded over the diagonals
+		outX = (1.f - std::fabs(py)) * (px >= 0.f ? 1.f : -1.f);
+		outY = (1.f - std::fabs(px)) * (py >= 0.f ? 1.f : -1.f);
+	}
+
 } // namespace Math
 
 
@@ -0,0 +1,194 @@
+#include "Core/Types/TransformBatch.h"
+
+#include <cassert>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRANSFORM_BATCH_SSE 1
+#include <emmintrin.h>
+#endif
+
+uint32_t TransformBatch::add(const Transform& t, const bool& wasUpdated)
+{
+	tx.push_back(t.translation.x); ty.push_back(t.translation.y); tz.push_back(t.translation.z);
+	rx.push_back(t.rotation.x); ry.push_back(t.rotation.y); rz.push_back(t.rotation.z);
+	sx.push_back(t.scale.x); sy.push_back(t.scale.y); sz.push_back(t.scale.z);
+	updated.push_back(wasUpdated ? 1 : 0);
+	return size() - 1;
+}
+
+void TransformBatch::clear()
+{
+	tx.clear(); ty.clear(); tz.clear();
+	rx.clear(); ry.clear(); rz.clear();
+	sx.clear(); sy.clear(); sz.clear();
+	updated.clear();
+}
+
+void TransformBatch::reserve(const size_t& n)
+{
+	tx.reserve(n); ty.reserve(n); tz.reserve(n);
+	rx.reserve(n); ry.reserve(n); rz.reserve(n);
+	sx.reserve(n); sy.reserve(n); sz.reserve(n);
+	updated.reserve(n);
+}
+
+namespace Math
+{
+#ifdef TRANSFORM_BATCH_SSE
+	// cephes sinf/cosf, range reduction by pi/4 followed by minimax polynomials
+	static inline void sinCosPs(__m128 x, __m128* s, __m128* c)
+	{
+		const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000));
+		__m128 signSin = _mm_and_ps(x, signMask);
+		x = _mm_andnot_ps(signMask, x); // abs
+
+		// j = (int)(x * 4/pi), rounded up to even
+		__m128i j = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.27323954473516f)));
+		j = _mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+		const __m128 y = _mm_cvtepi32_ps(j);
+
+		const __m128 swapSignSin = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, _mm_set1_epi32(4)), 29));
+		const __m128 polyMask = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(j, _mm_set1_epi32(2)), _mm_setzero_si128()));
+		const __m128 signCos = _mm_castsi128_ps(_mm_slli_epi32(
+			_mm_andnot_si128(_mm_sub_epi32(j, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+		signSin = _mm_xor_ps(signSin, swapSignSin);
+
+		// extended precision modular arithmetic, x - y * pi/4
+		x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(0.78515625f)));
+		x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(2.4187564849853515625e-4f)));
+		x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(3.77489497744594108e-8f)));
+		const __m128 z = _mm_mul_ps(x, x);
+
+		// cosine polynomial on [0, pi/4]
+		__m128 pc = _mm_set1_ps(2.443315711809948e-5f);
+		pc = _mm_add_ps(_mm_mul_ps(pc, z), _mm_set1_ps(-1.388731625493765e-3f));
+		pc = _mm_add_ps(_mm_mul_ps(pc, z), _mm_set1_ps(4.166664568298827e-2f));
+		pc = _mm_mul_ps(_mm_mul_ps(pc, z), z);
+		pc = _mm_add_ps(_mm_sub_ps(pc, _mm_mul_ps(z, _mm_set1_ps(0.5f))), _mm_set1_ps(1.f));
+
+		// sine polynomial on [0, pi/4]
+		__m128 ps = _mm_set1_ps(-1.9515295891e-4f);
+		ps = _mm_add_ps(_mm_mul_ps(ps, z), _mm_set1_ps(8.3321608736e-3f));
+		ps = _mm_add_ps(_mm_mul_ps(ps, z), _mm_set1_ps(-1.6666654611e-1f));
+		ps = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(ps, z), x), x);
+
+		// pick the right polynomial per lane, the octant decides which one approximates which function
+		const __m128 sinVal = _mm_or_ps(_mm_and_ps(polyMask, ps), _mm_andnot_ps(polyMask, pc));
+		const __m128 cosVal = _mm_or_ps(_mm_andnot_ps(polyMask, ps), _mm_and_ps(polyMask, pc));
+		*s = _mm_xor_ps(sinVal, signSin);
+		*c = _mm_xor_ps(cosVal, signCos);
+	}
+
+	// builds 4 matrices starting at i, lanes with a zero mask bit are not written
+	static inline void buildMatrices4(const TransformBatch& in, glm::mat4* out, const uint32_t& i, const int& writeMask)
+	{
+		__m128 s3, c3, s2, c2, s1, c1;
+		sinCosPs(_mm_loadu_ps(&in.rx[i]), &s3, &c3);
+		sinCosPs(_mm_loadu_ps(&in.ry[i]), &s2, &c2);
+		sinCosPs(_mm_loadu_ps(&in.rz[i]), &s1, &c1);
+		const __m128 sx = _mm_loadu_ps(&in.sx[i]);
+		const __m128 sy = _mm_loadu_ps(&in.sy[i]);
+		const __m128 sz = _mm_loadu_ps(&in.sz[i]);
+		const __m128 zero = _mm_setzero_ps();
+
+		// same terms as Transform::makeMatrix, each register holds one matrix element for 4 transforms
+		const __m128 s2s3 = _mm_mul_ps(s2, s3);
+		const __m128 c3s2 = _mm_mul_ps(c3, s2);
+		__m128 col[4][4] =
+		{
+			{
+				_mm_mul_ps(sx, _mm_mul_ps(c1, c2)),
+				_mm_mul_ps(sx, _mm_mul_ps(c2, s1)),
+				_mm_sub_ps(zero, _mm_mul_ps(sx, s2)),
+				zero
+			},
+			{
+				_mm_mul_ps(sy, _mm_sub_ps(_mm_mul_ps(c1, s2s3), _mm_mul_ps(c3, s1))),
+				_mm_mul_ps(sy, _mm_add_ps(_mm_mul_ps(c1, c3), _mm_mul_ps(s1, s2s3))),
+				_mm_mul_ps(sy, _mm_mul_ps(c2, s3)),
+				zero
+			},
+			{
+				_mm_mul_ps(sz, _mm_add_ps(_mm_mul_ps(s1, s3), _mm_mul_ps(c1, c3s2))),
+				_mm_mul_ps(sz, _mm_sub_ps(_mm_mul_ps(s1, c3s2), _mm_mul_ps(c1, s3))),
+				_mm_mul_ps(sz, _mm_mul_ps(c2, c3)),
+				zero
+			},
+			{
+				_mm_loadu_ps(&in.tx[i]),
+				_mm_loadu_ps(&in.ty[i]),
+				_mm_loadu_ps(&in.tz[i]),
+				_mm_set1_ps(1.f)
+			}
+		};
+
+		// transpose each column block, lane k of the element registers becomes column c of matrix k
+		for (int c = 0; c < 4; c++)
+		{
+			_MM_TRANSPOSE4_PS(col[c][0], col[c][1], col[c][2], col[c][3]);
+			for (int k = 0; k < 4; k++)
+			{
+				if (writeMask & (1 << k)) { _mm_storeu_ps(&out[i + k][c][0], col[c][k]); }
+			}
+		}
+	}
+#endif
+
+	void sinCos4(const float* x, float* s, float* c)
+	{
+#ifdef TRANSFORM_BATCH_SSE
+		__m128 vs, vc;
+		sinCosPs(_mm_loadu_ps(x), &vs, &vc);
+		_mm_storeu_ps(s, vs);
+		_mm_storeu_ps(c, vc);
+#else
+		for (int i = 0; i < 4; i++) { s[i] = std::sin(x[i]); c[i] = std::cos(x[i]); }
+#endif
+	}
+
+	void buildMatricesScalar(const TransformBatch& in, glm::mat4* out, const uint32_t& begin, const uint32_t& end)
+	{
+		const bool useFlags = !in.updated.empty();
+		for (uint32_t i = begin; i < end; i++)
+		{
+			if (useFlags && !in.updated[i]) { continue; }
+			out[i] = Transform::makeMatrix({ in.rx[i], in.ry[i], in.rz[i] }, { in.sx[i], in.sy[i], in.sz[i] },
+											{ in.tx[i], in.ty[i], in.tz[i] });
+		}
+	}
+
+	void buildMatrices(const TransformBatch& in, glm::mat4* out, const uint32_t& begin, const uint32_t& end)
+	{
+		assert(end <= in.size() && "matrix batch range out of bounds");
+#ifdef TRANSFORM_BATCH_SSE
+		const bool useFlags = !in.updated.empty();
+		uint32_t i = begin;
+		for (; i + 4 <= end; i += 4)
+		{
+			int mask = 0xF;
+			if (useFlags)
+			{
+				mask = (in.updated[i] ? 1 : 0) | (in.updated[i + 1] ? 2 : 0)
+					| (in.updated[i + 2] ? 4 : 0) | (in.updated[i + 3] ? 8 : 0);
+				if (mask == 0) { continue; } // nothing moved in this group
+			}
+			buildMatrices4(in, out, i, mask);
+		}
+		// remainder
+		buildMatricesScalar(in, out, i, end);
+#else
+		buildMatricesScalar(in, out, begin, end);
+#endif
+	}
+
+	bool hasSIMDMatrixPath()
+	{
+#ifdef TRANSFORM_BATCH_SSE
+		return true;
+#else
+		return false;
+#endif
+	}
+
+} // namespace Math
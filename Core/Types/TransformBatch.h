@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Core/Types/CommonTypes.h"
+
+// std
+#include <cstdint>
+#include <vector>
+
+/*	structure-of-arrays transform storage, each component lives in its own contiguous array
+	so that several transforms can be loaded into one SIMD register at a time */
+struct TransformBatch
+{
+	std::vector<float> tx, ty, tz;
+	std::vector<float> rx, ry, rz;
+	std::vector<float> sx, sy, sz;
+	// optional, entries with a zero flag are skipped by buildMatrices (see ActorTransform::wasUpdated)
+	std::vector<uint8_t> updated;
+
+	uint32_t add(const Transform& t, const bool& wasUpdated = true);
+	void clear();
+	void reserve(const size_t& n);
+	uint32_t size() const { return static_cast<uint32_t>(tx.size()); }
+};
+
+namespace Math
+{
+	/*	writes Transform::makeMatrix(rotation, scale, translation) for entries [begin, end) to out[i],
+		uses SSE when available and falls back to buildMatricesScalar otherwise,
+		entries whose updated flag is zero are left untouched (all entries are built if the flag array is empty) */
+	void buildMatrices(const TransformBatch& in, glm::mat4* out, const uint32_t& begin, const uint32_t& end);
+	// reference implementation, one Transform::makeMatrix call per entry
+	void buildMatricesScalar(const TransformBatch& in, glm::mat4* out, const uint32_t& begin, const uint32_t& end);
+	// true if buildMatrices was compiled with a SIMD path
+	bool hasSIMDMatrixPath();
+
+	// computes sine and cosine of 4 angles at once, accurate to float precision for |x| < 8192
+	void sinCos4(const float* x, float* s, float* c);
+
+} // namespace Math
@@ -1,48 +1,246 @@
 #include "Core/WorldSector.h"
 
-namespace World 
+#include <cassert>
+
+namespace World
 {
-	/*
-	PhysicalElementInterface::~PhysicalElementInterface()
+	Octree::Octree(const OctreeProperties& treeProps) : props{ treeProps }
 	{
-		// object destroyed, remove element from octree
-		if (linkedElement) 
+		const uint32_t w = treeProps.rootWidth;
+		if (w == 0 || (w & (w - 1)) != 0) { throw std::runtime_error("octree width must be a power of two"); }
+		if (w > SECTOR_MAX) { throw std::runtime_error("octree width cannot exceed SECTOR_MAX"); }
+		if (treeProps.branchThreshold == 0) { throw std::runtime_error("octree branch threshold must be above zero"); }
+		branches.emplace_back(); // root, centered at the origin
+	}
+
+	Octree::~Octree()
+	{
+		// objects outlive the tree, make sure they don't try to report back to it
+		for (auto& e : elementPool)
 		{
-			
+			if (!e.linkedObj) { continue; }
+			e.linkedObj->linkedTree = nullptr;
+			e.linkedObj->linkedElement = INVALID_INDEX;
 		}
 	}
 
-	void PhysicalElementInterface::reportPositionUpdated(const float& x,
-												const float& y, const float& z) 
+	uint32_t Octree::allocElement()
 	{
+		if (!freeElements.empty())
+		{
+			const uint32_t e = freeElements.back();
+			freeElements.pop_back();
+			return e;
+		}
+		elementPool.emplace_back();
+		return static_cast<uint32_t>(elementPool.size() - 1);
+	}
 
+	void Octree::freeElement(const uint32_t& e)
+	{
+		elementPool[e] = Element{};
+		freeElements.push_back(e);
 	}
 
-	void Octree::Branch::destroyEmptyElements()
+	uint32_t Octree::allocBranchBlock()
 	{
-		Element* e = firstElement;
-		Element* prev = nullptr;
-		while (e) 
+		numBranches += 8;
+		if (!freeBranchBlocks.empty())
 		{
-			if (e->linkedObj) 
+			const uint32_t first = freeBranchBlocks.back();
+			freeBranchBlocks.pop_back();
+			return first;
+		}
+		const uint32_t first = static_cast<uint32_t>(branches.size());
+		branches.resize(branches.size() + 8);
+		return first;
+	}
+
+	void Octree::freeBranchBlock(const uint32_t& first)
+	{
+		for (uint32_t i = first; i < first + 8; i++)
+		{
+			assert(branches[i].isLeaf() && branches[i].elements.empty() && "cannot free populated branch");
+			branches[i].parentBranch = INVALID_INDEX;
+		}
+		numBranches -= 8;
+		freeBranchBlocks.push_back(first);
+	}
+
+	void Octree::addElementToBranch(const uint32_t& b, const uint32_t& e)
+	{
+		auto& elems = branches[b].elements;
+		elementPool[e].branch = b;
+		elementPool[e].slot = static_cast<uint32_t>(elems.size());
+		elems.push_back(e);
+	}
+
+	void Octree::unlinkElement(const uint32_t& e)
+	{
+		Element& elem = elementPool[e];
+		auto& elems = branches[elem.branch].elements;
+		assert(elems[elem.slot] == e && "octree element slot out of sync");
+		// swap with the last entry, element order within a branch is irrelevant
+		const uint32_t last = elems.back();
+		elems[elem.slot] = last;
+		elementPool[last].slot = elem.slot;
+		elems.pop_back();
+		elem.branch = INVALID_INDEX;
+	}
+
+	void Octree::insert(PhysicalElementInterface* obj)
+	{
+		assert(obj && "cannot insert null object into octree");
+		if (obj->linkedTree == this) { relocate(obj); return; }
+		assert(!obj->linkedTree && "object is already in another octree");
+
+		const uint32_t e = allocElement();
+		elementPool[e].linkedObj = obj;
+		elementPool[e].bounds = obj->getBounds();
+		obj->linkedTree = this;
+		obj->linkedElement = e;
+		numElements++;
+		placeElement(e, ROOT);
+	}
+
+	void Octree::remove(PhysicalElementInterface* obj)
+	{
+		if (!obj || obj->linkedTree != this) { return; }
+		const uint32_t e = obj->linkedElement;
+		const uint32_t b = elementPool[e].branch;
+		unlinkElement(e);
+		freeElement(e);
+		obj->linkedTree = nullptr;
+		obj->linkedElement = INVALID_INDEX;
+		numElements--;
+		tryMerge(b);
+	}
+
+	void Octree::relocate(PhysicalElementInterface* obj)
+	{
+		if (!obj || obj->linkedTree != this) { return; }
+		const uint32_t e = obj->linkedElement;
+		const BoundingBox bounds = obj->getBounds();
+		elementPool[e].bounds = bounds;
+		const uint32_t b = elementPool[e].branch;
+		const Branch& branch = branches[b];
+
+		// common case, the element still belongs in its current branch
+		const bool fitsHere = (b == ROOT) || fitsInBranch(branch, bounds);
+		if (fitsHere && (branch.isLeaf() ||
+			!fitsInBranch(branches[branch.subBranch(getChildIndex(branch, bounds.getCenter()))], bounds)))
+		{ return; }
+
+		// walk up until a branch accepts the element, then walk back down from there
+		unlinkElement(e);
+		uint32_t start = b;
+		while (start != ROOT && !fitsInBranch(branches[start], bounds)) { start = branches[start].parentBranch; }
+		placeElement(e, start);
+		tryMerge(b);
+	}
+
+	void Octree::updateElementPositions()
+	{
+		// the pool is stable while relocating, so a linear pass visits every element exactly once
+		for (uint32_t i = 0; i < elementPool.size(); i++)
+		{
+			if (elementPool[i].linkedObj) { relocate(elementPool[i].linkedObj); }
+		}
+	}
+
+	bool Octree::fitsInBranch(const Branch& b, const BoundingBox& bounds) const
+	{
+		// the center must be inside the cell, and the size must fit within the loose bounds
+		const float half = (float)getBranchWidth(b.level) * 0.5f;
+		const Vec c = bounds.getCenter();
+		if (std::abs(c.x - b.center.x) > half || std::abs(c.y - b.center.y) > half
+			|| std::abs(c.z - b.center.z) > half) { return false; }
+		return bounds.getMaxHalfExtent() <= half;
+	}
+
+	uint32_t Octree::findBranchForBounds(uint32_t start, const BoundingBox& bounds) const
+	{
+		uint32_t b = start;
+		const Vec c = bounds.getCenter();
+		while (!branches[b].isLeaf())
+		{
+			const uint32_t sub = branches[b].subBranch(getChildIndex(branches[b], c));
+			if (!fitsInBranch(branches[sub], bounds)) { break; }
+			b = sub;
+		}
+		return b;
+	}
+
+	void Octree::placeElement(const uint32_t& e, const uint32_t& start)
+	{
+		const uint32_t b = findBranchForBounds(start, elementPool[e].bounds);
+		addElementToBranch(b, e);
+		const Branch& branch = branches[b];
+		if (branch.isLeaf() && branch.elements.size() > props.branchThreshold && canSplit(branch)) { split(b); }
+	}
+
+	void Octree::split(const uint32_t& b)
+	{
+		assert(branches[b].isLeaf() && "cannot split a branch that already has sub-branches");
+		const uint32_t first = allocBranchBlock(); // may reallocate branches, no references held across this
+		Branch& branch = branches[b];
+		branch.firstSubBranch = first;
+		const float quarter = (float)getBranchWidth(branch.level) * 0.25f;
+		for (uint32_t i = 0; i < 8; i++)
+		{
+			Branch& sub = branches[first + i];
+			sub.parentBranch = b;
+			sub.firstSubBranch = INVALID_INDEX;
+			sub.level = branch.level + 1;
+			sub.center = branch.center + Vec{ (i & 1) ? quarter : -quarter,
+										(i & 2) ? quarter : -quarter, (i & 4) ? quarter : -quarter };
+		}
+
+		// push down all elements that fit in a sub-branch, iterating backwards keeps swap-removal safe
+		for (size_t i = branch.elements.size(); i-- > 0;)
+		{
+			const uint32_t e = branch.elements[i];
+			const uint32_t sub = branch.subBranch(getChildIndex(branch, elementPool[e].bounds.getCenter()));
+			if (fitsInBranch(branches[sub], elementPool[e].bounds))
 			{
-				// not empty
-				if (e->next) 
-				{ 
-					prev = e;
-					e = e->next; // ++ (loop will end if null)
-				}
+				unlinkElement(e);
+				addElementToBranch(sub, e);
+			}
+		}
+		for (uint32_t i = first; i < first + 8; i++)
+		{
+			if (branches[i].elements.size() > props.branchThreshold && canSplit(branches[i])) { split(i); }
+		}
+	}
+
+	void Octree::tryMerge(const uint32_t& b)
+	{
+		// a leaf that lost elements may allow its parent to absorb all of its siblings
+		uint32_t p = branches[b].isLeaf() ? branches[b].parentBranch : b;
+		while (p != INVALID_INDEX)
+		{
+			const uint32_t first = branches[p].firstSubBranch;
+			size_t count = branches[p].elements.size();
+			for (uint32_t i = first; i < first + 8; i++)
+			{
+				if (!branches[i].isLeaf()) { return; }
+				count += branches[i].elements.size();
 			}
-			else
+			// hysteresis, avoids split/merge thrashing around the threshold
+			if (count > props.branchThreshold / 2) { return; }
+			for (uint32_t i = first; i < first + 8; i++)
 			{
-				// empty
-				Element* next = e->next;
-				if (!prev) { firstElement = next; }
-				else { prev->next = next; }
-				delete e;
-				e = next; // (loop will end if null)
+				while (!branches[i].elements.empty())
+				{
+					const uint32_t e = branches[i].elements.back();
+					unlinkElement(e);
+					addElementToBranch(p, e);
+				}
 			}
+			branches[p].firstSubBranch = INVALID_INDEX;
+			freeBranchBlock(first);
+			p = branches[p].parentBranch;
 		}
 	}
-	*/
-} // namespace
\ No newline at end of file
+
+} // namespace
@@ -1,6 +1,7 @@
 #pragma once
 
-#include "Core/ECS/Actor.h"
+#include "Core/Types/CommonTypes.h"
+#include "Core/Types/Bounds.h"
 
 // std
 #include <cstdint>
@@ -14,125 +15,159 @@ namespace World
 	#define SECTOR_MAX 1048576 // ~10km if unit = cm, millimeter precision guaranteed
 	#define SECTOR_TREE_MIN_BRANCH_WIDTH 10
 
-	class Octree;
-	class PhysicalElementInterface
-	{
-		/*	the element interface should be inherited by all
-			objects with a physical presence (physics/collision)
-			it is used for communicating data with a spatial data structure */
-	protected:
-		friend class Octree;
-		// pointer to corresponding data element in the octree
-		//Octree::Element* linkedElement;
-		// reports a change in physical location, used to organize data by location
-		//void reportPositionUpdated(const float& x, const float& y, const float& z);
-		
-	public:
-		//~PhysicalElementInterface();
-	};
+	class PhysicalElementInterface;
 
+	/*	loose octree, each branch accepts elements whose center lies inside the branch cell
+		and whose size fits within the branch width, the loose bounds of a branch are therefore
+		twice as wide as the cell itself, this lets moving elements stay in place for longer */
 	class Octree
 	{
 	public:
 		struct OctreeProperties
 		{
 			// physical width, must be power of two and below SECTOR_MAX
-			uint32_t rootWidth = 409600; // ~ 4km
+			uint32_t rootWidth = 524288; // ~ 5km
 			// branches with an element count above this value will split
 			uint32_t branchThreshold = 250;
 		};
 
-		Octree(const OctreeProperties& treeProps) : props{ treeProps }
-		{
-			if (treeProps.rootWidth % 2 != 0) { throw std::runtime_error("octree width must be a power of two "); }
-			if (treeProps.rootWidth > SECTOR_MAX) { throw std::runtime_error("octree width cannot exceed SECTOR_MAX"); }
-			root = new Branch();
-		}
-		~Octree() { delete root; }
+		Octree(const OctreeProperties& treeProps);
+		~Octree();
 
-		/*Actor* addActor(const Actor& actor)
-		{
-			Element* e = new Element();
-			e->linkedObj = new Actor(actor);
-			root->addElement(e);
-		}*/
+		Octree(const Octree&) = delete;
+		Octree& operator=(const Octree&) = delete;
+
+		/*	adds an object to the tree, the tree does not take ownership of the object,
+			objects remove themselves from the tree when they are destroyed */
+		void insert(PhysicalElementInterface* obj);
+		void remove(PhysicalElementInterface* obj);
+		// re-reads the bounds of an object and moves it to another branch if necessary
+		void relocate(PhysicalElementInterface* obj);
+		// checks and re-assigns all elements which have moved to another branch
+		void updateElementPositions();
+
+		uint32_t getElementCount() const { return numElements; }
+		uint32_t getBranchCount() const { return numBranches; }
+
+		// calls fn(PhysicalElementInterface*) for every element that overlaps the shape
+		template<typename F>
+		void queryBox(const BoundingBox& box, F&& fn) const { query(ROOT, box, fn, false); }
+		template<typename F>
+		void querySphere(const BoundingSphere& sphere, F&& fn) const { query(ROOT, sphere, fn, false); }
+		template<typename F>
+		void queryFrustum(const Frustum& frustum, F&& fn) const { query(ROOT, frustum, fn, false); }
+
+		static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
 
 	protected:
 		friend class PhysicalElementInterface;
-		/*	an octree element does not contain the object it represents,
-			but is linked to it, if the element is deleted we also delete the
-			associated object to ensure that it doesn't become leaked memory */
+		/*	an octree element does not contain the object it represents, but is linked to it,
+			elements live in a pool and are referenced by index, so they never move in memory
+			from the point of view of their owners (the pool itself may reallocate) */
 		struct Element
 		{
-			Element* next;
-			PhysicalElementInterface* linkedObj;
-			~Element() { if (linkedObj) { delete linkedObj; } }
+			PhysicalElementInterface* linkedObj = nullptr;
+			BoundingBox bounds{}; // cached world bounds, updated on relocation
+			uint32_t branch = INVALID_INDEX; // owning branch
+			uint32_t slot = 0; // position in the owning branch's element array
 		};
 
 		struct Branch
 		{
-			Branch* parentBranch = nullptr;
-			Element* firstElement = nullptr;
-			Branch* subBranches[8] = {};
+			Vec center{};
+			uint32_t parentBranch = INVALID_INDEX;
+			// sub-branches are always allocated as a contiguous block of 8
+			uint32_t firstSubBranch = INVALID_INDEX;
+			uint32_t level = 0;
+			// element pool indices, unordered (removal swaps with the last entry)
+			std::vector<uint32_t> elements;
+
+			bool isLeaf() const { return firstSubBranch == INVALID_INDEX; }
+			uint32_t subBranch(const uint32_t& i) const { return firstSubBranch + i; }
+		};
 
-			class Iterator
-			{
-			public:
-				Iterator(Element* e) : elem{ e } {};
-				Iterator& operator++() { elem = (elem && elem->next) ? elem->next : nullptr; return *this; }
-				bool operator!=(const Iterator& other) const { return &elem != &other.elem; }
-				const Element& operator*() const { return *elem; }
-			private:
-				Element* elem;
-			};
-			Iterator begin() const { return Iterator(firstElement); }
-			Iterator end() const { return Iterator(nullptr); }
-
-			~Branch() { destroyAllElements(); destroySubBranches(); }
-			void destroyEmptyElements();
-			void destroyAllElements()
-			{
-				auto* next = firstElement;
-				while (next)
-				{
-					auto* p = next;
-					next = next->next; // next
-					delete p;
-				}
-				firstElement = nullptr;
-			}
-			void destroySubBranches() { for (Branch* b : subBranches) { if (b) { delete b; } } }
-			void addElement(Element* element)
-			{
-				if (!firstElement) { firstElement = element; return; }
-				auto* p = firstElement;
-				while (p->next) { p = p->next; }
-				p->next = element;
-			}
-			uint32_t level()
+		OctreeProperties props;
+		static constexpr uint32_t ROOT = 0;
+		// branch storage, [0] is the root, everything after it is made up of blocks of 8 sub-branches
+		std::vector<Branch> branches;
+		std::vector<Element> elementPool;
+		// free lists, unused blocks and elements are recycled before the pools grow
+		std::vector<uint32_t> freeBranchBlocks; // first index of each unused block
+		std::vector<uint32_t> freeElements;
+		uint32_t numElements = 0;
+		uint32_t numBranches = 1;
+
+		// width of a branch at the specified depth (root = 0)
+		uint32_t getBranchWidth(const uint32_t& level) const { return props.rootWidth >> level; }
+		// branch cell bounds expanded by the looseness factor (2)
+		BoundingBox getLooseBounds(const Branch& b) const
+		{ return BoundingBox::fromCenterExtent(b.center, Vec((float)getBranchWidth(b.level))); }
+
+		// index of the sub-branch whose cell contains the point
+		static uint32_t getChildIndex(const Branch& b, const Vec& p)
+		{ return (p.x >= b.center.x ? 1 : 0) | (p.y >= b.center.y ? 2 : 0) | (p.z >= b.center.z ? 4 : 0); }
+		// true if the bounds belong in the branch (loose fit)
+		bool fitsInBranch(const Branch& b, const BoundingBox& bounds) const;
+		bool canSplit(const Branch& b) const { return getBranchWidth(b.level + 1) >= SECTOR_TREE_MIN_BRANCH_WIDTH; }
+
+		uint32_t allocElement();
+		void freeElement(const uint32_t& e);
+		// returns the index of the first branch in a new block of 8
+		uint32_t allocBranchBlock();
+		void freeBranchBlock(const uint32_t& first);
+		void addElementToBranch(const uint32_t& b, const uint32_t& e);
+		void unlinkElement(const uint32_t& e);
+
+		// finds the deepest branch below (and including) start that accepts the bounds
+		uint32_t findBranchForBounds(uint32_t start, const BoundingBox& bounds) const;
+		void placeElement(const uint32_t& e, const uint32_t& start);
+		void split(const uint32_t& b);
+		// merges sparsely populated leaf branches back into their parent
+		void tryMerge(const uint32_t& b);
+
+		template<typename Shape, typename F>
+		void query(const uint32_t& bi, const Shape& shape, F& fn, bool fullyInside) const
+		{
+			const Branch& b = branches[bi];
+			// the root accepts elements outside its cell, so it is never culled
+			if (!fullyInside && bi != ROOT)
 			{
-				Branch* p = this;
-				uint32_t count = 0;
-				while (p->parentBranch) { p = p->parentBranch; count++; }
-				return count;
+				const BoundingBox loose = getLooseBounds(b);
+				if (!shape.intersects(loose)) { return; }
+				fullyInside = shape.contains(loose);
 			}
-			// checks and re-assigns elements which have moved to another branch
-			bool updateElementPositions()
+			for (const uint32_t& ei : b.elements)
 			{
-				auto l = level();
-				for (auto& e : *this)
-				{
-				}
+				const Element& e = elementPool[ei];
+				if (fullyInside || shape.intersects(e.bounds)) { fn(e.linkedObj); }
 			}
-		};
-
-		OctreeProperties props;
-		Branch* root;
-
-		uint32_t getBranchWidth(const uint32_t& level) { return props.rootWidth / (2 ^ level); }
+			if (b.isLeaf()) { return; }
+			for (uint32_t i = 0; i < 8; i++) { query(b.subBranch(i), shape, fn, fullyInside); }
+		}
+	};
 
+	class PhysicalElementInterface
+	{
+		/*	the element interface should be inherited by all
+			objects with a physical presence (physics/collision)
+			it is used for communicating data with a spatial data structure */
+	protected:
+		friend class Octree;
+		// the tree (if any) containing this object, and the corresponding data element in it
+		Octree* linkedTree = nullptr;
+		uint32_t linkedElement = Octree::INVALID_INDEX;
+		// reports a change in physical location, used to organize data by location
+		void reportPositionUpdated() { if (linkedTree) { linkedTree->relocate(this); } }
 
+	public:
+		PhysicalElementInterface() = default;
+		PhysicalElementInterface(const PhysicalElementInterface&) = delete;
+		PhysicalElementInterface& operator=(const PhysicalElementInterface&) = delete;
+		virtual ~PhysicalElementInterface() { if (linkedTree) { linkedTree->remove(this); } }
+
+		// world space bounds, used to place the object in a spatial data structure
+		virtual BoundingBox getBounds() const = 0;
+		bool isInTree() const { return linkedTree; }
 	};
 
 } // namespace
-
@@ -32,9 +32,9 @@ namespace EngineCore
 	{
 		MeshRenderSystem meshRenderSys{ device, renderer.getSwapchainRenderPass() };
 
-		// texture test TODO: this is not an ideal way to store these objects
-		Image& marsTexture = *new Image(device, makePath("Textures/mars6k_v2.jpg"));
-		Image& spaceTexture = *new Image(device, makePath("Textures/space.png"));
+		// textures load in the background, the image array shows the placeholder until each one is resident
+		const std::vector<TextureStreamer::Handle> textures = { textureStreamer.request(makePath("Textures/mars6k_v2.jpg")),
+																textureStreamer.request(makePath("Textures/space.png")) };
 
 		// runtime descriptors test
 		//UBOCreateInfo ubo1{ device };
@@ -47,8 +47,8 @@ namespace EngineCore
 		float testScalar = 0.f;
 		dset.addUBO(ubo1, device);
 
-		dset.addImageArray(std::vector<VkImageView>{ marsTexture.imageView, spaceTexture.imageView });
-		dset.addSampler(marsTexture.sampler);
+		dset.addImageArray(std::vector<VkImageView>{ textureStreamer.getImageView(textures[0]), textureStreamer.getImageView(textures[1]) });
+		dset.addSampler(textureStreamer.getSampler());
 		//dset.addCombinedImageSampler(marsTexture.imageView, marsTexture.sampler);
 		//dset.addCombinedImageSampler(spaceTexture.imageView, spaceTexture.sampler);
 		dset.finalize();
@@ -65,11 +65,14 @@ namespace EngineCore
 		window.input.captureMouseCursor(true);
 		setupDefaultInputs();
 
-		// create test materials
-		ShaderFilePaths shader(makePath("Shaders/shader.vert.spv"),
+		// create test materials, packed vertex formats need the PACKED_VERTEX vertex shader variant
+		const bool packedVertices = renderSettings.meshVertexFormat != VertexFormat::Float;
+		ShaderFilePaths shader(makePath(packedVertices ? "Shaders/shader_packed.vert.spv" : "Shaders/shader.vert.spv"),
 								makePath("Shaders/shader.frag.spv"));
 
-		auto mat1 = materialsMgr.createMaterial(MaterialCreateInfo(shader, dsetLayout));
+		MaterialCreateInfo mat1Info(shader, dsetLayout);
+		mat1Info.vertexFormat = renderSettings.meshVertexFormat;
+		auto mat1 = materialsMgr.createMaterial(mat1Info);
 		//auto mat2 = materialsMgr.createMaterial(MaterialCreateInfo(shader2, setLayout));
 
 		if (loadedMeshes.size() > 0 && loadedMeshes[0]) { for (auto* m : loadedMeshes) 
@@ -83,6 +86,11 @@ namespace EngineCore
 		Imgui imguiObj{ window, device, renderer.getSwapchainRenderPass(),
 					EngineSwapChain::MAX_FRAMES_IN_FLIGHT, WIDTH, HEIGHT, renderSettings.sampleCountMSAA };
 
+		double lastStatsPrintTime = 0.0;
+
+		// one secondary command pool per job thread, for parallel draw recording
+		renderer.createSecondaryCommandPools(jobs.getThreadCount());
+
 		// window event loop
 		while (!window.getCloseWindow()) 
 		{
@@ -95,10 +103,25 @@ namespace EngineCore
 				const uint32_t frameIndex = renderer.getFrameIndex(); // current framebuffer index
 				engineClock.measureFrameDelta(frameIndex);
 
+				// swap in textures that finished streaming
+				for (const auto& handle : textureStreamer.update())
+				{
+					for (uint32_t i = 0; i < textures.size(); i++)
+					{ if (textures[i] == handle) { dset.setImageArrayElement(0, i, textureStreamer.getImageView(handle)); } }
+				}
+				dset.updateFrame(frameIndex);
+
+				tickActors(static_cast<float>(engineClock.getDelta()));
+
 				glm::mat4 pvm{ 1.f };
 				pvm = camera.getProjectionMatrix() * Camera::getWorldBasisMatrix() * camera.getViewMatrix(true);
 				dset.writeUBOMember(0, pvm, UBO_Layout::ElementAccessor{ 0, 0, 0 }, frameIndex);
 
+				// collect the meshes inside the view frustum, cost scales with visible meshes rather than all meshes
+				visibleMeshes.clear();
+				sceneTree.queryFrustum(Frustum::fromMatrix(pvm), [this](World::PhysicalElementInterface* e)
+					{ visibleMeshes.push_back(static_cast<ECS::Primitive*>(e)); });
+
 				float testScalar1 = 1.f - std::sin(engineClock.getElapsed()* 10.f);
 				float testScalar2 = 1.f - std::sin(engineClock.getElapsed() * 50.f);
 				dset.writeUBOMember(0, testScalar1, UBO_Layout::ElementAccessor{ 1, 0, 0 }, frameIndex);
@@ -115,15 +138,27 @@ namespace EngineCore
 				//ImGui::Button("Save");
 				
 				// render sky sphere
-				skyRenderSys.renderSky(commandBuffer, dset.getDescriptorSet(frameIndex), camera.transform.translation);
+				VkCommandBuffer skyCommandBuffer = renderer.beginSecondaryCommandBuffer(jobs.getCurrentThreadIndex());
+				skyRenderSys.renderSky(skyCommandBuffer, dset.getDescriptorSet(frameIndex), camera.transform.translation);
+				renderer.endSecondaryCommandBuffer(skyCommandBuffer);
+				renderer.executeSecondaryCommandBuffers(commandBuffer, &skyCommandBuffer, 1);
 
 				//simulateDistanceByScale(*loadedMeshes[1], camera.transform); //FakeScaleTest082
 
 				// render meshes
-				meshRenderSys.renderMeshes(commandBuffer, loadedMeshes, engineClock.getDelta(), engineClock.getElapsed(),
-											dset.getDescriptorSet(frameIndex), simDistOffsets); //FakeScaleTest082
+				meshRenderSys.renderMeshes(renderer, commandBuffer, visibleMeshes, engineClock.getDelta(), engineClock.getElapsed(),
+											dset.getDescriptorSet(frameIndex), simDistOffsets, jobs, camera.transform.translation, //FakeScaleTest082
+											camera.getProjectedSizeScale() * renderSettings.meshLodBias);
+				if (renderSettings.printRenderStats && engineClock.getElapsed() - lastStatsPrintTime > 1.0)
+				{
+					const auto& stats = meshRenderSys.getFrameStats();
+					std::cout << "draws: " << stats.draws << " instances: " << stats.instances << " pipeline binds: " << stats.pipelineBinds
+						<< " set binds: " << stats.descriptorSetBinds << " vertex buffer binds: " << stats.vertexBufferBinds
+						<< " triangles: " << stats.triangles << "\n";
+					lastStatsPrintTime = engineClock.getElapsed();
+				}
 				
-				//imguiObj.render(commandBuffer); // imgui
+				//imguiObj.render(commandBuffer); // imgui (needs a secondary command buffer, see beginSecondaryCommandBuffer)
 
 				// camera movement
 				auto lookInput = window.input.getMouseDelta();
@@ -138,7 +173,6 @@ namespace EngineCore
 				camera.aspectRatio = renderer.getAspectRatio();
 			}
 		}
-		delete& marsTexture; delete& spaceTexture;
 		// window pending close, wait for GPU
 		vkDeviceWaitIdle(device.device());
 	}
@@ -147,11 +181,13 @@ namespace EngineCore
 	{
 		using namespace ECS;
 
-		Primitive::MeshBuilder builder{};
-		builder.loadFromFile(makePath("Meshes/mars.obj")); // TODO: hardcoded path
-		loadedMeshes.push_back(new Primitive(device, builder));
-		loadedMeshes[0]->getTransform().translation = Vec{160.f, 0.f, 0.f};
-		loadedMeshes[0]->getTransform().scale = 120.f;
+		const std::string marsPath = makePath("Meshes/mars.obj"); // TODO: hardcoded path
+		loadedMeshes.push_back(meshStorage.emplace(meshCache.load(marsPath)));
+		Transform marsTransform{};
+		marsTransform.translation = Vec{160.f, 0.f, 0.f};
+		marsTransform.scale = 120.f;
+		loadedMeshes[0]->setTransform(marsTransform);
+		sceneTree.insert(loadedMeshes[0]);
 
 		/*builder.loadFromFile("G:/VulkanDev/VulkanEngine/Core/DevResources/Meshes/sphere.obj");
 		loadedMeshes.push_back(new Primitive(device, builder)); 
@@ -162,13 +198,30 @@ namespace EngineCore
 		return; // TODO: function terminates here!
 		for (uint32_t i = 0; i < 1; i++) 
 		{ 
-			loadedMeshes.push_back(new Primitive(device, builder));
-			loadedMeshes[i]->getTransform().translation.x = 0.5f * i;
+			loadedMeshes.push_back(meshStorage.emplace(meshCache.load(marsPath)));
+			Transform t{};
+			t.translation.x = 0.5f * i;
+			loadedMeshes[i]->setTransform(t);
 			if (i == 1) { loadedMeshes[i]->useFakeScale = true; } 
+			sceneTree.insert(loadedMeshes[i]);
 		}
 
 	}
 
+	void EngineApplication::tickActors(const float& deltaTimeSeconds)
+	{
+		// spin 3D primitives - demo, every placed mesh turns whether it is visible or not
+		const float spinRate = 0.1f;
+		for (auto* pMesh : loadedMeshes)
+		{
+			if (!pMesh) { continue; }
+			Vec rotation = pMesh->getTransform().rotation;
+			rotation.z = glm::mod(rotation.z + spinRate * deltaTimeSeconds, glm::two_pi<float>());
+			rotation.y = glm::mod(rotation.y + spinRate * 0.8f * deltaTimeSeconds, glm::two_pi<float>());
+			pMesh->setRotation(rotation);
+		}
+	}
+
 	void EngineApplication::setupDefaultInputs()
 	{
 		assert(&window.input && "error setting up default input bindings");
@@ -256,7 +309,12 @@ namespace EngineCore
 		cameraTransform.translation = {0.f,0.f,0.f};
 		if (loadedMeshes.size() > 0) 
 		{
-			for (auto* m : loadedMeshes) { m->getTransform().translation = m->getTransform().translation - nw; }
+			for (auto* m : loadedMeshes) 
+			{ 
+				Transform t = m->getTransform();
+				t.translation = t.translation - nw;
+				m->setTransform(t); // also relocates the mesh in the scene tree
+			}
 		}
 	}
 
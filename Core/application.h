@@ -16,6 +16,10 @@
 #include "Types/CommonTypes.h"
 #include "Core/GPU/Memory/descriptors.h"
 #include "Core/EngineSettings.h"
+#include "Core/Types/LinkedArraySeriesContainer.h"
+#include "Core/Jobs/JobSystem.h"
+#include "Core/Mesh/MeshCache.h"
+#include "Core/Texture/TextureStreamer.h"
 
 class SharedMaterialsPool;
 
@@ -86,6 +90,8 @@ namespace EngineCore
 
 	private:
 		void loadActors();
+		// advances the scene by one frame, runs before culling so the frustum query sees the new state
+		void tickActors(const float& deltaTimeSeconds);
 		void setupDefaultInputs();
 
 		// engine application window (creates a window using GLFW) 
@@ -98,14 +104,26 @@ namespace EngineCore
 		MaterialsManager materialsMgr{ renderer, renderSettings, device };
 
 		EngineClock engineClock{};
+		// worker threads for per-frame engine work (ticking, matrix building, culling)
+		JobSystem jobs{};
 
 		//GlobalDescriptorSetManager globalDSetMgr{ device, EngineSwapChain::MAX_FRAMES_IN_FLIGHT };
 
 		DescriptorSet dset{ device, EngineSwapChain::MAX_FRAMES_IN_FLIGHT };
+		// decodes and uploads textures on a few worker threads of its own
+		TextureStreamer textureStreamer{ device, TextureStreamer::DEFAULT_WORKER_COUNT, renderSettings.textureLodBias };
 
 		std::unique_ptr<DescriptorPool> globalDescriptorPool{};
+		// shared mesh geometry, each unique mesh file is loaded and uploaded once
+		MeshCache meshCache{ device, renderSettings.meshVertexFormat, true, &jobs, renderSettings.meshLodLevels };
+		// owns the placed meshes, addresses are stable so the raw pointers below remain valid
+		LinkedArraySeries<ECS::Primitive, 16> meshStorage{ 64, true };
 		std::vector<ECS::Primitive*> loadedMeshes;
 
+		// spatial index of all placed meshes, queried with the camera frustum every frame
+		World::Octree sceneTree{ World::Octree::OctreeProperties{} };
+		std::vector<ECS::Primitive*> visibleMeshes;
+
 	};
 
 } // namespace
\ No newline at end of file
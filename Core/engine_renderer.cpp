@@ -1,4 +1,5 @@
 #include "engine_renderer.h"
+#include "Core/GPU/Memory/UploadManager.h"
 
 #include <stdexcept>
 #include <array>
@@ -11,9 +12,15 @@ namespace EngineCore
 	{
 		recreateSwapchain();
 		createCommandBuffers();
+		uploadArena = std::make_unique<FrameUploadArena>(device,
+			renderSettings.uploadArenaFrameSize * EngineSwapChain::MAX_FRAMES_IN_FLIGHT, EngineSwapChain::MAX_FRAMES_IN_FLIGHT);
 	}
 
-	EngineRenderer::~EngineRenderer() { freeCommandBuffers(); }
+	EngineRenderer::~EngineRenderer() 
+	{ 
+		freeCommandBuffers(); 
+		destroySecondaryCommandPools();
+	}
 
 	void EngineRenderer::createCommandBuffers()
 	{
@@ -36,6 +43,98 @@ namespace EngineCore
 		commandBuffers.clear();
 	}
 
+	void EngineRenderer::createSecondaryCommandPools(const uint32_t& threadCount)
+	{
+		assert(threadCount > 0 && "secondary command pool thread count must be above zero");
+		destroySecondaryCommandPools();
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.queueFamilyIndex = device.findPhysicalQueueFamilies().graphicsFamily;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT; // buffers are re-recorded every frame
+
+		secondaryPools.resize(EngineSwapChain::MAX_FRAMES_IN_FLIGHT);
+		for (auto& framePools : secondaryPools)
+		{
+			framePools.resize(threadCount);
+			for (auto& p : framePools)
+			{
+				if (vkCreateCommandPool(device.device(), &poolInfo, nullptr, &p.pool) != VK_SUCCESS)
+				{ throw std::runtime_error("failed to create secondary command pool"); }
+			}
+		}
+	}
+
+	void EngineRenderer::destroySecondaryCommandPools()
+	{
+		// destroying a pool also frees its command buffers
+		for (auto& framePools : secondaryPools)
+		{
+			for (auto& p : framePools) { vkDestroyCommandPool(device.device(), p.pool, nullptr); }
+		}
+		secondaryPools.clear();
+	}
+
+	VkCommandBuffer EngineRenderer::beginSecondaryCommandBuffer(const uint32_t& threadIndex)
+	{
+		assert(isFrameStarted && "beginSecondaryCommandBuffer failed, no frame in progress");
+		assert(threadIndex < secondaryPools[currentFrameIndex].size() && "no secondary command pool for thread index");
+		SecondaryCommandPool& p = secondaryPools[currentFrameIndex][threadIndex];
+
+		if (p.used == p.buffers.size())
+		{
+			VkCommandBufferAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			allocInfo.commandPool = p.pool;
+			allocInfo.commandBufferCount = 1;
+			VkCommandBuffer buffer;
+			if (vkAllocateCommandBuffers(device.device(), &allocInfo, &buffer) != VK_SUCCESS)
+			{ throw std::runtime_error("failed to allocate secondary command buffer"); }
+			p.buffers.push_back(buffer);
+		}
+		VkCommandBuffer commandBuffer = p.buffers[p.used++];
+
+		VkCommandBufferInheritanceInfo inheritance{};
+		inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritance.renderPass = swapchain->getRenderPass();
+		inheritance.subpass = 0;
+		inheritance.framebuffer = swapchain->getFrameBuffer(currentImageIndex);
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		beginInfo.pInheritanceInfo = &inheritance;
+		if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS)
+		{ throw std::runtime_error("failed to begin recording secondary command buffer"); }
+
+		// dynamic state is not inherited from the primary command buffer
+		VkViewport viewport{};
+		viewport.x = 0.0f;
+		viewport.y = 0.0f;
+		viewport.width = static_cast<float>(swapchain->getSwapChainExtent().width);
+		viewport.height = static_cast<float>(swapchain->getSwapChainExtent().height);
+		viewport.minDepth = 0.0f;
+		viewport.maxDepth = 1.0f;
+		VkRect2D scissor{ {0, 0}, swapchain->getSwapChainExtent() };
+		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+		return commandBuffer;
+	}
+
+	void EngineRenderer::endSecondaryCommandBuffer(VkCommandBuffer commandBuffer)
+	{
+		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+		{ throw std::runtime_error("failed to record secondary command buffer"); }
+	}
+
+	void EngineRenderer::executeSecondaryCommandBuffers(VkCommandBuffer primary, const VkCommandBuffer* buffers, 
+														const uint32_t& count)
+	{
+		assert(primary == getCurrentCommandBuffer() && "cannot execute secondary command buffers on other frame");
+		if (count == 0) { return; }
+		vkCmdExecuteCommands(primary, count, buffers);
+	}
+
 	void EngineRenderer::recreateSwapchain()
 	{
 		auto extent = window.getExtent();
@@ -73,6 +172,17 @@ namespace EngineCore
 
 		isFrameStarted = true;
 
+		// the fence for this frame was waited on in acquireNextImage, its secondary buffers are no longer in use
+		if (!secondaryPools.empty())
+		{
+			for (auto& p : secondaryPools[currentFrameIndex])
+			{
+				vkResetCommandPool(device.device(), p.pool, 0);
+				p.used = 0;
+			}
+		}
+		uploadArena->beginFrame(currentFrameIndex);
+
 		auto commandBuffer = getCurrentCommandBuffer();
 
 		VkCommandBufferBeginInfo beginInfo{};
@@ -88,11 +198,16 @@ namespace EngineCore
 		assert(isFrameStarted && "endFrame failed, no frame in progress");
 
 		auto commandBuffer = getCurrentCommandBuffer();
+		uploadArena->endFrame();
 
 		if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
 		{ throw std::runtime_error("failed to record command buffer"); }
 
-		auto result = swapchain->submitCommandBuffers(&commandBuffer, &currentImageIndex);
+		// uploads recorded so far are submitted first, the frame waits only for those of resources it uses
+		UploadManager& uploads = device.getUploads();
+		uploads.flush();
+		auto result = swapchain->submitCommandBuffers(&commandBuffer, &currentImageIndex,
+													uploads.getTimelineSemaphore(), uploads.getFrameWaitValue());
 		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || window.wasWindowResized())
 		{
 			window.resetWindowResizedFlag();
@@ -126,18 +241,8 @@ namespace EngineCore
 		renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
 		renderPassInfo.pClearValues = clearValues.data();
 
-		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE); // inline = no secondary cmdbuffers
-
-		VkViewport viewport{};
-		viewport.x = 0.0f;
-		viewport.y = 0.0f;
-		viewport.width = static_cast<float>(swapchain->getSwapChainExtent().width);
-		viewport.height = static_cast<float>(swapchain->getSwapChainExtent().height);
-		viewport.minDepth = 0.0f;
-		viewport.maxDepth = 1.0f;
-		VkRect2D scissor{ {0, 0}, swapchain->getSwapChainExtent() };
-		vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-		vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+		// all draws are recorded into secondary command buffers (possibly on several threads)
+		vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
 	}
 
 	void EngineRenderer::endSwapchainRenderPass(VkCommandBuffer commandBuffer) 
@@ -4,6 +4,7 @@
 #include "Core/GPU/engine_device.h"
 #include "Core/engine_swap_chain.h"
 #include "Core/EngineSettings.h"
+#include "Core/GPU/Memory/UploadArena.h"
 
 // std
 #include <memory>
@@ -34,17 +35,35 @@ namespace EngineCore
 			return currentFrameIndex;
 		}
 		float getAspectRatio() const { return swapchain->getExtentAspectRatio(); }
+		// per-frame CPU to GPU data, ranges are valid until the current frame has completed
+		FrameUploadArena& getUploadArena()
+		{
+			assert(isFrameStarted && "getUploadArena failed, no frame in progress");
+			return *uploadArena;
+		}
 
 		// returns a command buffer object for writing commands to
 		VkCommandBuffer beginFrame();
 		// submit command buffer to finalize the frame
 		void endFrame();
+		// the swapchain render pass expects its contents in secondary command buffers
 		void beginSwapchainRenderPass(VkCommandBuffer commandBuffer);
 		void endSwapchainRenderPass(VkCommandBuffer commandBuffer);
 
+		/*	creates one command pool per recording thread and frame in flight,
+			must be called before secondary command buffers are requested */
+		void createSecondaryCommandPools(const uint32_t& threadCount);
+		/*	returns a secondary command buffer which continues the swapchain render pass, with viewport and scissor set,
+			threadIndex selects the command pool, so each index may only be used by one thread at a time */
+		VkCommandBuffer beginSecondaryCommandBuffer(const uint32_t& threadIndex);
+		void endSecondaryCommandBuffer(VkCommandBuffer commandBuffer);
+		// records the secondary command buffers into the primary command buffer, in order
+		void executeSecondaryCommandBuffers(VkCommandBuffer primary, const VkCommandBuffer* buffers, const uint32_t& count);
+
 	private:
 		void createCommandBuffers();
 		void freeCommandBuffers();
+		void destroySecondaryCommandPools();
 		void recreateSwapchain();
 
 		EngineWindow& window;
@@ -55,6 +74,17 @@ namespace EngineCore
 		std::unique_ptr<EngineSwapChain> swapchain;
 		// command buffers
 		std::vector<VkCommandBuffer> commandBuffers;
+		std::unique_ptr<FrameUploadArena> uploadArena;
+
+		// secondary command buffers are reused every frame, the pool is reset once the frame's fence has signaled
+		struct SecondaryCommandPool
+		{
+			VkCommandPool pool = VK_NULL_HANDLE;
+			std::vector<VkCommandBuffer> buffers;
+			uint32_t used = 0;
+		};
+		// [frame in flight][thread index]
+		std::vector<std::vector<SecondaryCommandPool>> secondaryPools;
 
 		uint32_t currentImageIndex;
 		int currentFrameIndex{ 0 };
@@ -85,7 +85,8 @@ namespace EngineCore {
 		return result;
 	}
 
-	VkResult EngineSwapChain::submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex)
+	VkResult EngineSwapChain::submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex,
+												VkSemaphore uploadSemaphore, uint64_t uploadValue)
 	{
 		if (imagesInFlight[*imageIndex] != VK_NULL_HANDLE) 
 		{ vkWaitForFences(device.device(), 1, &imagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX); }
@@ -94,11 +95,20 @@ namespace EngineCore {
 		VkSubmitInfo submitInfo = {};
 		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-		VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame] };
-		VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-		submitInfo.waitSemaphoreCount = 1;
+		// uploaded buffers and images are first read by vertex input, shaders or copies
+		VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame], uploadSemaphore };
+		VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 
+			VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
+			| VK_PIPELINE_STAGE_TRANSFER_BIT };
+		const uint64_t waitValues[] = { 0, uploadValue }; // the binary semaphore ignores its value
+		VkTimelineSemaphoreSubmitInfo timelineInfo{};
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timelineInfo.waitSemaphoreValueCount = 2;
+		timelineInfo.pWaitSemaphoreValues = waitValues;
+		submitInfo.waitSemaphoreCount = uploadSemaphore != VK_NULL_HANDLE && uploadValue > 0 ? 2 : 1;
 		submitInfo.pWaitSemaphores = waitSemaphores;
 		submitInfo.pWaitDstStageMask = waitStages;
+		if (submitInfo.waitSemaphoreCount == 2) { submitInfo.pNext = &timelineInfo; }
 
 		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers = buffers;
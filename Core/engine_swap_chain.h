@@ -44,7 +44,10 @@ namespace EngineCore {
 		VkFormat findDepthFormat();
 
 		VkResult acquireNextImage(uint32_t* imageIndex);
-		VkResult submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex);
+		/*	submits the frame, the graphics work additionally waits until uploadSemaphore (timeline) reaches uploadValue,
+			see UploadManager */
+		VkResult submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex,
+									VkSemaphore uploadSemaphore = VK_NULL_HANDLE, uint64_t uploadValue = 0);
 
 		bool compareSwapFormats(const EngineSwapChain& swapchain) const 
 		{
@@ -2,8 +2,10 @@
 
 #include "Core/Camera.h"
 
+#include <cassert>
 #include <stdexcept>
 #include <array>
+#include <algorithm>
 #include <limits>
 #include <iostream> // temporary
 
@@ -15,80 +17,139 @@
 
 namespace EngineCore
 {
-	void MeshRenderSystem::renderMeshes(VkCommandBuffer commandBuffer, std::vector<ECS::Primitive*>& meshes,
-			const float& deltaTimeSeconds, float time, VkDescriptorSet sceneGlobalDescriptorSet, Transform& fakeScaleOffsets) //FakeScaleTest082
-			
+	void MeshRenderSystem::renderMeshes(EngineRenderer& renderer, VkCommandBuffer commandBuffer, std::vector<ECS::Primitive*>& meshes,
+			const float& deltaTimeSeconds, float time, VkDescriptorSet sceneGlobalDescriptorSet, Transform& fakeScaleOffsets, //FakeScaleTest082
+			JobSystem& jobs, const Vec& viewPosition, const float& lodScale)
 	{
-		for (auto* pMesh : meshes)
-		{
-			if (!pMesh || !pMesh->getMaterial()) { continue; }
-			auto& mesh = *pMesh;
-			auto& material = *mesh.getMaterial();
+		updateWorldMatrices(meshes, jobs);
 
-			material.bindToCommandBuffer(commandBuffer); // bind material-specific shading pipeline
-			// bind scene global descriptor set for every primitive
-			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, material.getPipelineLayout(),
-									0, 1, &sceneGlobalDescriptorSet, 0, nullptr);
+		// order draws by state to skip redundant binds
+		renderQueue.clear();
+		for (auto* pMesh : meshes) { renderQueue.add(pMesh, sceneGlobalDescriptorSet, viewPosition, lodScale); }
+		renderQueue.sort();
 
-			// spin 3D primitive - demo
-			float spinRate = 0.1f;
-			mesh.getTransform().rotation.z = glm::mod(mesh.getTransform().rotation.z + spinRate * deltaTimeSeconds, glm::two_pi<float>());
-			mesh.getTransform().rotation.y = glm::mod(mesh.getTransform().rotation.y + spinRate * 0.8f * deltaTimeSeconds, glm::two_pi<float>());
+		frameStats = RenderQueue::Stats{};
+		const uint32_t drawCount = renderQueue.size();
+		if (drawCount == 0) { return; }
+		const UploadRange instanceRange = renderer.getUploadArena().allocate(
+			static_cast<VkDeviceSize>(drawCount) * sizeof(ECS::Primitive::InstanceData));
+		// split the draws into contiguous chunks, each is recorded into its own secondary command buffer
+		const uint32_t maxChunks = jobs.getThreadCount() * 2;
+		const uint32_t chunkCount = std::min(maxChunks, (drawCount + MIN_DRAWS_PER_CHUNK - 1) / MIN_DRAWS_PER_CHUNK);
+		const uint32_t chunkSize = (drawCount + chunkCount - 1) / chunkCount;
+		chunkCommandBuffers.resize(chunkCount);
+		chunkStats.assign(chunkCount, RenderQueue::Stats{});
 
-			/*if (camera != nullptr)
+		jobs.parallelFor(chunkCount, 1, [&](uint32_t begin, uint32_t end)
 			{
-				// camera rotation
-				//camera->transform.rotation += glm::vec3{ -x, y, 0.0 } * 0.03f;
-				glm::vec3 rot = { -inputSysPtr->getMouseDelta().x, inputSysPtr->getMouseDelta().y, 0.f};
-				rot = { Transform3D::degToRad(rot.x), Transform3D::degToRad(rot.y), 0.f };
-				camera->transform.rotation += rot * 0.03f;
-				auto x = camera->transform.rotation.x; auto y = camera->transform.rotation.y; auto z = camera->transform.rotation.z;
-				std::cout << "x: " << x << " y: " << y << " z: " << z << "\n \n \n";
-
-				// camera translation
-				glm::vec3 camFwdVec = camera->transform.getForwardVector();
-				float fwdInput = inputSysPtr->getAxisValue(0);
-				float constexpr epsilon = std::numeric_limits<float>::epsilon();
-				if ((glm::dot(camFwdVec, camFwdVec) > epsilon) && (fwdInput > epsilon || fwdInput < -epsilon))
+				for (uint32_t c = begin; c < end; c++)
 				{
-					camera->transform.translation += glm::normalize(camFwdVec) * (fwdInput * 1.2f * deltaTimeSeconds);
+					const uint32_t first = c * chunkSize;
+					const uint32_t last = std::min(drawCount, first + chunkSize);
+					VkCommandBuffer cmd = renderer.beginSecondaryCommandBuffer(jobs.getCurrentThreadIndex());
+					recordMeshDraws(cmd, first, last, fakeScaleOffsets, chunkStats[c], instanceRange);
+					renderer.endSecondaryCommandBuffer(cmd);
+					chunkCommandBuffers[c] = cmd;
 				}
-				camera->transform.translation.y += -inputSysPtr->getAxisValue(1) * deltaTimeSeconds * 1.2f;
-				camera->transform.translation.z += inputSysPtr->getAxisValue(2) * deltaTimeSeconds * 1.2f;
+			});
+		// chunks are executed in order, so draw order is the same as with single-threaded recording
+		renderer.executeSecondaryCommandBuffers(commandBuffer, chunkCommandBuffers.data(), chunkCount);
+		for (const auto& cs : chunkStats) { frameStats += cs; }
+	}
+
+	void MeshRenderSystem::recordMeshDraws(VkCommandBuffer commandBuffer, const uint32_t& first, const uint32_t& last,
+										const Transform& fakeScaleOffsets, RenderQueue::Stats& stats, const UploadRange& instanceRange)
+	{
+		// bound state, a secondary command buffer starts without any
+		Material* boundMaterial = nullptr;
+		VkPipelineLayout boundLayout = VK_NULL_HANDLE;
+		VkDescriptorSet boundSet = VK_NULL_HANDLE;
+		const MeshGeometry* boundGeometry = nullptr;
+
+		// instance data is written in sorted order, so a run of draws maps to a contiguous instance range
+		auto* instances = static_cast<ECS::Primitive::InstanceData*>(instanceRange.mapped);
+		VkBuffer instanceBuffers[] = { instanceRange.buffer };
+		VkDeviceSize instanceOffsets[] = { instanceRange.offset };
+		vkCmdBindVertexBuffers(commandBuffer, ECS::Primitive::INSTANCE_BINDING, 1, instanceBuffers, instanceOffsets);
+
+		uint32_t i = first;
+		while (i < last)
+		{
+			const RenderQueue::DrawItem& item = renderQueue.getSorted(i);
+			auto& mesh = *item.mesh;
+			auto& material = *item.material;
+			const MeshGeometry* geometry = mesh.getGeometry().get();
+
+			// consecutive draws with the same geometry, level of detail, material and set become one instanced draw
+			uint32_t runEnd = i;
+			while (runEnd < last)
+			{
+				const RenderQueue::DrawItem& next = renderQueue.getSorted(runEnd);
+				if (next.material != item.material || next.descriptorSet != item.descriptorSet
+					|| next.mesh->getGeometry().get() != geometry || next.lod != item.lod) { break; }
+				//FakeScaleTest082
+				instances[runEnd].model = next.mesh->useFakeScale ? fakeScaleOffsets.mat4() : next.mesh->getWorldMatrix();
+				runEnd++;
 			}
-			else 
-			{ throw std::runtime_error("renderEngineObjects null camera pointer"); }*/
-
-			/* view matrix and mesh transform matrix
-			glm::mat4 projectionMatrix = camera->getProjectionMatrix();
-			glm::mat4 viewMatrix = camera->getViewMatrix(true);
-			glm::mat4 meshMatrix =  mesh.transform.mat4();
-			glm::mat4 worldMatrix = Camera::getWorldBasisMatrix();
-			// old way of sending matrices to gpu
-			push.transform = projectionMatrix * worldMatrix * viewMatrix * meshMatrix;
-			vkCmdPushConstants(commandBuffer, mesh->getMaterial()->getPipelineLayout(),
-				VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-				0, sizeof(SimplePushConstantData), &push);*/
-
-			//FakeScaleTest082
-			if (mesh.useFakeScale) 
+
+			if (&material != boundMaterial)
 			{
-				Material::MeshPushConstants push{};
-				push.transform = fakeScaleOffsets.mat4(); //t
-				material.writePushConstantsForMesh(commandBuffer, push);
-			} 
-			else 
+				material.bindToCommandBuffer(commandBuffer); // bind material-specific shading pipeline
+				boundMaterial = &material;
+				stats.pipelineBinds++;
+			}
+			// a set stays bound across pipelines only if the layouts match
+			if (item.descriptorSet != boundSet || material.getPipelineLayout() != boundLayout)
 			{
-				// NON-TEST CODE!
-				Material::MeshPushConstants push{};
-				push.transform = mesh.getTransform().mat4();
-				material.writePushConstantsForMesh(commandBuffer, push);
+				vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, material.getPipelineLayout(),
+										0, 1, &item.descriptorSet, 0, nullptr);
+				boundSet = item.descriptorSet;
+				boundLayout = material.getPipelineLayout();
+				stats.descriptorSetBinds++;
 			}
 
+			// the world transform comes from the instance data, push constants hold the mesh-local transform
+			assert(geometry->getVertexFormat() == material.getVertexFormat() && "mesh and material vertex formats differ");
+			Material::MeshPushConstants push{};
+			push.transform = geometry->getVertexDecodeTransform();
+			material.writePushConstantsForMesh(commandBuffer, push);
+
 			// record mesh draw command
-			mesh.bind(commandBuffer);
-			mesh.draw(commandBuffer);
+			if (geometry != boundGeometry)
+			{
+				mesh.bind(commandBuffer);
+				boundGeometry = geometry;
+				stats.vertexBufferBinds++;
+			}
+			mesh.draw(commandBuffer, runEnd - i, i, item.lod);
+			stats.draws++;
+			stats.instances += runEnd - i;
+			stats.triangles += static_cast<uint64_t>(geometry->getTriangleCount(item.lod)) * (runEnd - i);
+			i = runEnd;
+		}
+	}
+
+	void MeshRenderSystem::updateWorldMatrices(std::vector<ECS::Primitive*>& meshes, JobSystem& jobs)
+	{
+		// gather only the outdated transforms, static meshes cost nothing here
+		matrixBatchInput.clear();
+		matrixBatchMeshes.clear();
+		for (auto* m : meshes)
+		{
+			if (!m || !m->isWorldMatrixOutdated()) { continue; }
+			matrixBatchInput.add(m->getTransform());
+			matrixBatchMeshes.push_back(m);
 		}
+		const uint32_t count = matrixBatchInput.size();
+		if (count == 0) { return; }
+		matrixBatchInput.updated.clear(); // every gathered entry needs a new matrix
+		if (matrixBatchOutput.size() < count) { matrixBatchOutput.resize(count); }
+
+		jobs.parallelFor(count, 1024, [this](uint32_t begin, uint32_t end)
+			{
+				Math::buildMatrices(matrixBatchInput, matrixBatchOutput.data(), begin, end);
+				for (uint32_t i = begin; i < end; i++) { matrixBatchMeshes[i]->setWorldMatrix(matrixBatchOutput[i]); }
+			});
 	}
 
 	glm::mat4 MeshRenderSystem::lerpMat4(float t, glm::mat4 matA, glm::mat4 matB) 
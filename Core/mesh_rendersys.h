@@ -2,6 +2,9 @@
 
 #include "Core/GPU/engine_device.h"
 #include "Core/GPU/Material.h"
+#include "Core/engine_renderer.h"
+#include "Core/GPU/RenderQueue.h"
+#include "Core/GPU/Memory/UploadArena.h"
 
 // glm
 #include <glm/gtc/matrix_transform.hpp>
@@ -12,6 +15,8 @@
 
 class Camera;
 #include "Core/ECS/Primitive.h"
+#include "Core/Jobs/JobSystem.h"
+#include "Core/Types/TransformBatch.h"
 
 namespace EngineCore
 {
@@ -24,12 +29,40 @@ namespace EngineCore
 		MeshRenderSystem(const MeshRenderSystem&) = delete;
 		MeshRenderSystem& operator=(const MeshRenderSystem&) = delete;
 
-		void renderMeshes(VkCommandBuffer commandBuffer, std::vector<ECS::Primitive*>& meshes,
-						const float& deltaTimeSeconds, float time, VkDescriptorSet sceneGlobalDescriptorSet, Transform& fakeScaleOffsets); //FakeScaleTest082
+		/*	records the mesh draws into secondary command buffers on the job system's threads,
+			then executes them in the primary command buffer (which must be inside the swapchain render pass),
+			levels of detail are picked per draw, see RenderQueue::add for lodScale */
+		void renderMeshes(EngineRenderer& renderer, VkCommandBuffer commandBuffer, std::vector<ECS::Primitive*>& meshes,
+						const float& deltaTimeSeconds, float time, VkDescriptorSet sceneGlobalDescriptorSet, Transform& fakeScaleOffsets, //FakeScaleTest082
+						JobSystem& jobs, const Vec& viewPosition, const float& lodScale);
+
+		// command counts of the last renderMeshes call
+		const RenderQueue::Stats& getFrameStats() const { return frameStats; }
+
+		// rebuilds the world matrices of all meshes whose transform was updated, in parallel batches
+		void updateWorldMatrices(std::vector<ECS::Primitive*>& meshes, JobSystem& jobs);
 
 	private:
 		EngineDevice& device;
 
+		// scratch storage for updateWorldMatrices, kept between frames to avoid reallocation
+		TransformBatch matrixBatchInput{};
+		std::vector<glm::mat4> matrixBatchOutput{};
+		std::vector<ECS::Primitive*> matrixBatchMeshes{};
+
+		// below this many draws per chunk, the cost of an extra secondary command buffer outweighs the parallelism
+		static constexpr uint32_t MIN_DRAWS_PER_CHUNK = 256;
+		std::vector<VkCommandBuffer> chunkCommandBuffers{};
+		std::vector<RenderQueue::Stats> chunkStats{};
+
+		RenderQueue renderQueue{};
+		RenderQueue::Stats frameStats{};
+
+		/*	records the sorted draws [first, last) of the render queue, runs of identical geometry and level of detail are instanced,
+			instance data (vertex binding 1) is written to the frame's range of the upload arena */
+		void recordMeshDraws(VkCommandBuffer commandBuffer, const uint32_t& first, const uint32_t& last,
+							const Transform& fakeScaleOffsets, RenderQueue::Stats& stats, const UploadRange& instanceRange);
+
 		static glm::mat4 orthographicMatrix(const float& n, const float& f)
 		{
 			float r = 1.f;
@@ -1,5 +1,6 @@
 #include "Core/sky_rendersys.h"
 #include "Types/CommonTypes.h"
+#include "Core/Mesh/MeshCache.h"
 
 namespace EngineCore
 {
@@ -10,11 +11,12 @@ namespace EngineCore
 		const std::string meshPath = makePath("Meshes/skysphere.obj");
 		ShaderFilePaths skyShaders(makePath("Shaders/sky.vert.spv"), makePath("Shaders/sky.frag.spv"));
 
-		// prepare sky mesh
-		ECS::Primitive::MeshBuilder builder{};
-		builder.loadFromFile(meshPath);
-		skyMesh = std::make_unique<ECS::Primitive>(device, builder);
-		skyMesh->getTransform().scale = 100000.f;
+		// prepare sky mesh, loaded through a cache for the cooked file fast path (the primitive keeps the geometry alive)
+		MeshCache skyMeshes{ device };
+		skyMesh = std::make_unique<ECS::Primitive>(skyMeshes.load(meshPath));
+		Transform skyTransform{};
+		skyTransform.scale = 100000.f;
+		skyMesh->setTransform(skyTransform);
 
 		// create unique material for sky
 		MaterialCreateInfo matInfo(skyShaders, setLayouts);
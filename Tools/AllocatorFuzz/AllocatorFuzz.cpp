@@ -0,0 +1,317 @@
+/*	stress test of DeviceMemoryAllocator without a GPU, the driver is replaced by host memory (FakeDeviceMemory),
+	random allocations (sizes, alignments, memory types, linear/optimal, dedicated), frees and defragmentation passes,
+	after every step the pools are validated (nodes tile each block without overlap, allocations are aligned,
+	no two free neighbours, free lists match the blocks) and the live allocations are checked against each other,
+	host-visible allocations carry a byte pattern that must survive defragmentation moves,
+	usage: AllocatorFuzz [--steps <n>] [--seed <n>], returns non-zero on the first failed check */
+#include "Core/GPU/Memory/VMemAllocator.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+	using namespace EngineCore;
+
+	[[noreturn]] void fail(const std::string& what)
+	{
+		throw std::runtime_error(what);
+	}
+
+	/*	memory types: 0 device local, 1 host visible and coherent, 2 host visible only (flushed in atoms),
+		the heaps are small so blocks fill up, get released and run out, host-visible blocks are backed by real memory */
+	class FakeDeviceMemory : public DeviceMemoryInterface
+	{
+	public:
+		static constexpr VkDeviceSize ATOM_SIZE = 64;
+		static constexpr VkDeviceSize DEVICE_HEAP_SIZE = 96ull * 1024 * 1024;
+		static constexpr VkDeviceSize HOST_HEAP_SIZE = 24ull * 1024 * 1024;
+
+		VkPhysicalDeviceMemoryProperties getMemoryProperties() override
+		{
+			VkPhysicalDeviceMemoryProperties p{};
+			p.memoryHeapCount = 2;
+			p.memoryHeaps[0].size = DEVICE_HEAP_SIZE;
+			p.memoryHeaps[0].flags = VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+			p.memoryHeaps[1].size = HOST_HEAP_SIZE;
+			p.memoryTypeCount = 3;
+			p.memoryTypes[0] = { VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0 };
+			p.memoryTypes[1] = { VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 1 };
+			p.memoryTypes[2] = { VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, 1 };
+			return p;
+		}
+		VkDeviceSize getNonCoherentAtomSize() override { return ATOM_SIZE; }
+
+		VkResult allocateMemory(const VkMemoryAllocateInfo& info, VkDeviceMemory& memory) override
+		{
+			if (info.memoryTypeIndex > 2 || info.allocationSize == 0) { fail("vkAllocateMemory with an invalid type or size"); }
+			const uint32_t heap = info.memoryTypeIndex == 0 ? 0 : 1;
+			if (heapUsage[heap] + info.allocationSize > (heap == 0 ? DEVICE_HEAP_SIZE : HOST_HEAP_SIZE))
+			{ return VK_ERROR_OUT_OF_DEVICE_MEMORY; }
+			heapUsage[heap] += info.allocationSize;
+
+			Block block{};
+			block.size = info.allocationSize;
+			block.heap = heap;
+			if (heap == 1) { block.data.reset(new uint8_t[info.allocationSize]); }
+			const uint64_t id = nextHandle++;
+			std::memcpy(&memory, &id, sizeof(memory)); // handles are only compared, never dereferenced
+			blocks.emplace(id, std::move(block));
+			return VK_SUCCESS;
+		}
+		void freeMemory(VkDeviceMemory memory) override
+		{
+			auto it = blocks.find(handleId(memory));
+			if (it == blocks.end()) { fail("vkFreeMemory of an unknown handle"); }
+			if (it->second.mapped) { fail("vkFreeMemory of a mapped block"); }
+			heapUsage[it->second.heap] -= it->second.size;
+			blocks.erase(it);
+		}
+		VkResult mapMemory(VkDeviceMemory memory, void*& data) override
+		{
+			Block& block = getBlock(memory);
+			if (block.mapped || !block.data) { fail("vkMapMemory of a mapped or device-only block"); }
+			block.mapped = true;
+			data = block.data.get();
+			return VK_SUCCESS;
+		}
+		void unmapMemory(VkDeviceMemory memory) override
+		{
+			Block& block = getBlock(memory);
+			if (!block.mapped) { fail("vkUnmapMemory of a block that is not mapped"); }
+			block.mapped = false;
+		}
+
+		uint32_t getBlockCount() const { return static_cast<uint32_t>(blocks.size()); }
+		VkDeviceSize getBlockSize(VkDeviceMemory memory) { return getBlock(memory).size; }
+		const uint8_t* getBlockData(VkDeviceMemory memory) { return getBlock(memory).data.get(); }
+
+	private:
+		struct Block
+		{
+			VkDeviceSize size = 0;
+			uint32_t heap = 0;
+			bool mapped = false;
+			std::unique_ptr<uint8_t[]> data;
+		};
+		std::unordered_map<uint64_t, Block> blocks;
+		VkDeviceSize heapUsage[2]{};
+		uint64_t nextHandle = 1;
+
+		static uint64_t handleId(VkDeviceMemory memory)
+		{
+			uint64_t id = 0;
+			std::memcpy(&id, &memory, sizeof(memory));
+			return id;
+		}
+		Block& getBlock(VkDeviceMemory memory)
+		{
+			auto it = blocks.find(handleId(memory));
+			if (it == blocks.end()) { fail("unknown memory handle"); }
+			return it->second;
+		}
+	};
+
+	struct Resource
+	{
+		Allocation allocation{};
+		VkMemoryRequirements requirements{};
+		uint32_t memoryType = 0;
+		// fills host-visible allocations, checked after every move
+		uint8_t pattern = 0;
+	};
+
+	class Fuzzer
+	{
+	public:
+		Fuzzer(const uint32_t& seed) : rng{ seed }, allocator{ driver } {}
+
+		void run(const uint32_t& steps)
+		{
+			uint32_t defragments = 0, releasedBlocks = 0, outOfMemory = 0;
+			for (step = 0; step < steps; step++)
+			{
+				const uint32_t action = random(100);
+				if (action < 2) { releasedBlocks += defragment(); defragments++; }
+				else if (action < 52 || live.empty()) { if (!allocate()) { outOfMemory++; } }
+				else { release(random(static_cast<uint32_t>(live.size()))); }
+				// long phases of growth and shrinking leave the blocks fragmented
+				if (step % 20000 == 10000) { while (live.size() > 50) { release(random(static_cast<uint32_t>(live.size()))); } }
+				check();
+			}
+			std::cout << steps << " steps, " << defragments << " defragment passes released " << releasedBlocks << " blocks, "
+				<< outOfMemory << " allocations ran out of memory, " << live.size() << " live, " << allocator.getNumBlocks() << " blocks\n";
+			while (!live.empty()) { release(static_cast<uint32_t>(live.size() - 1)); check(); }
+			if (allocator.getNumAllocs() != 0) { fail("allocations left after everything was freed"); }
+		}
+
+	private:
+		std::mt19937 rng;
+		FakeDeviceMemory driver;
+		DeviceMemoryAllocator allocator;
+		std::vector<std::unique_ptr<Resource>> live;
+		uint32_t step = 0;
+
+		uint32_t random(const uint32_t& range) { return static_cast<uint32_t>(rng() % range); }
+
+		std::string where() const { return "step " + std::to_string(step) + ": "; }
+
+		void verifyContents(const Resource& r)
+		{
+			const auto* bytes = static_cast<const uint8_t*>(r.allocation.mapped);
+			if (!bytes) { return; }
+			for (VkDeviceSize i = 0; i < r.allocation.size; i++)
+			{
+				if (bytes[i] != r.pattern) { fail(where() + "allocation contents were overwritten at byte " + std::to_string(i)); }
+			}
+		}
+
+		bool allocate()
+		{
+			auto r = std::make_unique<Resource>();
+			// mostly small resources, some medium, a few large enough to get a dedicated block
+			const uint32_t sizeClass = random(100);
+			const VkDeviceSize size = sizeClass < 70 ? 1 + random(4096) : sizeClass < 97 ? 1 + random(1u << 20) : 1 + random(8u << 20);
+			r->requirements.size = size;
+			r->requirements.alignment = 1ull << random(13);
+			r->memoryType = random(3);
+			r->requirements.memoryTypeBits = 1u << r->memoryType;
+			const VkMemoryPropertyFlags properties = r->memoryType == 0 ? VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+				: r->memoryType == 1 ? VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+				: VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+			const bool linear = random(3) != 0;
+			const bool dedicated = random(100) == 0;
+			try { allocator.alloc(r->allocation, r->requirements, properties, linear, dedicated); }
+			catch (const std::runtime_error& e)
+			{
+				if (std::string(e.what()).find("out of device memory") == std::string::npos) { throw; }
+				return false; // the heap is full, the allocator must still be consistent
+			}
+
+			const Allocation& a = r->allocation;
+			if (a.memoryType != r->memoryType) { fail(where() + "allocation in the wrong memory type"); }
+			if (a.size < size) { fail(where() + "allocation smaller than requested"); }
+			VkDeviceSize alignment = r->requirements.alignment;
+			if (r->memoryType == 2) { alignment = std::max(alignment, FakeDeviceMemory::ATOM_SIZE); }
+			if (a.offset % alignment != 0) { fail(where() + "allocation offset " + std::to_string(a.offset) + " not aligned to " + std::to_string(alignment)); }
+			if (a.offset + a.size > driver.getBlockSize(a.memoryBlockHandle)) { fail(where() + "allocation exceeds its block"); }
+			if ((a.mapped != nullptr) != (r->memoryType != 0)) { fail(where() + "mapping does not match the memory type"); }
+			if (a.mapped && a.mapped != driver.getBlockData(a.memoryBlockHandle) + a.offset) { fail(where() + "mapped pointer is not block + offset"); }
+			if (a.mapped)
+			{
+				r->pattern = static_cast<uint8_t>(random(255) + 1);
+				std::memset(a.mapped, r->pattern, a.size);
+			}
+			allocator.setUserData(a, r.get());
+			live.push_back(std::move(r));
+			return true;
+		}
+
+		void release(const uint32_t& index)
+		{
+			verifyContents(*live[index]);
+			allocator.free(live[index]->allocation);
+			if (live[index]->allocation.memoryBlockHandle != VK_NULL_HANDLE) { fail(where() + "free does not reset the allocation"); }
+			live[index] = std::move(live.back());
+			live.pop_back();
+		}
+
+		uint32_t defragment()
+		{
+			const VkDeviceSize budget = random(4) == 0 ? VK_WHOLE_SIZE : VkDeviceSize(1 + random(16u << 20));
+			const uint32_t blocksBefore = allocator.getNumBlocks();
+			const uint32_t released = allocator.defragment([&](const Allocation& from, const Allocation& to, void* userData)
+				{
+					Resource* r = static_cast<Resource*>(userData);
+					if (!r) { fail(where() + "moved allocation without user data"); }
+					const Allocation& a = r->allocation;
+					if (a.memoryBlockHandle != from.memoryBlockHandle || a.offset != from.offset || a.size != from.size)
+					{ fail(where() + "move source does not match the owner's allocation"); }
+					if (to.size != from.size || to.memoryType != from.memoryType || to.linear != from.linear)
+					{ fail(where() + "move target differs in size or kind"); }
+					if (to.memoryBlockHandle == from.memoryBlockHandle) { fail(where() + "allocation moved within its own block"); }
+					// some owners cannot be moved right now
+					if (random(10) == 0) { return false; }
+					verifyContents(*r);
+					if (from.mapped) { std::memcpy(to.mapped, from.mapped, from.size); }
+					r->allocation = to;
+					return true;
+				}, budget);
+			if (allocator.getNumBlocks() != blocksBefore - released) { fail(where() + "defragment miscounts released blocks"); }
+			return released;
+		}
+
+		void check()
+		{
+			try { allocator.validate(); }
+			catch (const std::runtime_error& e) { fail(where() + e.what()); }
+			if (allocator.getNumBlocks() != driver.getBlockCount()) { fail(where() + "allocator and driver disagree on the block count"); }
+			if (allocator.getNumAllocs() != live.size()) { fail(where() + "allocation count is off"); }
+
+			// live allocations of one block must not overlap
+			std::map<std::pair<uint64_t, VkDeviceSize>, const Resource*> ranges;
+			for (const auto& r : live)
+			{
+				uint64_t block = 0;
+				std::memcpy(&block, &r->allocation.memoryBlockHandle, sizeof(r->allocation.memoryBlockHandle));
+				ranges.emplace(std::make_pair(block, r->allocation.offset), r.get());
+			}
+			const Resource* previous = nullptr;
+			uint64_t previousBlock = 0;
+			for (const auto& [key, r] : ranges)
+			{
+				if (previous && previousBlock == key.first && previous->allocation.offset + previous->allocation.size > key.second)
+				{ fail(where() + "allocations overlap"); }
+				previous = r;
+				previousBlock = key.first;
+			}
+			// a sample of the contents, the full pattern is checked when allocations are moved or freed
+			for (const auto& r : live)
+			{
+				const auto* bytes = static_cast<const uint8_t*>(r->allocation.mapped);
+				if (!bytes) { continue; }
+				if (bytes[0] != r->pattern || bytes[r->allocation.size - 1] != r->pattern || bytes[r->allocation.size / 2] != r->pattern)
+				{ fail(where() + "allocation contents were overwritten"); }
+			}
+		}
+	};
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t steps = 200000;
+	uint32_t seed = 1;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		const uint32_t value = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+		if (std::strcmp(argv[i], "--steps") == 0) { steps = value; }
+		else if (std::strcmp(argv[i], "--seed") == 0) { seed = value; }
+		else
+		{
+			std::cerr << "usage: AllocatorFuzz [--steps <n>] [--seed <n>]\n";
+			return 1;
+		}
+	}
+
+	try
+	{
+		auto fuzzer = std::make_unique<Fuzzer>(seed);
+		fuzzer->run(steps);
+	}
+	catch (const std::exception& e)
+	{
+		std::cout << "FAILED (seed " << seed << "): " << e.what() << "\n";
+		return 1;
+	}
+	std::cout << "all checks passed\n";
+	return 0;
+}
@@ -0,0 +1,124 @@
+/*	headless job system benchmark, a synthetic per-frame update of many actors (integrate motion, build a world matrix,
+	test against a view volume) spread with JobSystem::parallelFor over 1..N threads,
+	usage: JobBenchmark [--actors <count>] [--frames <count>] [--threads <max>]
+	one thread runs the update directly on the calling thread, so it includes no scheduling overhead */
+#include "Core/Jobs/JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	struct Actor
+	{
+		float position[3];
+		float velocity[3];
+		float rotation[3];
+		float spin[3];
+		float world[16];
+		bool visible;
+	};
+
+	// roughly the per-actor work of a game tick: integration, a rotation-scale-translation matrix and a cull test
+	void updateActors(std::vector<Actor>& actors, const uint32_t& begin, const uint32_t& end, const float& dt)
+	{
+		for (uint32_t i = begin; i < end; i++)
+		{
+			Actor& a = actors[i];
+			for (int k = 0; k < 3; k++)
+			{
+				a.velocity[k] -= a.position[k] * 0.01f * dt; // pulled towards the origin, keeps positions bounded
+				a.position[k] += a.velocity[k] * dt;
+				a.rotation[k] = std::fmod(a.rotation[k] + a.spin[k] * dt, 6.2831853f);
+			}
+			const float c1 = std::cos(a.rotation[1]), s1 = std::sin(a.rotation[1]);
+			const float c2 = std::cos(a.rotation[0]), s2 = std::sin(a.rotation[0]);
+			const float c3 = std::cos(a.rotation[2]), s3 = std::sin(a.rotation[2]);
+			float* m = a.world;
+			m[0] = c1 * c3 + s1 * s2 * s3;	m[1] = c2 * s3;	m[2] = c1 * s2 * s3 - c3 * s1;	m[3] = 0.f;
+			m[4] = c3 * s1 * s2 - c1 * s3;	m[5] = c2 * c3;	m[6] = c1 * c3 * s2 + s1 * s3;	m[7] = 0.f;
+			m[8] = c2 * s1;					m[9] = -s2;		m[10] = c1 * c2;				m[11] = 0.f;
+			m[12] = a.position[0];			m[13] = a.position[1];	m[14] = a.position[2];	m[15] = 1.f;
+			const float d = a.position[0] * 0.577f + a.position[1] * 0.577f + a.position[2] * 0.577f;
+			a.visible = d > -50.f && std::abs(a.position[0]) < 400.f;
+		}
+	}
+
+	std::vector<Actor> makeActors(const uint32_t& count)
+	{
+		std::mt19937 rng(1);
+		std::uniform_real_distribution<float> u(-500.f, 500.f);
+		std::vector<Actor> actors(count);
+		for (auto& a : actors)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				a.position[k] = u(rng);
+				a.velocity[k] = u(rng) * 0.01f;
+				a.rotation[k] = 0.f;
+				a.spin[k] = u(rng) * 0.002f;
+			}
+		}
+		return actors;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t actorCount = 100000;
+	uint32_t frames = 200;
+	uint32_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		const uint32_t value = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+		if (std::strcmp(argv[i], "--actors") == 0) { actorCount = value; }
+		else if (std::strcmp(argv[i], "--frames") == 0) { frames = value; }
+		else if (std::strcmp(argv[i], "--threads") == 0) { maxThreads = std::max(1u, value); }
+		else
+		{
+			std::cerr << "usage: JobBenchmark [--actors <count>] [--frames <count>] [--threads <max>]\n";
+			return 1;
+		}
+	}
+
+	using namespace EngineCore;
+	using clock = std::chrono::steady_clock;
+	const float dt = 1.f / 60.f;
+	std::cout << actorCount << " actors, " << frames << " frames\n";
+	double singleThreaded = 0.0;
+	for (uint32_t threads = 1; threads <= maxThreads; threads++)
+	{
+		std::vector<Actor> actors = makeActors(actorCount);
+		double ms = 0.0;
+		if (threads == 1)
+		{
+			const auto start = clock::now();
+			for (uint32_t f = 0; f < frames; f++) { updateActors(actors, 0, actorCount, dt); }
+			ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+			singleThreaded = ms;
+		}
+		else
+		{
+			// workers plus the calling thread, which helps while it waits
+			JobSystem jobs{ threads - 1 };
+			const auto start = clock::now();
+			for (uint32_t f = 0; f < frames; f++)
+			{
+				jobs.parallelFor(actorCount, 512, [&](uint32_t begin, uint32_t end) { updateActors(actors, begin, end, dt); });
+			}
+			ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+		}
+		uint32_t visible = 0;
+		for (const auto& a : actors) { visible += a.visible ? 1 : 0; }
+		std::cout << threads << " thread(s): " << ms / frames << " ms/frame, speedup " << singleThreaded / ms
+			<< "x, " << visible << " visible\n";
+	}
+	return 0;
+}
@@ -0,0 +1,64 @@
+/*	offline mesh cooker, converts OBJ files into cooked meshes (see CookedMesh) ahead of time,
+	usage: MeshCooker [--format float|packed|packedcolor] [--lods <levels>] [--no-optimize] <file.obj>... */
+#include "Core/Mesh/CookedMesh.h"
+#include "Core/Jobs/JobSystem.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+	using namespace EngineCore;
+	VertexFormat format = VertexFormat::Float;
+	bool optimize = true;
+	// must match EngineRenderSettings::meshLodLevels, otherwise the engine cooks the file again
+	uint32_t lodLevels = 4;
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--no-optimize") == 0) { optimize = false; }
+		else if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+		{
+			const std::string name = argv[++i];
+			if (name == "float") { format = VertexFormat::Float; }
+			else if (name == "packed") { format = VertexFormat::Packed; }
+			else if (name == "packedcolor") { format = VertexFormat::PackedColor; }
+			else { std::cerr << "unknown vertex format " << name << "\n"; return 1; }
+		}
+		else if (std::strcmp(argv[i], "--lods") == 0 && i + 1 < argc)
+		{
+			const int levels = std::atoi(argv[++i]);
+			if (levels < 1 || levels > static_cast<int>(MeshGeometry::MAX_LODS))
+			{ std::cerr << "level count must be between 1 and " << MeshGeometry::MAX_LODS << "\n"; return 1; }
+			lodLevels = static_cast<uint32_t>(levels);
+		}
+		else { paths.push_back(argv[i]); }
+	}
+	if (paths.empty())
+	{
+		std::cerr << "usage: MeshCooker [--format float|packed|packedcolor] [--lods <levels>] [--no-optimize] <file.obj>...\n";
+		return 1;
+	}
+
+	JobSystem jobs{};
+	int failed = 0;
+	for (const auto& path : paths)
+	{
+		try
+		{
+			std::ifstream file(path, std::ios::binary);
+			if (!file) { throw std::runtime_error("failed to open mesh file: " + path); }
+			const std::vector<char> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+			ECS::Primitive::MeshBuilder builder{};
+			CookedMesh::cook(path, contents, format, optimize, lodLevels, builder, &jobs);
+		}
+		catch (const std::exception& e) { std::cerr << e.what() << "\n"; failed++; }
+	}
+	return failed == 0 ? 0 : 1;
+}
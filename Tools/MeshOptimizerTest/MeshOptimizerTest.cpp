@@ -0,0 +1,190 @@
+/*	deterministic checks of MeshOptimizer on generated meshes (a cube with split faces and grids in scrambled triangle order),
+	vertex cache ACMR/ATVR must improve, every pass must keep the set of triangles (with winding) intact,
+	usage: MeshOptimizerTest, prints the measured numbers and returns non-zero if a check fails */
+#include "Core/Mesh/MeshOptimizer.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	using namespace EngineCore;
+
+	uint32_t failures = 0;
+
+	void check(const bool& condition, const std::string& what)
+	{
+		if (condition) { return; }
+		std::cout << "FAILED: " << what << "\n";
+		failures++;
+	}
+
+	struct Vertex
+	{
+		float position[3];
+		// identifies the source vertex after optimizeVertexFetch moved it
+		uint32_t id;
+	};
+
+	struct Mesh
+	{
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+	};
+
+	// xorshift, same sequence on every platform (std::shuffle is not)
+	struct Random
+	{
+		uint32_t state;
+		uint32_t next() { state ^= state << 13; state ^= state >> 17; state ^= state << 5; return state; }
+	};
+
+	// shuffles the triangles (not the indices within them) so the input has poor cache locality
+	void scrambleTriangles(std::vector<uint32_t>& indices, const uint32_t& seed)
+	{
+		Random r{ seed };
+		const uint32_t triangles = static_cast<uint32_t>(indices.size() / 3);
+		for (uint32_t i = triangles; i > 1; i--)
+		{
+			const uint32_t j = r.next() % i;
+			for (uint32_t k = 0; k < 3; k++) { std::swap(indices[(i - 1) * 3 + k], indices[j * 3 + k]); }
+		}
+	}
+
+	// width x height quads, two triangles each
+	Mesh makeGrid(const uint32_t& width, const uint32_t& height)
+	{
+		Mesh m{};
+		for (uint32_t y = 0; y <= height; y++)
+		{
+			for (uint32_t x = 0; x <= width; x++)
+			{ m.vertices.push_back({ { static_cast<float>(x), static_cast<float>(y), 0.f }, static_cast<uint32_t>(m.vertices.size()) }); }
+		}
+		for (uint32_t y = 0; y < height; y++)
+		{
+			for (uint32_t x = 0; x < width; x++)
+			{
+				const uint32_t a = y * (width + 1) + x;
+				const uint32_t b = a + 1;
+				const uint32_t c = a + width + 1;
+				const uint32_t d = c + 1;
+				m.indices.insert(m.indices.end(), { a, b, d, a, d, c });
+			}
+		}
+		return m;
+	}
+
+	// 24 vertices, every face has its own 4 (split normals), like Primitive::MeshBuilder::makeCubeMesh
+	Mesh makeCube()
+	{
+		Mesh m{};
+		const float s = 0.5f;
+		const std::array<std::array<std::array<float, 3>, 4>, 6> faces =
+		{ {
+			{ { { -s, -s, -s }, { -s, s, s }, { -s, -s, s }, { -s, s, -s } } },
+			{ { { s, -s, -s }, { s, s, s }, { s, -s, s }, { s, s, -s } } },
+			{ { { -s, -s, -s }, { s, -s, s }, { -s, -s, s }, { s, -s, -s } } },
+			{ { { -s, s, -s }, { s, s, s }, { -s, s, s }, { s, s, -s } } },
+			{ { { -s, -s, s }, { s, s, s }, { -s, s, s }, { s, -s, s } } },
+			{ { { -s, -s, -s }, { s, s, -s }, { -s, s, -s }, { s, -s, -s } } },
+		} };
+		for (const auto& face : faces)
+		{
+			const uint32_t first = static_cast<uint32_t>(m.vertices.size());
+			for (const auto& p : face) { m.vertices.push_back({ { p[0], p[1], p[2] }, static_cast<uint32_t>(m.vertices.size()) }); }
+			m.indices.insert(m.indices.end(), { first, first + 1, first + 2, first, first + 3, first + 1 });
+		}
+		return m;
+	}
+
+	/*	triangles as sorted source vertex ids, each rotated so its smallest id comes first, which keeps the winding,
+		two index buffers describe the same surface exactly when these lists are equal */
+	std::vector<std::array<uint32_t, 3>> triangleSet(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+	{
+		std::vector<std::array<uint32_t, 3>> set;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			std::array<uint32_t, 3> t = { vertices[indices[i]].id, vertices[indices[i + 1]].id, vertices[indices[i + 2]].id };
+			while (t[0] > t[1] || t[0] > t[2]) { std::rotate(t.begin(), t.begin() + 1, t.end()); }
+			set.push_back(t);
+		}
+		std::sort(set.begin(), set.end());
+		return set;
+	}
+
+	void testMesh(const std::string& name, Mesh mesh, const float& maxAcmr)
+	{
+		const uint32_t vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+		const auto reference = triangleSet(mesh.vertices, mesh.indices);
+		const auto before = MeshOptimizer::analyzeVertexCache(mesh.indices, vertexCount);
+
+		MeshOptimizer::optimizeVertexCache(mesh.indices, vertexCount);
+		const auto after = MeshOptimizer::analyzeVertexCache(mesh.indices, vertexCount);
+		std::cout << name << ": ACMR " << before.acmr << " -> " << after.acmr << ", ATVR " << before.atvr << " -> " << after.atvr;
+		check(mesh.indices.size() == reference.size() * 3, name + ": optimizeVertexCache changes the index count");
+		check(triangleSet(mesh.vertices, mesh.indices) == reference, name + ": optimizeVertexCache changes the triangle set");
+		check(after.acmr <= before.acmr, name + ": optimizeVertexCache makes ACMR worse");
+		check(after.atvr <= before.atvr, name + ": optimizeVertexCache makes ATVR worse");
+		check(after.acmr <= maxAcmr, name + ": ACMR " + std::to_string(after.acmr) + " above " + std::to_string(maxAcmr));
+		check(after.atvr >= 1.f, name + ": ATVR below 1, every vertex must be transformed at least once");
+
+		MeshOptimizer::optimizeOverdraw(mesh.indices, mesh.vertices[0].position, sizeof(Vertex), vertexCount);
+		const auto overdraw = MeshOptimizer::analyzeVertexCache(mesh.indices, vertexCount);
+		std::cout << ", after overdraw ordering " << overdraw.acmr;
+		check(triangleSet(mesh.vertices, mesh.indices) == reference, name + ": optimizeOverdraw changes the triangle set");
+		check(overdraw.acmr <= after.acmr * 1.05f + 1e-6f, name + ": optimizeOverdraw exceeds its ACMR threshold");
+
+		// an unreferenced vertex at the front must be dropped, the rest must follow the first use order of the indices
+		Vertex unused{ { 1000.f, 1000.f, 1000.f }, UINT32_MAX };
+		mesh.vertices.insert(mesh.vertices.begin(), unused);
+		for (auto& index : mesh.indices) { index++; }
+		const std::vector<uint32_t> orderBefore = mesh.indices;
+		const uint32_t fetched = MeshOptimizer::optimizeVertexFetch(mesh.vertices.data(), sizeof(Vertex),
+																	vertexCount + 1, mesh.indices);
+		mesh.vertices.resize(fetched);
+		std::cout << ", " << fetched << "/" << vertexCount + 1 << " vertices kept\n";
+		check(fetched == vertexCount, name + ": optimizeVertexFetch keeps an unreferenced vertex");
+		check(triangleSet(mesh.vertices, mesh.indices) == reference, name + ": optimizeVertexFetch changes the triangle set");
+		uint32_t nextNew = 0;
+		bool ordered = true;
+		for (const auto& index : mesh.indices)
+		{
+			if (index >= fetched) { ordered = false; break; }
+			if (index == nextNew) { nextNew++; }
+			else if (index > nextNew) { ordered = false; break; }
+		}
+		check(ordered && nextNew == fetched, name + ": optimizeVertexFetch does not order vertices by first use");
+		check(orderBefore.size() == mesh.indices.size(), name + ": optimizeVertexFetch changes the index count");
+		const auto fetchStats = MeshOptimizer::analyzeVertexCache(mesh.indices, fetched);
+		check(fetchStats.acmr == overdraw.acmr, name + ": optimizeVertexFetch changes the triangle order");
+	}
+}
+
+int main()
+{
+	// limits leave headroom over what the optimizer reaches today, they catch regressions rather than tune it
+	testMesh("cube", makeCube(), 2.f);
+	Mesh grid = makeGrid(64, 64);
+	scrambleTriangles(grid.indices, 1);
+	testMesh("grid 64x64 (scrambled)", grid, 0.8f);
+	Mesh strip = makeGrid(500, 3);
+	scrambleTriangles(strip.indices, 7);
+	testMesh("grid 500x3 (scrambled)", strip, 0.8f);
+
+	// the same input must give the same output, run to run
+	Mesh a = makeGrid(32, 32);
+	scrambleTriangles(a.indices, 3);
+	Mesh b = a;
+	MeshOptimizer::optimizeVertexCache(a.indices, static_cast<uint32_t>(a.vertices.size()));
+	MeshOptimizer::optimizeVertexCache(b.indices, static_cast<uint32_t>(b.vertices.size()));
+	check(a.indices == b.indices, "optimizeVertexCache is not deterministic");
+
+	if (failures > 0) { std::cout << failures << " check(s) failed\n"; return 1; }
+	std::cout << "all checks passed\n";
+	return 0;
+}
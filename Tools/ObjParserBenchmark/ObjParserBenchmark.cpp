@@ -0,0 +1,96 @@
+/*	OBJ parsing throughput on a synthetic grid (several million triangles by default, mixed triangles and quads,
+	relative indices, missing attributes), ObjParser::parse (tinyobj, single-threaded) against ObjParser::parseParallel on 2..N threads,
+	usage: ObjParserBenchmark [--side <grid cells per side>] [--threads <max>] [--runs <n>]
+	the input is generated in memory, so disk speed does not enter the numbers */
+#include "Core/Mesh/ObjParser.h"
+#include "Core/Jobs/JobSystem.h"
+#include "Tools/ObjParserTest/SyntheticObj.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	using namespace EngineCore;
+	using Vertex = ECS::Primitive::Vertex;
+
+	// best of the runs in seconds, parseOnce fills the vertex list and returns false if the input was declined
+	template<typename Parse>
+	double measure(const uint32_t& runs, std::vector<Vertex>& vertices, Parse parseOnce)
+	{
+		using clock = std::chrono::steady_clock;
+		double best = 0.0;
+		for (uint32_t i = 0; i < runs; i++)
+		{
+			vertices.clear();
+			const auto start = clock::now();
+			if (!parseOnce()) { return 0.0; }
+			const double seconds = std::chrono::duration<double>(clock::now() - start).count();
+			best = i == 0 ? seconds : std::min(best, seconds);
+		}
+		return best;
+	}
+
+	void report(const char* name, const uint32_t& threads, const double& seconds, const size_t& bytes, const size_t& triangles,
+				const double& reference)
+	{
+		std::cout << name << ", " << threads << " thread(s): " << seconds * 1000.0 << " ms, " << bytes / seconds / 1e6 << " MB/s, "
+			<< triangles / seconds / 1e6 << " M triangles/s";
+		if (reference > 0.0) { std::cout << ", " << reference / seconds << "x tinyobj"; }
+		std::cout << "\n";
+	}
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t side = 1500;
+	uint32_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+	uint32_t runs = 3;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		const uint32_t value = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+		if (std::strcmp(argv[i], "--side") == 0) { side = std::max(1u, value); }
+		else if (std::strcmp(argv[i], "--threads") == 0) { maxThreads = std::max(1u, value); }
+		else if (std::strcmp(argv[i], "--runs") == 0) { runs = std::max(1u, value); }
+		else
+		{
+			std::cerr << "usage: ObjParserBenchmark [--side <grid cells per side>] [--threads <max>] [--runs <n>]\n";
+			return 1;
+		}
+	}
+
+	SyntheticObj::Options options{};
+	options.side = side;
+	options.negativeIndices = true;
+	options.quads = true;
+	options.missingAttributes = true;
+	const std::string obj = SyntheticObj::make(options);
+
+	std::vector<Vertex> reference;
+	const double tinyobj = measure(runs, reference, [&]() { ObjParser::parse(obj.data(), obj.size(), reference); return true; });
+	const size_t triangles = reference.size() / 3;
+	std::cout << obj.size() / (1024 * 1024) << " MB, " << triangles << " triangles, best of " << runs << "\n";
+	report("tinyobj (parse)", 1, tinyobj, obj.size(), triangles, 0.0);
+
+	std::vector<Vertex> vertices;
+	// a job system has at least one worker next to the calling thread, which helps while it waits
+	for (uint32_t threads = 2; threads <= std::max(2u, maxThreads); threads++)
+	{
+		JobSystem jobs{ threads - 1 };
+		const double seconds = measure(runs, vertices, [&]() { return ObjParser::parseParallel(obj.data(), obj.size(), jobs, vertices); });
+		if (seconds == 0.0) { std::cout << "parseParallel declined the input\n"; return 1; }
+		if (vertices.size() != reference.size()
+			|| std::memcmp(vertices.data(), reference.data(), sizeof(Vertex) * vertices.size()) != 0)
+		{
+			std::cout << "parseParallel output differs from parse\n";
+			return 1;
+		}
+		report("parseParallel", threads, seconds, obj.size(), triangles, tinyobj);
+	}
+	return 0;
+}
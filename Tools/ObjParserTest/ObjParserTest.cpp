@@ -0,0 +1,146 @@
+/*	compares the OBJ parsers on generated inputs: ObjParser::parseFile (the original tinyobj file loader),
+	ObjParser::parse (tinyobj on memory) and ObjParser::parseParallel must produce byte-identical vertices,
+	parseParallel may only decline inputs it documents (polygons above 4 corners, lines, points, forward references),
+	usage: ObjParserTest [--threads <count>] [--cases <random cases>], returns non-zero if a check fails */
+#include "Core/Mesh/ObjParser.h"
+#include "Core/Jobs/JobSystem.h"
+#include "Tools/ObjParserTest/SyntheticObj.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	using namespace EngineCore;
+	using Vertex = ECS::Primitive::Vertex;
+
+	uint32_t failures = 0;
+
+	void check(const bool& condition, const std::string& what)
+	{
+		if (condition) { return; }
+		std::cout << "FAILED: " << what << "\n";
+		failures++;
+	}
+
+	// index of the first differing vertex, or -1 if both lists are identical
+	int64_t firstDifference(const std::vector<Vertex>& a, const std::vector<Vertex>& b)
+	{
+		const size_t count = std::min(a.size(), b.size());
+		for (size_t i = 0; i < count; i++)
+		{
+			if (std::memcmp(&a[i], &b[i], sizeof(Vertex)) != 0) { return static_cast<int64_t>(i); }
+		}
+		return a.size() == b.size() ? -1 : static_cast<int64_t>(count);
+	}
+
+	void compare(const std::string& name, const std::string& obj, JobSystem& jobs, const bool& expectParallel)
+	{
+		// the file loader reads from disk, so it sees the input exactly like the engine did before parse existed
+		const std::filesystem::path path = std::filesystem::temp_directory_path() / "ObjParserTest.obj";
+		{
+			std::ofstream out(path, std::ios::binary | std::ios::trunc);
+			out.write(obj.data(), static_cast<std::streamsize>(obj.size()));
+		}
+		std::vector<Vertex> fromFile, fromMemory;
+		bool referenceThrew = false;
+		try { ObjParser::parseFile(path.string(), fromFile); }
+		catch (const std::exception&) { referenceThrew = true; }
+		std::filesystem::remove(path);
+		try { ObjParser::parse(obj.data(), obj.size(), fromMemory); }
+		catch (const std::exception&) { check(referenceThrew, name + ": parse throws, parseFile does not"); return; }
+		check(!referenceThrew, name + ": parseFile throws, parse does not");
+		const int64_t memoryDifference = firstDifference(fromFile, fromMemory);
+		check(memoryDifference < 0, name + ": parse differs from parseFile at vertex " + std::to_string(memoryDifference));
+
+		// parseParallel appends, existing contents must survive a declined input
+		const Vertex marker{ { 1.f, 2.f, 3.f }, {}, {}, {} };
+		std::vector<Vertex> parallel{ marker };
+		const bool handled = ObjParser::parseParallel(obj.data(), obj.size(), jobs, parallel);
+		std::cout << name << ": " << obj.size() / 1024 << " KB, " << fromMemory.size() / 3 << " triangles, parallel "
+			<< (handled ? "handled" : "declined") << "\n";
+		check(handled == expectParallel, name + (expectParallel ? ": parseParallel declines a supported input"
+																: ": parseParallel accepts an unsupported input"));
+		check(!parallel.empty() && std::memcmp(&parallel[0], &marker, sizeof(Vertex)) == 0,
+			name + ": parseParallel overwrites existing vertices");
+		if (!handled)
+		{
+			check(parallel.size() == 1, name + ": parseParallel changes the vertices of a declined input");
+			return;
+		}
+		parallel.erase(parallel.begin());
+		const int64_t parallelDifference = firstDifference(fromMemory, parallel);
+		check(parallelDifference < 0, name + ": parseParallel differs from parse at vertex " + std::to_string(parallelDifference)
+			+ " (" + std::to_string(parallel.size()) + " vs " + std::to_string(fromMemory.size()) + " vertices)");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t threads = 4;
+	uint32_t cases = 24;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		const uint32_t value = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+		if (std::strcmp(argv[i], "--threads") == 0) { threads = std::max(2u, value); }
+		else if (std::strcmp(argv[i], "--cases") == 0) { cases = value; }
+		else
+		{
+			std::cerr << "usage: ObjParserTest [--threads <count>] [--cases <random cases>]\n";
+			return 1;
+		}
+	}
+	// more threads than cores still splits the input into as many chunks, which is what matters here
+	JobSystem jobs{ threads - 1 };
+
+	// small hand-written inputs, mostly at the edges of the syntax
+	compare("empty", "", jobs, true);
+	compare("comments only", "# nothing\n\n   \t\n# here", jobs, true);
+	compare("no final line break", "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3", jobs, true);
+	compare("degenerate face", "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2\nf 1 2 3\n", jobs, true);
+	compare("carriage returns only", "v 0 0 0\rv 1 0 0\rv 0 1 0\rvt 0.5 0.5\rf 1/1 2/1 3/1\r", jobs, true);
+	compare("relative indices", "v 0 0 0\nv 1 0 0\nv 0 1 0\nvn 0 0 1\nf -3//-1 -2//-1 -1//-1\n", jobs, true);
+	compare("quad diagonal", "v 0 0 0\nv 4 0 0\nv 4 1 0\nv 0 1 0\nf 1 2 3 4\nv 0 0 1\nv 1 0 1\nv 1 4 1\nv 0 4 1\nf 5 6 7 8\n", jobs, true);
+	compare("pentagon", "v 0 0 0\nv 1 0 0\nv 2 1 0\nv 1 2 0\nv 0 1 0\nf 1 2 3 4 5\n", jobs, false);
+	compare("forward reference", "f 1 2 3 4\nv 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n", jobs, false);
+	compare("line element", "v 0 0 0\nv 1 0 0\nv 0 1 0\nl 1 2\nf 1 2 3\n", jobs, false);
+
+	// generated grids large enough to be split into several chunks, every feature on its own and then mixed at random
+	SyntheticObj::Options base{};
+	base.side = 260;
+	auto with = [&](auto set) { SyntheticObj::Options o = base; set(o); return o; };
+	compare("grid", SyntheticObj::make(base), jobs, true);
+	compare("grid, negative indices", SyntheticObj::make(with([](auto& o) { o.negativeIndices = true; })), jobs, true);
+	compare("grid, quads", SyntheticObj::make(with([](auto& o) { o.quads = true; })), jobs, true);
+	compare("grid, missing vt/vn", SyntheticObj::make(with([](auto& o) { o.missingAttributes = true; })), jobs, true);
+	compare("grid, crlf", SyntheticObj::make(with([](auto& o) { o.crlf = true; })), jobs, true);
+	compare("grid, interleaved", SyntheticObj::make(with([](auto& o) { o.interleave = true; o.negativeIndices = true; })), jobs, true);
+	compare("grid, noise", SyntheticObj::make(with([](auto& o) { o.noise = true; o.numberFormats = true; })), jobs, true);
+	compare("grid, polygons", SyntheticObj::make(with([](auto& o) { o.polygons = true; })), jobs, false);
+
+	SyntheticObj::Random r{ 12345 };
+	for (uint32_t c = 0; c < cases; c++)
+	{
+		SyntheticObj::Options o{};
+		o.side = 20 + r.next() % 240;
+		o.seed = c + 1;
+		o.negativeIndices = r.chance(50);
+		o.quads = r.chance(50);
+		o.polygons = r.chance(20);
+		o.missingAttributes = r.chance(50);
+		o.crlf = r.chance(30);
+		o.interleave = r.chance(50);
+		o.noise = r.chance(50);
+		o.numberFormats = r.chance(50);
+		compare("random case " + std::to_string(c), SyntheticObj::make(o), jobs, !o.polygons);
+	}
+
+	if (failures > 0) { std::cout << failures << " check(s) failed\n"; return 1; }
+	std::cout << "all checks passed\n";
+	return 0;
+}
@@ -0,0 +1,156 @@
+#pragma once
+
+// std
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+/*	generates OBJ text of a randomly displaced grid for the ObjParser test and benchmark,
+	the features switch on the syntax the parsers have to agree on */
+namespace SyntheticObj
+{
+	struct Options
+	{
+		// grid cells per side, 2 * side * side triangles when only triangles are written
+		uint32_t side = 64;
+		uint32_t seed = 1;
+		// random corners use indices relative to the end of the element list (-1 is the last one)
+		bool negativeIndices = false;
+		// random cells are written as one quad instead of two triangles
+		bool quads = false;
+		// random cells are written as a pentagon, parseParallel leaves these to the reference parser
+		bool polygons = false;
+		// random faces use "v", "v/t" or "v//n" instead of "v/t/n"
+		bool missingAttributes = false;
+		bool crlf = false;
+		// faces follow each grid row instead of coming after all elements, so chunks mix elements and faces
+		bool interleave = false;
+		// comments, groups, materials, smoothing groups, tabs and repeated spaces
+		bool noise = false;
+		// numbers in exponent and integer notation next to plain decimals
+		bool numberFormats = false;
+	};
+
+	// xorshift, the same sequence on every platform
+	struct Random
+	{
+		uint32_t state;
+		explicit Random(const uint32_t& seed) : state{ seed * 2654435761u + 1u } {}
+		uint32_t next() { state ^= state << 13; state ^= state >> 17; state ^= state << 5; return state; }
+		bool chance(const uint32_t& percent) { return next() % 100 < percent; }
+		float range(const float& low, const float& high) { return low + (high - low) * static_cast<float>(next() % 1000001) / 1000000.f; }
+	};
+
+	inline std::string make(const Options& o)
+	{
+		Random r{ o.seed };
+		std::string s;
+		s.reserve(static_cast<size_t>(o.side + 1) * (o.side + 1) * 96);
+		const char* eol = o.crlf ? "\r\n" : "\n";
+		const char* gap = o.noise ? " \t " : " ";
+		char buffer[256];
+
+		auto number = [&](const float& v)
+		{
+			const uint32_t format = o.numberFormats ? r.next() % 4 : 0;
+			if (format == 1) { std::snprintf(buffer, sizeof(buffer), "%e", v); }
+			else if (format == 2) { std::snprintf(buffer, sizeof(buffer), "%d", static_cast<int>(v)); }
+			else if (format == 3) { std::snprintf(buffer, sizeof(buffer), "%+.3f", v); }
+			else { std::snprintf(buffer, sizeof(buffer), "%.6f", v); }
+			s += buffer;
+		};
+		// counts written so far, negative indices are relative to them
+		uint32_t counts[3] = { 0, 0, 0 }; // positions, texcoords, normals
+		auto index = [&](const uint32_t& k, const uint32_t& oneBased)
+		{
+			if (o.negativeIndices && r.chance(50)) { std::snprintf(buffer, sizeof(buffer), "%d", static_cast<int>(oneBased) - static_cast<int>(counts[k]) - 1); }
+			else { std::snprintf(buffer, sizeof(buffer), "%u", oneBased); }
+			s += buffer;
+		};
+		const uint32_t rowVertices = o.side + 1;
+		// one normal per row, so faces spanning two rows reference two normals
+		auto corner = [&](const uint32_t& vertex, const uint32_t& attributes)
+		{
+			const uint32_t v = vertex + 1;
+			const uint32_t n = vertex / rowVertices + 1;
+			index(0, v);
+			if (attributes == 1) { s += "/"; index(1, v); }
+			else if (attributes == 2) { s += "//"; index(2, n); }
+			else if (attributes == 3) { s += "/"; index(1, v); s += "/"; index(2, n); }
+		};
+		auto face = [&](const uint32_t* vertices, const uint32_t& count)
+		{
+			const uint32_t attributes = o.missingAttributes ? r.next() % 4 : 3;
+			s += "f";
+			for (uint32_t i = 0; i < count; i++) { s += (o.noise && r.chance(10)) ? gap : " "; corner(vertices[i], attributes); }
+			if (o.noise && r.chance(5)) { s += " \t"; }
+			s += eol;
+		};
+		auto cells = [&](const uint32_t& y)
+		{
+			if (o.noise && r.chance(30))
+			{
+				std::snprintf(buffer, sizeof(buffer), "g row%u%susemtl material%u%ss %u%s# row %u%s", y, eol, y % 3, eol, y % 2, eol, y, eol);
+				s += buffer;
+			}
+			for (uint32_t x = 0; x < o.side; x++)
+			{
+				const uint32_t a = y * rowVertices + x;
+				const uint32_t b = a + 1;
+				const uint32_t c = a + rowVertices;
+				const uint32_t d = c + 1;
+				if (o.polygons && x + 1 < o.side && r.chance(5))
+				{
+					// covers this cell and the next one, which is written as usual
+					const uint32_t pentagon[5] = { a, b, b + 1, d + 1, c };
+					face(pentagon, 5);
+				}
+				else if (o.quads && r.chance(40))
+				{
+					const uint32_t quad[4] = { a, b, d, c };
+					face(quad, 4);
+					continue;
+				}
+				const uint32_t first[3] = { a, b, d };
+				const uint32_t second[3] = { a, d, c };
+				face(first, 3);
+				face(second, 3);
+			}
+		};
+
+		s += "# synthetic grid";
+		s += eol;
+		s += "o grid";
+		s += eol;
+		for (uint32_t y = 0; y <= o.side; y++)
+		{
+			for (uint32_t x = 0; x <= o.side; x++)
+			{
+				s += "v";
+				s += gap; number(static_cast<float>(x) + r.range(-0.3f, 0.3f));
+				s += gap; number(static_cast<float>(y) + r.range(-0.3f, 0.3f));
+				s += gap; number(r.range(-100.f, 100.f));
+				s += eol;
+				counts[0]++;
+			}
+			for (uint32_t x = 0; x <= o.side; x++)
+			{
+				s += "vt ";
+				number(static_cast<float>(x) / o.side);
+				s += " ";
+				number(static_cast<float>(y) / o.side);
+				s += eol;
+				counts[1]++;
+			}
+			s += "vn ";
+			number(r.range(-1.f, 1.f)); s += " "; number(r.range(-1.f, 1.f)); s += " "; number(r.range(-1.f, 1.f));
+			s += eol;
+			counts[2]++;
+			if (o.noise && r.chance(10)) { s += eol; }
+			if (o.interleave && y > 0) { cells(y - 1); }
+		}
+		if (!o.interleave) { for (uint32_t y = 0; y < o.side; y++) { cells(y); } }
+		return s;
+	}
+
+} // namespace SyntheticObj
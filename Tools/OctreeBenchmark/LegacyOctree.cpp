@@ -0,0 +1,227 @@
+#include "Tools/OctreeBenchmark/LegacyOctree.h"
+
+#include <cassert>
+
+namespace LegacyWorld
+{
+	Octree::Octree(const OctreeProperties& treeProps) : props{ treeProps }
+	{
+		const uint32_t w = treeProps.rootWidth;
+		if (w == 0 || (w & (w - 1)) != 0) { throw std::runtime_error("octree width must be a power of two"); }
+		if (w > SECTOR_MAX) { throw std::runtime_error("octree width cannot exceed SECTOR_MAX"); }
+		if (treeProps.branchThreshold == 0) { throw std::runtime_error("octree branch threshold must be above zero"); }
+		root = new Branch(); // centered at the origin
+	}
+
+	Octree::~Octree()
+	{
+		// objects outlive the tree, make sure they don't try to report back to it
+		unlinkAllObjects(root);
+		delete root;
+	}
+
+	void Octree::Branch::destroyAllElements()
+	{
+		auto* next = firstElement;
+		while (next)
+		{
+			auto* p = next;
+			next = next->next;
+			delete p;
+		}
+		firstElement = nullptr;
+		numElements = 0;
+	}
+
+	void Octree::Branch::addElement(Element* element)
+	{
+		// push front, element order within a branch is irrelevant
+		element->prev = nullptr;
+		element->next = firstElement;
+		if (firstElement) { firstElement->prev = element; }
+		firstElement = element;
+		element->branch = this;
+		numElements++;
+	}
+
+	void Octree::Branch::unlinkElement(Element* element)
+	{
+		assert(element->branch == this && "octree element unlinked from wrong branch");
+		if (element->prev) { element->prev->next = element->next; }
+		else { firstElement = element->next; }
+		if (element->next) { element->next->prev = element->prev; }
+		element->prev = nullptr;
+		element->next = nullptr;
+		element->branch = nullptr;
+		numElements--;
+	}
+
+	void Octree::insert(PhysicalElementInterface* obj)
+	{
+		assert(obj && "cannot insert null object into octree");
+		if (obj->linkedTree == this) { relocate(obj); return; }
+		assert(!obj->linkedTree && "object is already in another octree");
+
+		Element* e = new Element();
+		e->linkedObj = obj;
+		e->bounds = obj->getBounds();
+		obj->linkedTree = this;
+		obj->linkedElement = e;
+		numElements++;
+		placeElement(e, root);
+	}
+
+	void Octree::remove(PhysicalElementInterface* obj)
+	{
+		if (!obj || obj->linkedTree != this) { return; }
+		Element* e = obj->linkedElement;
+		Branch* b = e->branch;
+		b->unlinkElement(e);
+		delete e;
+		obj->linkedTree = nullptr;
+		obj->linkedElement = nullptr;
+		numElements--;
+		tryMerge(b);
+	}
+
+	void Octree::relocate(PhysicalElementInterface* obj)
+	{
+		if (!obj || obj->linkedTree != this) { return; }
+		Element* e = obj->linkedElement;
+		e->bounds = obj->getBounds();
+		Branch* b = e->branch;
+
+		// common case, the element still belongs in its current branch
+		const bool fitsHere = (b == root) || fitsInBranch(*b, e->bounds);
+		if (fitsHere && (b->isLeaf() || !fitsInBranch(*b->subBranches[getChildIndex(*b, e->bounds.getCenter())], e->bounds)))
+		{ return; }
+
+		// walk up until a branch accepts the element, then walk back down from there
+		b->unlinkElement(e);
+		Branch* start = b;
+		while (start != root && !fitsInBranch(*start, e->bounds)) { start = start->parentBranch; }
+		placeElement(e, start);
+		tryMerge(b);
+	}
+
+	void Octree::updateElementPositions()
+	{
+		// gather first, relocation may move elements into branches that have not been visited yet
+		std::vector<PhysicalElementInterface*> objs;
+		objs.reserve(numElements);
+		std::vector<Branch*> stack{ root };
+		while (!stack.empty())
+		{
+			Branch* b = stack.back();
+			stack.pop_back();
+			for (auto& e : *b) { objs.push_back(e.linkedObj); }
+			if (!b->isLeaf()) { for (Branch* sub : b->subBranches) { stack.push_back(sub); } }
+		}
+		for (auto* obj : objs) { relocate(obj); }
+	}
+
+	bool Octree::fitsInBranch(const Branch& b, const BoundingBox& bounds) const
+	{
+		// the center must be inside the cell, and the size must fit within the loose bounds
+		const float half = (float)getBranchWidth(b.level) * 0.5f;
+		const Vec c = bounds.getCenter();
+		if (std::abs(c.x - b.center.x) > half || std::abs(c.y - b.center.y) > half
+			|| std::abs(c.z - b.center.z) > half) { return false; }
+		return bounds.getMaxHalfExtent() <= half;
+	}
+
+	Octree::Branch* Octree::findBranchForBounds(Branch* start, const BoundingBox& bounds) const
+	{
+		Branch* b = start;
+		const Vec c = bounds.getCenter();
+		while (!b->isLeaf())
+		{
+			Branch* sub = b->subBranches[getChildIndex(*b, c)];
+			if (!fitsInBranch(*sub, bounds)) { break; }
+			b = sub;
+		}
+		return b;
+	}
+
+	void Octree::placeElement(Element* e, Branch* start)
+	{
+		Branch* b = findBranchForBounds(start, e->bounds);
+		b->addElement(e);
+		if (b->isLeaf() && b->numElements > props.branchThreshold && canSplit(*b)) { split(b); }
+	}
+
+	void Octree::split(Branch* b)
+	{
+		assert(b->isLeaf() && "cannot split a branch that already has sub-branches");
+		const float quarter = (float)getBranchWidth(b->level) * 0.25f;
+		for (uint32_t i = 0; i < 8; i++)
+		{
+			Branch* sub = new Branch();
+			sub->parentBranch = b;
+			sub->level = b->level + 1;
+			sub->center = b->center + Vec{ (i & 1) ? quarter : -quarter,
+										(i & 2) ? quarter : -quarter, (i & 4) ? quarter : -quarter };
+			b->subBranches[i] = sub;
+		}
+		numBranches += 8;
+
+		// push down all elements that fit in a sub-branch
+		Element* e = b->firstElement;
+		while (e)
+		{
+			Element* next = e->next;
+			Branch* sub = b->subBranches[getChildIndex(*b, e->bounds.getCenter())];
+			if (fitsInBranch(*sub, e->bounds))
+			{
+				b->unlinkElement(e);
+				sub->addElement(e);
+			}
+			e = next;
+		}
+		for (Branch* sub : b->subBranches)
+		{
+			if (sub->numElements > props.branchThreshold && canSplit(*sub)) { split(sub); }
+		}
+	}
+
+	void Octree::tryMerge(Branch* b)
+	{
+		// a leaf that lost elements may allow its parent to absorb all of its siblings
+		Branch* p = b->isLeaf() ? b->parentBranch : b;
+		while (p)
+		{
+			uint32_t count = p->numElements;
+			for (const Branch* sub : p->subBranches)
+			{
+				if (!sub->isLeaf()) { return; }
+				count += sub->numElements;
+			}
+			// hysteresis, avoids split/merge thrashing around the threshold
+			if (count > props.branchThreshold / 2) { return; }
+			for (Branch* sub : p->subBranches)
+			{
+				while (sub->firstElement)
+				{
+					Element* e = sub->firstElement;
+					sub->unlinkElement(e);
+					p->addElement(e);
+				}
+			}
+			p->destroySubBranches();
+			numBranches -= 8;
+			p = p->parentBranch;
+		}
+	}
+
+	void Octree::unlinkAllObjects(Branch* b)
+	{
+		for (auto& e : *b)
+		{
+			e.linkedObj->linkedTree = nullptr;
+			e.linkedObj->linkedElement = nullptr;
+		}
+		if (b->isLeaf()) { return; }
+		for (Branch* sub : b->subBranches) { unlinkAllObjects(sub); }
+	}
+
+} // namespace
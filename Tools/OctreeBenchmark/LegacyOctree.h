@@ -0,0 +1,175 @@
+#pragma once
+
+#include "Core/Types/CommonTypes.h"
+#include "Core/Types/Bounds.h"
+#include "Core/WorldSector.h" // SECTOR_MAX, SECTOR_TREE_MIN_BRANCH_WIDTH
+
+// std
+#include <cstdint>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+/*	World::Octree as it was before branches and elements moved into index pools (one heap allocation per branch
+	and element, doubly-linked element lists), kept only so OctreeBenchmark can compare the two layouts */
+namespace LegacyWorld
+{
+	class PhysicalElementInterface;
+
+	/*	loose octree, each branch accepts elements whose center lies inside the branch cell
+		and whose size fits within the branch width, the loose bounds of a branch are therefore
+		twice as wide as the cell itself, this lets moving elements stay in place for longer */
+	class Octree
+	{
+	public:
+		struct OctreeProperties
+		{
+			// physical width, must be power of two and below SECTOR_MAX
+			uint32_t rootWidth = 524288; // ~ 5km
+			// branches with an element count above this value will split
+			uint32_t branchThreshold = 250;
+		};
+
+		Octree(const OctreeProperties& treeProps);
+		~Octree();
+
+		Octree(const Octree&) = delete;
+		Octree& operator=(const Octree&) = delete;
+
+		/*	adds an object to the tree, the tree does not take ownership of the object,
+			objects remove themselves from the tree when they are destroyed */
+		void insert(PhysicalElementInterface* obj);
+		void remove(PhysicalElementInterface* obj);
+		// re-reads the bounds of an object and moves it to another branch if necessary
+		void relocate(PhysicalElementInterface* obj);
+		// checks and re-assigns all elements which have moved to another branch
+		void updateElementPositions();
+
+		uint32_t getElementCount() const { return numElements; }
+		uint32_t getBranchCount() const { return numBranches; }
+
+		// calls fn(PhysicalElementInterface*) for every element that overlaps the shape
+		template<typename F>
+		void queryBox(const BoundingBox& box, F&& fn) const { query(*root, box, fn, false); }
+		template<typename F>
+		void querySphere(const BoundingSphere& sphere, F&& fn) const { query(*root, sphere, fn, false); }
+		template<typename F>
+		void queryFrustum(const Frustum& frustum, F&& fn) const { query(*root, frustum, fn, false); }
+
+	protected:
+		friend class PhysicalElementInterface;
+		struct Branch;
+		/*	an octree element does not contain the object it represents, but is linked to it,
+			elements form a doubly-linked list per branch so they can be unlinked in constant time */
+		struct Element
+		{
+			Element* prev = nullptr;
+			Element* next = nullptr;
+			Branch* branch = nullptr;
+			PhysicalElementInterface* linkedObj = nullptr;
+			BoundingBox bounds{}; // cached world bounds, updated on relocation
+		};
+
+		struct Branch
+		{
+			Branch* parentBranch = nullptr;
+			Element* firstElement = nullptr;
+			Branch* subBranches[8] = {};
+			Vec center{};
+			uint32_t level = 0;
+			uint32_t numElements = 0;
+
+			class Iterator
+			{
+			public:
+				Iterator(Element* e) : elem{ e } {};
+				Iterator& operator++() { elem = elem->next; return *this; }
+				bool operator!=(const Iterator& other) const { return elem != other.elem; }
+				Element& operator*() const { return *elem; }
+			private:
+				Element* elem;
+			};
+			Iterator begin() const { return Iterator(firstElement); }
+			Iterator end() const { return Iterator(nullptr); }
+
+			~Branch() { destroyAllElements(); destroySubBranches(); }
+			bool isLeaf() const { return !subBranches[0]; }
+			void destroyAllElements();
+			void destroySubBranches()
+			{
+				for (Branch*& b : subBranches) { delete b; b = nullptr; }
+			}
+			void addElement(Element* element);
+			void unlinkElement(Element* element);
+		};
+
+		OctreeProperties props;
+		Branch* root;
+		uint32_t numElements = 0;
+		uint32_t numBranches = 1;
+
+		// width of a branch at the specified depth (root = 0)
+		uint32_t getBranchWidth(const uint32_t& level) const { return props.rootWidth >> level; }
+		// branch cell bounds expanded by the looseness factor (2)
+		BoundingBox getLooseBounds(const Branch& b) const
+		{ return BoundingBox::fromCenterExtent(b.center, Vec((float)getBranchWidth(b.level))); }
+
+		// index of the sub-branch whose cell contains the point
+		static uint32_t getChildIndex(const Branch& b, const Vec& p)
+		{ return (p.x >= b.center.x ? 1 : 0) | (p.y >= b.center.y ? 2 : 0) | (p.z >= b.center.z ? 4 : 0); }
+		// true if the bounds belong in the branch (loose fit)
+		bool fitsInBranch(const Branch& b, const BoundingBox& bounds) const;
+		bool canSplit(const Branch& b) const { return getBranchWidth(b.level + 1) >= SECTOR_TREE_MIN_BRANCH_WIDTH; }
+
+		// finds the deepest branch below (and including) start that accepts the bounds
+		Branch* findBranchForBounds(Branch* start, const BoundingBox& bounds) const;
+		void placeElement(Element* e, Branch* start);
+		void split(Branch* b);
+		// merges sparsely populated leaf branches back into their parent
+		void tryMerge(Branch* b);
+		void unlinkAllObjects(Branch* b);
+
+		template<typename Shape, typename F>
+		void query(const Branch& b, const Shape& shape, F& fn, bool fullyInside) const
+		{
+			// the root accepts elements outside its cell, so it is never culled
+			if (!fullyInside && &b != root)
+			{
+				const BoundingBox loose = getLooseBounds(b);
+				if (!shape.intersects(loose)) { return; }
+				fullyInside = shape.contains(loose);
+			}
+			for (const auto& e : b)
+			{
+				if (fullyInside || shape.intersects(e.bounds)) { fn(e.linkedObj); }
+			}
+			if (b.isLeaf()) { return; }
+			for (const Branch* sub : b.subBranches) { query(*sub, shape, fn, fullyInside); }
+		}
+	};
+
+	class PhysicalElementInterface
+	{
+		/*	the element interface should be inherited by all
+			objects with a physical presence (physics/collision)
+			it is used for communicating data with a spatial data structure */
+	protected:
+		friend class Octree;
+		// the tree (if any) containing this object, and the corresponding data element in it
+		Octree* linkedTree = nullptr;
+		Octree::Element* linkedElement = nullptr;
+		// reports a change in physical location, used to organize data by location
+		void reportPositionUpdated() { if (linkedTree) { linkedTree->relocate(this); } }
+
+	public:
+		PhysicalElementInterface() = default;
+		PhysicalElementInterface(const PhysicalElementInterface&) = delete;
+		PhysicalElementInterface& operator=(const PhysicalElementInterface&) = delete;
+		virtual ~PhysicalElementInterface() { if (linkedTree) { linkedTree->remove(this); } }
+
+		// world space bounds, used to place the object in a spatial data structure
+		virtual BoundingBox getBounds() const = 0;
+		bool isInTree() const { return linkedTree; }
+	};
+
+} // namespace
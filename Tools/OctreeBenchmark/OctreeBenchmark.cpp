@@ -0,0 +1,146 @@
+/*	octree microbenchmark, compares insert, relocate and remove throughput of World::Octree (index pools)
+	with the previous layout (heap allocated branches and elements, see LegacyOctree),
+	usage: OctreeBenchmark [--count <elements>] [--rounds <relocation rounds>] [--seed <n>]
+	both trees see the same bounds in the same order, small moves mostly stay in their branch, teleports never do */
+#include "Core/WorldSector.h"
+#include "Tools/OctreeBenchmark/LegacyOctree.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace
+{
+	struct Actor : World::PhysicalElementInterface
+	{
+		BoundingBox bounds{};
+		BoundingBox getBounds() const override { return bounds; }
+		void move(const BoundingBox& b) { bounds = b; reportPositionUpdated(); }
+	};
+
+	struct LegacyActor : LegacyWorld::PhysicalElementInterface
+	{
+		BoundingBox bounds{};
+		BoundingBox getBounds() const override { return bounds; }
+		void move(const BoundingBox& b) { bounds = b; reportPositionUpdated(); }
+	};
+
+	// the bounds every actor takes on in each phase, generated once so both trees do identical work
+	struct Workload
+	{
+		std::vector<BoundingBox> initial;
+		std::vector<std::vector<BoundingBox>> smallMoves; // per round
+		std::vector<std::vector<BoundingBox>> teleports; // per round
+	};
+
+	Workload makeWorkload(const uint32_t& count, const uint32_t& rounds, const uint32_t& seed, const float& rootWidth)
+	{
+		std::mt19937 rng(seed);
+		const float half = rootWidth * 0.45f;
+		std::uniform_real_distribution<float> position(-half, half);
+		std::uniform_real_distribution<float> size(0.5f, 50.f);
+		std::uniform_real_distribution<float> step(-20.f, 20.f);
+		auto random = [&]() { return BoundingBox::fromCenterExtent(Vec{ position(rng), position(rng), position(rng) }, Vec(size(rng))); };
+
+		Workload w{};
+		w.initial.resize(count);
+		for (auto& b : w.initial) { b = random(); }
+		std::vector<BoundingBox> current = w.initial;
+		for (uint32_t r = 0; r < rounds; r++)
+		{
+			for (auto& b : current)
+			{
+				const Vec d{ step(rng), step(rng), step(rng) };
+				b = BoundingBox(b.min + d, b.max + d);
+			}
+			w.smallMoves.push_back(current);
+			for (auto& b : current) { b = random(); }
+			w.teleports.push_back(current);
+		}
+		return w;
+	}
+
+	struct Timings
+	{
+		double insert = 0.0;
+		double smallMoves = 0.0;
+		double teleports = 0.0;
+		double remove = 0.0;
+		uint32_t branches = 0;
+	};
+
+	template<typename Tree, typename ActorType>
+	Timings run(const Workload& w, const typename Tree::OctreeProperties& props)
+	{
+		using clock = std::chrono::steady_clock;
+		auto ms = [](clock::time_point a, clock::time_point b) { return std::chrono::duration<double, std::milli>(b - a).count(); };
+		Timings t{};
+		Tree tree(props);
+		std::vector<ActorType> actors(w.initial.size());
+		for (size_t i = 0; i < actors.size(); i++) { actors[i].bounds = w.initial[i]; }
+
+		auto start = clock::now();
+		for (auto& a : actors) { tree.insert(&a); }
+		t.insert = ms(start, clock::now());
+
+		for (size_t r = 0; r < w.smallMoves.size(); r++)
+		{
+			start = clock::now();
+			for (size_t i = 0; i < actors.size(); i++) { actors[i].move(w.smallMoves[r][i]); }
+			t.smallMoves += ms(start, clock::now());
+			start = clock::now();
+			for (size_t i = 0; i < actors.size(); i++) { actors[i].move(w.teleports[r][i]); }
+			t.teleports += ms(start, clock::now());
+		}
+		t.branches = tree.getBranchCount();
+
+		start = clock::now();
+		for (auto& a : actors) { tree.remove(&a); }
+		t.remove = ms(start, clock::now());
+		return t;
+	}
+
+	void report(const char* name, const Timings& t, const uint32_t& count, const uint32_t& rounds)
+	{
+		auto rate = [](const double& ops, const double& ms) { return ms > 0.0 ? ops / ms / 1000.0 : 0.0; }; // M ops/s
+		const double moves = static_cast<double>(count) * rounds;
+		std::cout << name << ": insert " << rate(count, t.insert) << " M/s, relocate (small) " << rate(moves, t.smallMoves)
+			<< " M/s, relocate (teleport) " << rate(moves, t.teleports) << " M/s, remove " << rate(count, t.remove)
+			<< " M/s, " << t.branches << " branches\n";
+	}
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t count = 200000;
+	uint32_t rounds = 5;
+	uint32_t seed = 1;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		const uint32_t value = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+		if (std::strcmp(argv[i], "--count") == 0) { count = value; }
+		else if (std::strcmp(argv[i], "--rounds") == 0) { rounds = value; }
+		else if (std::strcmp(argv[i], "--seed") == 0) { seed = value; }
+		else
+		{
+			std::cerr << "usage: OctreeBenchmark [--count <elements>] [--rounds <relocation rounds>] [--seed <n>]\n";
+			return 1;
+		}
+	}
+
+	World::Octree::OctreeProperties props{};
+	LegacyWorld::Octree::OctreeProperties legacyProps{};
+	legacyProps.rootWidth = props.rootWidth;
+	legacyProps.branchThreshold = props.branchThreshold;
+	const Workload w = makeWorkload(count, rounds, seed, static_cast<float>(props.rootWidth));
+
+	std::cout << count << " elements, " << rounds << " rounds\n";
+	const Timings legacy = run<LegacyWorld::Octree, LegacyActor>(w, legacyProps);
+	const Timings pooled = run<World::Octree, Actor>(w, props);
+	report("legacy (heap nodes)", legacy, count, rounds);
+	report("pooled (index pools)", pooled, count, rounds);
+	return 0;
+}
@@ -0,0 +1,100 @@
+/*	offline texture cooker, converts JPG/PNG/TGA files into cooked textures (see CookedTexture) with a full mip chain,
+	usage: TextureCooker [--format bc1|bc3|bc5|bc7|rgba8] [--linear] [--virtual <tile size>] <image>...
+	bc7 (default) suits color with or without alpha, bc1 opaque color at half the size, bc5 normal maps,
+	--linear marks non-color data so it is not sampled through an sRGB view,
+	--virtual writes a tile file for virtual texturing instead (see VirtualTextureFile), tiles are RGBA8 */
+#include "Core/Texture/CookedTexture.h"
+#include "Core/Texture/VirtualTextureFile.h"
+#include "Core/Jobs/JobSystem.h"
+#include "Core/Types/Math.h"
+
+// image importer, the tool does not link the engine's copy
+#define STB_IMAGE_IMPLEMENTATION
+#include "ThirdParty/stb_image.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// texels repeated around every virtual texture tile, enough for bilinear and moderate anisotropic footprints
+static constexpr uint32_t VIRTUAL_TILE_BORDER = 4;
+
+int main(int argc, char** argv)
+{
+	using namespace EngineCore;
+	BlockFormat format = BlockFormat::BC7;
+	bool srgb = true;
+	uint32_t virtualTileSize = 0;
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--linear") == 0) { srgb = false; }
+		else if (std::strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+		{
+			const std::string name = argv[++i];
+			if (name == "bc1") { format = BlockFormat::BC1; }
+			else if (name == "bc3") { format = BlockFormat::BC3; }
+			else if (name == "bc5") { format = BlockFormat::BC5; }
+			else if (name == "bc7") { format = BlockFormat::BC7; }
+			else if (name == "rgba8") { format = BlockFormat::RGBA8; }
+			else { std::cerr << "unknown texture format " << name << "\n"; return 1; }
+		}
+		else if (std::strcmp(argv[i], "--virtual") == 0 && i + 1 < argc)
+		{
+			virtualTileSize = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+			if (virtualTileSize < VIRTUAL_TILE_BORDER) { std::cerr << "virtual tile size must be at least " << VIRTUAL_TILE_BORDER << "\n"; return 1; }
+		}
+		else { paths.push_back(argv[i]); }
+	}
+	if (paths.empty())
+	{
+		std::cerr << "usage: TextureCooker [--format bc1|bc3|bc5|bc7|rgba8] [--linear] [--virtual <tile size>] <image>...\n";
+		return 1;
+	}
+
+	JobSystem jobs{};
+	int failed = 0;
+	for (const auto& path : paths)
+	{
+		try
+		{
+			std::ifstream file(path, std::ios::binary);
+			if (!file) { throw std::runtime_error("failed to open image file: " + path); }
+			const std::vector<char> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+			int width, height, channels;
+			stbi_uc* pixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(contents.data()), static_cast<int>(contents.size()),
+													&width, &height, &channels, STBI_rgb_alpha);
+			if (!pixels) { throw std::runtime_error("failed to decode image: " + path); }
+
+			if (virtualTileSize > 0)
+			{
+				const bool written = VirtualTextureFile::cook(path, pixels, static_cast<uint32_t>(width), static_cast<uint32_t>(height),
+															virtualTileSize, VIRTUAL_TILE_BORDER, srgb, &jobs);
+				stbi_image_free(pixels);
+				if (!written) { throw std::runtime_error("could not write tile file " + VirtualTextureFile::getCookedPath(path)); }
+				const VirtualTextureLayout layout(static_cast<uint32_t>(width), static_cast<uint32_t>(height), virtualTileSize);
+				std::cout << "cooked virtual texture " << path << ", " << width << "x" << height << ", "
+					<< layout.levelCount << " levels, " << layout.getTileCount() << " tiles\n";
+				continue;
+			}
+
+			const uint64_t hash = Math::fnv1a64(contents.data(), contents.size());
+			const bool written = CookedTexture::cook(path, pixels, static_cast<uint32_t>(width), static_cast<uint32_t>(height),
+													format, srgb, hash, &jobs);
+			stbi_image_free(pixels);
+			if (!written) { throw std::runtime_error("could not write cooked texture " + CookedTexture::getCookedPath(path)); }
+
+			const uint64_t uncompressed = static_cast<uint64_t>(width) * height * 4;
+			const uint64_t encoded = BlockCompression::getEncodedSize(format, static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+			std::cout << "cooked texture " << path << ", " << width << "x" << height << ", level 0: "
+				<< uncompressed / 1024 << " KiB -> " << encoded / 1024 << " KiB\n";
+		}
+		catch (const std::exception& e) { std::cerr << e.what() << "\n"; failed++; }
+	}
+	return failed == 0 ? 0 : 1;
+}
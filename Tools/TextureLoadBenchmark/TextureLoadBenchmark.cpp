@@ -0,0 +1,147 @@
+/*	texture load times for every image in a directory, the CPU side of a TextureStreamer load:
+	source files are read and decoded to RGBA8 (the path without a cooked file), cooked files (see CookedTexture)
+	are mapped, validated and copied as one range, the way Image::loadCooked stages them,
+	usage: TextureLoadBenchmark [--workers <max>] [--runs <n>] <directory>
+	every file is a job like in TextureStreamer, the main thread only polls, 1..max workers are measured,
+	one untimed pass runs first so all numbers see a warm file cache */
+#include "Core/Texture/CookedTexture.h"
+#include "Core/Jobs/JobSystem.h"
+
+// image importer, the tool does not link the engine's copy
+#define STB_IMAGE_IMPLEMENTATION
+#include "ThirdParty/stb_image.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	using namespace EngineCore;
+
+	struct Totals
+	{
+		std::atomic<uint64_t> bytes{ 0 }; // staged bytes
+		std::atomic<uint32_t> failed{ 0 };
+	};
+
+	void loadSource(const std::string& path, Totals& totals)
+	{
+		std::ifstream file(path, std::ios::binary);
+		const std::vector<char> contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		int width, height, channels;
+		stbi_uc* pixels = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(contents.data()), static_cast<int>(contents.size()),
+												&width, &height, &channels, STBI_rgb_alpha);
+		if (!pixels) { totals.failed++; return; }
+		const size_t size = static_cast<size_t>(width) * height * 4;
+		std::vector<uint8_t> staging(size);
+		std::memcpy(staging.data(), pixels, size);
+		stbi_image_free(pixels);
+		totals.bytes += size;
+	}
+
+	void loadCooked(const std::string& path, Totals& totals)
+	{
+		MappedFile cooked{};
+		CookedTexture::View view{};
+		if (!cooked.open(CookedTexture::getCookedPath(path)) || !CookedTexture::parse(cooked, view)
+			|| !CookedTexture::isUpToDate(*view.header, path)) { totals.failed++; return; }
+		const uint32_t last = view.header->levelCount - 1;
+		const uint64_t first = view.levels[0].offset;
+		const uint64_t size = view.levels[last].offset + view.levels[last].size - first;
+		std::vector<uint8_t> staging(size);
+		std::memcpy(staging.data(), view.data + first, size);
+		totals.bytes += size;
+	}
+
+	// best of the runs in seconds
+	template<typename Load>
+	double measure(const std::vector<std::string>& paths, const uint32_t& workers, const uint32_t& runs, Totals& totals, Load load)
+	{
+		using clock = std::chrono::steady_clock;
+		JobSystem jobs{ workers };
+		double best = 0.0;
+		for (uint32_t r = 0; r < runs; r++)
+		{
+			totals.bytes = 0;
+			totals.failed = 0;
+			const auto start = clock::now();
+			std::vector<JobHandle> pending;
+			for (const auto& path : paths) { pending.push_back(jobs.run([&totals, &path, load]() { load(path, totals); })); }
+			// like the render thread, which keeps going and checks the streamer once per frame
+			for (const auto& job : pending) { while (!job->isFinished()) { std::this_thread::yield(); } }
+			const double seconds = std::chrono::duration<double>(clock::now() - start).count();
+			best = r == 0 ? seconds : std::min(best, seconds);
+		}
+		return best;
+	}
+
+	template<typename Load>
+	void run(const char* name, const std::vector<std::string>& paths, const uint32_t& maxWorkers, const uint32_t& runs, Load load)
+	{
+		Totals totals{};
+		measure(paths, 1, 1, totals, load);
+		if (totals.failed == paths.size()) { std::cout << name << ": nothing could be loaded\n"; return; }
+		double single = 0.0;
+		for (uint32_t workers = 1; workers <= maxWorkers; workers++)
+		{
+			const double seconds = measure(paths, workers, runs, totals, load);
+			if (workers == 1) { single = seconds; }
+			const uint32_t loaded = std::max(1u, static_cast<uint32_t>(paths.size()) - totals.failed);
+			std::cout << name << ", " << workers << " worker(s): " << seconds * 1000.0 << " ms for " << loaded << " textures, "
+				<< seconds * 1000.0 / loaded << " ms each, " << totals.bytes / seconds / 1e6 << " MB/s staged, "
+				<< single / seconds << "x\n";
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t maxWorkers = std::max(1u, std::thread::hardware_concurrency());
+	uint32_t runs = 3;
+	std::string directory;
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--workers") == 0 && i + 1 < argc)
+		{ maxWorkers = std::max(1u, static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10))); }
+		else if (std::strcmp(argv[i], "--runs") == 0 && i + 1 < argc)
+		{ runs = std::max(1u, static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10))); }
+		else if (directory.empty() && argv[i][0] != '-') { directory = argv[i]; }
+		else { directory.clear(); break; }
+	}
+	std::error_code error;
+	if (directory.empty() || !std::filesystem::is_directory(directory, error))
+	{
+		std::cerr << "usage: TextureLoadBenchmark [--workers <max>] [--runs <n>] <directory>\n";
+		return 1;
+	}
+
+	// the formats the engine imports, see TextureCooker
+	std::vector<std::string> sources, cooked;
+	for (const auto& entry : std::filesystem::directory_iterator(directory, error))
+	{
+		std::string extension = entry.path().extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		if (!entry.is_regular_file() || (extension != ".jpg" && extension != ".jpeg" && extension != ".png" && extension != ".tga")) { continue; }
+		sources.push_back(entry.path().string());
+		if (std::filesystem::exists(CookedTexture::getCookedPath(sources.back()), error)) { cooked.push_back(sources.back()); }
+	}
+	std::sort(sources.begin(), sources.end());
+	std::sort(cooked.begin(), cooked.end());
+	if (sources.empty()) { std::cerr << "no textures in " << directory << "\n"; return 1; }
+
+	std::cout << sources.size() << " textures, " << cooked.size() << " cooked, best of " << runs << "\n";
+	run("source (decode)", sources, maxWorkers, runs, loadSource);
+	if (!cooked.empty()) { run("cooked (map)", cooked, maxWorkers, runs, loadCooked); }
+	return 0;
+}
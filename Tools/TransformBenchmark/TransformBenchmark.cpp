@@ -0,0 +1,102 @@
+/*	world matrix benchmark, builds matrices from a TransformBatch with Math::buildMatricesScalar
+	(one Transform::makeMatrix per entry) and with Math::buildMatrices (SIMD when compiled in) and reports matrices/sec,
+	usage: TransformBenchmark [--count <transforms>] [--iterations <n>] [--updated <percent>] [--seed <n>]
+	--updated sets how many entries carry a set updated flag, the rest are skipped by both paths */
+#include "Core/Types/TransformBatch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace
+{
+	using BuildFunction = void(*)(const TransformBatch&, glm::mat4*, const uint32_t&, const uint32_t&);
+
+	// best of the iterations, in matrices per second, only entries with a set flag count
+	double measure(BuildFunction build, const TransformBatch& batch, std::vector<glm::mat4>& out,
+				const uint32_t& iterations, const uint32_t& builtPerCall)
+	{
+		using clock = std::chrono::steady_clock;
+		double best = 0.0;
+		for (uint32_t i = 0; i < iterations; i++)
+		{
+			const auto start = clock::now();
+			build(batch, out.data(), 0, batch.size());
+			const double seconds = std::chrono::duration<double>(clock::now() - start).count();
+			if (seconds > 0.0) { best = std::max(best, builtPerCall / seconds); }
+		}
+		return best;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t count = 100000;
+	uint32_t iterations = 50;
+	uint32_t updatedPercent = 100;
+	uint32_t seed = 1;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		const uint32_t value = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+		if (std::strcmp(argv[i], "--count") == 0) { count = value; }
+		else if (std::strcmp(argv[i], "--iterations") == 0) { iterations = std::max(1u, value); }
+		else if (std::strcmp(argv[i], "--updated") == 0) { updatedPercent = std::min(100u, value); }
+		else if (std::strcmp(argv[i], "--seed") == 0) { seed = value; }
+		else
+		{
+			std::cerr << "usage: TransformBenchmark [--count <transforms>] [--iterations <n>] [--updated <percent>] [--seed <n>]\n";
+			return 1;
+		}
+	}
+
+	std::mt19937 rng(seed);
+	std::uniform_real_distribution<float> angle(-6.2831853f, 6.2831853f);
+	std::uniform_real_distribution<float> position(-1000.f, 1000.f);
+	std::uniform_real_distribution<float> scale(0.1f, 10.f);
+	std::uniform_int_distribution<uint32_t> percent(0, 99);
+	TransformBatch batch;
+	batch.reserve(count);
+	uint32_t built = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		Transform t{};
+		t.translation = Vec{ position(rng), position(rng), position(rng) };
+		t.rotation = Vec{ angle(rng), angle(rng), angle(rng) };
+		t.scale = Vec{ scale(rng), scale(rng), scale(rng) };
+		const bool updated = percent(rng) < updatedPercent;
+		built += updated ? 1 : 0;
+		batch.add(t, updated);
+	}
+
+	std::vector<glm::mat4> scalar(count, glm::mat4(0.f));
+	std::vector<glm::mat4> simd(count, glm::mat4(0.f));
+	const double scalarRate = measure(&Math::buildMatricesScalar, batch, scalar, iterations, built);
+	const double simdRate = measure(&Math::buildMatrices, batch, simd, iterations, built);
+
+	// both paths must agree, relative to the matrix scale
+	float maxError = 0.f;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			for (int r = 0; r < 4; r++)
+			{
+				const float a = scalar[i][c][r];
+				const float b = simd[i][c][r];
+				maxError = std::max(maxError, std::abs(a - b) / std::max(1.f, std::abs(a)));
+			}
+		}
+	}
+
+	std::cout << count << " transforms, " << built << " updated, best of " << iterations << "\n";
+	std::cout << "scalar: " << scalarRate / 1e6 << " M matrices/s\n";
+	std::cout << (Math::hasSIMDMatrixPath() ? "simd: " : "simd (not compiled in, scalar fallback): ")
+		<< simdRate / 1e6 << " M matrices/s, speedup " << (scalarRate > 0.0 ? simdRate / scalarRate : 0.0) << "x\n";
+	std::cout << "max relative difference: " << maxError << "\n";
+	return maxError < 1e-4f ? 0 : 1;
+}
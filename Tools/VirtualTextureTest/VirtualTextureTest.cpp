@@ -0,0 +1,306 @@
+/*	CPU checks of virtual texturing without a device: VirtualTextureLayout, the VirtualTextureCache page table
+	under random feedback, loads, cancels and evictions, and a VirtualTextureFile round trip,
+	usage: VirtualTextureTest [--frames <per layout>] [--seed <n>], returns non-zero if a check fails
+	after every frame each page entry must point at the finest resident tile covering it, in the slot it was inserted into,
+	and the dirty ranges must carry every change of the page table */
+#include "Core/Texture/VirtualTextureCache.h"
+#include "Core/Texture/VirtualTextureFile.h"
+#include "Core/Jobs/JobSystem.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+	using namespace EngineCore;
+
+	uint32_t failures = 0;
+
+	// returns the condition, so callers can stop checking a state that is already broken
+	bool check(const bool& condition, const std::string& what)
+	{
+		if (condition) { return true; }
+		std::cout << "FAILED: " << what << "\n";
+		failures++;
+		return false;
+	}
+
+	bool isInSlot(const VirtualTextureCache::PageEntry& entry, const VirtualTextureCache& cache, const uint32_t& slot)
+	{
+		uint32_t x, y;
+		cache.getSlotPosition(slot, x, y);
+		return (entry & 0xFF) == x && ((entry >> 8) & 0xFF) == y;
+	}
+
+	uint32_t getMappedLevel(const VirtualTextureCache::PageEntry& entry) { return (entry >> 16) & 0xFF; }
+
+	/*	what virtual_texture.glsl does for a uv at a level: looks up the page entry of the covering tile,
+		then addresses the mapped level, returns the entry and the texel position within the mapped tile */
+	VirtualTextureCache::PageEntry lookup(const VirtualTextureCache& cache, const double& u, const double& v, const uint32_t& level,
+										uint32_t& tileXOut, uint32_t& tileYOut, double& localXOut, double& localYOut)
+	{
+		const VirtualTextureLayout& layout = cache.getLayout();
+		auto tileAt = [&](const uint32_t& k, uint32_t& tx, uint32_t& ty, double& cx, double& cy)
+		{
+			cx = std::min(u * layout.width / static_cast<double>(1u << k), static_cast<double>(layout.getLevelWidth(k)));
+			cy = std::min(v * layout.height / static_cast<double>(1u << k), static_cast<double>(layout.getLevelHeight(k)));
+			tx = std::min(static_cast<uint32_t>(cx / layout.tileSize), layout.getTilesX(k) - 1);
+			ty = std::min(static_cast<uint32_t>(cy / layout.tileSize), layout.getTilesY(k) - 1);
+		};
+		uint32_t tx, ty;
+		double cx, cy;
+		tileAt(level, tx, ty, cx, cy);
+		const VirtualTextureCache::PageEntry entry = cache.getPageTable()[layout.getFirstTile(level) + ty * layout.getTilesX(level) + tx];
+		tileAt(getMappedLevel(entry), tileXOut, tileYOut, cx, cy);
+		localXOut = cx - tileXOut * static_cast<double>(layout.tileSize);
+		localYOut = cy - tileYOut * static_cast<double>(layout.tileSize);
+		return entry;
+	}
+
+	void testLayout(const uint32_t& width, const uint32_t& height, const uint32_t& tileSize)
+	{
+		const std::string name = "layout " + std::to_string(width) + "x" + std::to_string(height) + " tile " + std::to_string(tileSize);
+		const VirtualTextureLayout layout(width, height, tileSize);
+		check(layout.getTilesX(layout.levelCount - 1) == 1 && layout.getTilesY(layout.levelCount - 1) == 1,
+			name + ": the last level is more than one tile");
+		check(layout.getRoot() == VirtualTile::pack(layout.levelCount - 1, 0, 0), name + ": root is not the last level's tile");
+		uint32_t index = 0;
+		for (uint32_t k = 0; k < layout.levelCount; k++)
+		{
+			for (uint32_t y = 0; y < layout.getTilesY(k); y++)
+			{
+				for (uint32_t x = 0; x < layout.getTilesX(k); x++, index++)
+				{
+					const uint32_t tile = VirtualTile::pack(k, x, y);
+					check(layout.isValid(tile), name + ": tile inside the grid is invalid");
+					check(layout.getIndex(tile) == index, name + ": tiles are not numbered level by level, row-major");
+					if (k + 1 < layout.levelCount) { check(layout.isValid(layout.getParent(tile)), name + ": parent is invalid"); }
+				}
+			}
+			check(!layout.isValid(VirtualTile::pack(k, layout.getTilesX(k), 0)) && !layout.isValid(VirtualTile::pack(k, 0, layout.getTilesY(k))),
+				name + ": tile past the grid is valid");
+		}
+		check(index == layout.getTileCount(), name + ": tile count does not match the levels");
+		check(!layout.isValid(VirtualTile::pack(layout.levelCount, 0, 0)), name + ": level past the last one is valid");
+	}
+
+	void testCache(const uint32_t& width, const uint32_t& height, const uint32_t& tileSize, const uint32_t& slotsX, const uint32_t& slotsY,
+					const uint32_t& frames, std::mt19937& rng)
+	{
+		const std::string name = "cache " + std::to_string(width) + "x" + std::to_string(height) + " tile " + std::to_string(tileSize)
+			+ ", " + std::to_string(slotsX) + "x" + std::to_string(slotsY) + " slots";
+		const VirtualTextureLayout layout(width, height, tileSize);
+		const uint32_t protectedFrames = 2;
+		VirtualTextureCache cache(layout, slotsX, slotsY, protectedFrames);
+		auto random = [&](const uint32_t& n) { return static_cast<uint32_t>(rng() % n); };
+
+		// what the GPU copy of the page table holds, only updated through the dirty ranges
+		std::vector<VirtualTextureCache::PageEntry> mirror(cache.getPageTable().size(), 0);
+		std::vector<std::pair<uint32_t, uint32_t>> ranges;
+		std::unordered_map<uint32_t, uint32_t> slotOf{ { layout.getRoot(), 0 } }; // tile -> slot returned by insert
+		uint32_t inserted = 0, refused = 0;
+
+		for (uint64_t frame = 0; frame < frames; frame++)
+		{
+			// feedback is mostly a moving window, so tiles are reused, plus some noise and the entries the pass skips
+			std::vector<uint32_t> feedback;
+			const double centerU = 0.5 + 0.4 * std::sin(frame * 0.01), centerV = 0.5 + 0.4 * std::cos(frame * 0.013);
+			for (uint32_t i = 0; i < 48; i++)
+			{
+				const uint32_t k = random(layout.levelCount);
+				const bool near = random(4) != 0;
+				const double u = near ? centerU + (random(1000) / 1000.0 - 0.5) * 0.2 : random(1000) / 1000.0;
+				const double v = near ? centerV + (random(1000) / 1000.0 - 0.5) * 0.2 : random(1000) / 1000.0;
+				const uint32_t x = std::min(static_cast<uint32_t>(std::max(0.0, u) * layout.getTilesX(k)), layout.getTilesX(k) - 1);
+				const uint32_t y = std::min(static_cast<uint32_t>(std::max(0.0, v) * layout.getTilesY(k)), layout.getTilesY(k) - 1);
+				feedback.push_back(VirtualTile::pack(k, x, y) + 1);
+			}
+			feedback.push_back(0);
+			feedback.push_back(UINT32_MAX);
+			feedback.push_back(VirtualTile::pack(layout.levelCount, 0, 0) + 1);
+			cache.resolveFeedback(feedback.data(), feedback.size(), frame);
+
+			const std::vector<uint32_t> requests = cache.takeRequests(4, frame);
+			check(requests.size() <= 4, name + ": more requests than asked for");
+			for (size_t i = 0; i < requests.size(); i++)
+			{
+				check(layout.isValid(requests[i]) && !cache.isResident(requests[i]), name + ": requested tile is invalid or resident");
+				if (i > 0) { check(VirtualTile::getLevel(requests[i - 1]) >= VirtualTile::getLevel(requests[i]), name + ": requests not coarse first"); }
+			}
+			for (const uint32_t& tile : requests)
+			{
+				if (random(10) == 0) { cache.cancel(tile); continue; }
+				const uint32_t slot = cache.insert(tile, frame);
+				if (slot == VirtualTextureCache::INVALID_SLOT) { refused++; continue; }
+				inserted++;
+				check(slot != 0 && slot < cache.getSlotCount(), name + ": tile inserted into the root slot or past the atlas");
+				check(cache.isResident(tile), name + ": inserted tile is not resident");
+				slotOf[tile] = slot;
+			}
+
+			cache.takeDirtyRanges(ranges);
+			for (const auto& range : ranges)
+			{
+				if (!check(range.first + range.second <= mirror.size(), name + ": dirty range past the page table")) { return; }
+				std::copy_n(cache.getPageTable().begin() + range.first, range.second, mirror.begin() + range.first);
+			}
+			cache.takeDirtyRanges(ranges);
+			check(ranges.empty(), name + ": dirty ranges reported twice");
+			if (!check(mirror == cache.getPageTable(), name + ": a page table change is missing from the dirty ranges")) { return; }
+
+			check(cache.isResident(layout.getRoot()), name + ": root tile was evicted");
+			check(cache.getResidentCount() <= cache.getSlotCount(), name + ": more resident tiles than slots");
+
+			// every entry maps the finest resident tile on the parent chain, in the slot that tile was given
+			bool consistent = true;
+			for (uint32_t k = 0; k < layout.levelCount && consistent; k++)
+			{
+				for (uint32_t y = 0; y < layout.getTilesY(k) && consistent; y++)
+				{
+					for (uint32_t x = 0; x < layout.getTilesX(k) && consistent; x++)
+					{
+						uint32_t tile = VirtualTile::pack(k, x, y);
+						while (!cache.isResident(tile)) { tile = layout.getParent(tile); }
+						const VirtualTextureCache::PageEntry entry = cache.getPageTable()[layout.getIndex(VirtualTile::pack(k, x, y))];
+						consistent = check(getMappedLevel(entry) == VirtualTile::getLevel(tile) && (entry & (1u << 24)) != 0
+											&& isInSlot(entry, cache, slotOf[tile]),
+										name + ": page entry of a tile is not its finest resident ancestor");
+					}
+				}
+			}
+			if (!consistent) { return; }
+
+			// sampled positions stay inside the mapped tile, which covers them
+			for (uint32_t s = 0; s < 16; s++)
+			{
+				const double u = random(100001) / 100000.0, v = random(100001) / 100000.0;
+				uint32_t tx, ty;
+				double lx, ly;
+				const VirtualTextureCache::PageEntry entry = lookup(cache, u, v, random(layout.levelCount), tx, ty, lx, ly);
+				check(cache.isResident(VirtualTile::pack(getMappedLevel(entry), tx, ty)), name + ": lookup ends in a tile that is not resident");
+				check(lx >= -1e-9 && lx <= layout.tileSize + 1e-9 && ly >= -1e-9 && ly <= layout.tileSize + 1e-9,
+					name + ": lookup lands outside the mapped tile");
+			}
+		}
+		std::cout << name << ": " << layout.levelCount << " levels, " << layout.getTileCount() << " tiles, " << inserted << " inserted, "
+			<< refused << " refused, " << cache.getResidentCount() << " resident\n";
+	}
+
+	void testProtection()
+	{
+		// one slot next to the root, the tile in it may not be replaced while frames in flight can still sample it
+		const VirtualTextureLayout layout(256, 256, 64);
+		VirtualTextureCache cache(layout, 2, 1, 2);
+		const uint32_t a = VirtualTile::pack(0, 0, 0), b = VirtualTile::pack(0, 1, 0);
+		check(cache.insert(a, 10) == 1, "protection: first tile does not get the free slot");
+		check(cache.insert(b, 11) == VirtualTextureCache::INVALID_SLOT, "protection: a tile used last frame was evicted");
+		check(cache.isResident(a) && !cache.isResident(b), "protection: refused insert changed the residency");
+		check(cache.insert(b, 12) == 1, "protection: an old enough tile was not evicted");
+		check(!cache.isResident(a) && cache.isResident(b), "protection: eviction did not replace the tile");
+		check(cache.getPageTable()[layout.getIndex(a)] == cache.getPageTable()[layout.getIndex(layout.getRoot())],
+			"protection: evicted tile is not mapped back to the root");
+	}
+
+	void testFile(JobSystem& jobs)
+	{
+		const uint32_t width = 300, height = 170, tileSize = 32, border = 4;
+		std::vector<uint8_t> image(static_cast<size_t>(width) * height * 4);
+		for (uint32_t y = 0; y < height; y++)
+		{
+			for (uint32_t x = 0; x < width; x++)
+			{
+				uint8_t* p = &image[(static_cast<size_t>(y) * width + x) * 4];
+				p[0] = static_cast<uint8_t>(x);
+				p[1] = static_cast<uint8_t>(y);
+				p[2] = static_cast<uint8_t>(x * y);
+				p[3] = 255;
+			}
+		}
+		// the cooked file records the stamp of its source, so one has to exist
+		const std::filesystem::path source = std::filesystem::temp_directory_path() / "VirtualTextureTest.png";
+		const std::string cookedPath = VirtualTextureFile::getCookedPath(source.string());
+		std::ofstream(source, std::ios::binary | std::ios::trunc) << "source";
+		if (!check(VirtualTextureFile::cook(source.string(), image.data(), width, height, tileSize, border, false, &jobs),
+				"file: cook failed")) { return; }
+		{
+			MappedFile file{};
+			VirtualTextureFile::View view{};
+			if (check(file.open(cookedPath) && VirtualTextureFile::parse(file, view), "file: cooked file does not parse"))
+			{
+				check(VirtualTextureFile::isUpToDate(*view.header, source.string()), "file: fresh file is out of date");
+				const uint32_t side = tileSize + 2 * border;
+				auto texel = [&](const uint32_t& tile, const uint32_t& x, const uint32_t& y)
+				{ return VirtualTextureFile::getTile(view, tile) + (static_cast<size_t>(y) * side + x) * 4; };
+				// tile (2, 1) starts at source texel (64, 32), its border reaches 4 texels further out
+				const uint8_t* inner = texel(VirtualTile::pack(0, 2, 1), border, border);
+				check(inner[0] == 64 && inner[1] == 32, "file: tile texels are not at their source position");
+				const uint8_t* corner = texel(VirtualTile::pack(0, 2, 1), 0, 0);
+				check(corner[0] == 60 && corner[1] == 28, "file: border does not hold the neighbouring texels");
+				// borders past the image repeat the edge
+				const uint8_t* edge = texel(VirtualTile::pack(0, 0, 0), 0, 0);
+				check(edge[0] == 0 && edge[1] == 0, "file: border past the top left corner does not repeat the edge");
+				const uint8_t* last = texel(VirtualTile::pack(0, 9, 0), border + 20, border);
+				check(last[0] == static_cast<uint8_t>(width - 1), "file: texels past the right edge do not repeat the edge");
+				std::cout << "file: " << view.layout.levelCount << " levels, " << file.size() << " bytes\n";
+			}
+		}
+		// a truncated copy must be rejected
+		{
+			std::ifstream in(cookedPath, std::ios::binary);
+			std::vector<char> head(1000);
+			in.read(head.data(), static_cast<std::streamsize>(head.size()));
+			std::ofstream(cookedPath, std::ios::binary | std::ios::trunc).write(head.data(), in.gcount());
+			MappedFile file{};
+			VirtualTextureFile::View view{};
+			check(!file.open(cookedPath) || !VirtualTextureFile::parse(file, view), "file: truncated file parses");
+		}
+		std::filesystem::remove(cookedPath);
+		std::filesystem::remove(source);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	uint32_t frames = 2000;
+	uint32_t seed = 1;
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		const uint32_t value = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+		if (std::strcmp(argv[i], "--frames") == 0) { frames = value; }
+		else if (std::strcmp(argv[i], "--seed") == 0) { seed = value; }
+		else
+		{
+			std::cerr << "usage: VirtualTextureTest [--frames <per layout>] [--seed <n>]\n";
+			return 1;
+		}
+	}
+	std::mt19937 rng(seed);
+
+	/*	square, odd sizes, exact multiples, a single row and a texture that fits one tile,
+		one texel past a tile edge leaves the last tile column and row without a parent of their own, those are clamped */
+	const std::vector<std::array<uint32_t, 3>> layouts = { { 1000, 700, 64 }, { 11 * 16, 5 * 16, 16 }, { 10 * 16 + 1, 6 * 16 + 1, 16 },
+															{ 4096, 4096, 128 }, { 100, 1, 8 }, { 64, 64, 64 } };
+	for (const auto& l : layouts) { testLayout(l[0], l[1], l[2]); }
+	for (const auto& l : layouts)
+	{
+		testCache(l[0], l[1], l[2], 4, 4, frames, rng);
+		testCache(l[0], l[1], l[2], 1, 3, frames / 4, rng);
+	}
+	testProtection();
+	JobSystem jobs{ 2 };
+	testFile(jobs);
+
+	if (failures > 0) { std::cout << failures << " check(s) failed\n"; return 1; }
+	std::cout << "all checks passed\n";
+	return 0;
+}